@@ -0,0 +1,600 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca & Marcel Gacoń
+ * AGH - Programowanie sieciowe
+ */
+
+/*
+ * Mikrobenchmarki funkcji gry i protokołu.
+ *
+ * Mierzy w izolacji, bez sieci, najgorętsze czyste funkcje: rejestrowanie strzałów,
+ * sprawdzanie końca gry, spłaszczanie planszy, parsowanie komunikatów serwera (tekst
+ * i ramki binarne) oraz budowanie pakietów TLV dla obserwatorów. Logika gry z gra.h
+ * działa na lokalnym GameState, a jej wysyłki trafiają do ujścia zamiast do gniazda.
+ *
+ * Jądra plansz (plansza.h) są mierzone osobno dla każdej implementacji obsługiwanej przez
+ * procesor (sufiks _scalar, _sse2, _avx2). Przed pomiarami benchmark sprawdza, że wersje
+ * SIMD dają te same wyniki co skalarna, i kończy się błędem, gdy się różnią.
+ *
+ * Rozmiar planszy jest stałą kompilacji, więc każdy rozmiar to osobna binarka:
+ *   gcc -O2 -DBOARD_SIZE=16 -o benchmark16 benchmark.c -pthread
+ * Nazwy wyników mają sufiks "/<rozmiar planszy>".
+ *
+ * Pomiar i format wyników naśladują Google Benchmark (te same nazwy opcji, plik JSON
+ * zgodny z jego tools/compare.py): liczba iteracji rośnie, aż pojedynczy przebieg trwa
+ * co najmniej --benchmark_min_time, a wynikiem jest mediana z --benchmark_repetitions
+ * przebiegów. --benchmark_baseline porównuje bieżący przebieg z zapisanym plikiem JSON.
+ */
+
+/* ===================== Includy i Definicje ===================== */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "gra.h"  // Logika gry (GameState) i protokół
+
+#define DEF_MIN_TIME     0.2    // Minimalny czas jednego przebiegu (s)
+#define DEF_REPETITIONS  3
+#define MAX_REPETITIONS  32
+#define MAX_ITERATIONS   1000000000L
+#define BOARD_CELLS      (BOARD_SIZE * BOARD_SIZE)
+
+#ifdef __OPTIMIZE__
+#define BUILD_TYPE "release"
+#else
+#define BUILD_TYPE "debug"
+#endif
+
+// Zapobiega usunięciu przez optymalizator obliczeń, których wynik nie jest używany
+#define DO_NOT_OPTIMIZE(value) __asm__ volatile("" : : "g"(value) : "memory")
+#define CLOBBER_MEMORY()       __asm__ volatile("" : : : "memory")
+
+typedef void (*BenchFn)(long iterations);
+
+typedef struct {
+    const char *name;
+    BenchFn fn;
+    const char *kernels;  // Implementacja jąder plansz mierzona przez fn (NULL - bez jąder)
+} Benchmark;
+
+typedef struct {
+    char name[64];
+    long iterations;
+    double real_ns;   // Mediana czasu na iterację
+    double cpu_ns;
+} BenchResult;
+
+/* ===================== Dane Testowe ===================== */
+static GameState fixture;                           // Plansza z rozstawioną flotą
+static GameState game;                              // Stan modyfikowany przez benchmark
+static int shot_order[BOARD_CELLS];                 // Kolejność strzałów (permutacja pól)
+static char fire_lines[BOARD_CELLS][32];            // "FIRE x y enemy" dla każdego pola
+static char hit_lines[BOARD_CELLS][32];             // "HIT x y enemy"
+static unsigned char fire_frames[BOARD_CELLS][PROTO_SHOT_SIZE];
+static char board_cells[BOARD_CELLS];
+static unsigned long long sent_bytes;
+static char kernel_board[BOARD_CELLS];              // Plansza po połowie strzałów (do różnic z board_cells)
+static unsigned long long kernel_mask[BOARD_MASK_WORDS(BOARD_CELLS)];
+static unsigned char kernel_packed[BOARD_PACKED_LEN(BOARD_CELLS)];
+static const BoardKernels *kernels;                 // Implementacja mierzona przez bm_kernel_*
+
+// Ujście wysyłek gry zamiast gniazda
+static int bench_transport(GameState *g, const void *data, int length) {
+    (void)g;
+    DO_NOT_OPTIMIZE(data);
+    sent_bytes += length;
+    return 0;
+}
+
+static void setup_fixture(void) {
+    unsigned seed = 12345;
+    gameInit(&fixture, -1, "me");
+    fixture.quiet = 1;
+    fixture.transport = bench_transport;
+    fixture.amFirstPlayer = 1;
+    fixture.gameStarted = 1;
+    placeShipsRandomly(&fixture, &seed);
+
+    for (int i = 0; i < BOARD_CELLS; i++)
+        shot_order[i] = i;
+    for (int i = BOARD_CELLS - 1; i > 0; i--) {
+        int j = rand_r(&seed) % (i + 1);
+        int t = shot_order[i];
+        shot_order[i] = shot_order[j];
+        shot_order[j] = t;
+    }
+    for (int i = 0; i < BOARD_CELLS; i++) {
+        int x = shot_order[i] / BOARD_SIZE, y = shot_order[i] % BOARD_SIZE;
+        snprintf(fire_lines[i], sizeof(fire_lines[i]), "FIRE %d %d enemy", x, y);
+        snprintf(hit_lines[i], sizeof(hit_lines[i]), "HIT %d %d enemy", x, y);
+        proto_shot(fire_frames[i], PROTO_FIRE, x, y, 1);
+    }
+    for (int i = 0; i < BOARD_CELLS; i++)
+        board_cells[i] = proto_cells[rand_r(&seed) % 4];
+    memcpy(kernel_board, board_cells, BOARD_CELLS);
+    for (int i = 0; i < BOARD_CELLS / 2; i++)
+        kernel_board[shot_order[i]] = proto_cells[rand_r(&seed) % 4];
+    board_impls[0].diff(board_cells, kernel_board, BOARD_CELLS, kernel_mask);
+    board_impls[0].pack(board_cells, BOARD_CELLS, kernel_packed);
+}
+
+// Świeża plansza przed serią strzałów - wszystkie pola znów nieostrzelane
+static void reset_game(void) {
+    game = fixture;
+}
+
+/* ===================== Benchmarki ===================== */
+// Strzał przeciwnika w moją planszę; co BOARD_CELLS strzałów plansza wraca do stanu początkowego
+static void bm_register_hit_or_miss(long iterations) {
+    reset_game();
+    for (long i = 0, k = 0; i < iterations; i++) {
+        int cell = shot_order[k];
+        DO_NOT_OPTIMIZE(registerHitOrMiss(&game, cell / BOARD_SIZE, cell % BOARD_SIZE));
+        if (++k == BOARD_CELLS) {
+            k = 0;
+            reset_game();
+        }
+    }
+}
+
+// Sprawdzenie końca gry na planszy z połową pól ostrzelanych
+static void bm_all_my_ships_are_hit(long iterations) {
+    reset_game();
+    for (int k = 0; k < BOARD_CELLS / 2; k++)
+        registerHitOrMiss(&game, shot_order[k] / BOARD_SIZE, shot_order[k] % BOARD_SIZE);
+    for (long i = 0; i < iterations; i++) {
+        CLOBBER_MEMORY();
+        DO_NOT_OPTIMIZE(allMyShipsAreHit(&game));
+    }
+}
+
+static void bm_flatten_board(long iterations) {
+    char flat[BOARD_CELLS + 1];
+    reset_game();
+    for (long i = 0; i < iterations; i++) {
+        flattenBoard(&game, flat);
+        DO_NOT_OPTIMIZE(flat);
+    }
+}
+
+// Linia "FIRE x y enemy" od rozpoznania czasownika do odpowiedzi HIT/MISS
+static void bm_parse_fire(long iterations) {
+    reset_game();
+    for (long i = 0, k = 0; i < iterations; i++) {
+        const char *args;
+        int id = command_find(&server_messages, fire_lines[k], &args);
+        DO_NOT_OPTIMIZE(parseBattleshipMessage(&game, id, args));
+        if (++k == BOARD_CELLS) {
+            k = 0;
+            reset_game();
+        }
+    }
+}
+
+// Wynik mojego strzału "HIT x y enemy"
+static void bm_parse_hit(long iterations) {
+    reset_game();
+    for (long i = 0, k = 0; i < iterations; i++) {
+        const char *args;
+        int id = command_find(&server_messages, hit_lines[k], &args);
+        DO_NOT_OPTIMIZE(parseBattleshipMessage(&game, id, args));
+        if (++k == BOARD_CELLS) {
+            k = 0;
+            reset_game();
+        }
+    }
+}
+
+// Zmiana tury - obejmuje wysłanie planszy (BOARD0) do serwera
+static void bm_parse_next_turn(long iterations) {
+    reset_game();
+    for (long i = 0; i < iterations; i++) {
+        const char *args;
+        int id = command_find(&server_messages, (i & 1) ? "NEXT_TURN me" : "NEXT_TURN enemy", &args);
+        DO_NOT_OPTIMIZE(parseBattleshipMessage(&game, id, args));
+    }
+}
+
+// Zmiana tury z przyrostowymi planszami - niezmieniona plansza nie jest wysyłana
+static void bm_parse_next_turn_delta(long iterations) {
+    reset_game();
+    gameProtocolAccepted(&game, PROTO_CAP_DELTA);
+    for (long i = 0; i < iterations; i++) {
+        const char *args;
+        int id = command_find(&server_messages, (i & 1) ? "NEXT_TURN me" : "NEXT_TURN enemy", &args);
+        DO_NOT_OPTIMIZE(parseBattleshipMessage(&game, id, args));
+    }
+}
+
+// Ramka FIRE w protokole binarnym
+static void bm_parse_fire_frame(long iterations) {
+    reset_game();
+    game.binaryProtocol = 1;
+    for (long i = 0, k = 0; i < iterations; i++) {
+        parseBattleshipFrame(&game, fire_frames[k], PROTO_SHOT_SIZE);
+        CLOBBER_MEMORY();
+        if (++k == BOARD_CELLS) {
+            k = 0;
+            reset_game();
+            game.binaryProtocol = 1;
+        }
+    }
+}
+
+// Zmiana tury w protokole binarnym - wysłanie planszy jako ramki BOARD
+static void bm_parse_next_turn_frame(long iterations) {
+    unsigned char frames[2][PROTO_TURN_SIZE];
+    proto_next_turn(frames[0], 0);
+    proto_next_turn(frames[1], 1);
+    reset_game();
+    game.binaryProtocol = 1;
+    for (long i = 0; i < iterations; i++) {
+        parseBattleshipFrame(&game, frames[i & 1], PROTO_TURN_SIZE);
+        CLOBBER_MEMORY();
+    }
+}
+
+// Pakowanie i rozpakowanie ramki BOARD (zawsze 64 pola)
+static void bm_proto_board(long iterations) {
+    unsigned char frame[PROTO_BOARD_SIZE];
+    char cells[PROTO_BOARD_CELLS];
+    for (long i = 0; i < iterations; i++) {
+        proto_board(frame, 0, board_cells);
+        proto_unpack_board(frame, cells);
+        DO_NOT_OPTIMIZE(cells);
+    }
+}
+
+// Pakiety TLV obu plansz dla obserwatora (jak send_board_update_to_observers)
+static void bm_tlv_board_packets(long iterations) {
+    unsigned char packet[2 * (TLV_HEADER_SIZE + BOARD_CELLS)];
+    for (long i = 0; i < iterations; i++) {
+        int len = tlv_board_packet(packet, TLV_BOARD_PLAYER0, board_cells, BOARD_CELLS);
+        len += tlv_board_packet(packet + len, TLV_BOARD_PLAYER1, board_cells, BOARD_CELLS);
+        DO_NOT_OPTIMIZE(packet);
+        DO_NOT_OPTIMIZE(len);
+    }
+}
+
+// Rozpoznanie czasownika w rejestrze komunikatów
+static void bm_command_find(long iterations) {
+    static const char *lines[4] = { "NEXT_TURN enemy", "FIRE 3 4 enemy", "PING", "hello there" };
+    for (long i = 0; i < iterations; i++) {
+        const char *args;
+        DO_NOT_OPTIMIZE(command_find(&server_messages, lines[i & 3], &args));
+    }
+}
+
+// Jądra plansz (plansza.h) na całej planszy BOARD_SIZE x BOARD_SIZE
+static void bm_kernel_diff(long iterations) {
+    for (long i = 0; i < iterations; i++) {
+        kernels->diff(board_cells, kernel_board, BOARD_CELLS, kernel_mask);
+        DO_NOT_OPTIMIZE(kernel_mask);
+    }
+}
+
+static void bm_kernel_count(long iterations) {
+    int counts[BOARD_STATES];
+    for (long i = 0; i < iterations; i++) {
+        kernels->count(board_cells, BOARD_CELLS, counts);
+        DO_NOT_OPTIMIZE(counts);
+    }
+}
+
+static void bm_kernel_pack(long iterations) {
+    unsigned char packed[BOARD_PACKED_LEN(BOARD_CELLS)];
+    for (long i = 0; i < iterations; i++) {
+        kernels->pack(board_cells, BOARD_CELLS, packed);
+        DO_NOT_OPTIMIZE(packed);
+    }
+}
+
+static void bm_kernel_unpack(long iterations) {
+    char cells[BOARD_CELLS];
+    for (long i = 0; i < iterations; i++) {
+        kernels->unpack(kernel_packed, BOARD_CELLS, cells);
+        DO_NOT_OPTIMIZE(cells);
+    }
+}
+
+static void bm_kernel_render(long iterations) {
+    char cells[BOARD_CELLS];
+    for (long i = 0; i < iterations; i++) {
+        kernels->render(kernel_mask, BOARD_CELLS, HIT_SHIP, EMPTY_CELL, cells);
+        DO_NOT_OPTIMIZE(cells);
+    }
+}
+
+static const Benchmark benchmarks[] = {
+    { "registerHitOrMiss",                 bm_register_hit_or_miss, NULL },
+    { "allMyShipsAreHit",                  bm_all_my_ships_are_hit, NULL },
+    { "flattenBoard",                      bm_flatten_board, NULL },
+    { "parseBattleshipMessage_FIRE",       bm_parse_fire,    NULL },
+    { "parseBattleshipMessage_HIT",        bm_parse_hit,     NULL },
+    { "parseBattleshipMessage_NEXT_TURN",  bm_parse_next_turn, NULL },
+    { "parseBattleshipMessage_NEXT_TURN_delta", bm_parse_next_turn_delta, NULL },
+    { "parseBattleshipFrame_FIRE",         bm_parse_fire_frame, NULL },
+    { "parseBattleshipFrame_NEXT_TURN",    bm_parse_next_turn_frame, NULL },
+    { "proto_board_pack_unpack",           bm_proto_board,   NULL },
+    { "tlv_board_packets",                 bm_tlv_board_packets, NULL },
+    { "command_find",                      bm_command_find,  NULL },
+    { "board_diff_scalar",                 bm_kernel_diff,   "scalar" },
+    { "board_diff_sse2",                   bm_kernel_diff,   "sse2" },
+    { "board_diff_avx2",                   bm_kernel_diff,   "avx2" },
+    { "board_count_scalar",                bm_kernel_count,  "scalar" },
+    { "board_count_sse2",                  bm_kernel_count,  "sse2" },
+    { "board_count_avx2",                  bm_kernel_count,  "avx2" },
+    { "board_pack_scalar",                 bm_kernel_pack,   "scalar" },
+    { "board_pack_sse2",                   bm_kernel_pack,   "sse2" },
+    { "board_pack_avx2",                   bm_kernel_pack,   "avx2" },
+    { "board_unpack_scalar",               bm_kernel_unpack, "scalar" },
+    { "board_unpack_sse2",                 bm_kernel_unpack, "sse2" },
+    { "board_unpack_avx2",                 bm_kernel_unpack, "avx2" },
+    { "board_render_scalar",               bm_kernel_render, "scalar" },
+    { "board_render_sse2",                 bm_kernel_render, "sse2" },
+    { "board_render_avx2",                 bm_kernel_render, "avx2" },
+};
+#define BENCHMARK_COUNT ((int)(sizeof(benchmarks) / sizeof(benchmarks[0])))
+
+/* ===================== Zgodność Jąder ===================== */
+#define CHECK_MAX_CELLS  (BOARD_CELLS + 200)
+
+// Porównuje implementację 'k' ze skalarną na losowych planszach różnej długości
+// (także z nieznanymi znakami i niewyrównanym początkiem). Zwraca liczbę różnic.
+static int check_kernels(const BoardKernels *k) {
+    static const char alphabet[] = ".OX=?";
+    const BoardKernels *ref = &board_impls[0];
+    char a[CHECK_MAX_CELLS + 1], b[CHECK_MAX_CELLS + 1], out_ref[CHECK_MAX_CELLS], out[CHECK_MAX_CELLS];
+    unsigned long long mask_ref[BOARD_MASK_WORDS(CHECK_MAX_CELLS)], mask[BOARD_MASK_WORDS(CHECK_MAX_CELLS)];
+    unsigned char packed_ref[BOARD_PACKED_LEN(CHECK_MAX_CELLS)], packed[BOARD_PACKED_LEN(CHECK_MAX_CELLS)];
+    unsigned seed = 777;
+    int errors = 0;
+    for (int n = 0; n <= CHECK_MAX_CELLS; n++) {
+        int off = n % 2;
+        for (int i = 0; i < n + off; i++) {
+            a[i] = alphabet[rand_r(&seed) % 5];
+            b[i] = rand_r(&seed) % 4 ? a[i] : alphabet[rand_r(&seed) % 5];
+        }
+        int counts_ref[BOARD_STATES], counts[BOARD_STATES];
+        ref->diff(a + off, b + off, n, mask_ref);
+        k->diff(a + off, b + off, n, mask);
+        errors += memcmp(mask_ref, mask, sizeof(mask[0]) * BOARD_MASK_WORDS(n)) != 0;
+        ref->count(a + off, n, counts_ref);
+        k->count(a + off, n, counts);
+        errors += memcmp(counts_ref, counts, sizeof(counts)) != 0;
+        ref->pack(a + off, n, packed_ref);
+        k->pack(a + off, n, packed);
+        errors += memcmp(packed_ref, packed, BOARD_PACKED_LEN(n)) != 0;
+        for (int i = 0; i < BOARD_PACKED_LEN(n); i++)
+            packed[i] = (unsigned char)rand_r(&seed);
+        ref->unpack(packed, n, out_ref);
+        k->unpack(packed, n, out);
+        errors += memcmp(out_ref, out, n) != 0;
+        ref->render(mask_ref, n, HIT_SHIP, EMPTY_CELL, out_ref);
+        k->render(mask_ref, n, HIT_SHIP, EMPTY_CELL, out);
+        errors += memcmp(out_ref, out, n) != 0;
+    }
+    return errors;
+}
+
+// Sprawdza wszystkie dostępne implementacje; zwraca 0 albo -1 przy różnicy wyników
+static int check_all_kernels(void) {
+    int failed = 0;
+    printf("Board kernels:");
+    for (int i = 0; i < BOARD_IMPL_COUNT; i++) {
+        if (!board_impls[i].available())
+            continue;
+        int errors = i ? check_kernels(&board_impls[i]) : 0;
+        printf(" %s%s", board_impls[i].name, errors ? " (MISMATCH)" : "");
+        failed |= errors != 0;
+    }
+    printf(", dispatch: %s\n", board_kernels()->name);
+    if (failed)
+        fprintf(stderr, "[BENCH] SIMD board kernels differ from the scalar version\n");
+    return failed ? -1 : 0;
+}
+
+/* ===================== Pomiar ===================== */
+static double clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void run_timed(BenchFn fn, long iterations, double *real_ns, double *cpu_ns) {
+    double real0 = clock_ns(CLOCK_MONOTONIC), cpu0 = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+    fn(iterations);
+    *cpu_ns = clock_ns(CLOCK_THREAD_CPUTIME_ID) - cpu0;
+    *real_ns = clock_ns(CLOCK_MONOTONIC) - real0;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Dobiera liczbę iteracji do min_time, potem mierzy 'repetitions' przebiegów
+static void run_benchmark(const Benchmark *bm, double min_time, int repetitions, BenchResult *out) {
+    long iterations = 1;
+    double real_ns, cpu_ns;
+    for (;;) {
+        run_timed(bm->fn, iterations, &real_ns, &cpu_ns);
+        if (real_ns >= min_time * 1e9 || iterations >= MAX_ITERATIONS)
+            break;
+        // Jak w Google Benchmark: cel z 40% zapasem, najwyżej 10x na krok
+        double factor = real_ns > 0 ? (min_time * 1e9 * 1.4) / real_ns : 10.0;
+        if (factor > 10.0)
+            factor = 10.0;
+        long next = (long)(iterations * factor) + 1;
+        iterations = next > MAX_ITERATIONS ? MAX_ITERATIONS : next;
+    }
+    double real[MAX_REPETITIONS], cpu[MAX_REPETITIONS];
+    for (int r = 0; r < repetitions; r++) {
+        run_timed(bm->fn, iterations, &real_ns, &cpu_ns);
+        real[r] = real_ns / iterations;
+        cpu[r] = cpu_ns / iterations;
+    }
+    qsort(real, repetitions, sizeof(double), compare_double);
+    qsort(cpu, repetitions, sizeof(double), compare_double);
+    snprintf(out->name, sizeof(out->name), "%s/%d", bm->name, BOARD_SIZE);
+    out->iterations = iterations;
+    out->real_ns = real[repetitions / 2];
+    out->cpu_ns = cpu[repetitions / 2];
+}
+
+/* ===================== Wyniki JSON ===================== */
+static int write_json(const char *path, const BenchResult *results, int count, int repetitions) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror("[BENCH] fopen");
+        return -1;
+    }
+    char date[64], host[64] = "unknown";
+    time_t now = time(NULL);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+    gethostname(host, sizeof(host) - 1);
+    fprintf(f, "{\n  \"context\": {\n");
+    fprintf(f, "    \"date\": \"%s\",\n", date);
+    fprintf(f, "    \"host_name\": \"%s\",\n", host);
+    fprintf(f, "    \"executable\": \"benchmark\",\n");
+    fprintf(f, "    \"num_cpus\": %ld,\n", sysconf(_SC_NPROCESSORS_ONLN));
+    fprintf(f, "    \"board_size\": %d,\n", BOARD_SIZE);
+    fprintf(f, "    \"repetitions\": %d,\n", repetitions);
+    fprintf(f, "    \"compiler\": \"%s\",\n", __VERSION__);
+    fprintf(f, "    \"library_build_type\": \"%s\"\n", BUILD_TYPE);
+    fprintf(f, "  },\n  \"benchmarks\": [\n");
+    for (int i = 0; i < count; i++) {
+        const BenchResult *r = &results[i];
+        fprintf(f, "    {\n");
+        fprintf(f, "      \"name\": \"%s\",\n", r->name);
+        fprintf(f, "      \"run_name\": \"%s\",\n", r->name);
+        fprintf(f, "      \"run_type\": \"iteration\",\n");
+        fprintf(f, "      \"iterations\": %ld,\n", r->iterations);
+        fprintf(f, "      \"real_time\": %.4f,\n", r->real_ns);
+        fprintf(f, "      \"cpu_time\": %.4f,\n", r->cpu_ns);
+        fprintf(f, "      \"time_unit\": \"ns\"\n");
+        fprintf(f, "    }%s\n", i + 1 < count ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+    return 0;
+}
+
+// Czyta real_time wyniku 'name' z pliku JSON zapisanego przez write_json
+static int baseline_lookup(const char *json, const char *name, double *real_ns) {
+    char key[96];
+    snprintf(key, sizeof(key), "\"name\": \"%s\"", name);
+    const char *p = strstr(json, key);
+    if (!p)
+        return 0;
+    p = strstr(p, "\"real_time\":");
+    if (!p)
+        return 0;
+    *real_ns = strtod(p + strlen("\"real_time\":"), NULL);
+    return 1;
+}
+
+static char *read_file(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return NULL;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *data = malloc(size + 1);
+    if (data) {
+        size_t n = fread(data, 1, size, f);
+        data[n] = '\0';
+    }
+    fclose(f);
+    return data;
+}
+
+/* ===================== Funkcja main ===================== */
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options]\n", prog);
+    fprintf(stderr, "  --benchmark_filter=<substring>  run only benchmarks whose name contains it\n");
+    fprintf(stderr, "  --benchmark_min_time=<s>        minimum time per run (default %.1f)\n", DEF_MIN_TIME);
+    fprintf(stderr, "  --benchmark_repetitions=<n>     runs per benchmark, median is reported (default %d)\n", DEF_REPETITIONS);
+    fprintf(stderr, "  --benchmark_out=<file>          write results as JSON\n");
+    fprintf(stderr, "  --benchmark_baseline=<file>     compare with a JSON file from an earlier run\n");
+    fprintf(stderr, "  --benchmark_list_tests          list benchmark names and exit\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *filter = NULL, *out_path = NULL, *baseline_path = NULL;
+    double min_time = DEF_MIN_TIME;
+    int repetitions = DEF_REPETITIONS;
+    int list_only = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--benchmark_filter=", 19) == 0) {
+            filter = argv[i] + 19;
+        } else if (strncmp(argv[i], "--benchmark_min_time=", 21) == 0) {
+            min_time = atof(argv[i] + 21);  // Akceptuje też zapis "0.5s"
+        } else if (strncmp(argv[i], "--benchmark_repetitions=", 24) == 0) {
+            repetitions = atoi(argv[i] + 24);
+        } else if (strncmp(argv[i], "--benchmark_out=", 16) == 0) {
+            out_path = argv[i] + 16;
+        } else if (strncmp(argv[i], "--benchmark_baseline=", 21) == 0) {
+            baseline_path = argv[i] + 21;
+        } else if (strcmp(argv[i], "--benchmark_list_tests") == 0) {
+            list_only = 1;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (repetitions < 1)
+        repetitions = 1;
+    if (repetitions > MAX_REPETITIONS)
+        repetitions = MAX_REPETITIONS;
+    if (min_time <= 0)
+        min_time = DEF_MIN_TIME;
+
+    char *baseline = NULL;
+    if (baseline_path && !(baseline = read_file(baseline_path))) {
+        perror("[BENCH] Cannot read baseline");
+        return 1;
+    }
+
+    setup_fixture();
+    BenchResult results[BENCHMARK_COUNT];
+    int count = 0;
+    if (!list_only && check_all_kernels() < 0) {
+        free(baseline);
+        return 1;
+    }
+    if (!list_only) {
+        printf("Board size: %dx%d, repetitions: %d, min time: %.2f s\n", BOARD_SIZE, BOARD_SIZE, repetitions, min_time);
+        printf("%-42s %12s %12s %12s", "Benchmark", "Time (ns)", "CPU (ns)", "Iterations");
+        printf(baseline ? " %12s %9s\n" : "\n", "Base (ns)", "Change");
+    }
+    for (int i = 0; i < BENCHMARK_COUNT; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "%s/%d", benchmarks[i].name, BOARD_SIZE);
+        if (filter && !strstr(name, filter))
+            continue;
+        // Implementacja, której nie ma w tej binarce albo na tym procesorze, jest pomijana
+        if (benchmarks[i].kernels && !(kernels = board_impl_find(benchmarks[i].kernels)))
+            continue;
+        if (list_only) {
+            printf("%s\n", name);
+            continue;
+        }
+        BenchResult *r = &results[count++];
+        run_benchmark(&benchmarks[i], min_time, repetitions, r);
+        printf("%-42s %12.2f %12.2f %12ld", r->name, r->real_ns, r->cpu_ns, r->iterations);
+        double base;
+        if (baseline && baseline_lookup(baseline, r->name, &base) && base > 0)
+            printf(" %12.2f %+8.1f%%", base, (r->real_ns - base) / base * 100.0);
+        printf("\n");
+        fflush(stdout);
+    }
+    DO_NOT_OPTIMIZE(sent_bytes);
+    free(baseline);
+    if (out_path && count > 0 && write_json(out_path, results, count, repetitions) < 0)
+        return 1;
+    return 0;
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca & Marcel Gacoń
+ * AGH - Programowanie sieciowe
+ */
+
+#ifndef BLOKADY_H
+#define BLOKADY_H
+
+/*
+ * Profiler blokad: MUTEX_LOCK / MUTEX_UNLOCK zamiast pthread_mutex_lock / unlock.
+ *
+ * Z LOCK_PROFILING=1 (gcc -DLOCK_PROFILING=1) każde miejsce wywołania MUTEX_LOCK dostaje
+ * własne statystyki: liczbę pozyskań, liczbę pozyskań z czekaniem (nieudany trylock)
+ * oraz histogramy czasu czekania i trzymania blokady (kubełki jak w metryki.h).
+ * Czas trzymania jest przypisywany miejscu, które blokadę wzięło - zwolnienie odnajduje je
+ * na stosie blokad wątku, więc lock i unlock mogą być w różnych funkcjach.
+ * Statystyki trafiają do zrzutu metryk (--metrics), a przy zamykaniu serwera na stdout
+ * wypisywane są miejsca o najdłuższym łącznym czekaniu.
+ *
+ * Bez LOCK_PROFILING makra są zwykłymi wywołaniami pthread_mutex_lock / unlock.
+ */
+
+/* ===================== Includy ===================== */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "metryki.h"  // Kubełki histogramów i kwantyle
+
+#ifndef LOCK_PROFILING
+#define LOCK_PROFILING 0
+#endif
+
+#define LOCKPROF_TOP        10  // Ile najbardziej spornych miejsc wypisać
+#define LOCKPROF_MAX_HELD   8   // Głębokość stosu trzymanych blokad wątku
+
+#if LOCK_PROFILING
+
+/* ===================== Miejsca Wywołań ===================== */
+typedef struct LockSite {
+    const char *where;            // "plik:linia"
+    const char *lock;             // Wyrażenie blokady z kodu
+    int registered;
+    struct LockSite *next;        // Lista wszystkich miejsc (do zrzutu)
+    unsigned long long acquisitions;
+    unsigned long long contended;
+    MetricHistogram wait_ns;
+    MetricHistogram hold_ns;
+} LockSite;
+
+typedef struct {
+    pthread_mutex_t *mutex;
+    LockSite *site;
+    unsigned long long acquired_ns;
+} HeldLock;
+
+static LockSite *lockprof_sites;
+static __thread HeldLock lockprof_held[LOCKPROF_MAX_HELD];
+static __thread int lockprof_depth;
+
+#define LOCKPROF_STR2(x) #x
+#define LOCKPROF_STR(x)  LOCKPROF_STR2(x)
+
+#define MUTEX_LOCK(m) do { \
+        static LockSite lockprof_site_ = { __FILE__ ":" LOCKPROF_STR(__LINE__), #m, 0, NULL, 0, 0, { 0 }, { 0 } }; \
+        lockprof_lock(&lockprof_site_, (m)); \
+    } while (0)
+#define MUTEX_UNLOCK(m) lockprof_unlock(m)
+
+// Histogram współdzielony przez wątki (w przeciwieństwie do fragmentów metryki.h)
+static inline void lockprof_observe(MetricHistogram *h, unsigned long long value) {
+    __atomic_fetch_add(&h->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum, value, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->buckets[metric_bucket(value)], 1, __ATOMIC_RELAXED);
+}
+
+static void lockprof_register(LockSite *site) {
+    int expected = 0;
+    if (!__atomic_compare_exchange_n(&site->registered, &expected, 1, 0,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        return;
+    const char *base = strrchr(site->where, '/');  // Sama nazwa pliku, bez katalogu kompilacji
+    if (base)
+        site->where = base + 1;
+    LockSite *head = __atomic_load_n(&lockprof_sites, __ATOMIC_RELAXED);
+    do {
+        site->next = head;
+    } while (!__atomic_compare_exchange_n(&lockprof_sites, &head, site, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static inline void lockprof_lock(LockSite *site, pthread_mutex_t *mutex) {
+    if (__builtin_expect(!__atomic_load_n(&site->registered, __ATOMIC_ACQUIRE), 0))
+        lockprof_register(site);
+    unsigned long long waited = 0, acquired;
+    if (pthread_mutex_trylock(mutex) == 0) {
+        acquired = metric_now_ns();
+    } else {
+        unsigned long long start = metric_now_ns();
+        pthread_mutex_lock(mutex);
+        acquired = metric_now_ns();
+        waited = acquired - start;
+        __atomic_fetch_add(&site->contended, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&site->acquisitions, 1, __ATOMIC_RELAXED);
+    lockprof_observe(&site->wait_ns, waited);
+    if (lockprof_depth < LOCKPROF_MAX_HELD)
+        lockprof_held[lockprof_depth++] = (HeldLock){ mutex, site, acquired };
+}
+
+static inline void lockprof_unlock(pthread_mutex_t *mutex) {
+    for (int i = lockprof_depth - 1; i >= 0; i--) {
+        if (lockprof_held[i].mutex != mutex)
+            continue;
+        lockprof_observe(&lockprof_held[i].site->hold_ns, metric_now_ns() - lockprof_held[i].acquired_ns);
+        lockprof_held[i] = lockprof_held[--lockprof_depth];
+        break;
+    }
+    pthread_mutex_unlock(mutex);
+}
+
+/* ===================== Zrzut ===================== */
+static void lockprof_snapshot(const MetricHistogram *src, MetricHistogram *dst) {
+    dst->count = 0;
+    dst->sum = __atomic_load_n(&src->sum, __ATOMIC_RELAXED);
+    for (int b = 0; b < METRIC_BUCKETS; b++) {
+        dst->buckets[b] = __atomic_load_n(&src->buckets[b], __ATOMIC_RELAXED);
+        dst->count += dst->buckets[b];
+    }
+}
+
+static void lockprof_render_summary(FILE *out, const char *name, const LockSite *site,
+                                    const char *lock, const MetricHistogram *h) {
+    static const double quantiles[] = { 0.5, 0.99, 0.999 };
+    for (size_t q = 0; q < sizeof(quantiles) / sizeof(quantiles[0]); q++)
+        fprintf(out, METRICS_PREFIX "%s{site=\"%s\",lock=\"%s\",quantile=\"%g\"} %.9g\n", name,
+                site->where, lock, quantiles[q], metrics_quantile(h, quantiles[q]) * 1e-9);
+    fprintf(out, METRICS_PREFIX "%s_sum{site=\"%s\",lock=\"%s\"} %.9g\n", name, site->where, lock, h->sum * 1e-9);
+    fprintf(out, METRICS_PREFIX "%s_count{site=\"%s\",lock=\"%s\"} %llu\n", name, site->where, lock, h->count);
+}
+
+// Statystyki wszystkich miejsc w formacie Prometheusa
+static void lockprof_render(FILE *out) {
+    MetricHistogram *h = malloc(sizeof(MetricHistogram));
+    if (!h)
+        return;
+    fprintf(out, "# TYPE " METRICS_PREFIX "lock_acquisitions_total counter\n");
+    fprintf(out, "# TYPE " METRICS_PREFIX "lock_contended_total counter\n");
+    fprintf(out, "# TYPE " METRICS_PREFIX "lock_wait_seconds summary\n");
+    fprintf(out, "# TYPE " METRICS_PREFIX "lock_hold_seconds summary\n");
+    for (LockSite *s = __atomic_load_n(&lockprof_sites, __ATOMIC_ACQUIRE); s; s = s->next) {
+        const char *lock = s->lock[0] == '&' ? s->lock + 1 : s->lock;
+        fprintf(out, METRICS_PREFIX "lock_acquisitions_total{site=\"%s\",lock=\"%s\"} %llu\n", s->where, lock,
+                __atomic_load_n(&s->acquisitions, __ATOMIC_RELAXED));
+        fprintf(out, METRICS_PREFIX "lock_contended_total{site=\"%s\",lock=\"%s\"} %llu\n", s->where, lock,
+                __atomic_load_n(&s->contended, __ATOMIC_RELAXED));
+        lockprof_snapshot(&s->wait_ns, h);
+        lockprof_render_summary(out, "lock_wait_seconds", s, lock, h);
+        lockprof_snapshot(&s->hold_ns, h);
+        lockprof_render_summary(out, "lock_hold_seconds", s, lock, h);
+    }
+    free(h);
+}
+
+static int lockprof_cmp_wait(const void *a, const void *b) {
+    unsigned long long wa = (*(LockSite *const *)a)->wait_ns.sum, wb = (*(LockSite *const *)b)->wait_ns.sum;
+    return wa < wb ? 1 : wa > wb ? -1 : 0;
+}
+
+// Miejsca o najdłuższym łącznym czekaniu (komentarze - czytelne także w zrzucie metryk)
+static void lockprof_report_top(FILE *out) {
+    LockSite *sites[256];
+    int n = 0;
+    for (LockSite *s = __atomic_load_n(&lockprof_sites, __ATOMIC_ACQUIRE); s && n < 256; s = s->next)
+        sites[n++] = s;
+    qsort(sites, n, sizeof(sites[0]), lockprof_cmp_wait);
+    fprintf(out, "# Top contended lock sites (total wait, contended/acquisitions, mean hold)\n");
+    for (int i = 0; i < n && i < LOCKPROF_TOP; i++) {
+        LockSite *s = sites[i];
+        unsigned long long acq = __atomic_load_n(&s->acquisitions, __ATOMIC_RELAXED);
+        unsigned long long holds = __atomic_load_n(&s->hold_ns.count, __ATOMIC_RELAXED);
+        fprintf(out, "#  %-20s %-22s wait %10.3f ms  %llu/%llu  hold %8.3f us\n", s->where, s->lock,
+                __atomic_load_n(&s->wait_ns.sum, __ATOMIC_RELAXED) / 1e6,
+                __atomic_load_n(&s->contended, __ATOMIC_RELAXED), acq,
+                holds ? __atomic_load_n(&s->hold_ns.sum, __ATOMIC_RELAXED) / 1e3 / holds : 0.0);
+    }
+}
+
+#else  // !LOCK_PROFILING
+
+#define MUTEX_LOCK(m)   pthread_mutex_lock(m)
+#define MUTEX_UNLOCK(m) pthread_mutex_unlock(m)
+
+static inline void lockprof_render(FILE *out) { (void)out; }
+static inline void lockprof_report_top(FILE *out) { (void)out; }
+
+#endif // LOCK_PROFILING
+
+#endif // BLOKADY_H
@@ -0,0 +1,644 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca & Marcel Gacoń
+ * AGH - Programowanie sieciowe
+ */
+
+/*
+ * Bezobsługowy klient-bot i generator obciążenia.
+ *
+ * Otwiera wiele jednoczesnych sesji, każda z własnym stanem gry z gra.h (ta sama logika
+ * co w klient.c, w trybie cichym). Sesje łączą się w pary: twórca zakłada pokój, drugi
+ * gracz dołącza, obaj losowo rozstawiają flotę i rozgrywają pełne partie, po których
+ * wracają do lobby i zaczynają kolejną. Pary są rozdzielone między wątki robocze, każdy
+ * z własną pętlą epoll; para zawsze trafia do jednego wątku, więc numer pokoju twórca
+ * przekazuje drugiemu graczowi bez blokad.
+ *
+ * Na koniec bot raportuje połączenia i gry na sekundę oraz percentyle opóźnień:
+ *   connect - od connect() do "Username accepted",
+ *   shot    - od wysłania FIRE do powrotu tego strzału od serwera,
+ *   turn    - od wysłania FIRE do następnego NEXT_TURN (z odpowiedzią przeciwnika).
+ */
+
+/* ===================== Includy i Definicje ===================== */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+
+#include "gra.h"  // Logika gry w statki (stan sesji w GameState)
+
+#define DEF_SERVER_PORT  12345
+#define DEF_SESSIONS     1000
+#define DEF_DURATION     30      // Czas pomiaru w sekundach
+#define MAX_WORKERS      64
+#define BOT_RX_SIZE      4096
+#define BOT_EPOLL_BATCH  256
+
+// Stan sesji bota
+#define BOT_HANDSHAKE    0
+#define BOT_LOBBY        1
+#define BOT_ROOM         2
+#define BOT_CLOSED       3
+
+// Strategia wyboru pola do strzału
+#define POLICY_RANDOM    0   // Losowe nieostrzelane pole
+#define POLICY_SCAN      1   // Kolejne pola wierszami
+#define POLICY_HUNT      2   // Losowo, a po trafieniu sąsiednie pola
+
+/* ===================== Struktury Danych ===================== */
+typedef struct Bot {
+    GameState game;
+    char name[50];
+    struct Bot *peer;        // Drugi gracz z pary
+    int creator;             // Twórca pokoju w parze
+    int state;               // BOT_*
+    int pending_room;        // Pokój od twórcy, do którego trzeba dołączyć (-1 = brak)
+    char rx[BOT_RX_SIZE];    // Bufor odbiorczy - strumień dzielony na linie i ramki
+    int rx_len;
+    unsigned seed;
+    unsigned long long connect_start;
+    unsigned long long fire_at;    // Zaplanowany strzał po czasie do namysłu (0 = brak)
+    unsigned long long fire_sent;  // Wysłanie ostatniego FIRE
+    int awaiting_echo;       // Czekamy na powrót własnego FIRE
+    int awaiting_turn;       // Czekamy na NEXT_TURN po własnym strzale
+    int awaiting_result;     // Czekamy na HIT/MISS własnego strzału
+    int last_x, last_y;
+    int targets[BOARD_SIZE * BOARD_SIZE];  // Pola do sprawdzenia po trafieniu (POLICY_HUNT)
+    int target_count;
+} Bot;
+
+// Próbki opóźnień w mikrosekundach
+typedef struct {
+    unsigned *v;
+    size_t n;
+    size_t cap;
+} LatencyLog;
+
+typedef struct {
+    int id;
+    pthread_t thread;
+    int epoll_fd;
+    Bot *bots;
+    int count;
+    LatencyLog connect_lat;
+    LatencyLog shot_lat;
+    LatencyLog turn_lat;
+    unsigned long games;
+    unsigned long connect_failures;
+    unsigned long disconnects;
+    unsigned long long last_connect;   // Ostatni udany handshake (do połączeń na sekundę)
+} Worker;
+
+/* ===================== Zmienne Globalne ===================== */
+static struct sockaddr_in server_addr;
+static int session_count = DEF_SESSIONS;
+static int worker_count  = 0;
+static int duration      = DEF_DURATION;
+static int think_ms      = 0;
+static int policy        = POLICY_RANDOM;
+static int use_binary    = 0;
+static int use_deltas    = 0;
+static char name_prefix[24];
+static volatile int stop = 0;
+static Worker workers[MAX_WORKERS];
+
+/* ===================== Funkcje Pomocnicze ===================== */
+static unsigned long long now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void latency_add(LatencyLog *log, unsigned long long us) {
+    if (log->n == log->cap) {
+        size_t cap = log->cap ? log->cap * 2 : 4096;
+        unsigned *v = realloc(log->v, cap * sizeof(unsigned));
+        if (!v)
+            return;
+        log->v = v;
+        log->cap = cap;
+    }
+    log->v[log->n++] = us > 0xFFFFFFFFULL ? 0xFFFFFFFFU : (unsigned)us;
+}
+
+static int compare_unsigned(const void *a, const void *b) {
+    unsigned x = *(const unsigned *)a, y = *(const unsigned *)b;
+    return (x > y) - (x < y);
+}
+
+static unsigned percentile(const LatencyLog *log, double p) {
+    if (log->n == 0)
+        return 0;
+    size_t i = (size_t)(p * (log->n - 1) + 0.5);
+    return log->v[i];
+}
+
+/* ===================== Rozgrywka ===================== */
+// Wysyła komendę tekstową sesji
+static void bot_send(Bot *b, const char *line) {
+    char buf[BUFFER_SIZE];
+    snprintf(buf, sizeof(buf), "%s\n", line);
+    sendText(&b->game, buf);
+}
+
+static int bot_cell_free(const Bot *b, int x, int y) {
+    return validCoords(x, y) && b->game.myShots[x][y] == EMPTY_CELL;
+}
+
+// Wybiera pole do strzału według strategii; zwraca 0, gdy plansza jest już ostrzelana
+static int bot_pick_target(Bot *b, int *x, int *y) {
+    if (policy == POLICY_HUNT) {
+        while (b->target_count > 0) {
+            int cell = b->targets[--b->target_count];
+            if (bot_cell_free(b, cell / BOARD_SIZE, cell % BOARD_SIZE)) {
+                *x = cell / BOARD_SIZE;
+                *y = cell % BOARD_SIZE;
+                return 1;
+            }
+        }
+    }
+    int start = (policy == POLICY_SCAN) ? 0 : (int)(rand_r(&b->seed) % (BOARD_SIZE * BOARD_SIZE));
+    for (int i = 0; i < BOARD_SIZE * BOARD_SIZE; i++) {
+        int cell = (start + i) % (BOARD_SIZE * BOARD_SIZE);
+        if (bot_cell_free(b, cell / BOARD_SIZE, cell % BOARD_SIZE)) {
+            *x = cell / BOARD_SIZE;
+            *y = cell % BOARD_SIZE;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void bot_fire(Bot *b) {
+    int x, y;
+    b->fire_at = 0;
+    if (!b->game.gameStarted || !b->game.myTurn || !bot_pick_target(b, &x, &y))
+        return;
+    b->game.myTurn = 0;  // Do kolejnego NEXT_TURN nie strzelamy ponownie
+    b->last_x = x;
+    b->last_y = y;
+    b->awaiting_echo = b->awaiting_turn = b->awaiting_result = 1;
+    b->fire_sent = now_us();
+    sendShot(&b->game, PROTO_FIRE, x, y);
+}
+
+// Nasza tura: strzał od razu albo po czasie do namysłu
+static void bot_schedule_fire(Bot *b) {
+    if (!b->game.gameStarted || !b->game.myTurn)
+        return;
+    if (think_ms > 0)
+        b->fire_at = now_us() + (unsigned long long)think_ms * 1000;
+    else
+        bot_fire(b);
+}
+
+// Po trafieniu dokładamy sąsiednie pola (POLICY_HUNT)
+static void bot_on_my_result(Bot *b) {
+    b->awaiting_result = 0;
+    if (policy != POLICY_HUNT || b->game.myShots[b->last_x][b->last_y] != HIT_SHIP)
+        return;
+    static const int dx[4] = { -1, 1, 0, 0 }, dy[4] = { 0, 0, -1, 1 };
+    for (int k = 0; k < 4; k++) {
+        int x = b->last_x + dx[k], y = b->last_y + dy[k];
+        if (bot_cell_free(b, x, y) && b->target_count < BOARD_SIZE * BOARD_SIZE)
+            b->targets[b->target_count++] = x * BOARD_SIZE + y;
+    }
+}
+
+static void bot_try_join(Bot *b) {
+    if (b->state != BOT_LOBBY || b->pending_room < 0)
+        return;
+    char line[32];
+    snprintf(line, sizeof(line), "/join %d", b->pending_room);
+    b->pending_room = -1;
+    b->game.amFirstPlayer = 0;
+    bot_send(b, line);
+}
+
+// Sesja w lobby (po handshake lub po zakończonej grze)
+static void bot_enter_lobby(Bot *b) {
+    b->state = BOT_LOBBY;
+    b->fire_at = 0;
+    b->awaiting_echo = b->awaiting_turn = b->awaiting_result = 0;
+    b->target_count = 0;
+    if (b->creator) {
+        b->game.amFirstPlayer = 1;
+        bot_send(b, "/create");
+    } else {
+        bot_try_join(b);
+    }
+}
+
+// W pokoju: losowa flota, plansza dla serwera i gotowość
+static void bot_enter_room(Bot *b) {
+    b->state = BOT_ROOM;
+    placeShipsRandomly(&b->game, &b->seed);
+    sendBoardUpdate(&b->game);
+    bot_send(b, "/start");
+}
+
+static void bot_close(Worker *w, Bot *b) {
+    if (b->state == BOT_CLOSED)
+        return;
+    if (b->state == BOT_HANDSHAKE)
+        w->connect_failures++;
+    else if (!stop)
+        w->disconnects++;
+    b->state = BOT_CLOSED;
+    epoll_ctl(w->epoll_fd, EPOLL_CTL_DEL, b->game.socket, NULL);
+    close(b->game.socket);
+}
+
+// Obsługuje ramkę binarną (po "PROTOCOL bin")
+static void bot_on_frame(Worker *w, Bot *b, const unsigned char *frame, int length) {
+    int op = frame[0];
+    if (op == PROTO_FIRE && b->awaiting_echo) {
+        b->awaiting_echo = 0;
+        latency_add(&w->shot_lat, now_us() - b->fire_sent);
+    }
+    if (op == PROTO_NEXT_TURN && b->awaiting_turn) {
+        b->awaiting_turn = 0;
+        latency_add(&w->turn_lat, now_us() - b->fire_sent);
+    }
+    parseBattleshipFrame(&b->game, frame, length);
+    if ((op == PROTO_HIT || op == PROTO_MISS) && b->awaiting_result &&
+        b->game.myShots[b->last_x][b->last_y] != EMPTY_CELL)
+        bot_on_my_result(b);
+    if (op == PROTO_NEXT_TURN)
+        bot_schedule_fire(b);
+}
+
+// Obsługuje jedną linię tekstu od serwera
+static void bot_on_line(Worker *w, Bot *b, char *line) {
+    if (b->state == BOT_HANDSHAKE) {
+        if (strncmp(line, "Username accepted", 17) == 0) {
+            unsigned long long now = now_us();
+            latency_add(&w->connect_lat, now - b->connect_start);
+            w->last_connect = now;
+            b->state = BOT_LOBBY;
+        } else if (strncmp(line, "Username in use", 15) == 0 || strncmp(line, "Server full", 11) == 0) {
+            bot_close(w, b);
+        }
+        return;
+    }
+    const char *args;
+    int id = command_find(&server_messages, line, &args);
+    switch (id) {
+    case MSG_PING:
+        bot_send(b, "PONG");
+        return;
+    case MSG_PROTOCOL:
+        gameProtocolAccepted(&b->game, args);
+        return;
+    case MSG_RESUME_TOKEN:
+    case MSG_TLV_PORT:
+        return;
+    case MSG_FIRE:
+        if (b->awaiting_echo) {
+            b->awaiting_echo = 0;
+            latency_add(&w->shot_lat, now_us() - b->fire_sent);
+        }
+        break;
+    case MSG_NEXT_TURN:
+        if (b->awaiting_turn) {
+            b->awaiting_turn = 0;
+            latency_add(&w->turn_lat, now_us() - b->fire_sent);
+        }
+        break;
+    case MSG_NONE: {
+        int room;
+        if (b->creator && sscanf(line, "Room %d created by", &room) == 1) {
+            b->peer->pending_room = room;
+            bot_try_join(b->peer);
+        }
+        return;
+    }
+    }
+    parseBattleshipMessage(&b->game, id, args);
+    switch (id) {
+    case MSG_ENTERING_LOBBY:
+        bot_enter_lobby(b);
+        break;
+    case MSG_JOINED_ROOM:
+        bot_enter_room(b);
+        break;
+    case MSG_NEXT_TURN:
+        bot_schedule_fire(b);
+        break;
+    case MSG_HIT:
+    case MSG_MISS:
+        if (b->awaiting_result && b->game.myShots[b->last_x][b->last_y] != EMPTY_CELL)
+            bot_on_my_result(b);
+        break;
+    case MSG_YOU_WIN:
+        if (b->creator)
+            w->games++;  // Każdą grę liczymy raz - u twórcy pokoju
+        break;
+    }
+}
+
+// Wyjmuje z bufora kolejną linię lub ramkę; zwraca jej długość albo -1, gdy niekompletna
+static int bot_next_message(Bot *b, char *out, int size) {
+    while (b->rx_len > 0) {
+        unsigned char first = (unsigned char)b->rx[0];
+        int len, consumed;
+        if (b->game.binaryProtocol && proto_is_frame(first)) {
+            len = proto_frame_length((unsigned char *)b->rx, b->rx_len);
+            if (len < 0 || len > size) {
+                memmove(b->rx, b->rx + 1, --b->rx_len);  // Uszkodzona ramka - pomijamy bajt
+                continue;
+            }
+            if (len == 0 || len > b->rx_len)
+                return -1;
+            memcpy(out, b->rx, len);
+            consumed = len;
+        } else {
+            char *nl = memchr(b->rx, '\n', b->rx_len);
+            if (!nl)
+                return (b->rx_len >= size - 1) ? (b->rx_len = 0, -1) : -1;
+            len = (int)(nl - b->rx);
+            consumed = len + 1;
+            if (len > size - 1)
+                len = size - 1;
+            memcpy(out, b->rx, len);
+            if (len > 0 && out[len - 1] == '\r')
+                len--;
+            out[len] = '\0';
+        }
+        b->rx_len -= consumed;
+        memmove(b->rx, b->rx + consumed, b->rx_len);
+        return len;
+    }
+    return -1;
+}
+
+static void bot_on_readable(Worker *w, Bot *b) {
+    int n = recv(b->game.socket, b->rx + b->rx_len, sizeof(b->rx) - b->rx_len, 0);
+    if (n <= 0) {
+        if (n < 0 && errno == EINTR)
+            return;
+        bot_close(w, b);
+        return;
+    }
+    b->rx_len += n;
+    char line[BOT_RX_SIZE];
+    int len;
+    while (b->state != BOT_CLOSED && (len = bot_next_message(b, line, sizeof(line))) >= 0) {
+        if (b->game.binaryProtocol && len > 0 && proto_is_frame((unsigned char)line[0]))
+            bot_on_frame(w, b, (unsigned char *)line, len);
+        else
+            bot_on_line(w, b, line);
+    }
+}
+
+/* ===================== Wątek Roboczy ===================== */
+static int bot_connect(Worker *w, Bot *b) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    b->connect_start = now_us();
+    if (connect(fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    gameInit(&b->game, fd, b->name);
+    b->game.quiet = 1;
+    char hello[BUFFER_SIZE];
+    snprintf(hello, sizeof(hello), "HELLO %s %s%s%s\n", b->name,
+             use_binary ? PROTO_CAP_BINARY : "", use_binary && use_deltas ? "," : "",
+             use_deltas ? PROTO_CAP_DELTA : use_binary ? "" : "-");
+    if (sendText(&b->game, hello) < 0) {
+        close(fd);
+        return -1;
+    }
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = b };
+    epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+    return 0;
+}
+
+static void *worker_loop(void *arg) {
+    Worker *w = (Worker *)arg;
+    for (int i = 0; i < w->count && !stop; i++) {
+        Bot *b = &w->bots[i];
+        if (bot_connect(w, b) < 0) {
+            b->state = BOT_CLOSED;
+            w->connect_failures++;
+        }
+    }
+    struct epoll_event events[BOT_EPOLL_BATCH];
+    while (!stop) {
+        int timeout = (think_ms > 0) ? 1 : 100;
+        int n = epoll_wait(w->epoll_fd, events, BOT_EPOLL_BATCH, timeout);
+        for (int i = 0; i < n; i++)
+            bot_on_readable(w, (Bot *)events[i].data.ptr);
+        if (think_ms > 0) {
+            unsigned long long now = now_us();
+            for (int i = 0; i < w->count; i++) {
+                Bot *b = &w->bots[i];
+                if (b->fire_at && b->fire_at <= now && b->state == BOT_ROOM)
+                    bot_fire(b);
+            }
+        }
+    }
+    for (int i = 0; i < w->count; i++)
+        bot_close(w, &w->bots[i]);
+    return NULL;
+}
+
+/* ===================== Raport ===================== */
+static void merge_latency(LatencyLog *all, const LatencyLog *part) {
+    for (size_t i = 0; i < part->n; i++)
+        latency_add(all, part->v[i]);
+}
+
+static void print_latency(const char *label, LatencyLog *log) {
+    qsort(log->v, log->n, sizeof(unsigned), compare_unsigned);
+    printf("  %-8s %10zu %10u %10u %10u %10u\n", label, log->n,
+           percentile(log, 0.50), percentile(log, 0.99), percentile(log, 0.999),
+           log->n ? log->v[log->n - 1] : 0);
+}
+
+static void report(unsigned long long start, unsigned long long end) {
+    LatencyLog connect_lat = { 0 }, shot_lat = { 0 }, turn_lat = { 0 };
+    unsigned long games = 0, failures = 0, disconnects = 0;
+    unsigned long long last_connect = start;
+    for (int i = 0; i < worker_count; i++) {
+        Worker *w = &workers[i];
+        merge_latency(&connect_lat, &w->connect_lat);
+        merge_latency(&shot_lat, &w->shot_lat);
+        merge_latency(&turn_lat, &w->turn_lat);
+        games += w->games;
+        failures += w->connect_failures;
+        disconnects += w->disconnects;
+        if (w->last_connect > last_connect)
+            last_connect = w->last_connect;
+    }
+    double elapsed = (end - start) / 1e6;
+    double connect_time = (last_connect - start) / 1e6;
+    const char *policies[] = { "random", "scan", "hunt" };
+    printf("\n[BOT] Sessions: %d (%d pairs), workers: %d, policy: %s, think: %d ms, protocol: %s%s\n",
+           session_count, session_count / 2, worker_count, policies[policy], think_ms,
+           use_binary ? "binary" : "text", use_deltas ? " with board deltas" : "");
+    printf("[BOT] Connects: %zu in %.2f s (%.0f/s), failed: %lu, disconnected: %lu\n",
+           connect_lat.n, connect_time, connect_time > 0 ? connect_lat.n / connect_time : 0.0,
+           failures, disconnects);
+    printf("[BOT] Games: %lu in %.1f s (%.1f/s), shots: %zu (%.0f/s)\n",
+           games, elapsed, games / elapsed, shot_lat.n, shot_lat.n / elapsed);
+    printf("[BOT] Latency (us) %10s %10s %10s %10s %10s\n", "samples", "p50", "p99", "p99.9", "max");
+    print_latency("connect", &connect_lat);
+    print_latency("shot", &shot_lat);
+    print_latency("turn", &turn_lat);
+}
+
+/* ===================== Funkcja main ===================== */
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s --serverIP <address> [options]\n", prog);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --port N            server port (default %d)\n", DEF_SERVER_PORT);
+    fprintf(stderr, "  --sessions N        concurrent sessions, paired into games (default %d)\n", DEF_SESSIONS);
+    fprintf(stderr, "  --workers N         worker threads (default: one per core)\n");
+    fprintf(stderr, "  --duration S        measurement time in seconds (default %d)\n", DEF_DURATION);
+    fprintf(stderr, "  --think MS          think time before each shot (default 0)\n");
+    fprintf(stderr, "  --policy P          shot policy: random, scan or hunt (default random)\n");
+    fprintf(stderr, "  --bin               negotiate the binary game protocol\n");
+    fprintf(stderr, "  --delta             send board updates as versioned deltas\n");
+    fprintf(stderr, "  --prefix NAME       username prefix (default bot<pid>_)\n");
+}
+
+static void handle_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+int main(int argc, char *argv[]) {
+    const char *server_ip = NULL;
+    int port = DEF_SERVER_PORT;
+    snprintf(name_prefix, sizeof(name_prefix), "bot%d_", (int)getpid() % 100000);
+    worker_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--serverIP") == 0 && i + 1 < argc) {
+            server_ip = argv[++i];
+        } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--sessions") == 0 && i + 1 < argc) {
+            session_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            worker_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+            duration = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--think") == 0 && i + 1 < argc) {
+            think_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc) {
+            const char *p = argv[++i];
+            if (strcmp(p, "random") == 0) {
+                policy = POLICY_RANDOM;
+            } else if (strcmp(p, "scan") == 0) {
+                policy = POLICY_SCAN;
+            } else if (strcmp(p, "hunt") == 0) {
+                policy = POLICY_HUNT;
+            } else {
+                fprintf(stderr, "Unknown shot policy: %s\n", p);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--bin") == 0) {
+            use_binary = 1;
+        } else if (strcmp(argv[i], "--delta") == 0) {
+            use_deltas = 1;
+        } else if (strcmp(argv[i], "--prefix") == 0 && i + 1 < argc) {
+            strncpy(name_prefix, argv[++i], sizeof(name_prefix) - 1);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!server_ip) {
+        usage(argv[0]);
+        return 1;
+    }
+    session_count &= ~1;  // Sesje grają parami
+    if (session_count < 2)
+        session_count = 2;
+    if (worker_count < 1)
+        worker_count = 1;
+    if (worker_count > MAX_WORKERS)
+        worker_count = MAX_WORKERS;
+    if (worker_count > session_count / 2)
+        worker_count = session_count / 2;
+
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, server_ip, &server_addr.sin_addr) <= 0) {
+        fprintf(stderr, "Invalid server address: %s\n", server_ip);
+        return 1;
+    }
+
+    // Tysiące gniazd - podnosimy limit deskryptorów do maksimum
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, handle_signal);
+
+    // Para k trafia do wątku k % worker_count
+    Bot *bots = calloc(session_count, sizeof(Bot));
+    if (!bots) {
+        perror("[BOT] calloc");
+        return 1;
+    }
+    int pairs = session_count / 2;
+    int offset = 0;
+    for (int t = 0; t < worker_count; t++) {
+        Worker *w = &workers[t];
+        int worker_pairs = pairs / worker_count + (t < pairs % worker_count);
+        w->id = t;
+        w->bots = bots + offset;
+        w->count = worker_pairs * 2;
+        w->epoll_fd = epoll_create1(0);
+        if (w->epoll_fd < 0) {
+            perror("[BOT] epoll_create1");
+            return 1;
+        }
+        for (int i = 0; i < w->count; i++) {
+            Bot *b = &w->bots[i];
+            snprintf(b->name, sizeof(b->name), "%s%d", name_prefix, offset + i);
+            b->creator = (i % 2 == 0);
+            b->peer = &w->bots[i ^ 1];
+            b->pending_room = -1;
+            b->seed = (unsigned)(offset + i) * 2654435761u + (unsigned)getpid();
+        }
+        offset += w->count;
+    }
+
+    printf("[BOT] Starting %d sessions against %s:%d for %d s...\n", session_count, server_ip, port, duration);
+    unsigned long long start = now_us();
+    for (int t = 0; t < worker_count; t++) {
+        if (pthread_create(&workers[t].thread, NULL, worker_loop, &workers[t]) != 0) {
+            perror("[BOT] pthread_create");
+            return 1;
+        }
+    }
+    for (int s = 0; s < duration * 10 && !stop; s++)
+        usleep(100000);
+    stop = 1;
+    unsigned long long end = now_us();
+    for (int t = 0; t < worker_count; t++)
+        pthread_join(workers[t].thread, NULL);
+    report(start, end);
+    free(bots);
+    return 0;
+}
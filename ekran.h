@@ -0,0 +1,312 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca & Marcel Gacoń
+ * AGH - Programowanie sieciowe
+ */
+
+#ifndef EKRAN_H
+#define EKRAN_H
+
+/*
+ * Renderer plansz klienta. Ramka (wszystkie plansze zmienione od poprzedniej) jest
+ * składana w jednym buforze i wysyłana jednym write(), zamiast printf na każde pole.
+ *
+ * Tryby:
+ *   SCREEN_PLAIN - pełne plansze jedna pod drugą, jak zwykły tekst (potok, plik, TERM=dumb)
+ *   SCREEN_ANSI  - plansze stoją obok siebie u góry terminala, a komunikaty przewijają się
+ *                  pod nimi (obszar przewijania DECSTBM). Po pierwszym rysunku ramka
+ *                  przestawia kursor tylko na pola, które się zmieniły.
+ *   SCREEN_QUIET - plansz nie ma wcale (skrypty); komunikaty gry zostają
+ *
+ * Są dwa miejsca na plansze: gracz ma w nich swoją planszę i swoje strzały, obserwator -
+ * plansze obu graczy. Wątki odbioru gry i TLV rysują przez wspólny muteks.
+ */
+
+/* ===================== Includy ===================== */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+
+#include "plansza.h"  // Różnice plansz (board_diff)
+
+/* ===================== Definicje ===================== */
+#define SCREEN_SLOTS      2
+#define SCREEN_MAX_SIDE   32
+#define SCREEN_MAX_CELLS  (SCREEN_MAX_SIDE * SCREEN_MAX_SIDE)
+#define SCREEN_TITLE_LEN  64
+#define SCREEN_FRAME_SIZE (64 * 1024)  // Bufor ramki (pełny rysunek dwóch plansz 32x32 to ~9 KB)
+#define SCREEN_GAP        4            // Odstęp między planszami w trybie ANSI
+#define SCREEN_MIN_WIDTH  37           // Szerokość miejsca na planszę w ANSI (mieści tytuły gracza)
+#define SCREEN_MIN_LOG    3            // Najmniej wierszy na komunikaty pod planszami
+
+enum { SCREEN_PLAIN, SCREEN_ANSI, SCREEN_QUIET };
+
+typedef struct {
+    int mode;
+    int fd;
+    int side;                                    // Bok planszy
+    pthread_mutex_t lock;
+    // Stan do narysowania
+    char title[SCREEN_SLOTS][SCREEN_TITLE_LEN];
+    char cells[SCREEN_SLOTS][SCREEN_MAX_CELLS];
+    int dirty[SCREEN_SLOTS];
+    // Tryb ANSI: co jest teraz na ekranie
+    int rows;                                    // Wiersze terminala przy rysunku układu (0 = układu nie ma)
+    char shown_title[SCREEN_SLOTS][SCREEN_TITLE_LEN];
+    char shown[SCREEN_SLOTS][SCREEN_MAX_CELLS];
+    // Składana ramka
+    char frame[SCREEN_FRAME_SIZE];
+    size_t len;
+} Screen;
+
+static const char *screen_modes[] = { "plain", "ansi", "quiet" };
+
+// Tryb o danej nazwie albo -1
+static inline int screen_mode_find(const char *name) {
+    for (int i = 0; i < (int)(sizeof(screen_modes) / sizeof(screen_modes[0])); i++)
+        if (strcmp(screen_modes[i], name) == 0)
+            return i;
+    return -1;
+}
+
+// ANSI na terminalu, który je rozumie; zwykły tekst w potoku i pliku
+static inline int screen_mode_auto(int fd) {
+    const char *term = getenv("TERM");
+    return isatty(fd) && term && strcmp(term, "dumb") != 0 ? SCREEN_ANSI : SCREEN_PLAIN;
+}
+
+static inline void screen_init(Screen *s, int mode, int fd, int side) {
+    memset(s, 0, sizeof(*s));
+    s->mode = mode;
+    s->fd = fd;
+    s->side = side > SCREEN_MAX_SIDE ? SCREEN_MAX_SIDE : side;
+    pthread_mutex_init(&s->lock, NULL);
+    memset(s->cells, BOARD_CHAR_EMPTY, sizeof(s->cells));
+}
+
+/* ===================== Składanie Ramki ===================== */
+static inline void screen_put(Screen *s, const char *data, size_t len) {
+    if (len > sizeof(s->frame) - s->len)
+        len = sizeof(s->frame) - s->len;  // Nie zdarza się przy SCREEN_MAX_SIDE; ramka jest przycinana
+    memcpy(s->frame + s->len, data, len);
+    s->len += len;
+}
+
+static inline void screen_puts(Screen *s, const char *text) {
+    screen_put(s, text, strlen(text));
+}
+
+static inline void screen_printf(Screen *s, const char *format, ...) {
+    char text[128];
+    va_list ap;
+    va_start(ap, format);
+    int n = vsnprintf(text, sizeof(text), format, ap);
+    va_end(ap);
+    if (n > 0)
+        screen_put(s, text, n < (int)sizeof(text) ? (size_t)n : sizeof(text) - 1);
+}
+
+static inline void screen_move(Screen *s, int row, int col) {
+    screen_printf(s, "\033[%d;%dH", row, col);
+}
+
+// Wysyła złożoną ramkę jednym write() (pętla tylko przy częściowym zapisie)
+static inline void screen_write(Screen *s) {
+    fflush(stdout);  // Tekst wypisany wcześniej przez stdio ma być przed ramką
+    size_t off = 0;
+    while (off < s->len) {
+        ssize_t n = write(s->fd, s->frame + off, s->len - off);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        off += (size_t)n;
+    }
+    s->len = 0;
+}
+
+/* ===================== Tryb Zwykły ===================== */
+static inline void screen_plain_board(Screen *s, int slot) {
+    char line[3 * SCREEN_MAX_SIDE + 8];
+    screen_printf(s, "\n--- %s ---\n  ", s->title[slot]);
+    for (int j = 0; j < s->side; j++)
+        screen_printf(s, "%d ", j);
+    screen_puts(s, "\n");
+    for (int i = 0; i < s->side; i++) {
+        int n = snprintf(line, sizeof(line), "%d ", i);
+        for (int j = 0; j < s->side; j++) {
+            line[n++] = s->cells[slot][i * s->side + j];
+            line[n++] = ' ';
+        }
+        line[n++] = '\n';
+        screen_put(s, line, n);
+    }
+    screen_puts(s, "\n");
+}
+
+/* ===================== Tryb ANSI ===================== */
+// Wysokość obszaru plansz: tytuł, numery kolumn, wiersze planszy i pusty wiersz
+static inline int screen_ansi_height(const Screen *s) {
+    return s->side + 3;
+}
+
+// Szerokość miejsca na planszę: "NN " i po dwa znaki na pole, ale nie mniej niż tytuł
+static inline int screen_ansi_width(const Screen *s) {
+    int width = 3 + 2 * s->side;
+    return width < SCREEN_MIN_WIDTH ? SCREEN_MIN_WIDTH : width;
+}
+
+// Kolumna, od której zaczyna się plansza 'slot'
+static inline int screen_ansi_left(const Screen *s, int slot) {
+    return 1 + slot * (screen_ansi_width(s) + SCREEN_GAP);
+}
+
+static inline void screen_ansi_title(Screen *s, int slot) {
+    int width = screen_ansi_width(s);
+    screen_move(s, 1, screen_ansi_left(s, slot));
+    screen_printf(s, "%-*.*s", width, width, s->title[slot]);
+    memcpy(s->shown_title[slot], s->title[slot], SCREEN_TITLE_LEN);
+}
+
+// Cała plansza na swoim miejscu
+static inline void screen_ansi_board(Screen *s, int slot) {
+    char line[3 * SCREEN_MAX_SIDE + 8];
+    int left = screen_ansi_left(s, slot);
+    screen_ansi_title(s, slot);
+    screen_move(s, 2, left);
+    screen_puts(s, "   ");
+    for (int j = 0; j < s->side; j++)
+        screen_printf(s, "%d ", j % 10);
+    for (int i = 0; i < s->side; i++) {
+        int n = snprintf(line, sizeof(line), "%2d ", i);
+        for (int j = 0; j < s->side; j++) {
+            line[n++] = s->cells[slot][i * s->side + j];
+            line[n++] = ' ';
+        }
+        screen_move(s, 3 + i, left);
+        screen_put(s, line, n);
+    }
+    memcpy(s->shown[slot], s->cells[slot], (size_t)s->side * s->side);
+}
+
+// Tylko pola różne od tych na ekranie
+static inline void screen_ansi_changes(Screen *s, int slot) {
+    unsigned long long mask[BOARD_MASK_WORDS(SCREEN_MAX_CELLS)];
+    int cells = s->side * s->side;
+    if (strcmp(s->shown_title[slot], s->title[slot]) != 0)
+        screen_ansi_title(s, slot);
+    board_diff(s->shown[slot], s->cells[slot], cells, mask);
+    int left = screen_ansi_left(s, slot);
+    for (int w = 0; w < BOARD_MASK_WORDS(cells); w++) {
+        for (unsigned long long m = mask[w]; m; m &= m - 1) {
+            int i = w * 64 + __builtin_ctzll(m);
+            screen_move(s, 3 + i / s->side, left + 3 + 2 * (i % s->side));
+            screen_put(s, &s->cells[slot][i], 1);
+            s->shown[slot][i] = s->cells[slot][i];
+        }
+    }
+}
+
+// Wiersze terminala (0, gdy nie da się ich ustalić)
+static inline int screen_rows(const Screen *s) {
+    struct winsize ws;
+    return ioctl(s->fd, TIOCGWINSZ, &ws) == 0 ? ws.ws_row : 0;
+}
+
+// Układ od nowa: czyści ekran, rysuje obie plansze i zostawia pod nimi obszar przewijania
+static inline void screen_ansi_layout(Screen *s, int rows) {
+    screen_puts(s, "\033[r\033[H\033[2J");
+    for (int slot = 0; slot < SCREEN_SLOTS; slot++)
+        screen_ansi_board(s, slot);
+    screen_printf(s, "\033[%d;%dr", screen_ansi_height(s) + 1, rows);
+    screen_move(s, rows, 1);
+    s->rows = rows;
+}
+
+static inline void screen_ansi_frame(Screen *s) {
+    int rows = screen_rows(s);
+    if (rows < screen_ansi_height(s) + SCREEN_MIN_LOG) {
+        // Terminal za niski na stałe plansze - rysujemy jak tekst, układ wróci po powiększeniu
+        if (s->rows)
+            screen_puts(s, "\033[r");
+        s->rows = 0;
+        for (int slot = 0; slot < SCREEN_SLOTS; slot++)
+            if (s->dirty[slot])
+                screen_plain_board(s, slot);
+        return;
+    }
+    if (rows != s->rows) {
+        screen_ansi_layout(s, rows);
+        return;
+    }
+    size_t start = s->len;
+    screen_puts(s, "\0337");  // Zapamiętanie kursora - po ramce wraca do obszaru komunikatów
+    for (int slot = 0; slot < SCREEN_SLOTS; slot++)
+        if (s->dirty[slot])
+            screen_ansi_changes(s, slot);
+    if (s->len == start + 2)
+        s->len = start;  // Nic się nie zmieniło
+    else
+        screen_puts(s, "\0338");
+}
+
+/* ===================== Interfejs ===================== */
+// Zapamiętuje planszę do narysowania w miejscu 'slot' (side*side znaków)
+static inline void screen_board(Screen *s, int slot, const char *title, const char *cells) {
+    if (s->mode == SCREEN_QUIET || slot < 0 || slot >= SCREEN_SLOTS)
+        return;
+    pthread_mutex_lock(&s->lock);
+    snprintf(s->title[slot], SCREEN_TITLE_LEN, "%s", title);
+    memcpy(s->cells[slot], cells, (size_t)s->side * s->side);
+    s->dirty[slot] = 1;
+    pthread_mutex_unlock(&s->lock);
+}
+
+// Rysuje plansze zapamiętane od poprzedniej ramki
+static inline void screen_flush(Screen *s) {
+    if (s->mode == SCREEN_QUIET)
+        return;
+    pthread_mutex_lock(&s->lock);
+    if (s->mode == SCREEN_ANSI) {
+        screen_ansi_frame(s);
+    } else {
+        for (int slot = 0; slot < SCREEN_SLOTS; slot++)
+            if (s->dirty[slot])
+                screen_plain_board(s, slot);
+    }
+    memset(s->dirty, 0, sizeof(s->dirty));
+    screen_write(s);
+    pthread_mutex_unlock(&s->lock);
+}
+
+// Bajty pakietu szesnastkowo, w jednym zapisie (tylko tryb zwykły - w ANSI plansza
+// zmienia się w miejscu, a dodatkowy tekst by ją przewijał)
+static inline void screen_hexdump(Screen *s, const unsigned char *data, int len) {
+    if (s->mode != SCREEN_PLAIN)
+        return;
+    pthread_mutex_lock(&s->lock);
+    for (int i = 0; i < len; i++)
+        screen_printf(s, "%02X ", data[i]);
+    screen_puts(s, "\n");
+    screen_write(s);
+    pthread_mutex_unlock(&s->lock);
+}
+
+// Przywraca przewijanie całego terminala (przy wyjściu z klienta)
+static inline void screen_close(Screen *s) {
+    if (s->mode != SCREEN_ANSI || !s->rows)
+        return;
+    pthread_mutex_lock(&s->lock);
+    screen_puts(s, "\033[r");
+    screen_move(s, s->rows, 1);
+    screen_puts(s, "\n");
+    screen_write(s);
+    s->rows = 0;
+    pthread_mutex_unlock(&s->lock);
+}
+
+#endif // EKRAN_H
@@ -10,83 +10,144 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
 #include <unistd.h>
 #include <arpa/inet.h>
 
-/* ===================== Definicje i Zmienne Globalne ===================== */
-extern int server_socket;  // Globalny socket serwera (definiowany w klient.c)
+#include "protokol.h"  // Binarne ramki gry (po potwierdzeniu "PROTOCOL bin")
+#include "komendy.h"   // Rejestr komunikatów serwera i role
 
+/* ===================== Definicje ===================== */
 #define BUFFER_SIZE    1024   // Rozmiar bufora wiadomości
-static char msg[BUFFER_SIZE];     // Bufor do tworzenia komunikatów
+#define BOARD_MAX_UNACKED 8   // Tyle delt bez BOARD_ACK i następna zmiana idzie pełną planszą
 
-#define BOARD_SIZE 8          // Rozmiar planszy (8x8)
+#ifndef BOARD_SIZE
+#define BOARD_SIZE 8          // Rozmiar planszy (8x8); benchmark.c buduje też inne rozmiary
+#endif
 // Znaki reprezentujące stany pól planszy
-#define SHIP_CELL 'O'   // Mój statek
-#define HIT_SHIP  'X'   // Trafiony statek
-#define MISS_CELL '='   // Pudło
-#define EMPTY_CELL '.'  // Puste pole
+#define SHIP_CELL  BOARD_CHAR_SHIP   // Mój statek
+#define HIT_SHIP   BOARD_CHAR_HIT    // Trafiony statek
+#define MISS_CELL  BOARD_CHAR_MISS   // Pudło
+#define EMPTY_CELL BOARD_CHAR_EMPTY  // Puste pole
 
-/* ===================== Globalne Zmienne Planszy ===================== */
-// Tablice przechowujące stan mojej planszy oraz moje strzały
-static char myBoard[BOARD_SIZE][BOARD_SIZE];  // Moja plansza (statki, trafienia przeciwnika)
-static char myShots[BOARD_SIZE][BOARD_SIZE];  // Moje strzały w planszę przeciwnika
+// Flota rozstawiana przed grą (długości statków, poziomo)
+static const int fleetShips[] = { 1, 2 };  // Można zmodyfikować na np. {3,3,2,2}
+#define FLEET_SIZE ((int)(sizeof(fleetShips) / sizeof(fleetShips[0])))
 
-// Liczniki i flagi stanu
-static int placedShips  = 0;   // Flaga: czy statki zostały rozstawione
-static int myShipsCount = 0;   // Liczba fragmentów moich statków
-static int myHitsCount  = 0;   // Liczba trafień wykonanych przez mnie
-static int inRoom       = 0;   // Flaga: czy jestem w pokoju gry
-static int iAmObserver  = 0;   // Flaga: czy jestem obserwatorem
+/* ===================== Stan Gry ===================== */
+struct GameState;
+// Wysyłanie danych sesji; NULL - send() na gnieździe sesji. Benchmark podstawia własne
+// ujście, żeby mierzyć logikę gry bez sieci.
+typedef int (*GameTransport)(struct GameState *g, const void *data, int length);
+// Rysowanie obu plansz po zmianie; NULL - printBoard na stdout. Klient podstawia
+// renderer z ekran.h.
+typedef void (*GameRender)(struct GameState *g);
 
-static char username_received[50];  // Bufor do przechowywania odebranej nazwy użytkownika
+// Stan jednej sesji gry. Klient interaktywny ma jedną sesję, generator obciążenia
+// (bot.c) - tysiące, dlatego żadna funkcja gry nie używa zmiennych globalnych.
+typedef struct GameState {
+    int socket;                            // Gniazdo kanału głównego
+    const char *username;
+    char myBoard[BOARD_SIZE][BOARD_SIZE];  // Moja plansza (statki, trafienia przeciwnika)
+    char myShots[BOARD_SIZE][BOARD_SIZE];  // Moje strzały w planszę przeciwnika
+    // Liczniki i flagi stanu
+    int placedShips;     // Flaga: czy statki zostały rozstawione
+    int myShipsCount;    // Liczba fragmentów moich statków
+    int myHitsCount;     // Liczba trafień wykonanych przez mnie
+    int inRoom;          // Flaga: czy jestem w pokoju gry
+    int iAmObserver;     // Flaga: czy jestem obserwatorem
+    int amFirstPlayer;   // Rola gracza: -1 = nieustalono, 1 = pierwszy gracz, 0 = drugi gracz
+    int binaryProtocol;  // Serwer potwierdził ramki binarne ("PROTOCOL bin")
+    int boardDeltas;     // Serwer potwierdził przyrostowe plansze ("PROTOCOL delta")
+    int boardSynced;     // Serwer ma pełną planszę - dalej wysyłamy tylko zmienione pola
+    unsigned boardVersion;  // Wersja ostatnio wysłanej planszy (pełna = 0)
+    unsigned boardAcked;    // Ostatnia wersja potwierdzona przez BOARD_ACK (0 po pełnej planszy)
+    char sentBoard[BOARD_SIZE*BOARD_SIZE];  // Plansza w wersji boardVersion
+    int gameStarted;
+    int myTurn;
+    int quiet;           // Bez wypisywania plansz i komunikatów gry (bot)
+    GameTransport transport;
+    GameRender render;
+} GameState;
 
-int amFirstPlayer = -1;  // Określa rolę gracza: -1 = nieustalono, 1 = pierwszy gracz, 0 = drugi gracz
+// Stan nowej sesji przed handshake
+static void gameInit(GameState *g, int socket, const char *username) {
+    memset(g, 0, sizeof(*g));
+    g->socket = socket;
+    g->username = username;
+    g->amFirstPlayer = -1;
+}
+
+// Komunikat gry dla użytkownika (pomijany w trybie cichym)
+static void gameLog(const GameState *g, const char *format, ...) {
+    if (g->quiet)
+        return;
+    va_list ap;
+    va_start(ap, format);
+    vprintf(format, ap);
+    va_end(ap);
+}
 
 /* ===================== Inicjalizacja Planszy ===================== */
 // Inicjalizuje obie tablice (myBoard i myShots) ustawiając wszystkie pola na EMPTY_CELL
-static void initBoards() {
-    placedShips  = 0;
-    myShipsCount = 0;
-    myHitsCount  = 0;
+static void initBoards(GameState *g) {
+    g->boardSynced  = 0;  // Nowa plansza idzie do serwera w całości
+    g->placedShips  = 0;
+    g->myShipsCount = 0;
+    g->myHitsCount  = 0;
     for (int i = 0; i < BOARD_SIZE; i++) {
         for (int j = 0; j < BOARD_SIZE; j++) {
-            myBoard[i][j] = EMPTY_CELL;
-            myShots[i][j] = EMPTY_CELL;
+            g->myBoard[i][j] = EMPTY_CELL;
+            g->myShots[i][j] = EMPTY_CELL;
         }
     }
 }
 
 /* ===================== Wyświetlanie Plansz ===================== */
-// Rysuje moją planszę – pokazuje moje statki, trafienia przeciwnika oraz pudła
-static void printMyBoard() {
-    printf("\n--- MY BOARD (O=ship, X=ship hit, %c=miss) ---\n  ", MISS_CELL);
+#define MY_BOARD_TITLE  "MY BOARD (O=ship, X=ship hit, ==miss)"
+#define MY_SHOTS_TITLE  "MY SHOTS BOARD (X=ship hit, ==miss)"
+
+// Plansza składana w buforze i wypisywana jednym fwrite
+static void printBoard(const GameState *g, const char *title, char board[BOARD_SIZE][BOARD_SIZE]) {
+    if (g->quiet)
+        return;
+    char out[(BOARD_SIZE + 1) * (3 * BOARD_SIZE + 8) + 64];
+    int n = snprintf(out, sizeof(out), "\n--- %.40s ---\n  ", title);
     for (int j = 0; j < BOARD_SIZE; j++)
-        printf("%d ", j);
-    printf("\n");
+        n += snprintf(out + n, sizeof(out) - n, "%d ", j);
+    out[n++] = '\n';
     for (int i = 0; i < BOARD_SIZE; i++) {
-        printf("%d ", i);
+        n += snprintf(out + n, sizeof(out) - n, "%d ", i);
         for (int j = 0; j < BOARD_SIZE; j++) {
-            printf("%c ", myBoard[i][j]);
+            out[n++] = board[i][j];
+            out[n++] = ' ';
         }
-        printf("\n");
+        out[n++] = '\n';
     }
-    printf("\n");
+    out[n++] = '\n';
+    fwrite(out, 1, n, stdout);
+}
+
+// Rysuje moją planszę – pokazuje moje statki, trafienia przeciwnika oraz pudła
+static void printMyBoard(GameState *g) {
+    printBoard(g, MY_BOARD_TITLE, g->myBoard);
 }
 
 // Rysuje tablicę moich strzałów w planszę przeciwnika
-static void printMyShotsBoard() {
-    printf("\n--- MY SHOTS BOARD (X=ship hit, %c=miss) ---\n  ", MISS_CELL);
-    for (int j = 0; j < BOARD_SIZE; j++)
-        printf("%d ", j);
-    printf("\n");
-    for (int i = 0; i < BOARD_SIZE; i++) {
-        printf("%d ", i);
-        for (int j = 0; j < BOARD_SIZE; j++) {
-            printf("%c ", myShots[i][j]);
-        }
-        printf("\n");
+static void printMyShotsBoard(GameState *g) {
+    printBoard(g, MY_SHOTS_TITLE, g->myShots);
+}
+
+// Obie plansze po zmianie stanu gry
+static void showBoards(GameState *g) {
+    if (g->quiet)
+        return;
+    if (g->render) {
+        g->render(g);
+        return;
     }
-    printf("\n");
+    printMyBoard(g);
+    printMyShotsBoard(g);
 }
 
 /* ===================== Walidacja Współrzędnych ===================== */
@@ -99,16 +160,11 @@ static int validCoords(int x, int y)
 /*
  * Czy wszystkie moje statki zostały trafione?
  */
-static int allMyShipsAreHit()
+static int allMyShipsAreHit(const GameState *g)
 {
-    int hitCount = 0;
-    for (int i = 0; i < BOARD_SIZE; i++) {
-        for (int j = 0; j < BOARD_SIZE; j++) {
-            if (myBoard[i][j] == HIT_SHIP)
-                hitCount++;
-        }
-    }
-    return (hitCount >= myShipsCount);
+    int counts[BOARD_STATES];
+    board_count(&g->myBoard[0][0], BOARD_SIZE * BOARD_SIZE, counts);
+    return (counts[BOARD_HIT] >= g->myShipsCount);
 }
 
 /*
@@ -116,78 +172,173 @@ static int allMyShipsAreHit()
  *  - Jeśli myBoard[x][y] == 'O' => trafienie (ustaw 'X'),
  *  - W przeciwnym wypadku -> pudło (ustaw MISS_CELL).
  */
-static int registerHitOrMiss(int x, int y)
+static int registerHitOrMiss(GameState *g, int x, int y)
 {
     if (!validCoords(x, y))
         return -1;
-    if (myBoard[x][y] == SHIP_CELL) {
-        myBoard[x][y] = HIT_SHIP;
+    if (g->myBoard[x][y] == SHIP_CELL) {
+        g->myBoard[x][y] = HIT_SHIP;
         return 1;
     }
-    if (myBoard[x][y] == HIT_SHIP || myBoard[x][y] == MISS_CELL)
+    if (g->myBoard[x][y] == HIT_SHIP || g->myBoard[x][y] == MISS_CELL)
         return 0;
-    myBoard[x][y] = MISS_CELL;
+    g->myBoard[x][y] = MISS_CELL;
     return 0;
 }
 
 // Rejestruje wynik mojego strzału (trafienie lub pudło) w tablicy myShots
-static void registerShotResult(int x, int y, int wasHit) {
+static void registerShotResult(GameState *g, int x, int y, int wasHit) {
     if (!validCoords(x, y))
         return;
     if (wasHit) {
-        myShots[x][y] = HIT_SHIP;
-        myHitsCount++;
+        g->myShots[x][y] = HIT_SHIP;
+        g->myHitsCount++;
     } else {
-        myShots[x][y] = MISS_CELL;
+        g->myShots[x][y] = MISS_CELL;
     }
 }
 
 /* ===================== Spłaszczanie Planszy ===================== */
 // Konwertuje dwuwymiarową tablicę myBoard do jednowymiarowego ciągu BOARD_SIZE*BOARD_SIZE znaków czyli w naszym wypadku 64 znaków + 1 znak na końcu czyli 65
-static void flattenBoard(char flat[BOARD_SIZE*BOARD_SIZE+1]) {
-    int index = 0;
+// (wiersze myBoard leżą w pamięci jeden za drugim, więc wystarcza jedno kopiowanie)
+static void flattenBoard(const GameState *g, char flat[BOARD_SIZE*BOARD_SIZE+1]) {
+    memcpy(flat, g->myBoard, BOARD_SIZE * BOARD_SIZE);
+    flat[BOARD_SIZE*BOARD_SIZE] = '\0';
+}
+
+/* ===================== Odtwarzanie Planszy ===================== */
+// Odtwarza plansze po wznowieniu sesji: moją planszę wprost z serwera, a moje strzały
+// z planszy przeciwnika (widać na niej tylko trafienia i pudła)
+static void restoreBoards(GameState *g, const char *mine, const char *theirs) {
+    initBoards(g);
     for (int i = 0; i < BOARD_SIZE; i++) {
         for (int j = 0; j < BOARD_SIZE; j++) {
-            flat[index++] = myBoard[i][j];
+            char c = mine[i * BOARD_SIZE + j];
+            char t = theirs[i * BOARD_SIZE + j];
+            g->myBoard[i][j] = c;
+            if (c == SHIP_CELL || c == HIT_SHIP)
+                g->myShipsCount++;
+            if (t == HIT_SHIP) {
+                g->myShots[i][j] = HIT_SHIP;
+                g->myHitsCount++;
+            } else if (t == MISS_CELL) {
+                g->myShots[i][j] = MISS_CELL;
+            }
         }
     }
-    flat[BOARD_SIZE*BOARD_SIZE] = '\0';
+    g->placedShips = (g->myShipsCount > 0);
 }
 
 /* ===================== Wysyłanie Aktualizacji Planszy ===================== */
-// Wysyła zaktualizowany stan planszy do serwera – w zależności od roli gracza (BOARD0 lub BOARD1)
-void sendBoardUpdate() {
+// Jedyne miejsce, w którym logika gry wysyła dane
+static int gameSend(GameState *g, const void *data, int length) {
+    if (g->transport)
+        return g->transport(g, data, length);
+    return (send(g->socket, data, length, 0) < 0) ? -1 : 0;
+}
+
+// Wysyła ramkę binarną do serwera
+static int sendFrame(GameState *g, const unsigned char *frame, int length) {
+    return gameSend(g, frame, length);
+}
+
+// Wysyła jedną linię tekstu (z "\n") do serwera
+static int sendText(GameState *g, const char *text) {
+    return gameSend(g, text, (int)strlen(text));
+}
+
+// Wysyła tylko pola zmienione od ostatnio wysłanej wersji planszy (BOARD_DELTA).
+// Niezmieniona plansza nie jest wysyłana wcale.
+static void sendBoardDelta(GameState *g, const char *flat) {
+    if (memcmp(flat, g->sentBoard, sizeof(g->sentBoard)) == 0)
+        return;
+    int board = g->amFirstPlayer == 1 ? 0 : 1;
+    int rc;
+    g->boardVersion++;
+    if (g->binaryProtocol) {
+        unsigned char frame[PROTO_MAX_DELTA];
+        int len = proto_board_delta(frame, board, g->boardVersion, g->sentBoard, flat);
+        rc = sendFrame(g, frame, len);
+    } else {
+        char cells[PROTO_DELTA_TEXT];
+        char msg[PROTO_DELTA_TEXT + 32];
+        proto_delta_text(g->sentBoard, flat, cells);
+        snprintf(msg, sizeof(msg), "BOARD_DELTA %d %u %s\n", board, g->boardVersion, cells);
+        rc = sendText(g, msg);
+    }
+    if (rc < 0)
+        perror("[CLIENT] Send board update failed");
+    memcpy(g->sentBoard, flat, sizeof(g->sentBoard));
+}
+
+// Wysyła zaktualizowany stan planszy do serwera – w zależności od roli gracza (BOARD0 lub BOARD1).
+// Z możliwością "delta" pełna plansza idzie raz (wersja 0), a potem tylko zmiany.
+static void sendBoardUpdate(GameState *g) {
     char flat[BOARD_SIZE*BOARD_SIZE+1];
-    flattenBoard(flat);
-    if (amFirstPlayer == 1) {
+    char msg[BOARD_SIZE*BOARD_SIZE+16];  // "BOARDn " + plansza + "\n"
+    flattenBoard(g, flat);
+    if (g->amFirstPlayer != -1 && g->boardDeltas) {
+        // Serwer nie potwierdza kolejnych wersji (zgubił delty albo nie nadąża) - zamiast
+        // dokładać następne, wysyłamy planszę w całości
+        if (g->boardSynced && g->boardVersion - g->boardAcked >= BOARD_MAX_UNACKED)
+            g->boardSynced = 0;
+        if (g->boardSynced) {
+            sendBoardDelta(g, flat);
+            return;
+        }
+        g->boardSynced = 1;
+        g->boardVersion = 0;
+        g->boardAcked = 0;
+        memcpy(g->sentBoard, flat, sizeof(g->sentBoard));
+    }
+    if (g->binaryProtocol && g->amFirstPlayer != -1) {
+        unsigned char frame[PROTO_BOARD_SIZE];
+        proto_board(frame, g->amFirstPlayer == 1 ? 0 : 1, flat);
+        if (sendFrame(g, frame, sizeof(frame)) < 0)
+            perror("[CLIENT] Send board update failed");
+        return;
+    }
+    if (g->amFirstPlayer == 1) {
         snprintf(msg, sizeof(msg), "BOARD0 %s\n", flat);
-    } else if (amFirstPlayer == 0) {
+    } else if (g->amFirstPlayer == 0) {
         snprintf(msg, sizeof(msg), "BOARD1 %s\n", flat);
     } else {
         return;
     }
-    if (send(server_socket, msg, strlen(msg), 0) < 0)
+    if (sendText(g, msg) < 0)
         perror("[CLIENT] Send board update failed");
-    else
-    {
-        //WYSLANO POPRAWNIE
-    }
 }
 
 /* ===================== Rozstawianie Statków ===================== */
+// Czy statek o długości 'length' mieści się poziomo od (x, y) i nie koliduje z innymi
+static int shipFits(const GameState *g, int x, int y, int length) {
+    if (!validCoords(x, y) || !validCoords(x, y + length - 1))
+        return 0;
+    for (int k = 0; k < length; k++) {
+        if (g->myBoard[x][y + k] != EMPTY_CELL)
+            return 0;
+    }
+    return 1;
+}
+
+static void putShip(GameState *g, int x, int y, int length) {
+    for (int k = 0; k < length; k++) {
+        g->myBoard[x][y + k] = SHIP_CELL;
+        g->myShipsCount++;
+    }
+}
+
 // Umożliwia graczowi lokalne rozstawienie statków na planszy
-static void placeShipsLocally() {
-    if (placedShips) {
+static inline void placeShipsLocally(GameState *g) {
+    if (g->placedShips) {
         printf("[PLACE] You have already placed your ships!\n");
         return;
     }
     printf("[PLACE] Place ships (horizontal)\n");
-    #define shipNumber 2
-    int shipLengths[shipNumber] = {1, 2};  // Można zmodyfikować na np. {3,3,2,2}
-    for (int s = 0; s < shipNumber; s++) {
-        int length = shipLengths[s];
+    for (int s = 0; s < FLEET_SIZE; s++) {
+        int length = fleetShips[s];
         int placed = 0;
-        printMyBoard();
+        printMyBoard(g);
         while (!placed) {
             printf("[PLACE] Place ship (length=%d) horizontally\n", length);
             printf("[PLACE] Enter row col (e.g. '2 3'): ");
@@ -205,150 +356,297 @@ static void placeShipsLocally() {
                 printf("[PLACE] Ship doesn't fit horizontally. Try again.\n");
                 continue;
             }
-            int conflict = 0;
-            for (int k = 0; k < length; k++) {
-                if (myBoard[x][y + k] != EMPTY_CELL) {
-                    conflict = 1;
-                    break;
-                }
-            }
-            if (conflict) {
+            if (!shipFits(g, x, y, length)) {
                 printf("[PLACE] Collision with another ship. Try again.\n");
                 continue;
             }
-            for (int k = 0; k < length; k++) {
-                myBoard[x][y + k] = SHIP_CELL;
-                myShipsCount++;
-            }
+            putShip(g, x, y, length);
             placed = 1;
         }
     }
-    placedShips = 1;
-    printMyBoard();
+    g->placedShips = 1;
+    printMyBoard(g);
     printf("[PLACE] All ships placed! Now type /start (once) to confirm readiness.\n");
 }
 
+// Rozstawia flotę losowo (bez wejścia z klawiatury) - dla bota
+static inline void placeShipsRandomly(GameState *g, unsigned *seed) {
+    initBoards(g);
+    for (int s = 0; s < FLEET_SIZE; s++) {
+        int length = fleetShips[s];
+        int x, y;
+        do {
+            x = rand_r(seed) % BOARD_SIZE;
+            y = rand_r(seed) % (BOARD_SIZE - length + 1);
+        } while (!shipFits(g, x, y, length));
+        putShip(g, x, y, length);
+    }
+    g->placedShips = 1;
+}
+
+/* ===================== Zdarzenia Gry ===================== */
+// Wysyła strzał lub jego wynik (FIRE/HIT/MISS) - ramką albo linią tekstu
+static int sendShot(GameState *g, int op, int x, int y) {
+    if (g->binaryProtocol) {
+        unsigned char frame[PROTO_SHOT_SIZE];
+        proto_shot(frame, op, x, y, g->amFirstPlayer == 1 ? 0 : 1);
+        return sendFrame(g, frame, sizeof(frame));
+    }
+    char msg[BUFFER_SIZE];
+    const char *name = (op == PROTO_FIRE) ? "FIRE" : (op == PROTO_HIT) ? "HIT" : "MISS";
+    snprintf(msg, sizeof(msg), "%s %d %d %s\n", name, x, y, g->username);
+    return sendText(g, msg);
+}
+
+// Zmiana tury; 'who' to nazwa gracza na ruchu (NULL, gdy znamy tylko jego miejsce)
+static void onNextTurn(GameState *g, int mine, const char *who) {
+    if (mine) {
+        g->myTurn = 1;
+        gameLog(g, "[BATTLESHIP] It's now YOUR turn => /fire x y.\n");
+    } else {
+        g->myTurn = 0;
+        gameLog(g, "[BATTLESHIP] It's now %s's turn. Please wait.\n", who ? who : "your opponent");
+    }
+    sendBoardUpdate(g);
+}
+
+// Przeciwnik strzelił w moją planszę - odpowiadamy HIT, MISS albo YOU_WIN
+static void onEnemyFire(GameState *g, int x, int y) {
+    if (!validCoords(x, y))
+        return;
+    int result = registerHitOrMiss(g, x, y);
+    if (result == 1) {
+        gameLog(g, "[BATTLESHIP] Enemy HIT your ship at (%d,%d)\n", x, y);
+        if (allMyShipsAreHit(g))
+            sendText(g, "YOU_WIN\n");
+        else
+            sendShot(g, PROTO_HIT, x, y);
+    } else {
+        gameLog(g, "[BATTLESHIP] Enemy missed at (%d,%d)\n", x, y);
+        sendShot(g, PROTO_MISS, x, y);
+    }
+    showBoards(g);
+}
+
+// Wynik mojego strzału
+static void onShotResult(GameState *g, int x, int y, int wasHit) {
+    if (!validCoords(x, y))
+        return;
+    registerShotResult(g, x, y, wasHit);
+    if (wasHit)
+        gameLog(g, "[BATTLESHIP] You HIT enemy at (%d,%d). Fire again!\n", x, y);
+    else
+        gameLog(g, "[BATTLESHIP] You MISS at (%d,%d). Enemy's turn now.\n", x, y);
+    showBoards(g);
+}
+
 /* ===================== Parsowanie Komunikatów ===================== */
-// Przetwarza komunikaty otrzymywane od serwera i aktualizuje stan gry
-static int parseBattleshipMessage(char *buffer, int *myTurn, int *gameStarted, const char *username) {
-    if (!iAmObserver) {
-        if (strncmp(buffer, "JOINED_ROOM", 11) == 0) {
-            inRoom = 1;
-            if (strncmp(buffer, "JOINED_ROOM_OBSERVER", 20) == 0) {
-                iAmObserver = 1;
-            }
-            return 1;
-        }
-        else if (strncmp(buffer, "ENTERING_LOBBY", 14) == 0) {
-            inRoom = 0;
-            iAmObserver = 0;
-            return 1;
-        }
-        else if (strncmp(buffer, "GAME_START", 10) == 0) {
-            *gameStarted = 1;
-            printf("[BATTLESHIP] GAME_START => The battle begins!\n");
-            printMyBoard();
-            printMyShotsBoard();
-            return 1;
-        }
-        else if (strncmp(buffer, "NEXT_TURN ", 10) == 0) {
-            char turnName[50];
-            if (sscanf(buffer + 10, "%s", turnName) == 1) {
-                if (strcmp(turnName, username) == 0) {
-                    *myTurn = 1;
-                    printf("[BATTLESHIP] It's now YOUR turn => /fire x y.\n");
-                } else {
-                    *myTurn = 0;
-                    printf("[BATTLESHIP] It's now %s's turn. Please wait.\n", turnName);
-                }
-                sendBoardUpdate();
-            }
-            return 1;
-        }
-        else if (strncmp(buffer, "FIRE ", 5) == 0) {
-            int x, y;
-            if (sscanf(buffer + 5, "%d %d %s", &x, &y, username_received) == 3) {
-                if (strcmp(username_received, username) != 0) {
-                    int result = registerHitOrMiss(x, y);
-                    if (result == 1) {
-                        printf("[BATTLESHIP] Enemy HIT your ship at (%d,%d)\n", x, y);
-                        if (allMyShipsAreHit()) {
-                            snprintf(msg, sizeof(msg), "YOU_WIN");
-                            send(server_socket, msg, strlen(msg), 0);
-                        } else {
-                            snprintf(msg, sizeof(msg), "HIT %d %d %s", x, y, username);
-                            send(server_socket, msg, strlen(msg), 0);
-                        }
-                    } else {
-                        printf("[BATTLESHIP] Enemy missed at (%d,%d)\n", x, y);
-                        snprintf(msg, sizeof(msg), "MISS %d %d %s", x, y, username);
-                        send(server_socket, msg, strlen(msg), 0);
-                    }
-                    printMyBoard();
-                    printMyShotsBoard();
-                }
-            }
-            return 1;
-        }
-        else if (strncmp(buffer, "HIT ", 4) == 0) {
-            int x, y;
-            char shooter[50];
-            if (sscanf(buffer + 4, "%d %d %s", &x, &y, shooter) == 3) {
-                if (strcmp(shooter, username) != 0) {
-                    registerShotResult(x, y, 1);
-                    printf("[BATTLESHIP] You HIT enemy at (%d,%d). Fire again!\n", x, y);
-                    printMyBoard();
-                    printMyShotsBoard();
-                }
-            }
-            return 1;
-        }
-        else if (strncmp(buffer, "MISS ", 5) == 0) {
-            int x, y;
-            char shooter[50];
-            if (sscanf(buffer + 5, "%d %d %s", &x, &y, shooter) == 3) {
-                if (strcmp(shooter, username) != 0) {
-                    registerShotResult(x, y, 0);
-                    printf("[BATTLESHIP] You MISS at (%d,%d). Enemy's turn now.\n", x, y);
-                    printMyBoard();
-                    printMyShotsBoard();
-                }
-            }
-            return 1;
-        }
-        else if (strncmp(buffer, "YOU_WIN", 7) == 0) {
-            char winner[50];
-            if (sscanf(buffer + 7, "%s", winner) == 1)
-                printf("[BATTLESHIP] %s WON the game!\n", winner);
-            else
-                printf("[BATTLESHIP] Someone WON the game!\n");
-            initBoards();
-            return 1;
-        }
+// "PROTOCOL <możliwość>": serwer przyjął możliwość ogłoszoną w HELLO
+static void gameProtocolAccepted(GameState *g, const char *cap) {
+    if (strcmp(cap, PROTO_CAP_BINARY) == 0)
+        g->binaryProtocol = 1;
+    else if (strcmp(cap, PROTO_CAP_DELTA) == 0)
+        g->boardDeltas = 1;
+}
+
+// Funkcje obsługi komunikatów serwera z rejestru (komendy.h). 'args' to tekst po
+// czasowniku. Zwracają 1, gdy komunikat został obsłużony (nie trzeba go wypisywać).
+typedef int (*MessageHandler)(GameState *g, const char *args);
+
+static int msgJoinedRoom(GameState *g, const char *args) {
+    (void)args;
+    g->inRoom = 1;
+    return 1;
+}
+
+static int msgJoinedRoomObserver(GameState *g, const char *args) {
+    (void)args;
+    g->inRoom = 1;
+    g->iAmObserver = 1;
+    return 1;
+}
+
+static int msgEnteringLobby(GameState *g, const char *args) {
+    (void)args;
+    g->inRoom = 0;
+    g->iAmObserver = 0;
+    return 1;
+}
+
+static int msgGameStart(GameState *g, const char *args) {
+    (void)args;
+    g->gameStarted = 1;
+    gameLog(g, "[BATTLESHIP] GAME_START => The battle begins!\n");
+    showBoards(g);
+    return 1;
+}
+
+static int msgNextTurn(GameState *g, const char *args) {
+    char turnName[50];
+    if (sscanf(args, "%49s", turnName) == 1)
+        onNextTurn(g, strcmp(turnName, g->username) == 0, turnName);
+    return 1;
+}
+
+static int msgFire(GameState *g, const char *args) {
+    int x, y;
+    char shooter[50];
+    if (sscanf(args, "%d %d %49s", &x, &y, shooter) == 3) {
+        if (strcmp(shooter, g->username) != 0)
+            onEnemyFire(g, x, y);
     }
-    else if (iAmObserver) {
-        if (strncmp(buffer, "JOINED_ROOM", 11) == 0) {
-            inRoom = 1;
-            if (strncmp(buffer, "JOINED_ROOM_OBSERVER", 20) == 0) {
-                iAmObserver = 1;
-            }
-            return 1;
-        }
-        else if (strncmp(buffer, "ENTERING_LOBBY", 14) == 0) {
-            inRoom = 0;
-            iAmObserver = 0;
-            return 1;
-        }
-        else if (strncmp(buffer, "GAME_NOT_STARTED", 16) == 0) {
-            printf("[BATTLESHIP][OBSERVER] The game hasn't started yet.\n");
-            return 1;
-        }
-        else if (strncmp(buffer, "GAME_STARTED", 11) == 0) {
-            printf("[BATTLESHIP][OBSERVER] The game is already in progress.\n");
-            return 1;
-        }
+    return 1;
+}
+
+// HIT i MISS niosą nazwę gracza, w którego strzelano - wynik dotyczy mnie, gdy to nie ja
+static int msgShotResult(GameState *g, const char *args, int wasHit) {
+    int x, y;
+    char target[50];
+    if (sscanf(args, "%d %d %49s", &x, &y, target) == 3) {
+        if (strcmp(target, g->username) != 0)
+            onShotResult(g, x, y, wasHit);
+    }
+    return 1;
+}
+
+static int msgHit(GameState *g, const char *args) {
+    return msgShotResult(g, args, 1);
+}
+
+static int msgMiss(GameState *g, const char *args) {
+    return msgShotResult(g, args, 0);
+}
+
+static int msgResumeState(GameState *g, const char *args) {
+    int me, started;
+    char turnName[50];
+    char mine[BOARD_SIZE*BOARD_SIZE+1], theirs[BOARD_SIZE*BOARD_SIZE+1];
+    if (sscanf(args, "%d %d %49s %64s %64s", &me, &started, turnName, mine, theirs) == 5) {
+        restoreBoards(g, mine, theirs);
+        g->amFirstPlayer = (me == 0);
+        g->gameStarted = started;
+        g->myTurn = (started && strcmp(turnName, g->username) == 0);
+        gameLog(g, "[BATTLESHIP] Game state restored.\n");
+        showBoards(g);
+        if (g->myTurn)
+            gameLog(g, "[BATTLESHIP] It's now YOUR turn => /fire x y.\n");
+    }
+    return 1;
+}
+
+static int msgTurnTimeout(GameState *g, const char *args) {
+    gameLog(g, "[BATTLESHIP] %s ran out of time and forfeits the game.\n", args);
+    return 1;
+}
+
+static int msgYouWin(GameState *g, const char *args) {
+    char winner[50];
+    if (sscanf(args, "%49s", winner) == 1)
+        gameLog(g, "[BATTLESHIP] %s WON the game!\n", winner);
+    else
+        gameLog(g, "[BATTLESHIP] Someone WON the game!\n");
+    initBoards(g);
+    g->gameStarted = 0;
+    g->myTurn = 0;
+    return 1;
+}
+
+// Serwer ma naszą planszę w wersji 'version'. Potwierdzenia wersji spoza bieżącej serii
+// (sprzed ponownego wysłania pełnej planszy) są pomijane.
+static int msgBoardAck(GameState *g, const char *args) {
+    int board;
+    unsigned version;
+    if (sscanf(args, "%d %u", &board, &version) == 2 && board == (g->amFirstPlayer == 1 ? 0 : 1) &&
+        version <= g->boardVersion && version > g->boardAcked)
+        g->boardAcked = version;
+    return 1;
+}
+
+// Serwer nie ma planszy, do której pasuje nasza delta - wysyłamy ją w całości
+static int msgBoardResync(GameState *g, const char *args) {
+    (void)args;
+    g->boardSynced = 0;
+    sendBoardUpdate(g);
+    return 1;
+}
+
+static int msgGameNotStarted(GameState *g, const char *args) {
+    (void)args;
+    gameLog(g, "[BATTLESHIP][OBSERVER] The game hasn't started yet.\n");
+    return 1;
+}
+
+static int msgGameStarted(GameState *g, const char *args) {
+    (void)args;
+    gameLog(g, "[BATTLESHIP][OBSERVER] The game is already in progress.\n");
+    return 1;
+}
+
+// Komunikaty połączenia (PING, RESUME_TOKEN, TLV_PORT, PROTOCOL) obsługuje klient
+static const MessageHandler messageHandlers[MSG_COUNT] = {
+    [MSG_JOINED_ROOM]          = msgJoinedRoom,
+    [MSG_JOINED_ROOM_OBSERVER] = msgJoinedRoomObserver,
+    [MSG_ENTERING_LOBBY]       = msgEnteringLobby,
+    [MSG_GAME_START]           = msgGameStart,
+    [MSG_NEXT_TURN]            = msgNextTurn,
+    [MSG_FIRE]                 = msgFire,
+    [MSG_HIT]                  = msgHit,
+    [MSG_MISS]                 = msgMiss,
+    [MSG_RESUME_STATE]         = msgResumeState,
+    [MSG_TURN_TIMEOUT]         = msgTurnTimeout,
+    [MSG_YOU_WIN]              = msgYouWin,
+    [MSG_GAME_NOT_STARTED]     = msgGameNotStarted,
+    [MSG_GAME_STARTED]         = msgGameStarted,
+    [MSG_BOARD_ACK]            = msgBoardAck,
+    [MSG_BOARD_RESYNC]         = msgBoardResync,
+};
+
+// Przetwarza komunikat serwera rozpoznany w rejestrze i aktualizuje stan gry.
+// Komunikaty, które nie przysługują bieżącej roli (gracz / obserwator), zwracają 0.
+static int parseBattleshipMessage(GameState *g, int id, const char *args) {
+    int role = g->iAmObserver ? ROLE_OBSERVER : ROLE_PLAYER;
+    if (id == MSG_NONE || !messageHandlers[id] || !command_allowed(&server_messages, id, role))
+        return 0;
+    return messageHandlers[id](g, args);
+}
+
+// Przetwarza ramkę binarną od serwera. Ramki niosą miejsce gracza zamiast nazwy:
+// miejsce 0 to twórca pokoju (amFirstPlayer == 1), miejsce 1 - drugi gracz.
+static void parseBattleshipFrame(GameState *g, const unsigned char *frame, int length) {
+    int op = frame[0];
+    if (op == PROTO_CHAT) {
+        const char *text;
+        int n = proto_chat_text(frame, length, &text);
+        if (n >= 0)
+            gameLog(g, "%.*s\n", n, text);
+        return;
+    }
+    int mySeat = (g->amFirstPlayer == 1) ? 0 : (g->amFirstPlayer == 0) ? 1 : -1;
+    int seat = (op == PROTO_NEXT_TURN) ? frame[1] : frame[3];
+    if (g->iAmObserver) {
+        if (op == PROTO_FIRE)
+            gameLog(g, "[BATTLESHIP][OBSERVER] Player %d fires at (%d,%d)\n", seat + 1, frame[1], frame[2]);
+        else if (op == PROTO_HIT || op == PROTO_MISS)
+            gameLog(g, "[BATTLESHIP][OBSERVER] Player %d reports %s at (%d,%d)\n", seat + 1,
+                    op == PROTO_HIT ? "HIT" : "MISS", frame[1], frame[2]);
+        else if (op == PROTO_NEXT_TURN)
+            gameLog(g, "[BATTLESHIP][OBSERVER] Player %d's turn.\n", seat + 1);
+        return;
+    }
+    switch (op) {
+    case PROTO_NEXT_TURN:
+        onNextTurn(g, seat == mySeat, NULL);
+        break;
+    case PROTO_FIRE:
+        if (seat != mySeat)
+            onEnemyFire(g, frame[1], frame[2]);
+        break;
+    case PROTO_HIT:
+    case PROTO_MISS:
+        if (seat != mySeat)
+            onShotResult(g, frame[1], frame[2], op == PROTO_HIT);
+        break;
     }
-    return 0;
 }
 
 #endif // GRA_H
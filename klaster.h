@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca & Marcel Gacoń
+ * AGH - Programowanie sieciowe
+ */
+
+#ifndef KLASTER_H
+#define KLASTER_H
+
+/*
+ * Katalog pokoi klastra serwerów (serwer z --cluster).
+ *
+ * Każdy węzeł co CLUSTER_GOSSIP_INTERVAL sekund ogłasza na grupie multicast swoje pokoje;
+ * pozostałe węzły trzymają z tych ogłoszeń katalog (węzeł, jego adres i pokoje), z którego
+ * /list pokazuje pokoje całego klastra, a /join do cudzego pokoju odsyła klienta do węzła,
+ * który ten pokój ma (REDIRECT). Węzeł, który przestał się ogłaszać, wypada z katalogu
+ * po CLUSTER_NODE_TTL_MS.
+ *
+ * Ogłoszenie to datagram tekstowy (jeden lub kilka na cykl, gdy pokoi jest dużo):
+ *
+ *   CLUSTER <węzeł> <adres>:<port> <generacja> <klienci> <pojemność>\n
+ *   <pokój> <gracze> <twórca>\n ...          (twórca do końca linii)
+ *
+ * Generacją jest czas ogłoszenia w ms - datagramy nowszej generacji zastępują listę pokoi
+ * węzła, kolejne datagramy tej samej generacji ją uzupełniają, starsze są pomijane
+ * (także po restarcie węzła generacja rośnie).
+ */
+
+/* ===================== Includy ===================== */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* ===================== Definicje ===================== */
+#define CLUSTER_ADDR              "239.255.0.2"
+#define CLUSTER_PORT              12347
+#define CLUSTER_GOSSIP_INTERVAL   1      // Co ile sekund węzeł ogłasza swoje pokoje
+#define CLUSTER_NODE_TTL_MS       3500   // Po tylu ms bez ogłoszenia węzeł wypada z katalogu
+#define CLUSTER_MAX_NODES         32
+#define CLUSTER_NODE_ROOMS        512    // Pamiętane pokoje jednego węzła (MAX_ROOMS serwera)
+#define CLUSTER_DATAGRAM          1200   // Rozmiar ogłoszenia (mieści się w MTU)
+#define CLUSTER_ID_LEN            16
+
+typedef struct {
+    int id;
+    int players;
+    char creator[24];
+} ClusterRoom;
+
+typedef struct {
+    char id[CLUSTER_ID_LEN + 1];   // Pusty = wolny slot
+    char ip[64];
+    int port;
+    int clients;
+    int capacity;
+    unsigned long long gen;        // Generacja bieżącej listy pokoi
+    unsigned long long seen_ms;    // Ostatnie ogłoszenie (zegar monotoniczny)
+    int room_count;
+    ClusterRoom rooms[CLUSTER_NODE_ROOMS];
+} ClusterNode;
+
+typedef struct {
+    ClusterNode nodes[CLUSTER_MAX_NODES];
+} ClusterDirectory;
+
+static inline unsigned long long cluster_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+// Generacja ogłoszenia - zegar ścienny, aby rosła także po restarcie węzła
+static inline unsigned long long cluster_generation(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (unsigned long long)ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+/* ===================== Ogłoszenia ===================== */
+// Nagłówek ogłoszenia; zwraca długość
+static inline int cluster_announce_header(char *out, size_t size, const char *node, const char *ip,
+                                          int port, unsigned long long gen, int clients, int capacity) {
+    return snprintf(out, size, "CLUSTER %s %s:%d %llu %d %d\n", node, ip, port, gen, clients, capacity);
+}
+
+// Dopisuje pokój do ogłoszenia; zwraca nową długość albo -1, gdy się nie mieści
+static inline int cluster_announce_room(char *out, int len, int size, int room, int players,
+                                        const char *creator) {
+    int n = snprintf(out + len, size - len, "%d %d %.23s\n", room, players, creator);
+    return n < 0 || len + n >= size ? -1 : len + n;
+}
+
+// Węzeł o danym identyfikatorze (albo NULL)
+static inline ClusterNode *cluster_find(ClusterDirectory *dir, const char *node) {
+    for (int i = 0; i < CLUSTER_MAX_NODES; i++)
+        if (dir->nodes[i].id[0] && strcmp(dir->nodes[i].id, node) == 0)
+            return &dir->nodes[i];
+    return NULL;
+}
+
+// Usuwa węzły, które od CLUSTER_NODE_TTL_MS milczą
+static inline void cluster_expire(ClusterDirectory *dir, unsigned long long now_ms) {
+    for (int i = 0; i < CLUSTER_MAX_NODES; i++)
+        if (dir->nodes[i].id[0] && now_ms - dir->nodes[i].seen_ms > CLUSTER_NODE_TTL_MS)
+            dir->nodes[i].id[0] = '\0';
+}
+
+// Wprowadza ogłoszenie do katalogu (pomija własne ogłoszenia węzła 'self').
+// Zwraca 0 albo -1 dla nieznanego formatu.
+static inline int cluster_apply(ClusterDirectory *dir, const char *self, char *data, int len,
+                                unsigned long long now_ms) {
+    data[len] = '\0';
+    char node[CLUSTER_ID_LEN + 1], ip[64];
+    int port, clients, capacity, consumed = 0;
+    unsigned long long gen;
+    if (sscanf(data, "CLUSTER %16s %63[^:]:%d %llu %d %d\n%n", node, ip, &port, &gen,
+               &clients, &capacity, &consumed) != 6 || consumed == 0)
+        return -1;
+    if (strcmp(node, self) == 0)
+        return 0;
+
+    ClusterNode *n = cluster_find(dir, node);
+    if (!n) {
+        cluster_expire(dir, now_ms);
+        for (int i = 0; i < CLUSTER_MAX_NODES && !n; i++)
+            if (!dir->nodes[i].id[0])
+                n = &dir->nodes[i];
+        if (!n)
+            return 0;  // Katalog pełny
+        memset(n, 0, sizeof(*n));
+        snprintf(n->id, sizeof(n->id), "%s", node);
+    }
+    if (gen < n->gen)
+        return 0;  // Spóźniony datagram starszego cyklu
+    if (gen > n->gen) {
+        n->gen = gen;
+        n->room_count = 0;
+    }
+    snprintf(n->ip, sizeof(n->ip), "%s", ip);
+    n->port = port;
+    n->clients = clients;
+    n->capacity = capacity;
+    n->seen_ms = now_ms;
+
+    char *line = data + consumed;
+    while (*line && n->room_count < CLUSTER_NODE_ROOMS) {
+        ClusterRoom *r = &n->rooms[n->room_count];
+        if (sscanf(line, "%d %d %23[^\n]", &r->id, &r->players, r->creator) == 3)
+            n->room_count++;
+        char *next = strchr(line, '\n');
+        if (!next)
+            break;
+        line = next + 1;
+    }
+    return 0;
+}
+
+#endif // KLASTER_H
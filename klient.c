@@ -11,15 +11,27 @@
 #include <arpa/inet.h>
 #include <pthread.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <poll.h>
+#include <time.h>
 
-#include "gra.h"  // Logika gry w statki
+#include "gra.h"    // Logika gry w statki
+#include "ekran.h"  // Rysowanie plansz (jedna ramka - jeden write)
 
-int server_socket;  // Definicja globalnego socketu serwera (extern zadeklarowany w gra.h)
+static GameState game;  // Stan gry i gniazdo kanału głównego (game.socket)
+static Screen screen;   // Plansze gracza albo - u obserwatora - plansze obu graczy
 
 #define BUFFER_SIZE    1024
 #define DISCOVERY_PORT 12346
 #define MULTICAST_ADDR "239.255.0.1"
 #define DEF_SERVER_PORT 12345
+#define DISCOVERY_TIMEOUT_MS  3000  // Czekanie na pierwszą odpowiedź discovery
+#define DISCOVERY_WINDOW_MS   200   // Zbieranie odpowiedzi kolejnych serwerów po pierwszej
+#define DISCOVERY_MAX_SERVERS 16
+#define DISCOVERY_LOAD_WEIGHT 100.0 // Kara (w ms RTT) za całkowicie zajęty serwer
+#define RESUME_ATTEMPTS 5      // Liczba prób wznowienia sesji po zerwaniu połączenia
+#define CLIENT_CAPS     "resume,bin,delta"  // Możliwości klienta ogłaszane w HELLO
 
 /* ===================== Zmienne Globalne ===================== */
 char username[50];
@@ -27,13 +39,19 @@ int running = 1;
 
 pthread_t receive_thread;
 
-// Flagi stanu gry
-int gameStarted = 0;
-int myTurn      = 0;
+// Flaga interfejsu: czy użyto już /start
 int iAmReady    = 0;
 
-// Globalny adres serwera – wykorzystywany przy łączeniu kanałem TLV
+// Globalny adres serwera – wykorzystywany przy łączeniu kanałem TLV i przy wznawianiu sesji
 char global_server_ip[100];
+int global_server_port = DEF_SERVER_PORT;
+
+// Token wznowienia sesji otrzymany od serwera przy handshake
+char resume_token[64];
+
+// Serwer zapasowy (STANDBY) - tam wznawiamy sesję, gdy serwer główny nie odpowiada
+char standby_ip[100];
+int standby_port;
 
 // Zmienne związane z obsługą TLV
 int tlv_socket = -1;         // Socket do komunikacji TLV
@@ -41,26 +59,14 @@ pthread_t tlv_receive_thread;  // Wątek odbierający dane TLV
 
 /* ===================== Obsługa TLV ===================== */
 
-// Funkcja pomocnicza do wyświetlania planszy 8x8 otrzymanej przez TLV
-static void displayBoardData(const unsigned char *data, int length, const char *label) {
-    if (length != 64) {
+// Plansza otrzymana przez TLV na miejscu 'slot' ekranu
+static void displayBoardData(const unsigned char *data, int length, int slot, const char *label) {
+    if (length != BOARD_SIZE * BOARD_SIZE) {
         printf("[TLV] Nieoczekiwana długość planszy: %d bajtów\n", length);
         return;
     }
-    printf("\n[%s]\n", label);
-    printf("   ");
-    for (int i = 0; i < 8; i++) {
-        printf("%d ", i);
-    }
-    printf("\n");
-    for (int i = 0; i < 8; i++) {
-        printf("%d  ", i);
-        for (int j = 0; j < 8; j++) {
-            printf("%c ", data[i * 8 + j]);
-        }
-        printf("\n");
-    }
-    printf("\n");
+    screen_board(&screen, slot, label, (const char *)data);
+    screen_flush(&screen);
 }
 
 // Wątek odbierający dane TLV i prezentujący je jako planszę
@@ -69,10 +75,7 @@ static void *receive_tlv_messages(void *arg) {
     unsigned char tlv_buf[67];
     int n;
     while ((n = recv(tlv_socket, tlv_buf, sizeof(tlv_buf), 0)) > 0) {
-        for (int i = 0; i < n; i++) {
-            printf("%02X ", tlv_buf[i]);
-        }
-        printf("\n");
+        screen_hexdump(&screen, tlv_buf, n);
 
         // Sprawdzamy czy długość nagłówka jest odpowiednia, jak nie to pomijamy (3 bajty)
         if (n < 3) {
@@ -86,31 +89,88 @@ static void *receive_tlv_messages(void *arg) {
             continue;
         }
 
-        // Ustalenie etykiety planszy w zależności od typu pakietu
-        const char *boardLabel = NULL;
-        if (type == 0x01) {
-            boardLabel = "Plansza Gracza 1";
-        } else if (type == 0x02) {
-            boardLabel = "Plansza Gracza 2";
+        // Plansza pierwszego gracza po lewej, drugiego po prawej
+        if (type == TLV_BOARD_PLAYER0) {
+            displayBoardData(tlv_buf + 3, length, 0, "Plansza Gracza 1");
+        } else if (type == TLV_BOARD_PLAYER1) {
+            displayBoardData(tlv_buf + 3, length, 1, "Plansza Gracza 2");
         } else {
-            boardLabel = "Nieznany typ TLV";
+            printf("[TLV] Nieznany typ TLV: 0x%02X\n", type);
         }
-
-        // Wyświetlenie odebranych danych jako plansza 8x8
-        displayBoardData(tlv_buf + 3, length, boardLabel);
     }
     close(tlv_socket);
     return NULL;
 }
 
+// Renderer plansz gry (GameState.render): moja plansza i moje strzały w jednej ramce
+static void renderGameBoards(GameState *g) {
+    screen_board(&screen, 0, MY_BOARD_TITLE, &g->myBoard[0][0]);
+    screen_board(&screen, 1, MY_SHOTS_TITLE, &g->myShots[0][0]);
+    screen_flush(&screen);
+}
+
 /* ===================== Multicast Discovery ===================== */
 
-// Funkcja wysyłająca DISCOVERY_REQUEST i odbierająca odpowiedź z serwera
-int discover_server(char *out_ip, int *out_port, const char *interface_name) {
+// Serwer znaleziony przez discovery. Odpowiedź: "SERVER_IP=adres:port ID=... CLIENTS=n
+// ROOMS=n CAPACITY=n" (starsze serwery wysyłają samo "SERVER_IP=adres:port").
+typedef struct {
+    char ip[100];
+    int port;
+    char id[32];
+    int clients;
+    int rooms;
+    int capacity;          // 0 = serwer nie podał obciążenia
+    double rtt_ms;
+    double score;          // Mniejszy = lepszy
+} DiscoveredServer;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// Parsuje odpowiedź discovery; zwraca 0 albo -1 dla nieznanego formatu
+static int parse_discovery_reply(const char *reply, DiscoveredServer *srv) {
+    memset(srv, 0, sizeof(*srv));
+    if (sscanf(reply, "SERVER_IP=%99[^:]:%d", srv->ip, &srv->port) != 2)
+        return -1;
+    const char *field;
+    if ((field = strstr(reply, " ID=")) != NULL)
+        sscanf(field + 4, "%31s", srv->id);
+    if ((field = strstr(reply, " CLIENTS=")) != NULL)
+        srv->clients = atoi(field + 9);
+    if ((field = strstr(reply, " ROOMS=")) != NULL)
+        srv->rooms = atoi(field + 7);
+    if ((field = strstr(reply, " CAPACITY=")) != NULL)
+        srv->capacity = atoi(field + 10);
+    if (srv->id[0] == '\0')
+        snprintf(srv->id, sizeof(srv->id), "%.20s:%d", srv->ip, srv->port);
+    return 0;
+}
+
+// Ocena serwera: RTT w ms plus kara za zajętość (pełny serwer = +DISCOVERY_LOAD_WEIGHT ms).
+// Pełne serwery trafiają na koniec listy - zostają tylko jako ostatnia deska ratunku.
+static double score_server(const DiscoveredServer *srv) {
+    double load = srv->capacity > 0 ? (double)srv->clients / srv->capacity : 0.5;
+    double score = srv->rtt_ms + load * DISCOVERY_LOAD_WEIGHT;
+    if (srv->capacity > 0 && srv->clients >= srv->capacity)
+        score += 1e6;
+    return score;
+}
+
+static int compare_servers(const void *a, const void *b) {
+    double sa = ((const DiscoveredServer *)a)->score, sb = ((const DiscoveredServer *)b)->score;
+    return sa < sb ? -1 : sa > sb;
+}
+
+// Wysyła DISCOVERY_REQUEST na grupę multicast i zbiera odpowiedzi: do 3 s na pierwszą,
+// potem jeszcze DISCOVERY_WINDOW_MS na pozostałe serwery. Zwraca liczbę serwerów w 'out',
+// posortowanych od najlepszego (obciążenie i RTT), albo -1.
+int discover_servers(DiscoveredServer *out, int max, const char *interface_name) {
     int udp_sock;
     struct sockaddr_in addr;
     char buffer[BUFFER_SIZE];
-    struct timeval tv;
 
     // Utworzenie socketu UDP
     if ((udp_sock = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
@@ -130,11 +190,6 @@ int discover_server(char *out_ip, int *out_port, const char *interface_name) {
         return -1;
     }
 
-    // Ustawienie timeoutu na 3 sekundy
-    tv.tv_sec = 3;
-    tv.tv_usec = 0;
-    setsockopt(udp_sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-
     memset(&addr, 0, sizeof(addr));
     addr.sin_family      = AF_INET;
     addr.sin_addr.s_addr = inet_addr(MULTICAST_ADDR);
@@ -146,156 +201,161 @@ int discover_server(char *out_ip, int *out_port, const char *interface_name) {
     printf("[DISCOVERY] Sending DISCOVERY_REQUEST to %s:%d\n", MULTICAST_ADDR, DISCOVERY_PORT);
 
     const char *request = "DISCOVERY_REQUEST";
+    double sent_at = now_ms();
     if (sendto(udp_sock, request, strlen(request), 0, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
         perror("[DISCOVERY] sendto");
         close(udp_sock);
         return -1;
     }
 
-    struct sockaddr_in from_addr;
-    socklen_t from_len = sizeof(from_addr);
-    int n = recvfrom(udp_sock, buffer, sizeof(buffer)-1, 0, (struct sockaddr*)&from_addr, &from_len);
-    if (n < 0) {
+    int count = 0;
+    double deadline = sent_at + DISCOVERY_TIMEOUT_MS;
+    while (count < max) {
+        double left = deadline - now_ms();
+        if (left <= 0)
+            break;
+        struct pollfd pfd = { udp_sock, POLLIN, 0 };
+        if (poll(&pfd, 1, (int)left + 1) <= 0)
+            break;
+        int n = recv(udp_sock, buffer, sizeof(buffer) - 1, 0);
+        if (n < 0)
+            break;
+        double arrived = now_ms();
+        buffer[n] = '\0';
+        DiscoveredServer srv;
+        if (parse_discovery_reply(buffer, &srv) < 0) {
+            printf("[DISCOVERY] Unknown response: %s\n", buffer);
+            continue;
+        }
+        int duplicate = 0;
+        for (int i = 0; i < count; i++)
+            duplicate |= strcmp(out[i].id, srv.id) == 0;
+        if (duplicate)
+            continue;
+        srv.rtt_ms = arrived - sent_at;
+        srv.score = score_server(&srv);
+        out[count++] = srv;
+        if (count == 1)
+            deadline = arrived + DISCOVERY_WINDOW_MS;  // Pozostałe serwery mają krótkie okno
+    }
+    close(udp_sock);
+    if (count == 0) {
         printf("[DISCOVERY] No response (timeout?).\n");
-        close(udp_sock);
         return -1;
     }
-    buffer[n] = '\0';
-
-    if (strncmp(buffer, "SERVER_IP=", 9) == 0) {
-        char *p = buffer + 10;  // wskazuje na "X.X.X.X:port"
-        char *colon = strstr(p, ":");
-        if (!colon) {
-            printf("[DISCOVERY] Invalid response format.\n");
-            close(udp_sock);
-            return -1;
-        }
-        *colon = '\0';
-        colon++;
-        strcpy(out_ip, p);
-        *out_port = atoi(colon);
-        close(udp_sock);
-        return 0; // Sukces
-    }
 
-    printf("[DISCOVERY] Unknown response: %s\n", buffer);
-    close(udp_sock);
-    return -1;
+    qsort(out, count, sizeof(out[0]), compare_servers);
+    for (int i = 0; i < count; i++)
+        printf("[DISCOVERY] %s %s:%d  clients %d/%d, rooms %d, rtt %.2f ms\n", out[i].id,
+               out[i].ip, out[i].port, out[i].clients, out[i].capacity, out[i].rooms, out[i].rtt_ms);
+    return count;
 }
 
-/* ===================== Obsługa Odbioru Wiadomości ===================== */
+/* ===================== Buforowany Odczyt Linii ===================== */
 
-// Wątek odbierający wiadomości tekstowe z serwera (line-based)
-void *receive_messages(void *arg) {
-    static char lineBuf[4096];
-    static int lineLen = 0;
-    char tmp[512];
-    while (running) {
-        int n = recv(server_socket, tmp, sizeof(tmp), 0);
-        if (n <= 0) {
-            printf("Disconnected.\n");
-            running = 0;
-            break;
-        }
-        for (int i = 0; i < n; i++) {
-            char c = tmp[i];
-            lineBuf[lineLen++] = c;
-            // Jeśli natrafimy na znak nowej linii, kończymy buforowanie
-            if (c == '\n') {
-                lineBuf[lineLen-1] = '\0';
-                // Obsługa komunikatu TLV_PORT – inicjujemy oddzielne połączenie TLV
-                if (strncmp(lineBuf, "TLV_PORT ", 9) == 0) {
-                    int tlv_port = atoi(lineBuf + 9);
-                    printf("[TLV] Received TLV port: %d\n", tlv_port);
-                    struct sockaddr_in tlv_addr;
-                    tlv_socket = socket(AF_INET, SOCK_STREAM, 0);
-                    if (tlv_socket < 0) {
-                        perror("[TLV] TCP socket creation failed");
-                    } else {
-                        memset(&tlv_addr, 0, sizeof(tlv_addr));
-                        tlv_addr.sin_family = AF_INET;
-                        tlv_addr.sin_port = htons(tlv_port);
-                        if (inet_pton(AF_INET, global_server_ip, &tlv_addr.sin_addr) <= 0) {
-                            perror("[TLV] Invalid server address for TLV");
-                        } else {
-                            if (connect(tlv_socket, (struct sockaddr *)&tlv_addr, sizeof(tlv_addr)) < 0) {
-                                perror("[TLV] Connection to TLV channel failed");
-                            } else {
-                                if (send(tlv_socket, username, strlen(username), 0) < 0) {
-                                    perror("[TLV] Failed to send TLV username");
-                                }
-                                printf("[TLV] Connected to TLV channel.\n");
-                                pthread_create(&tlv_receive_thread, NULL, receive_tlv_messages, NULL);
-                                pthread_detach(tlv_receive_thread);
-                            }
-                        }
-                    }
-                    lineLen = 0;
-                    continue;
-                }
-                // Parsujemy komunikaty dotyczące gry
-                if (!parseBattleshipMessage(lineBuf, &myTurn, &gameStarted, username)) {
-                    printf("%s\n", lineBuf);
-                }
-                lineLen = 0;
+// Bufor odbiorczy kanału głównego. Wspólny dla handshake i wątku odbiorczego,
+// aby wiadomości, które przyszły w tym samym segmencie co "Username accepted", nie przepadły.
+static char rx_buf[4096];
+static int rx_start = 0;
+static int rx_end   = 0;
+
+// Czyści bufor odbiorczy (po zmianie gniazda serwera)
+static void reset_line_buffer(void) {
+    rx_start = 0;
+    rx_end   = 0;
+}
+
+// Zwraca kolejną linię z gniazda (bez "\r\n"), czytając dane większymi porcjami zamiast
+// pojedynczych bajtów. Zbyt długa linia jest zwracana w kawałkach. Po potwierdzeniu
+// protokołu binarnego zwraca też całe ramki (długość w bajtach). -1 oznacza rozłączenie.
+static int read_line_buffered(int sock, char *line, int size) {
+    while (1) {
+        int avail = rx_end - rx_start;
+        if (game.binaryProtocol && avail > 0 && proto_is_frame((unsigned char)rx_buf[rx_start])) {
+            int flen = proto_frame_length((unsigned char *)rx_buf + rx_start, avail);
+            if (flen < 0 || flen > size) {
+                rx_start++;  // Uszkodzona ramka - pomijamy kod operacji
+                continue;
             }
-            else if (lineLen >= 4095) {
-                lineBuf[lineLen] = '\0';
-                if (!parseBattleshipMessage(lineBuf, &myTurn, &gameStarted, username)) {
-                    printf("%s\n", lineBuf);
-                }
-                lineLen = 0;
+            if (flen > 0 && flen <= avail) {
+                memcpy(line, rx_buf + rx_start, flen);
+                rx_start += flen;
+                return flen;
+            }
+        } else {
+            char *nl = memchr(rx_buf + rx_start, '\n', avail);
+            int len = nl ? (int)(nl - (rx_buf + rx_start)) : avail;
+            if (nl || len >= size - 1) {
+                int consumed = len;
+                if (len > size - 1)
+                    len = consumed = size - 1;
+                else if (nl)
+                    consumed++;
+                memcpy(line, rx_buf + rx_start, len);
+                line[len] = '\0';
+                rx_start += consumed;
+                if (len > 0 && line[len - 1] == '\r')
+                    line[--len] = '\0';
+                return len;
             }
         }
+        // Niekompletna linia lub ramka - doczytujemy dane z gniazda
+        if (rx_start > 0) {
+            memmove(rx_buf, rx_buf + rx_start, avail);
+            rx_start = 0;
+            rx_end = avail;
+        }
+        int n = recv(sock, rx_buf + rx_end, sizeof(rx_buf) - rx_end, 0);
+        if (n <= 0)
+            return -1;
+        rx_end += n;
     }
-    return NULL;
+}
+
+// Wysyła jedną linię protokołu - serwer dzieli strumień po znakach nowej linii
+static int send_line(int sock, const char *text) {
+    char line[BUFFER_SIZE + 2];
+    int len = snprintf(line, sizeof(line), "%s\n", text);
+    if (len >= (int)sizeof(line))
+        return -1;
+    return (send(sock, line, len, 0) < 0) ? -1 : 0;
 }
 
 /* ===================== Handshake ===================== */
 
-// Funkcja blokująca odczyt jednej linii z socketu (używana podczas handshake)
-static int read_line_blocking(int sock, char *buf, int bufsize) {
-    int idx = 0;
-    while (idx < bufsize - 1) {
-        char c;
-        int n = recv(sock, &c, 1, 0);
-        if (n <= 0)
-            return -1;
-        if (c == '\n') {
-            buf[idx] = '\0';
-            return idx;
-        }
-        buf[idx++] = c;
-    }
-    buf[idx] = '\0';
-    return idx;
+// Wczytuje nazwę użytkownika z klawiatury
+static int prompt_username(void) {
+    printf("Your username: ");
+    fflush(stdout);
+    if (!fgets(username, sizeof(username), stdin))
+        return -1;
+    username[strcspn(username, "\n")] = '\0';
+    return 0;
 }
 
-// Funkcja negocjująca nazwę użytkownika – czeka na "Enter your username:" i wysyła nick
+// Kończy handshake rozpoczęty przez HELLO wysłane od razu po connect. Pierwszy prompt
+// serwera ("Enter your username:") jest pomijany - odpowiedzią na niego jest już HELLO.
+// Dopiero gdy nazwa zostanie odrzucona, pytamy użytkownika o kolejną.
 int handshake_username(int sockfd) {
     char line[BUFFER_SIZE];
+    int hello_in_flight = 1;
     while (1) {
-        int n = read_line_blocking(sockfd, line, sizeof(line));
-        if (n <= 0) {
+        int n = read_line_buffered(sockfd, line, sizeof(line));
+        if (n < 0) {
             printf("[CLIENT] Connection closed or error during handshake.\n");
             return -1;
         }
         if (strncmp(line, "Enter your username:", 20) == 0) {
+            if (hello_in_flight) {
+                hello_in_flight = 0;
+                continue;
+            }
             printf("%s\n", line);
-            printf("Your username: ");
-            fflush(stdout);
-            if (!fgets(username, sizeof(username), stdin))
+            if (prompt_username() < 0)
                 return -1;
-            username[strcspn(username, "\n")] = '\0';
-            if (send(sockfd, username, strlen(username), 0) < 0)
+            if (send_line(sockfd, username) < 0)
                 return -1;
         }
-        else if (strncmp(line, "Username in use", 15) == 0) {
-            printf("%s\n", line);
-        }
-        else if (strncmp(line, "Username cannot be empty", 24) == 0) {
-            printf("%s\n", line);
-        }
         else if (strncmp(line, "Username accepted", 17) == 0) {
             printf("%s\n", line);
             return 0;
@@ -307,63 +367,333 @@ int handshake_username(int sockfd) {
     return 0;
 }
 
+// Jedna próba wznowienia sesji na serwerze ip:port. RESUME wysyłamy od razu po connect,
+// bez czekania na prompt serwera. Zwraca 0 po wznowieniu, 1 gdy warto spróbować ponownie
+// (serwer nieosiągalny albo zapasowy jeszcze nie przejął gier), -1 gdy serwer nie zna tokenu.
+static int try_resume(const char *ip, int port) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons(port);
+    if (inet_pton(AF_INET, ip, &addr.sin_addr) <= 0)
+        return -1;
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0)
+        return 1;
+    char line[BUFFER_SIZE];
+    snprintf(line, sizeof(line), "RESUME %s", resume_token);
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        send_line(sock, line) < 0) {
+        close(sock);
+        return 1;
+    }
+    reset_line_buffer();
+    int n;
+    while ((n = read_line_buffered(sock, line, sizeof(line))) >= 0 &&
+           strncmp(line, "Enter your username:", 20) == 0) {
+        // Prompt wysłany przez serwer przed odczytem RESUME
+    }
+    if (n < 0 || strncmp(line, "Standby server", 14) == 0) {
+        close(sock);
+        return 1;
+    }
+    if (strncmp(line, "Username accepted", 17) == 0) {
+        int old_socket = game.socket;
+        game.socket = sock;
+        close(old_socket);
+        return 0;
+    }
+    // Serwer nie zna już tokenu - okres wznowienia minął
+    printf("%s\n", line);
+    close(sock);
+    return -1;
+}
+
+// Po zerwaniu połączenia próbuje wznowić sesję tokenem - serwer trzyma nasze miejsce przez chwilę.
+// Gdy serwer główny nie odpowiada, a znamy serwer zapasowy, próbujemy także tam.
+static int resume_session(void) {
+    for (int attempt = 1; attempt <= RESUME_ATTEMPTS; attempt++) {
+        printf("[CLIENT] Connection lost, resuming session (attempt %d/%d)...\n", attempt, RESUME_ATTEMPTS);
+        sleep(1);
+        int ret = try_resume(global_server_ip, global_server_port);
+        if (ret == 1 && standby_port) {
+            ret = try_resume(standby_ip, standby_port);
+            if (ret == 0) {
+                // Zapasowy przejął gry i jest teraz naszym serwerem
+                printf("[CLIENT] Primary server unreachable, continuing on the standby %s:%d.\n",
+                       standby_ip, standby_port);
+                snprintf(global_server_ip, sizeof(global_server_ip), "%s", standby_ip);
+                global_server_port = standby_port;
+                standby_port = 0;
+            }
+        }
+        if (ret == 0) {
+            printf("[CLIENT] Session resumed.\n");
+            return 0;
+        }
+        if (ret < 0)
+            return -1;
+    }
+    return -1;
+}
+
+/* ===================== Obsługa Odbioru Wiadomości ===================== */
+
+// Otwiera oddzielne połączenie TLV (plansze dla obserwatora) na porcie z komunikatu TLV_PORT
+static void connect_tlv(int tlv_port) {
+    printf("[TLV] Received TLV port: %d\n", tlv_port);
+    struct sockaddr_in tlv_addr;
+    tlv_socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (tlv_socket < 0) {
+        perror("[TLV] TCP socket creation failed");
+        return;
+    }
+    memset(&tlv_addr, 0, sizeof(tlv_addr));
+    tlv_addr.sin_family = AF_INET;
+    tlv_addr.sin_port = htons(tlv_port);
+    if (inet_pton(AF_INET, global_server_ip, &tlv_addr.sin_addr) <= 0) {
+        perror("[TLV] Invalid server address for TLV");
+        return;
+    }
+    if (connect(tlv_socket, (struct sockaddr *)&tlv_addr, sizeof(tlv_addr)) < 0) {
+        perror("[TLV] Connection to TLV channel failed");
+        return;
+    }
+    if (send(tlv_socket, username, strlen(username), 0) < 0) {
+        perror("[TLV] Failed to send TLV username");
+    }
+    printf("[TLV] Connected to TLV channel.\n");
+    pthread_create(&tlv_receive_thread, NULL, receive_tlv_messages, NULL);
+    pthread_detach(tlv_receive_thread);
+}
+
+static int follow_redirect(const char *args);
+
+// Wątek odbierający wiadomości tekstowe z serwera (line-based)
+void *receive_messages(void *arg) {
+    (void)arg;
+    char lineBuf[4096];
+    while (running) {
+        int n = read_line_buffered(game.socket, lineBuf, sizeof(lineBuf));
+        if (n < 0) {
+            if (running && resume_token[0] && resume_session() == 0)
+                continue;
+            printf("Disconnected.\n");
+            running = 0;
+            break;
+        }
+        // Ramka binarna (po "PROTOCOL bin") - strzały, tury i czat
+        if (game.binaryProtocol && proto_is_frame((unsigned char)lineBuf[0])) {
+            parseBattleshipFrame(&game, (unsigned char *)lineBuf, n);
+            continue;
+        }
+        const char *args;
+        int id = command_find(&server_messages, lineBuf, &args);
+        switch (id) {
+        case MSG_PING:
+            // Heartbeat serwera - odpowiadamy od razu, bez wypisywania
+            if (send_line(game.socket, "PONG") < 0)
+                perror("[CLIENT] Send heartbeat failed");
+            break;
+        case MSG_RESUME_TOKEN:
+            // Token wznowienia sesji - zapamiętujemy na wypadek zerwania połączenia
+            strncpy(resume_token, args, sizeof(resume_token) - 1);
+            resume_token[sizeof(resume_token) - 1] = '\0';
+            break;
+        case MSG_PROTOCOL:
+            // Serwer przyjął możliwość z HELLO ("bin" - komunikaty gry mogą przychodzić
+            // jako ramki, "delta" - plansza idzie do serwera przyrostowo)
+            gameProtocolAccepted(&game, args);
+            break;
+        case MSG_TLV_PORT:
+            // Inicjujemy oddzielne połączenie TLV
+            connect_tlv(atoi(args));
+            break;
+        case MSG_STANDBY:
+            // Adres serwera zapasowego - na wypadek awarii serwera głównego
+            if (sscanf(args, "%99[^:]:%d", standby_ip, &standby_port) != 2)
+                standby_port = 0;
+            break;
+        case MSG_REDIRECT:
+            // Pokój z /list klastra jest na innym węźle - przechodzimy tam i dołączamy
+            if (follow_redirect(args) < 0)
+                printf("[CLIENT] Redirect failed, staying on %s:%d.\n", global_server_ip, global_server_port);
+            break;
+        default:
+            // Komunikaty gry; pozostałe wypisujemy
+            if (!parseBattleshipMessage(&game, id, args))
+                printf("%s\n", lineBuf);
+        }
+    }
+    return NULL;
+}
+
+/* ===================== Połączenie ===================== */
+
+// Łączy się z serwerem i od razu wysyła HELLO (handshake zajmuje jedno RTT).
+// Zwraca gniazdo albo -1.
+static int connect_server(const char *ip, int port, int use_tfo) {
+    struct sockaddr_in server_address;
+    memset(&server_address, 0, sizeof(server_address));
+    server_address.sin_family = AF_INET;
+    server_address.sin_port   = htons(port);
+    if (inet_pton(AF_INET, ip, &server_address.sin_addr) <= 0) {
+        fprintf(stderr, "[CLIENT] Invalid server address: %s\n", ip);
+        return -1;
+    }
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) {
+        perror("[CLIENT] TCP socket creation failed");
+        return -1;
+    }
+    if (use_tfo) {
+        // connect() wraca od razu, a HELLO poleci w segmencie SYN (gdy mamy ciasteczko TFO)
+        int one = 1;
+        if (setsockopt(sock, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &one, sizeof(one)) < 0)
+            perror("[CLIENT] TCP Fast Open unavailable, using regular connect");
+    }
+    if (connect(sock, (struct sockaddr *)&server_address, sizeof(server_address)) < 0) {
+        perror("[CLIENT] Connection failed");
+        close(sock);
+        return -1;
+    }
+    char hello[BUFFER_SIZE];
+    snprintf(hello, sizeof(hello), "HELLO %s %s", username, CLIENT_CAPS);
+    if (send_line(sock, hello) < 0) {
+        perror("[CLIENT] Send HELLO failed");
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+// REDIRECT <adres>:<port> <pokój>: łączy się z węzłem klastra, który ma pokój, i wysyła tam
+// /join. Wywoływane przez wątek odbiorczy, więc handshake czyta nowe gniazdo bez wyścigu.
+// Przy niepowodzeniu zostajemy na bieżącym serwerze. Zwraca 0 albo -1.
+static int follow_redirect(const char *args) {
+    char host[100];
+    int port, room;
+    if (sscanf(args, "%99[^:]:%d %d", host, &port, &room) != 3)
+        return -1;
+    printf("[INFO] Room %d is on %s:%d, switching server.\n", room, host, port);
+    int sock = connect_server(host, port, 0);
+    if (sock < 0)
+        return -1;
+    // Resztę bufora starego połączenia porzucamy - dalej czytamy już tylko nowy serwer
+    reset_line_buffer();
+    game.binaryProtocol = 0;
+    game.boardDeltas = 0;
+    game.boardSynced = 0;
+    resume_token[0] = '\0';
+    standby_port = 0;  // Serwer zapasowy poprzedniego węzła nie zna naszej nowej sesji
+    if (handshake_username(sock) < 0) {
+        close(sock);
+        return -1;
+    }
+    int old_socket = game.socket;
+    game.socket = sock;
+    close(old_socket);  // W lobby serwer nie trzyma miejsca - zwykłe rozłączenie
+    snprintf(global_server_ip, sizeof(global_server_ip), "%s", host);
+    global_server_port = port;
+
+    char join[32];
+    snprintf(join, sizeof(join), "/join %d", room);
+    return send_line(game.socket, join);
+}
+
 /* ===================== Funkcja main ===================== */
 
 int main(int argc, char *argv[]) {
     char server_ip[100];
     int server_port = DEF_SERVER_PORT;  // Port domyślny
 
-    if (argc < 2) {
+    const char *interface_name = NULL;
+    int direct = 0;
+    int use_tfo = 0;
+    int render_mode = screen_mode_auto(STDOUT_FILENO);
+
+    // Przetwarzanie argumentów wiersza poleceń
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--serverIP") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: Missing <server IP> argument.\n");
+                return 1;
+            }
+            strncpy(server_ip, argv[++i], sizeof(server_ip) - 1);
+            server_ip[sizeof(server_ip) - 1] = '\0';
+            direct = 1;
+        } else if (strcmp(argv[i], "--user") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: Missing <username> argument.\n");
+                return 1;
+            }
+            strncpy(username, argv[++i], sizeof(username) - 1);
+            username[sizeof(username) - 1] = '\0';
+        } else if (strcmp(argv[i], "--tfo") == 0) {
+            use_tfo = 1;
+        } else if (strcmp(argv[i], "--render") == 0) {
+            if (i + 1 >= argc || (render_mode = screen_mode_find(argv[++i])) < 0) {
+                fprintf(stderr, "Error: --render expects ansi, plain or quiet.\n");
+                return 1;
+            }
+        } else {
+            interface_name = argv[i];
+        }
+    }
+    if (!direct && !interface_name) {
         fprintf(stderr, "Usage:\n");
         fprintf(stderr, "  %s <interface IP>                 (automatic discovery)\n", argv[0]);
         fprintf(stderr, "  %s --serverIP <server IP>        (direct connect)\n", argv[0]);
+        fprintf(stderr, "Options:\n");
+        fprintf(stderr, "  --user <name>                     (skip the username prompt)\n");
+        fprintf(stderr, "  --tfo                             (send HELLO with TCP Fast Open)\n");
+        fprintf(stderr, "  --render <ansi|plain|quiet>       (board drawing; default ansi on a terminal)\n");
         return 1;
     }
 
-    // Przetwarzanie argumentów wiersza poleceń
-    if (strcmp(argv[1], "--serverIP") == 0) {
-        if (argc < 3) {
-            fprintf(stderr, "Error: Missing <server IP> argument.\n");
-            return 1;
-        }
-        strcpy(server_ip, argv[2]);
-    } else {
-        const char *interface_name = argv[1];
+    // Nazwę pobieramy przed połączeniem, aby HELLO mogło wyjść razem z nawiązaniem połączenia
+    if (username[0] == '\0' && prompt_username() < 0)
+        return 1;
+
+    DiscoveredServer servers[DISCOVERY_MAX_SERVERS];
+    int server_count = 1;
+    if (!direct) {
         printf("[DISCOVERY] Attempting to find server via multicast...\n");
-        if (discover_server(server_ip, &server_port, interface_name) < 0) {
+        server_count = discover_servers(servers, DISCOVERY_MAX_SERVERS, interface_name);
+        if (server_count < 0) {
             printf("[DISCOVERY] Failed. Exiting.\n");
             return 1;
         }
+    } else {
+        memset(&servers[0], 0, sizeof(servers[0]));
+        snprintf(servers[0].ip, sizeof(servers[0].ip), "%s", server_ip);
+        servers[0].port = server_port;
     }
-    // Ustawienie globalnego adresu serwera (do TLV)
-    strcpy(global_server_ip, server_ip);
-
-    printf("[INFO] Connecting to server at %s:%d\n", server_ip, server_port);
-
-    struct sockaddr_in server_address;
-    server_socket = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_socket < 0) {
-        perror("[CLIENT] TCP socket creation failed");
-        exit(EXIT_FAILURE);
-    }
-    memset(&server_address, 0, sizeof(server_address));
-    server_address.sin_family = AF_INET;
-    server_address.sin_port   = htons(server_port);
-    if (inet_pton(AF_INET, server_ip, &server_address.sin_addr) <= 0) {
-        perror("[CLIENT] Invalid server address");
-        close(server_socket);
-        exit(EXIT_FAILURE);
+    signal(SIGPIPE, SIG_IGN);  // Wysyłka przy zerwanym połączeniu nie może zabić klienta
+
+    // Serwery próbujemy od najlepszego; gdy połączenie się nie uda, bierzemy kolejny
+    int sock = -1;
+    for (int i = 0; i < server_count && sock < 0; i++) {
+        printf("[INFO] Connecting to server at %s:%d\n", servers[i].ip, servers[i].port);
+        sock = connect_server(servers[i].ip, servers[i].port, use_tfo);
+        if (sock >= 0) {
+            // Ustawienie globalnego adresu serwera (do TLV i wznawiania sesji)
+            strcpy(global_server_ip, servers[i].ip);
+            global_server_port = servers[i].port;
+        } else if (i + 1 < server_count) {
+            printf("[INFO] Trying the next server.\n");
+        }
     }
-    if (connect(server_socket, (struct sockaddr *)&server_address, sizeof(server_address)) < 0) {
-        perror("[CLIENT] Connection failed");
-        close(server_socket);
+    if (sock < 0)
         exit(EXIT_FAILURE);
-    }
-    if (handshake_username(server_socket) < 0) {
-        close(server_socket);
+    gameInit(&game, sock, username);
+    screen_init(&screen, render_mode, STDOUT_FILENO, BOARD_SIZE);
+    game.render = renderGameBoards;
+    if (handshake_username(game.socket) < 0) {
+        close(game.socket);
         return 1;
     }
-    initBoards();
+    initBoards(&game);
     pthread_create(&receive_thread, NULL, receive_messages, NULL);
 
     char message[BUFFER_SIZE];
@@ -375,29 +705,29 @@ int main(int argc, char *argv[]) {
         if (message[0] == '/') {
             // Obsługa komend wysyłanych przez klienta
             if (strncmp(message, "/exit", 5) == 0) {
-                if (send(server_socket, message, strlen(message), 0) < 0)
+                if (send_line(game.socket, message) < 0)
                     printf("[CLIENT] Send error.\n");
                 continue;
             }
             else if (strncmp(message, "/create", 7) == 0) {
                 // Klient tworzący pokój jest pierwszym graczem
-                amFirstPlayer = 1;
-                if (send(server_socket, message, strlen(message), 0) < 0)
+                game.amFirstPlayer = 1;
+                if (send_line(game.socket, message) < 0)
                     printf("[CLIENT] Send error.\n");
                 continue;
             }
             else if (strncmp(message, "/join ", 6) == 0) {
                 // Klient dołączający do pokoju jako drugi gracz
-                amFirstPlayer = 0;
-                if (send(server_socket, message, strlen(message), 0) < 0)
+                game.amFirstPlayer = 0;
+                if (send_line(game.socket, message) < 0)
                     printf("[CLIENT] Send error.\n");
                 continue;
             }
             else if (strncmp(message, "/place", 6) == 0) {
-                if (inRoom && !iAmObserver) {
-                    placeShipsLocally();
-                    sendBoardUpdate();  // Wysyłamy stan planszy po rozstawieniu statków
-                } else if (iAmObserver) {
+                if (game.inRoom && !game.iAmObserver) {
+                    placeShipsLocally(&game);
+                    sendBoardUpdate(&game);  // Wysyłamy stan planszy po rozstawieniu statków
+                } else if (game.iAmObserver) {
                     printf("Observer cannot /place.\n");
                 } else {
                     printf("[WARNING] You can use /place only in game room!\n");
@@ -405,23 +735,23 @@ int main(int argc, char *argv[]) {
                 continue;
             }
             else if (strncmp(message, "/start", 6) == 0) {
-                if (!placedShips)
+                if (!game.placedShips)
                     printf("[BATTLESHIP] You must /place your ships first!\n");
                 if (iAmReady)
                     printf("[BATTLESHIP] You have already used /start!\n");
-                if (gameStarted)
+                if (game.gameStarted)
                     printf("[BATTLESHIP] Game has already started.\n");
                 iAmReady = 1;
-                if (send(server_socket, "/start", 6, 0) < 0)
+                if (send_line(game.socket, "/start") < 0)
                     printf("[CLIENT] Send error.\n");
                 continue;
             }
             else if (strncmp(message, "/fire ", 6) == 0) {
-                if (!gameStarted) {
+                if (!game.gameStarted) {
                     printf("[BATTLESHIP] Game not started.\n");
                     continue;
                 }
-                if (!myTurn) {
+                if (!game.myTurn) {
                     printf("[BATTLESHIP] It's not your turn!\n");
                     continue;
                 }
@@ -431,9 +761,7 @@ int main(int argc, char *argv[]) {
                         printf("[BATTLESHIP] Invalid coords.\n");
                         continue;
                     }
-                    char msg_to_send[BUFFER_SIZE];
-                    snprintf(msg_to_send, sizeof(msg_to_send), "FIRE %d %d %s", x, y, username);
-                    if (send(server_socket, msg_to_send, strlen(msg_to_send), 0) < 0)
+                    if (sendShot(&game, PROTO_FIRE, x, y) < 0)
                         printf("[CLIENT] Send error.\n");
                 } else {
                     printf("[BATTLESHIP] Usage: /fire x y\n");
@@ -441,10 +769,18 @@ int main(int argc, char *argv[]) {
                 continue;
             }
             // Wysyłanie pozostałych komend bez modyfikacji
-            if (send(server_socket, message, strlen(message), 0) < 0)
+            if (send_line(game.socket, message) < 0)
+                printf("[CLIENT] Send error.\n");
+        } else if (game.binaryProtocol) {
+            // Wiadomość czatu jako ramka
+            unsigned char frame[PROTO_MAX_FRAME];
+            int flen = proto_chat(frame, message, (int)strlen(message));
+            if (sendFrame(&game, frame, flen) < 0) {
                 printf("[CLIENT] Send error.\n");
+                break;
+            }
         } else {
-            if (send(server_socket, message, strlen(message), 0) < 0) {
+            if (send_line(game.socket, message) < 0) {
                 printf("[CLIENT] Send error.\n");
                 break;
             }
@@ -453,9 +789,10 @@ int main(int argc, char *argv[]) {
     running = 0;
     pthread_cancel(receive_thread);
     pthread_join(receive_thread, NULL);
-    close(server_socket);
+    close(game.socket);
     if (tlv_socket != -1)
         close(tlv_socket);
+    screen_close(&screen);
     printf("[CLIENT] Terminated.\n");
     return 0;
 }
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca & Marcel Gacoń
+ * AGH - Programowanie sieciowe
+ */
+
+#ifndef KOMENDY_H
+#define KOMENDY_H
+
+/*
+ * Wspólny rejestr komend protokołu tekstowego.
+ *
+ * Każda komenda to czasownik (pierwsze słowo linii) z identyfikatorem i maską ról,
+ * które mogą jej użyć. Listy poniżej są makrami X - z nich kompilator generuje enum
+ * identyfikatorów i tablice specyfikacji, a serwer i klient przypisują identyfikatorom
+ * swoje funkcje obsługi. Nowa komenda to jedna linia w liście i jedna funkcja obsługi.
+ *
+ * Wyszukiwanie czasownika nie przechodzi po liście: indeks kubełków według pierwszego
+ * znaku (dla komend "/..." - drugiego) budowany jest raz z rejestru, a kubełek zawiera
+ * najwyżej kilka komend różniących się długością lub treścią. Koszt rozpoznania linii
+ * nie zależy więc od liczby komend ani od ich kolejności.
+ */
+
+/* ===================== Includy ===================== */
+#include <string.h>
+#include <pthread.h>
+
+/* ===================== Role ===================== */
+#define ROLE_LOBBY     0x01   // Zalogowany, poza pokojem
+#define ROLE_PLAYER    0x02   // Gracz w pokoju
+#define ROLE_OBSERVER  0x04   // Obserwator w pokoju
+#define ROLE_IN_ROOM   (ROLE_PLAYER | ROLE_OBSERVER)
+#define ROLE_ANY       (ROLE_LOBBY | ROLE_IN_ROOM)
+
+/* ===================== Rejestr ===================== */
+// Komendy klienta wykonywane przez serwer: X(id, czasownik, role, odmowa dla obserwatora)
+#define CLIENT_COMMANDS(X) \
+    X(CMD_CREATE,  "/create", ROLE_LOBBY,                NULL) \
+    X(CMD_JOIN,    "/join",   ROLE_LOBBY,                NULL) \
+    X(CMD_LIST,    "/list",   ROLE_LOBBY,                NULL) \
+    X(CMD_EXIT,    "/exit",   ROLE_ANY,                  NULL) \
+    X(CMD_START,   "/start",  ROLE_PLAYER,               "Observer cannot /start.\n") \
+    X(CMD_FIRE,    "FIRE",    ROLE_PLAYER,               "Observer cannot FIRE.\n") \
+    X(CMD_HIT,     "HIT",     ROLE_PLAYER,               NULL) \
+    X(CMD_MISS,    "MISS",    ROLE_PLAYER,               NULL) \
+    X(CMD_YOU_WIN, "YOU_WIN", ROLE_PLAYER,               NULL) \
+    X(CMD_BOARD0,  "BOARD0",  ROLE_PLAYER,               NULL) \
+    X(CMD_BOARD1,  "BOARD1",  ROLE_PLAYER,               NULL) \
+    X(CMD_BOARD_DELTA, "BOARD_DELTA", ROLE_PLAYER,       NULL) \
+    X(CMD_PONG,    "PONG",    ROLE_ANY,                  NULL) \
+    X(CMD_CHAT,    "",        ROLE_LOBBY | ROLE_PLAYER,  "Observer cannot send messages.\n")
+
+// Komunikaty serwera obsługiwane przez klienta (rolą klienta jest gracz albo obserwator)
+#define SERVER_MESSAGES(X) \
+    X(MSG_JOINED_ROOM,          "JOINED_ROOM",          ROLE_ANY,      NULL) \
+    X(MSG_JOINED_ROOM_OBSERVER, "JOINED_ROOM_OBSERVER", ROLE_ANY,      NULL) \
+    X(MSG_ENTERING_LOBBY,       "ENTERING_LOBBY",       ROLE_ANY,      NULL) \
+    X(MSG_GAME_START,           "GAME_START",           ROLE_PLAYER,   NULL) \
+    X(MSG_NEXT_TURN,            "NEXT_TURN",            ROLE_PLAYER,   NULL) \
+    X(MSG_FIRE,                 "FIRE",                 ROLE_PLAYER,   NULL) \
+    X(MSG_HIT,                  "HIT",                  ROLE_PLAYER,   NULL) \
+    X(MSG_MISS,                 "MISS",                 ROLE_PLAYER,   NULL) \
+    X(MSG_RESUME_STATE,         "RESUME_STATE",         ROLE_PLAYER,   NULL) \
+    X(MSG_TURN_TIMEOUT,         "TURN_TIMEOUT",         ROLE_PLAYER,   NULL) \
+    X(MSG_YOU_WIN,              "YOU_WIN",              ROLE_PLAYER,   NULL) \
+    X(MSG_GAME_NOT_STARTED,     "GAME_NOT_STARTED",     ROLE_OBSERVER, NULL) \
+    X(MSG_GAME_STARTED,         "GAME_STARTED",         ROLE_OBSERVER, NULL) \
+    X(MSG_PING,                 "PING",                 ROLE_ANY,      NULL) \
+    X(MSG_RESUME_TOKEN,         "RESUME_TOKEN",         ROLE_ANY,      NULL) \
+    X(MSG_TLV_PORT,             "TLV_PORT",             ROLE_ANY,      NULL) \
+    X(MSG_PROTOCOL,             "PROTOCOL",             ROLE_ANY,      NULL) \
+    X(MSG_REDIRECT,             "REDIRECT",             ROLE_ANY,      NULL) \
+    X(MSG_STANDBY,              "STANDBY",              ROLE_ANY,      NULL) \
+    X(MSG_BOARD_ACK,            "BOARD_ACK",            ROLE_PLAYER,   NULL) \
+    X(MSG_BOARD_RESYNC,         "BOARD_RESYNC",         ROLE_PLAYER,   NULL)
+
+#define COMMAND_ENUM(id, verb, roles, denied) id,
+enum { CMD_NONE, CLIENT_COMMANDS(COMMAND_ENUM) CMD_COUNT };
+enum { MSG_NONE, SERVER_MESSAGES(COMMAND_ENUM) MSG_COUNT };
+#undef COMMAND_ENUM
+
+typedef struct {
+    const char *verb;      // "" - komenda bez czasownika (czat, czyli linia nie będąca komendą)
+    int length;
+    int roles;
+    const char *denied;    // Odpowiedź dla roli w pokoju, której komenda nie przysługuje
+} CommandSpec;
+
+#define COMMAND_SPEC(id, verb, roles, denied) [id] = { verb, sizeof(verb) - 1, roles, denied },
+static const CommandSpec client_command_specs[CMD_COUNT] = { CLIENT_COMMANDS(COMMAND_SPEC) };
+static const CommandSpec server_message_specs[MSG_COUNT] = { SERVER_MESSAGES(COMMAND_SPEC) };
+#undef COMMAND_SPEC
+
+/* ===================== Indeks ===================== */
+// Kubełki według znaku klucza; identyfikatory w kubełku połączone listą
+#define COMMAND_MAX  64
+
+_Static_assert(CMD_COUNT <= COMMAND_MAX && MSG_COUNT <= COMMAND_MAX, "command registry too large");
+
+typedef struct {
+    const CommandSpec *specs;
+    int count;
+    unsigned char head[256];           // Pierwszy identyfikator w kubełku (0 = pusty)
+    unsigned char next[COMMAND_MAX];   // Kolejny identyfikator w tym samym kubełku
+} CommandIndex;
+
+static CommandIndex client_commands = { client_command_specs, CMD_COUNT, { 0 }, { 0 } };
+static CommandIndex server_messages = { server_message_specs, MSG_COUNT, { 0 }, { 0 } };
+static pthread_once_t command_index_once = PTHREAD_ONCE_INIT;
+
+// Znak wybierający kubełek: komendy "/..." różnią się dopiero drugim znakiem
+static inline unsigned char command_key(const char *verb) {
+    return (unsigned char)(verb[0] == '/' ? verb[1] : verb[0]);
+}
+
+static inline void command_index_fill(CommandIndex *index) {
+    for (int id = index->count - 1; id > 0; id--) {
+        const CommandSpec *spec = &index->specs[id];
+        if (spec->length == 0)
+            continue;
+        unsigned char key = command_key(spec->verb);
+        index->next[id] = index->head[key];
+        index->head[key] = (unsigned char)id;
+    }
+}
+
+static void command_index_build(void) {
+    command_index_fill(&client_commands);
+    command_index_fill(&server_messages);
+}
+
+/* ===================== Wyszukiwanie ===================== */
+// Rozpoznaje czasownik linii (słowo do pierwszej spacji). Zwraca identyfikator komendy
+// albo 0 (CMD_NONE / MSG_NONE), a w *args - początek argumentów (pusty napis, gdy brak).
+static inline int command_find(CommandIndex *index, const char *line, const char **args) {
+    pthread_once(&command_index_once, command_index_build);
+    const char *space = strchr(line, ' ');
+    int length = space ? (int)(space - line) : (int)strlen(line);
+    if (args)
+        *args = space ? space + 1 : line + length;
+    if (length == 0 || (line[0] == '/' && length < 2))
+        return 0;
+    for (int id = index->head[command_key(line)]; id; id = index->next[id]) {
+        const CommandSpec *spec = &index->specs[id];
+        if (spec->length == length && memcmp(spec->verb, line, length) == 0)
+            return id;
+    }
+    return 0;
+}
+
+// Czy rola może użyć komendy
+static inline int command_allowed(const CommandIndex *index, int id, int role) {
+    return (index->specs[id].roles & role) != 0;
+}
+
+#endif // KOMENDY_H
@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca & Marcel Gacoń
+ * AGH - Programowanie sieciowe
+ */
+
+#ifndef METRYKI_H
+#define METRYKI_H
+
+/*
+ * Metryki serwera: liczniki i histogramy zbierane bez blokad.
+ *
+ * Każdy wątek (reaktor, wątek puli) pisze do własnego fragmentu (MetricsShard),
+ * rejestrowanego przy pierwszym zdarzeniu. Zapis to zwykłe dodanie do pola fragmentu
+ * (atomowy zapis relaxed bez prefiksu lock - jedynym piszącym jest właściciel), więc
+ * zdarzenie kosztuje kilka nanosekund i nie dzieli linii cache z innymi wątkami.
+ * Odczyt (zrzut metryk) sumuje wszystkie fragmenty.
+ *
+ * Histogramy są w stylu HDR: wartość trafia do kubełka wyznaczonego przez jej najstarszy
+ * bit i 3 kolejne bity (8 podkubełków na każdą potęgę dwójki), co daje błąd względny
+ * poniżej 12,5% w zakresie od 1 do 2^64 przy stałej liczbie kubełków.
+ *
+ * Zrzut jest w formacie tekstowym Prometheusa: liczniki jako counter, histogramy jako
+ * summary z kwantylami liczonymi z kubełków.
+ */
+
+/* ===================== Includy ===================== */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "komendy.h"  // Czasowniki komend (etykiety licznika komunikatów)
+
+/* ===================== Rejestr Metryk ===================== */
+#define METRICS_PREFIX  "battleship_"
+
+// X(id, nazwa, opis)
+#define METRIC_COUNTERS(X) \
+    X(MET_CONN_ACCEPTED,      "connections_accepted_total", "TCP connections accepted") \
+    X(MET_CONN_CLOSED,        "connections_closed_total",   "TCP connections closed") \
+    X(MET_HANDSHAKE_OK,       "handshakes_total",           "Successful username handshakes") \
+    X(MET_HANDSHAKE_REJECTED, "handshakes_rejected_total",  "Handshake lines rejected (empty name, name in use, server full, no random token)") \
+    X(MET_HANDSHAKE_TIMEOUT,  "handshake_timeouts_total",   "Connections dropped for not finishing the handshake in time") \
+    X(MET_SESSIONS_RESUMED,   "sessions_resumed_total",     "Held sessions taken over with RESUME") \
+    X(MET_ROOMS_CREATED,      "rooms_created_total",        "Rooms created with /create") \
+    X(MET_ROOMS_RECLAIMED,    "rooms_reclaimed_total",      "Empty rooms released for reuse") \
+    X(MET_GAMES_FINISHED,     "games_finished_total",       "Games that ended with a winner") \
+    X(MET_BYTES_IN,           "bytes_in_total",             "Bytes received from clients") \
+    X(MET_BYTES_OUT,          "bytes_out_total",            "Bytes written to clients") \
+    X(MET_SEND_STALLS,        "send_stalls_total",          "Writes the socket did not take in full (rest queued in the output buffer)") \
+    X(MET_OUTPUT_OVERFLOWS,   "output_overflows_total",     "Clients disconnected for an output buffer overflow") \
+    X(MET_MAILBOX_FULL,       "mailbox_full_total",         "Commands dropped because a room or client mailbox was full") \
+    X(MET_DISCOVERY_REPLIES,  "discovery_replies_total",    "UDP discovery replies sent") \
+    X(MET_DISCOVERY_LIMITED,  "discovery_rate_limited_total", "UDP discovery requests dropped by the per-address rate limit") \
+    X(MET_OBSERVER_CONFLATED, "observer_updates_conflated_total", "Observer board updates replaced by a newer one before they were sent") \
+    X(MET_BOARD_DELTAS,       "board_deltas_total",         "Incremental board updates (BOARD_DELTA) applied") \
+    X(MET_BOARD_RESYNCS,      "board_resyncs_total",        "Full boards requested with BOARD_RESYNC after a delta did not match")
+
+// X(id, nazwa, skala wartości -> jednostka nazwy, opis)
+#define METRIC_HISTOGRAMS(X) \
+    X(HIST_FIRE_TO_NEXT_TURN,  "fire_to_next_turn_seconds", 1e-9, "Time from a FIRE applied by the room to the NEXT_TURN after its result") \
+    X(HIST_OBSERVER_FANOUT,    "observer_fanout",           1.0,  "Observers reached by one board update") \
+    X(HIST_SEND_QUEUE_BYTES,   "send_queue_bytes",          1.0,  "Output buffer size after a stalled send") \
+    X(HIST_ROOM_MAILBOX_DEPTH, "room_mailbox_depth",        1.0,  "Room mailbox depth seen when a command is posted") \
+    X(HIST_CLIENT_MAILBOX_DEPTH, "client_mailbox_depth",    1.0,  "Client mailbox depth seen when an input line is posted")
+
+#define METRIC_ENUM(id, ...) id,
+enum { METRIC_COUNTERS(METRIC_ENUM) MET_COUNT };
+enum { METRIC_HISTOGRAMS(METRIC_ENUM) HIST_COUNT };
+#undef METRIC_ENUM
+
+/* ===================== Histogram HDR ===================== */
+#define METRIC_SUB_BITS     3
+#define METRIC_SUB_BUCKETS  (1 << METRIC_SUB_BITS)
+#define METRIC_BUCKETS      (METRIC_SUB_BUCKETS + (64 - METRIC_SUB_BITS) * METRIC_SUB_BUCKETS)
+#define METRICS_MAX_SHARDS  256   // Więcej wątków dzieli ostatni fragment (wyniki przybliżone)
+
+typedef struct {
+    unsigned long long count;
+    unsigned long long sum;
+    unsigned long long buckets[METRIC_BUCKETS];
+} MetricHistogram;
+
+typedef struct {
+    unsigned long long counters[MET_COUNT];
+    unsigned long long verbs[CMD_COUNT];   // Komendy klientów według czasownika
+    MetricHistogram hist[HIST_COUNT];
+} __attribute__((aligned(64))) MetricsShard;
+
+static MetricsShard *metrics_shards[METRICS_MAX_SHARDS];
+static int metrics_shard_count;
+static __thread MetricsShard *metrics_tls;
+
+// Kubełek wartości: małe wartości wprost, dalej potęga dwójki + 3 bity mantysy
+static inline int metric_bucket(unsigned long long v) {
+    if (v < METRIC_SUB_BUCKETS)
+        return (int)v;
+    int e = 63 - __builtin_clzll(v);
+    return METRIC_SUB_BUCKETS + (e - METRIC_SUB_BITS) * METRIC_SUB_BUCKETS +
+           (int)((v >> (e - METRIC_SUB_BITS)) & (METRIC_SUB_BUCKETS - 1));
+}
+
+// Największa wartość, która trafia do kubełka (raportowana jako kwantyl)
+static inline unsigned long long metric_bucket_max(int b) {
+    if (b < METRIC_SUB_BUCKETS)
+        return (unsigned long long)b;
+    int e = (b - METRIC_SUB_BUCKETS) / METRIC_SUB_BUCKETS + METRIC_SUB_BITS;
+    unsigned long long sub = (unsigned long long)((b - METRIC_SUB_BUCKETS) % METRIC_SUB_BUCKETS);
+    unsigned long long width = 1ULL << (e - METRIC_SUB_BITS);
+    return ((METRIC_SUB_BUCKETS + sub) << (e - METRIC_SUB_BITS)) + (width - 1);
+}
+
+/* ===================== Zapis ===================== */
+static MetricsShard *metrics_register(void) {
+    MetricsShard *shard = aligned_alloc(64, sizeof(MetricsShard));
+    int slot = __atomic_fetch_add(&metrics_shard_count, 1, __ATOMIC_RELAXED);
+    if (!shard || slot >= METRICS_MAX_SHARDS) {
+        free(shard);
+        __atomic_fetch_sub(&metrics_shard_count, 1, __ATOMIC_RELAXED);
+        return metrics_shards[METRICS_MAX_SHARDS - 1];
+    }
+    memset(shard, 0, sizeof(*shard));
+    __atomic_store_n(&metrics_shards[slot], shard, __ATOMIC_RELEASE);
+    return shard;
+}
+
+static inline MetricsShard *metrics_local(void) {
+    if (__builtin_expect(metrics_tls == NULL, 0))
+        metrics_tls = metrics_register();
+    return metrics_tls;
+}
+
+// Dodanie do pola fragmentu bieżącego wątku (jedyny piszący - wystarczy load + store)
+#define METRIC_BUMP(field, n) \
+    __atomic_store_n(&(field), __atomic_load_n(&(field), __ATOMIC_RELAXED) + (n), __ATOMIC_RELAXED)
+
+static inline void metric_add(int id, unsigned long long n) {
+    MetricsShard *s = metrics_local();
+    if (s)
+        METRIC_BUMP(s->counters[id], n);
+}
+
+static inline void metric_inc(int id) {
+    metric_add(id, 1);
+}
+
+static inline void metric_verb(int cmd) {
+    MetricsShard *s = metrics_local();
+    if (s)
+        METRIC_BUMP(s->verbs[cmd], 1);
+}
+
+static inline void metric_observe(int id, unsigned long long value) {
+    MetricsShard *s = metrics_local();
+    if (!s)
+        return;
+    MetricHistogram *h = &s->hist[id];
+    METRIC_BUMP(h->count, 1);
+    METRIC_BUMP(h->sum, value);
+    METRIC_BUMP(h->buckets[metric_bucket(value)], 1);
+}
+
+// Czas monotoniczny w nanosekundach (do histogramów opóźnień)
+static inline unsigned long long metric_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* ===================== Zrzut ===================== */
+static unsigned long long metrics_sum_counter(int id) {
+    unsigned long long total = 0;
+    int n = __atomic_load_n(&metrics_shard_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < n && i < METRICS_MAX_SHARDS; i++) {
+        MetricsShard *s = __atomic_load_n(&metrics_shards[i], __ATOMIC_ACQUIRE);
+        if (s)
+            total += __atomic_load_n(&s->counters[id], __ATOMIC_RELAXED);
+    }
+    return total;
+}
+
+static unsigned long long metrics_sum_verb(int cmd) {
+    unsigned long long total = 0;
+    int n = __atomic_load_n(&metrics_shard_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < n && i < METRICS_MAX_SHARDS; i++) {
+        MetricsShard *s = __atomic_load_n(&metrics_shards[i], __ATOMIC_ACQUIRE);
+        if (s)
+            total += __atomic_load_n(&s->verbs[cmd], __ATOMIC_RELAXED);
+    }
+    return total;
+}
+
+static void metrics_sum_histogram(int id, MetricHistogram *out) {
+    memset(out, 0, sizeof(*out));
+    int n = __atomic_load_n(&metrics_shard_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < n && i < METRICS_MAX_SHARDS; i++) {
+        MetricsShard *s = __atomic_load_n(&metrics_shards[i], __ATOMIC_ACQUIRE);
+        if (!s)
+            continue;
+        const MetricHistogram *h = &s->hist[id];
+        out->sum += __atomic_load_n(&h->sum, __ATOMIC_RELAXED);
+        for (int b = 0; b < METRIC_BUCKETS; b++) {
+            unsigned long long c = __atomic_load_n(&h->buckets[b], __ATOMIC_RELAXED);
+            out->buckets[b] += c;
+            out->count += c;  // Liczność z kubełków - spójna z kwantylami
+        }
+    }
+}
+
+static unsigned long long metrics_quantile(const MetricHistogram *h, double q) {
+    if (h->count == 0)
+        return 0;
+    unsigned long long rank = (unsigned long long)(q * (h->count - 1)) + 1, seen = 0;
+    for (int b = 0; b < METRIC_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if (seen >= rank)
+            return metric_bucket_max(b);
+    }
+    return metric_bucket_max(METRIC_BUCKETS - 1);
+}
+
+// Wypisuje liczniki i histogramy w formacie tekstowym Prometheusa
+static void metrics_render(FILE *out) {
+    static const char *names[MET_COUNT] = {
+#define METRIC_NAME(id, name, help) [id] = name,
+        METRIC_COUNTERS(METRIC_NAME)
+#undef METRIC_NAME
+    };
+    static const char *helps[MET_COUNT] = {
+#define METRIC_HELP(id, name, help) [id] = help,
+        METRIC_COUNTERS(METRIC_HELP)
+#undef METRIC_HELP
+    };
+    for (int id = 0; id < MET_COUNT; id++) {
+        fprintf(out, "# HELP " METRICS_PREFIX "%s %s\n", names[id], helps[id]);
+        fprintf(out, "# TYPE " METRICS_PREFIX "%s counter\n", names[id]);
+        fprintf(out, METRICS_PREFIX "%s %llu\n", names[id], metrics_sum_counter(id));
+    }
+
+    fprintf(out, "# HELP " METRICS_PREFIX "commands_total Client commands by verb\n");
+    fprintf(out, "# TYPE " METRICS_PREFIX "commands_total counter\n");
+    for (int cmd = 0; cmd < CMD_COUNT; cmd++) {
+        // CMD_NONE to linie bez znanego czasownika, pusty czasownik - czat
+        const char *verb = cmd == CMD_NONE ? "unknown" : client_command_specs[cmd].verb;
+        fprintf(out, METRICS_PREFIX "commands_total{verb=\"%s\"} %llu\n",
+                verb[0] ? verb : "chat", metrics_sum_verb(cmd));
+    }
+
+    static const struct { const char *name; double scale; const char *help; } hists[HIST_COUNT] = {
+#define METRIC_HIST(id, name, scale, help) [id] = { name, scale, help },
+        METRIC_HISTOGRAMS(METRIC_HIST)
+#undef METRIC_HIST
+    };
+    static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+    MetricHistogram *h = malloc(sizeof(MetricHistogram));
+    if (!h)
+        return;
+    for (int id = 0; id < HIST_COUNT; id++) {
+        metrics_sum_histogram(id, h);
+        fprintf(out, "# HELP " METRICS_PREFIX "%s %s\n", hists[id].name, hists[id].help);
+        fprintf(out, "# TYPE " METRICS_PREFIX "%s summary\n", hists[id].name);
+        for (size_t q = 0; q < sizeof(quantiles) / sizeof(quantiles[0]); q++)
+            fprintf(out, METRICS_PREFIX "%s{quantile=\"%g\"} %.9g\n", hists[id].name, quantiles[q],
+                    metrics_quantile(h, quantiles[q]) * hists[id].scale);
+        fprintf(out, METRICS_PREFIX "%s_sum %.9g\n", hists[id].name, h->sum * hists[id].scale);
+        fprintf(out, METRICS_PREFIX "%s_count %llu\n", hists[id].name, h->count);
+    }
+    free(h);
+}
+
+#endif // METRYKI_H
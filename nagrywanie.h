@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca & Marcel Gacoń
+ * AGH - Programowanie sieciowe
+ */
+
+#ifndef NAGRYWANIE_H
+#define NAGRYWANIE_H
+
+/*
+ * Nagrywanie ruchu sesji do zwartego pliku binarnego (serwer z --capture) i jego
+ * odczyt (odtwarzacz.c).
+ *
+ * Plik zaczyna się nagłówkiem "BSCP" + wersja, dalej idą rekordy w kolejności zdarzeń:
+ *
+ *   [typ: 1 bajt][połączenie: varint][odstęp od poprzedniego rekordu w us: varint]
+ *   [długość: varint][dane]
+ *
+ * Typy: OPEN (nowe połączenie), IN (bajty od klienta), OUT (bajty do klienta), CLOSE.
+ * OPEN i CLOSE mają długość 0. Liczby zapisywane są jako varint (LEB128, do 64 bitów),
+ * więc typowy rekord z komendą ma kilka bajtów nagłówka.
+ *
+ * Połączenie ma numer nadany przy accept; wznowiona sesja (RESUME) przejmuje numer
+ * nowego połączenia, więc strumień jednego połączenia TCP jest zawsze pod jednym numerem.
+ */
+
+/* ===================== Includy ===================== */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+/* ===================== Definicje ===================== */
+#define CAPTURE_MAGIC      "BSCP"
+#define CAPTURE_VERSION    1
+#define CAPTURE_HEADER     8         // Magia (4), wersja (1), zarezerwowane (3)
+#define CAPTURE_OPEN       1
+#define CAPTURE_IN         2
+#define CAPTURE_OUT        3
+#define CAPTURE_CLOSE      4
+#define CAPTURE_MAX_DATA   (1 << 20) // Górna granica długości rekordu przy odczycie
+#define CAPTURE_FILE_BUF   (1 << 20) // Bufor stdio pliku nagrania
+
+typedef struct {
+    int type;
+    unsigned long conn;
+    unsigned long long time_us;      // Czas od początku nagrania
+    unsigned len;
+    unsigned char *data;             // Bufor czytelnika (ważny do następnego odczytu)
+} CaptureRecord;
+
+/* ===================== Varint ===================== */
+static inline int capture_put_varint(unsigned char *out, unsigned long long value) {
+    int n = 0;
+    while (value >= 0x80) {
+        out[n++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (unsigned char)value;
+    return n;
+}
+
+static inline int capture_get_varint(FILE *f, unsigned long long *value) {
+    unsigned long long v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = fgetc(f);
+        if (c == EOF)
+            return -1;
+        v |= (unsigned long long)(c & 0x7F) << shift;
+        if (!(c & 0x80)) {
+            *value = v;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* ===================== Zapis ===================== */
+// Jeden plik nagrania na proces; rekordy z wielu reaktorów i wątków puli
+// serializuje mutex (czas rekordu pobierany pod mutexem, więc odstępy są nieujemne)
+static FILE *capture_file;
+static pthread_mutex_t capture_mutex = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long long capture_last_us;
+static unsigned long capture_next_conn;
+
+static inline unsigned long long capture_clock_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static inline int capture_open(const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return -1;
+    setvbuf(f, NULL, _IOFBF, CAPTURE_FILE_BUF);
+    unsigned char header[CAPTURE_HEADER] = { 'B', 'S', 'C', 'P', CAPTURE_VERSION, 0, 0, 0 };
+    fwrite(header, 1, sizeof(header), f);
+    capture_last_us = capture_clock_us();
+    capture_file = f;
+    return 0;
+}
+
+// Numer dla nowego połączenia (0 = nagrywanie wyłączone)
+static inline unsigned long capture_new_conn(void) {
+    if (!capture_file)
+        return 0;
+    return __atomic_add_fetch(&capture_next_conn, 1, __ATOMIC_RELAXED);
+}
+
+static inline void capture_record(int type, unsigned long conn, const void *data, unsigned len) {
+    if (!capture_file || conn == 0)
+        return;
+    unsigned char head[1 + 3 * 10];
+    pthread_mutex_lock(&capture_mutex);
+    unsigned long long now = capture_clock_us();
+    int n = 0;
+    head[n++] = (unsigned char)type;
+    n += capture_put_varint(head + n, conn);
+    n += capture_put_varint(head + n, now - capture_last_us);
+    n += capture_put_varint(head + n, len);
+    capture_last_us = now;
+    fwrite(head, 1, n, capture_file);
+    if (len)
+        fwrite(data, 1, len, capture_file);
+    pthread_mutex_unlock(&capture_mutex);
+}
+
+// Wypchnięcie bufora nagrania do pliku. fflush bierze blokadę strumienia, którą trzyma też
+// capture_record, więc nie wolno go wołać z obsługi sygnału (tam wystarcza exit()).
+static inline void capture_flush(void) {
+    if (capture_file)
+        fflush(capture_file);
+}
+
+/* ===================== Odczyt ===================== */
+typedef struct {
+    FILE *file;
+    unsigned long long time_us;
+    unsigned char *buf;
+    unsigned cap;
+} CaptureReader;
+
+static inline int capture_reader_open(CaptureReader *r, const char *path) {
+    memset(r, 0, sizeof(*r));
+    r->file = fopen(path, "rb");
+    if (!r->file)
+        return -1;
+    unsigned char header[CAPTURE_HEADER];
+    if (fread(header, 1, sizeof(header), r->file) != sizeof(header) ||
+        memcmp(header, CAPTURE_MAGIC, 4) != 0 || header[4] != CAPTURE_VERSION) {
+        fclose(r->file);
+        r->file = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// Czyta kolejny rekord; zwraca 1, 0 na końcu pliku i -1 dla uszkodzonego rekordu
+static inline int capture_read(CaptureReader *r, CaptureRecord *rec) {
+    int type = fgetc(r->file);
+    if (type == EOF)
+        return 0;
+    unsigned long long conn, delta, len;
+    if (capture_get_varint(r->file, &conn) < 0 || capture_get_varint(r->file, &delta) < 0 ||
+        capture_get_varint(r->file, &len) < 0 || type < CAPTURE_OPEN || type > CAPTURE_CLOSE ||
+        len > CAPTURE_MAX_DATA)
+        return -1;
+    if (len > r->cap) {
+        unsigned char *grown = realloc(r->buf, len);
+        if (!grown)
+            return -1;
+        r->buf = grown;
+        r->cap = (unsigned)len;
+    }
+    if (len && fread(r->buf, 1, len, r->file) != len)
+        return -1;
+    r->time_us += delta;
+    rec->type = type;
+    rec->conn = (unsigned long)conn;
+    rec->time_us = r->time_us;
+    rec->len = (unsigned)len;
+    rec->data = r->buf;
+    return 1;
+}
+
+static inline void capture_reader_close(CaptureReader *r) {
+    if (r->file)
+        fclose(r->file);
+    free(r->buf);
+    memset(r, 0, sizeof(*r));
+}
+
+#endif // NAGRYWANIE_H
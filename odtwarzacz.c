@@ -0,0 +1,568 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca & Marcel Gacoń
+ * AGH - Programowanie sieciowe
+ */
+
+/*
+ * Odtwarzacz nagrań ruchu (plik z serwera uruchomionego z --capture).
+ *
+ * Każde nagrane połączenie jest otwierane ponownie i dostaje te same bajty od klienta
+ * w tej samej kolejności zdarzeń; wszystkie połączenia nagrania działają równolegle.
+ * Tempo:
+ *   - domyślnie oryginalne odstępy czasu (--speed X przyspiesza X razy),
+ *   - --fast: bez czekania, ale kolejne dane od klienta idą dopiero, gdy serwer wysłał
+ *     temu połączeniu i łącznie wszystkim połączeniom tyle bajtów, ile w oryginale przed
+ *     tym zdarzeniem. Zachowuje to przyczynowość (strzał po NEXT_TURN, /join po
+ *     utworzeniu pokoju) przy pełnej prędkości; gdy odpowiedzi się różnią, bramka
+ *     puszcza po --gate-timeout ms.
+ *
+ * Na koniec odpowiedzi serwera są porównywane z nagranymi, po znormalizowaniu wartości
+ * zmieniających się między uruchomieniami (RESUME_TOKEN, TLV_PORT) i pominięciu PING.
+ * Porównanie ma sens dla nagrania zaczętego na świeżo uruchomionym serwerze i
+ * odtwarzanego też na świeżym (numery pokoi i zajęte nazwy użytkowników).
+ * Kod wyjścia 2 oznacza różnice w odpowiedziach - nagranie staje się testem regresji.
+ */
+
+/* ===================== Includy i Definicje ===================== */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+
+#include "nagrywanie.h"  // Format pliku nagrania
+
+#define DEF_SERVER_PORT    12345
+#define DEF_GATE_TIMEOUT   100     // ms
+#define DEF_DRAIN_TIMEOUT  1000    // ms na odpowiedzi po ostatnim zdarzeniu
+#define REPLAY_EPOLL_BATCH 256
+#define REPLAY_RECV_SIZE   65536
+#define MAX_REPORTED_DIFFS 5
+
+/* ===================== Struktury Danych ===================== */
+typedef struct {
+    unsigned char *data;
+    size_t len;
+    size_t cap;
+} ByteBuf;
+
+typedef struct {
+    unsigned long id;            // Numer połączenia w nagraniu
+    int fd;
+    int opened;
+    int eof;                     // Serwer zamknął połączenie
+    ByteBuf expected;            // Nagrane bajty od serwera
+    ByteBuf received;            // Bajty od serwera w tym odtworzeniu
+    ByteBuf pending;             // Dane od klienta, których gniazdo jeszcze nie przyjęło
+    size_t pending_off;
+    int want_write;
+    unsigned long long reply_since;  // Wysłanie danych, na które czekamy z odpowiedzią (0 = brak)
+    size_t gate_slack;           // Bajty, których bramka już nie oczekuje (po jej przekroczeniu)
+} Conn;
+
+typedef struct {
+    int type;                    // CAPTURE_OPEN / CAPTURE_IN / CAPTURE_CLOSE
+    int conn;                    // Indeks w tablicy połączeń
+    unsigned long long time_us;
+    size_t off;                  // Dane w blob (CAPTURE_IN)
+    unsigned len;
+    unsigned long long out_before;  // Bajty od serwera nagrane przed zdarzeniem (łącznie)
+    size_t conn_out_before;      // ... i do tego połączenia
+    int expects_reply;           // W oryginale serwer odpowiedział na te dane
+} Event;
+
+typedef struct {
+    unsigned *v;
+    size_t n;
+    size_t cap;
+} LatencyLog;
+
+/* ===================== Zmienne Globalne ===================== */
+static Conn *conns;
+static int conn_count;
+static Event *events;
+static size_t event_count, event_cap;
+static ByteBuf blob;             // Dane wszystkich zdarzeń CAPTURE_IN
+static unsigned long long capture_duration_us;
+static unsigned long long recorded_in_bytes, recorded_out_bytes;
+
+static struct sockaddr_in server_addr;
+static int fast_mode = 0;
+static double speed = 1.0;
+static int gate_timeout_ms = DEF_GATE_TIMEOUT;
+static int drain_timeout_ms = DEF_DRAIN_TIMEOUT;
+
+static unsigned long long received_total;
+static unsigned long long gate_slack;
+static unsigned long long sent_total;
+static unsigned long gate_timeouts;
+static unsigned long connect_failures;
+static LatencyLog reply_lat;
+
+/* ===================== Funkcje Pomocnicze ===================== */
+static int buf_append(ByteBuf *b, const void *data, size_t len) {
+    if (b->len + len > b->cap) {
+        size_t cap = b->cap ? b->cap : 1024;
+        while (cap < b->len + len)
+            cap *= 2;
+        unsigned char *grown = realloc(b->data, cap);
+        if (!grown)
+            return -1;
+        b->data = grown;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+    return 0;
+}
+
+static void latency_add(LatencyLog *log, unsigned long long us) {
+    if (log->n == log->cap) {
+        size_t cap = log->cap ? log->cap * 2 : 4096;
+        unsigned *v = realloc(log->v, cap * sizeof(unsigned));
+        if (!v)
+            return;
+        log->v = v;
+        log->cap = cap;
+    }
+    log->v[log->n++] = us > 0xFFFFFFFFULL ? 0xFFFFFFFFU : (unsigned)us;
+}
+
+static int compare_unsigned(const void *a, const void *b) {
+    unsigned x = *(const unsigned *)a, y = *(const unsigned *)b;
+    return (x > y) - (x < y);
+}
+
+static unsigned percentile(const LatencyLog *log, double p) {
+    if (log->n == 0)
+        return 0;
+    return log->v[(size_t)(p * (log->n - 1) + 0.5)];
+}
+
+/* ===================== Wczytanie Nagrania ===================== */
+// Indeks połączenia o numerze 'id' z nagrania (nowe połączenie przy OPEN)
+static int conn_index(unsigned long id, int create) {
+    for (int i = conn_count - 1; i >= 0; i--) {
+        if (conns[i].id == id)
+            return i;
+    }
+    if (!create)
+        return -1;
+    Conn *grown = realloc(conns, (conn_count + 1) * sizeof(Conn));
+    if (!grown)
+        return -1;
+    conns = grown;
+    memset(&conns[conn_count], 0, sizeof(Conn));
+    conns[conn_count].id = id;
+    conns[conn_count].fd = -1;
+    return conn_count++;
+}
+
+static Event *event_add(int type, int conn, unsigned long long time_us) {
+    if (event_count == event_cap) {
+        size_t cap = event_cap ? event_cap * 2 : 1024;
+        Event *grown = realloc(events, cap * sizeof(Event));
+        if (!grown)
+            return NULL;
+        events = grown;
+        event_cap = cap;
+    }
+    Event *e = &events[event_count++];
+    memset(e, 0, sizeof(*e));
+    e->type = type;
+    e->conn = conn;
+    e->time_us = time_us;
+    e->out_before = recorded_out_bytes;
+    return e;
+}
+
+static int load_capture(const char *path) {
+    CaptureReader reader;
+    if (capture_reader_open(&reader, path) < 0) {
+        fprintf(stderr, "[REPLAY] Cannot open capture %s (missing or not a capture file)\n", path);
+        return -1;
+    }
+    // Ostatnie zdarzenie IN każdego połączenia bez nagranej jeszcze odpowiedzi
+    long *awaiting = NULL;
+    CaptureRecord rec;
+    int ret;
+    while ((ret = capture_read(&reader, &rec)) > 0) {
+        int c = conn_index(rec.conn, rec.type == CAPTURE_OPEN);
+        if (c < 0)
+            continue;  // Połączenie otwarte przed początkiem nagrania
+        long *grown = realloc(awaiting, conn_count * sizeof(long));
+        if (!grown) {
+            ret = -1;
+            break;
+        }
+        awaiting = grown;
+        if (rec.type == CAPTURE_OPEN)
+            awaiting[c] = -1;
+        capture_duration_us = rec.time_us;
+        if (rec.type == CAPTURE_OUT) {
+            // PING zależy od zegara serwera, a nie od danych klienta - nie bramkujemy na nim
+            if (rec.len == 5 && memcmp(rec.data, "PING\n", 5) == 0)
+                continue;
+            buf_append(&conns[c].expected, rec.data, rec.len);
+            recorded_out_bytes += rec.len;
+            if (awaiting[c] >= 0) {
+                events[awaiting[c]].expects_reply = 1;
+                awaiting[c] = -1;
+            }
+            continue;
+        }
+        Event *e = event_add(rec.type, c, rec.time_us);
+        if (!e) {
+            ret = -1;
+            break;
+        }
+        e->conn_out_before = conns[c].expected.len;
+        if (rec.type == CAPTURE_IN) {
+            e->off = blob.len;
+            e->len = rec.len;
+            buf_append(&blob, rec.data, rec.len);
+            recorded_in_bytes += rec.len;
+            awaiting[c] = (long)(event_count - 1);
+        }
+    }
+    free(awaiting);
+    capture_reader_close(&reader);
+    if (ret < 0) {
+        fprintf(stderr, "[REPLAY] Corrupt capture record after %zu events\n", event_count);
+        return -1;
+    }
+    return 0;
+}
+
+/* ===================== Odtwarzanie ===================== */
+static void conn_update_events(int epoll_fd, Conn *c) {
+    struct epoll_event ev = { .events = EPOLLIN | (c->want_write ? EPOLLOUT : 0), .data.ptr = c };
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+}
+
+static void conn_close(int epoll_fd, Conn *c) {
+    if (c->fd < 0)
+        return;
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    c->fd = -1;
+    c->eof = 1;
+}
+
+static void conn_open(int epoll_fd, Conn *c) {
+    c->opened = 1;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+        if (fd >= 0)
+            close(fd);
+        connect_failures++;
+        c->eof = 1;
+        return;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    c->fd = fd;
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = c };
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+// Dosyła zaległe dane od klienta
+static void conn_flush(int epoll_fd, Conn *c) {
+    while (c->fd >= 0 && c->pending_off < c->pending.len) {
+        ssize_t n = send(c->fd, c->pending.data + c->pending_off, c->pending.len - c->pending_off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            conn_close(epoll_fd, c);
+            return;
+        }
+        c->pending_off += n;
+        sent_total += n;
+    }
+    int want = c->pending_off < c->pending.len;
+    if (!want) {
+        c->pending.len = 0;
+        c->pending_off = 0;
+    }
+    if (c->fd >= 0 && want != c->want_write) {
+        c->want_write = want;
+        conn_update_events(epoll_fd, c);
+    }
+}
+
+static void issue_event(int epoll_fd, const Event *e, unsigned long long now) {
+    Conn *c = &conns[e->conn];
+    switch (e->type) {
+    case CAPTURE_OPEN:
+        conn_open(epoll_fd, c);
+        break;
+    case CAPTURE_IN:
+        if (c->fd < 0)
+            break;
+        buf_append(&c->pending, blob.data + e->off, e->len);
+        if (e->expects_reply && !c->reply_since)
+            c->reply_since = now;
+        conn_flush(epoll_fd, c);
+        break;
+    case CAPTURE_CLOSE:
+        // Zamknięcie przez serwer już tu dotarło (EOF), a klient w oryginale zamknął
+        // gniazdo bez czytania dalszych odpowiedzi - zamykamy tak samo
+        conn_flush(epoll_fd, c);
+        conn_close(epoll_fd, c);
+        break;
+    }
+}
+
+static void on_readable(int epoll_fd, Conn *c, unsigned long long now) {
+    unsigned char buf[REPLAY_RECV_SIZE];
+    for (;;) {
+        ssize_t n = recv(c->fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+            buf_append(&c->received, buf, n);
+            received_total += n;
+            if (c->reply_since) {
+                latency_add(&reply_lat, now - c->reply_since);
+                c->reply_since = 0;
+            }
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        if (n < 0 && errno == EINTR)
+            continue;
+        conn_close(epoll_fd, c);
+        return;
+    }
+}
+
+static int all_closed(void) {
+    for (int i = 0; i < conn_count; i++) {
+        if (conns[i].fd >= 0)
+            return 0;
+    }
+    return 1;
+}
+
+static void replay(unsigned long long *elapsed_us) {
+    int epoll_fd = epoll_create1(0);
+    struct epoll_event evs[REPLAY_EPOLL_BATCH];
+    unsigned long long start = capture_clock_us();
+    unsigned long long gate_since = 0, drain_deadline = 0;
+    size_t next = 0;
+    for (;;) {
+        unsigned long long now = capture_clock_us();
+        int timeout = 100;
+        while (next < event_count) {
+            const Event *e = &events[next];
+            if (fast_mode) {
+                Conn *c = &conns[e->conn];
+                int global_short = received_total + gate_slack < e->out_before;
+                int conn_short = c->fd >= 0 && c->received.len + c->gate_slack < e->conn_out_before;
+                if (global_short || conn_short) {
+                    if (!gate_since)
+                        gate_since = now;
+                    if (now - gate_since < (unsigned long long)gate_timeout_ms * 1000) {
+                        int left = (int)((gate_since + gate_timeout_ms * 1000ULL - now) / 1000) + 1;
+                        timeout = left < timeout ? left : timeout;
+                        break;
+                    }
+                    // Odpowiedzi rozeszły się z nagraniem - brakujących bajtów już nie czekamy,
+                    // żeby jedna różnica nie spowalniała reszty odtworzenia
+                    gate_timeouts++;
+                    if (global_short)
+                        gate_slack = e->out_before - received_total;
+                    if (conn_short)
+                        c->gate_slack = e->conn_out_before - c->received.len;
+                }
+                gate_since = 0;
+            } else {
+                unsigned long long due = start + (unsigned long long)(e->time_us / speed);
+                if (due > now) {
+                    int left = (int)((due - now) / 1000);
+                    timeout = left < timeout ? left : timeout;
+                    break;
+                }
+            }
+            issue_event(epoll_fd, e, now);
+            next++;
+        }
+        if (next == event_count) {
+            if (!drain_deadline)
+                drain_deadline = now + (unsigned long long)drain_timeout_ms * 1000;
+            if (all_closed() || now >= drain_deadline)
+                break;
+        }
+        int n = epoll_wait(epoll_fd, evs, REPLAY_EPOLL_BATCH, timeout);
+        now = capture_clock_us();
+        for (int i = 0; i < n; i++) {
+            Conn *c = (Conn *)evs[i].data.ptr;
+            if (c->fd >= 0 && (evs[i].events & EPOLLOUT))
+                conn_flush(epoll_fd, c);
+            if (c->fd >= 0 && (evs[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+                on_readable(epoll_fd, c, now);
+        }
+    }
+    *elapsed_us = capture_clock_us() - start;
+    for (int i = 0; i < conn_count; i++)
+        conn_close(epoll_fd, &conns[i]);
+    close(epoll_fd);
+}
+
+/* ===================== Porównanie Odpowiedzi ===================== */
+// Pomija linie PING (zależne od zegara) i maskuje wartości różne w każdym uruchomieniu
+static void normalize(const ByteBuf *in, ByteBuf *out) {
+    static const char *masked[] = { "RESUME_TOKEN ", "TLV_PORT " };
+    size_t pos = 0;
+    out->len = 0;
+    while (pos < in->len) {
+        const unsigned char *line = in->data + pos;
+        const unsigned char *nl = memchr(line, '\n', in->len - pos);
+        size_t len = nl ? (size_t)(nl - line) + 1 : in->len - pos;
+        pos += len;
+        if (len >= 4 && memcmp(line, "PING", 4) == 0 && (len == 4 || line[4] == '\n' || line[4] == '\r'))
+            continue;
+        int done = 0;
+        for (size_t k = 0; k < sizeof(masked) / sizeof(masked[0]); k++) {
+            size_t m = strlen(masked[k]);
+            if (len > m && memcmp(line, masked[k], m) == 0) {
+                buf_append(out, line, m);
+                buf_append(out, "*\n", 2);
+                done = 1;
+                break;
+            }
+        }
+        if (!done)
+            buf_append(out, line, len);
+    }
+}
+
+static void print_snippet(const char *label, const ByteBuf *b, size_t at) {
+    printf("    %s: \"", label);
+    for (size_t i = at; i < b->len && i < at + 40; i++) {
+        unsigned char ch = b->data[i];
+        if (ch == '\n')
+            printf("\\n");
+        else if (ch < 0x20 || ch >= 0x7F)
+            printf("\\x%02x", ch);
+        else
+            putchar(ch);
+    }
+    printf("\"%s\n", (at >= b->len) ? " (end)" : "");
+}
+
+// Zwraca liczbę połączeń z odpowiedziami różnymi od nagranych
+static int verify(void) {
+    ByteBuf want = { 0 }, got = { 0 };
+    int mismatched = 0;
+    for (int i = 0; i < conn_count; i++) {
+        Conn *c = &conns[i];
+        if (!c->opened)
+            continue;
+        normalize(&c->expected, &want);
+        normalize(&c->received, &got);
+        if (want.len == got.len && memcmp(want.data, got.data, want.len) == 0)
+            continue;
+        if (++mismatched > MAX_REPORTED_DIFFS)
+            continue;
+        size_t at = 0;
+        while (at < want.len && at < got.len && want.data[at] == got.data[at])
+            at++;
+        // Początek linii z różnicą - czytelniejszy fragment
+        while (at > 0 && want.data[at - 1] != '\n')
+            at--;
+        printf("[REPLAY] Connection %lu: responses differ at byte %zu (expected %zu bytes, got %zu)\n",
+               c->id, at, want.len, got.len);
+        print_snippet("expected", &want, at);
+        print_snippet("received", &got, at);
+    }
+    free(want.data);
+    free(got.data);
+    return mismatched;
+}
+
+/* ===================== Funkcja main ===================== */
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s <capture file> [--serverIP <address>] [--port N] [--fast | --speed X]\n", prog);
+    fprintf(stderr, "          [--gate-timeout MS] [--drain MS]\n");
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char *capture_path = argv[1];
+    const char *server_ip = "127.0.0.1";
+    int port = DEF_SERVER_PORT;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--serverIP") == 0 && i + 1 < argc) {
+            server_ip = argv[++i];
+        } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--fast") == 0) {
+            fast_mode = 1;
+        } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            speed = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--gate-timeout") == 0 && i + 1 < argc) {
+            gate_timeout_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--drain") == 0 && i + 1 < argc) {
+            drain_timeout_ms = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (speed <= 0)
+        speed = 1.0;
+
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, server_ip, &server_addr.sin_addr) <= 0) {
+        fprintf(stderr, "Invalid server address: %s\n", server_ip);
+        return 1;
+    }
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    if (load_capture(capture_path) < 0)
+        return 1;
+    size_t in_records = 0;
+    for (size_t i = 0; i < event_count; i++)
+        in_records += (events[i].type == CAPTURE_IN);
+    printf("[REPLAY] Capture: %d connections, %zu inbound records (%llu bytes), %llu outbound bytes, %.2f s\n",
+           conn_count, in_records, recorded_in_bytes, recorded_out_bytes, capture_duration_us / 1e6);
+    if (fast_mode)
+        printf("[REPLAY] Mode: as fast as possible (gated on server output)\n");
+    else
+        printf("[REPLAY] Mode: original timing x%.2f\n", speed);
+
+    unsigned long long elapsed_us;
+    replay(&elapsed_us);
+    double elapsed = elapsed_us / 1e6;
+
+    printf("[REPLAY] Replayed in %.2f s: %.0f records/s, in %.1f KB/s, out %.1f KB/s\n", elapsed,
+           in_records / elapsed, sent_total / 1024.0 / elapsed, received_total / 1024.0 / elapsed);
+    if (connect_failures || gate_timeouts)
+        printf("[REPLAY] Connect failures: %lu, gate timeouts: %lu\n", connect_failures, gate_timeouts);
+    qsort(reply_lat.v, reply_lat.n, sizeof(unsigned), compare_unsigned);
+    printf("[REPLAY] Reply latency (us): samples %zu, p50 %u, p99 %u, p99.9 %u, max %u\n", reply_lat.n,
+           percentile(&reply_lat, 0.50), percentile(&reply_lat, 0.99), percentile(&reply_lat, 0.999),
+           reply_lat.n ? reply_lat.v[reply_lat.n - 1] : 0);
+
+    int mismatched = verify();
+    printf("[REPLAY] Responses: %d/%d connections match the capture\n", conn_count - mismatched, conn_count);
+    return mismatched ? 2 : 0;
+}
@@ -0,0 +1,338 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca & Marcel Gacoń
+ * AGH - Programowanie sieciowe
+ */
+
+#ifndef PIERSCIEN_H
+#define PIERSCIEN_H
+
+/*
+ * Minimalna obsługa io_uring bez liburing - bezpośrednio przez wywołania systemowe.
+ *
+ * Pierścień zgłoszeń (SQ) i zakończeń (CQ) są mapowane do pamięci procesu, więc
+ * przygotowanie operacji i odbiór wyników nie wymagają wywołań systemowych;
+ * jedno io_uring_enter wysyła całą paczkę zgłoszeń i czeka na zakończenia.
+ * Dodatkowo:
+ *  - tablica stałych deskryptorów (fixed files) - jądro nie szuka pliku przy każdej operacji,
+ *  - pierścień buforów (provided buffer ring) - jądro samo wybiera bufor dla recv,
+ *    dzięki czemu jedno wielokrotne (multishot) recv obsługuje połączenie do końca.
+ *
+ * Pierścień nie jest wątkowo bezpieczny - zgłoszenia wysyła tylko wątek właściciela.
+ * Wymaga jądra 6.0+ (multishot accept/recv, pierścień buforów).
+ */
+
+/* ===================== Includy ===================== */
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+/* ===================== Definicje ===================== */
+#define URING_BUF_GROUP  0   // Identyfikator grupy buforów recv
+
+typedef struct {
+    int fd;
+    // Pierścień zgłoszeń
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned sqe_tail;        // Zgłoszenia przygotowane, ale jeszcze nie wysłane
+    struct io_uring_sqe *sqes;
+    // Pierścień zakończeń
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+    void *sq_map;
+    void *cq_map;
+    size_t sq_map_size;
+    size_t cq_map_size;
+    size_t sqes_size;
+    // Stałe deskryptory
+    int file_slots;           // Rozmiar tablicy (0 = brak)
+    // Pierścień buforów recv
+    struct io_uring_buf_ring *buf_ring;
+    size_t buf_ring_size;
+    char *buf_data;
+    unsigned buf_count;
+    unsigned buf_size;
+    unsigned short buf_tail;
+} Uring;
+
+/* ===================== Wywołania Systemowe ===================== */
+static inline int uring_sys_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static inline int uring_sys_enter(int fd, unsigned to_submit, unsigned min_complete,
+                                  unsigned flags, void *arg, size_t argsz) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+static inline int uring_sys_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+/* ===================== Inicjalizacja ===================== */
+static void uring_unmap(Uring *ring) {
+    if (ring->sqes && ring->sqes != MAP_FAILED)
+        munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_map && ring->cq_map != MAP_FAILED && ring->cq_map != ring->sq_map)
+        munmap(ring->cq_map, ring->cq_map_size);
+    if (ring->sq_map && ring->sq_map != MAP_FAILED)
+        munmap(ring->sq_map, ring->sq_map_size);
+}
+
+// Tworzy pierścień z 'entries' zgłoszeniami i 'cq_entries' zakończeniami.
+// Zwraca 0 albo -errno (np. -ENOSYS na starym jądrze, -EPERM przy wyłączonym io_uring).
+static int uring_init(Uring *ring, unsigned entries, unsigned cq_entries) {
+    struct io_uring_params p;
+    memset(ring, 0, sizeof(*ring));
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = cq_entries;
+    ring->fd = uring_sys_setup(entries, &p);
+    if (ring->fd < 0)
+        return -errno;
+    // Potrzebne: timeout w io_uring_enter, pomijanie CQE sukcesu i brak gubienia zakończeń
+    unsigned required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG |
+                        IORING_FEAT_CQE_SKIP | IORING_FEAT_LINKED_FILE;
+    if ((p.features & required) != required) {
+        close(ring->fd);
+        return -EOPNOTSUPP;
+    }
+
+    ring->sq_map_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cq_map_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (ring->cq_map_size > ring->sq_map_size)
+        ring->sq_map_size = ring->cq_map_size;
+    ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    ring->cq_map = ring->sq_map;  // IORING_FEAT_SINGLE_MMAP - oba pierścienie w jednym mapowaniu
+    ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sq_map == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        int err = errno;
+        uring_unmap(ring);
+        close(ring->fd);
+        return -err;
+    }
+
+    char *sq = ring->sq_map;
+    ring->sq_head = (unsigned *)(sq + p.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    ring->sq_mask = *(unsigned *)(sq + p.sq_off.ring_mask);
+    ring->sq_entries = p.sq_entries;
+    ring->sqe_tail = *ring->sq_tail;
+    // Tablica indeksów SQ - stałe odwzorowanie i -> i
+    unsigned *array = (unsigned *)(sq + p.sq_off.array);
+    for (unsigned i = 0; i < p.sq_entries; i++)
+        array[i] = i;
+
+    char *cq = ring->cq_map;
+    ring->cq_head = (unsigned *)(cq + p.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    ring->cq_mask = *(unsigned *)(cq + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    return 0;
+}
+
+// Rejestruje pustą tablicę 'count' stałych deskryptorów (wszystkie sloty wolne)
+static int uring_register_file_table(Uring *ring, int count) {
+    int *fds = malloc(count * sizeof(int));
+    if (!fds)
+        return -ENOMEM;
+    for (int i = 0; i < count; i++)
+        fds[i] = -1;
+    int ret = uring_sys_register(ring->fd, IORING_REGISTER_FILES, fds, count);
+    free(fds);
+    if (ret < 0)
+        return -errno;
+    ring->file_slots = count;
+    return 0;
+}
+
+// Oddaje bufor 'bid' do pierścienia buforów (jądro może go znów użyć)
+static inline void uring_buf_recycle(Uring *ring, unsigned short bid) {
+    struct io_uring_buf *buf = &ring->buf_ring->bufs[ring->buf_tail & (ring->buf_count - 1)];
+    buf->addr = (unsigned long)(ring->buf_data + (size_t)bid * ring->buf_size);
+    buf->len = ring->buf_size;
+    buf->bid = bid;
+    ring->buf_tail++;
+    __atomic_store_n(&ring->buf_ring->tail, ring->buf_tail, __ATOMIC_RELEASE);
+}
+
+static inline char *uring_buf_data(Uring *ring, unsigned short bid) {
+    return ring->buf_data + (size_t)bid * ring->buf_size;
+}
+
+// Rejestruje pierścień 'count' buforów po 'size' bajtów (count - potęga dwójki)
+static int uring_setup_buf_ring(Uring *ring, unsigned count, unsigned size) {
+    ring->buf_ring_size = count * sizeof(struct io_uring_buf);
+    // Pierścień musi być wyrównany do strony - mmap to zapewnia
+    void *map = mmap(NULL, ring->buf_ring_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED)
+        return -errno;
+    ring->buf_data = malloc((size_t)count * size);
+    if (!ring->buf_data) {
+        munmap(map, ring->buf_ring_size);
+        return -ENOMEM;
+    }
+    ring->buf_ring = map;
+    ring->buf_count = count;
+    ring->buf_size = size;
+    ring->buf_tail = 0;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (unsigned long)map;
+    reg.ring_entries = count;
+    reg.bgid = URING_BUF_GROUP;
+    if (uring_sys_register(ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        int err = errno;
+        free(ring->buf_data);
+        munmap(map, ring->buf_ring_size);
+        ring->buf_ring = NULL;
+        ring->buf_data = NULL;
+        return -err;
+    }
+    for (unsigned i = 0; i < count; i++)
+        uring_buf_recycle(ring, (unsigned short)i);
+    return 0;
+}
+
+/* ===================== Zgłoszenia ===================== */
+// Wysyła przygotowane zgłoszenia; opcjonalnie czeka na co najmniej jedno zakończenie
+// nie dłużej niż 'timeout_ms'. Zwraca liczbę wysłanych zgłoszeń albo -errno.
+static int uring_submit_and_wait(Uring *ring, int wait, int timeout_ms) {
+    unsigned to_submit = ring->sqe_tail - *ring->sq_tail;
+    __atomic_store_n(ring->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+    if (!wait && to_submit == 0)
+        return 0;
+    struct __kernel_timespec ts;
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.ts = (unsigned long)&ts;
+    unsigned flags = wait ? IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG : 0;
+    int ret = uring_sys_enter(ring->fd, to_submit, wait ? 1 : 0, flags,
+                              wait ? &arg : NULL, wait ? sizeof(arg) : 0);
+    return ret < 0 ? -errno : ret;
+}
+
+static inline int uring_submit(Uring *ring) {
+    return uring_submit_and_wait(ring, 0, 0);
+}
+
+// Zwraca wyzerowane zgłoszenie. Gdy pierścień SQ jest pełny, najpierw wysyła zaległe.
+static struct io_uring_sqe *uring_get_sqe(Uring *ring) {
+    while (ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries) {
+        int ret = uring_submit(ring);
+        if (ret < 0 && ret != -EINTR && ret != -EBUSY && ret != -EAGAIN) {
+            fprintf(stderr, "[URING] submit failed: %s\n", strerror(-ret));
+            exit(EXIT_FAILURE);
+        }
+    }
+    struct io_uring_sqe *sqe = &ring->sqes[ring->sqe_tail & ring->sq_mask];
+    ring->sqe_tail++;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+// Wielokrotny accept - jedno zgłoszenie daje CQE dla każdego nowego połączenia
+static inline void uring_prep_accept_multishot(struct io_uring_sqe *sqe, int fd, int flags,
+                                               unsigned long long user_data) {
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = flags;
+    sqe->user_data = user_data;
+}
+
+// Wielokrotny recv z buforem wybieranym przez jądro z pierścienia buforów
+static inline void uring_prep_recv_multishot(struct io_uring_sqe *sqe, int fd, int fixed,
+                                             unsigned long long user_data) {
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->flags = IOSQE_BUFFER_SELECT | (fixed ? IOSQE_FIXED_FILE : 0);
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->buf_group = URING_BUF_GROUP;
+    sqe->user_data = user_data;
+}
+
+static inline void uring_prep_send(struct io_uring_sqe *sqe, int fd, int fixed, const void *buf,
+                                   size_t len, int msg_flags, unsigned long long user_data) {
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = fd;
+    sqe->flags = fixed ? IOSQE_FIXED_FILE : 0;
+    sqe->addr = (unsigned long)buf;
+    sqe->len = (unsigned)len;
+    sqe->msg_flags = msg_flags;
+    sqe->user_data = user_data;
+}
+
+static inline void uring_prep_read(struct io_uring_sqe *sqe, int fd, void *buf, size_t len,
+                                   unsigned long long user_data) {
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = (unsigned long)buf;
+    sqe->len = (unsigned)len;
+    sqe->off = (unsigned long long)-1;  // Bieżąca pozycja (eventfd nie ma przesunięcia)
+    sqe->user_data = user_data;
+}
+
+// Ustawia slot 'slot' tablicy stałych deskryptorów na *fd (-1 zwalnia slot).
+// 'fd' musi wskazywać na pamięć ważną do chwili wysłania zgłoszenia.
+static inline void uring_prep_files_update(struct io_uring_sqe *sqe, const int *fd, int slot,
+                                           unsigned long long user_data) {
+    sqe->opcode = IORING_OP_FILES_UPDATE;
+    sqe->fd = -1;
+    sqe->addr = (unsigned long)fd;
+    sqe->len = 1;
+    sqe->off = (unsigned long long)slot;
+    sqe->user_data = user_data;
+}
+
+// Wielokrotny poll - CQE przy każdej gotowości deskryptora, aż do anulowania lub błędu
+static inline void uring_prep_poll_multishot(struct io_uring_sqe *sqe, int fd, unsigned events,
+                                             unsigned long long user_data) {
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = events;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = user_data;
+}
+
+// Anuluje operację o danym user_data
+static inline void uring_prep_cancel(struct io_uring_sqe *sqe, unsigned long long target,
+                                     unsigned long long user_data) {
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = target;
+    sqe->user_data = user_data;
+}
+
+/* ===================== Zakończenia ===================== */
+// Zwraca najstarsze nieobsłużone zakończenie albo NULL
+static inline struct io_uring_cqe *uring_peek_cqe(Uring *ring) {
+    unsigned head = *ring->cq_head;
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+        return NULL;
+    return &ring->cqes[head & ring->cq_mask];
+}
+
+// Oznacza zakończenie jako obsłużone (miejsce w CQ wraca do jądra)
+static inline void uring_cqe_seen(Uring *ring) {
+    __atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+#endif // PIERSCIEN_H
@@ -0,0 +1,441 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca & Marcel Gacoń
+ * AGH - Programowanie sieciowe
+ */
+
+#ifndef PLANSZA_H
+#define PLANSZA_H
+
+/*
+ * Jądra operacji na planszach: różnica dwóch plansz jako maska bitowa, liczba pól
+ * w każdym stanie, pakowanie pól po 2 bity (układ ramki BOARD z protokol.h) i z powrotem
+ * oraz rysowanie maski bitowej jako znaków.
+ *
+ * Każde jądro ma wersję skalarną, SSE2 i AVX2 o identycznych wynikach (benchmark.c
+ * porównuje je przy starcie). board_kernels() przy pierwszym użyciu wybiera najszybszą
+ * wersję, którą obsługuje procesor. Plansza to n znaków dowolnej długości (serwer - 64 pola,
+ * benchmark.c - BOARD_SIZE^2); końcówkę krótszą od bloku wektorowego liczy kod skalarny.
+ *
+ * Wersje SIMD mają atrybut target, więc nie wymagają flag -m. -DBOARD_SIMD=0 zostawia
+ * tylko wersję skalarną (poza x86 jest ona jedyna).
+ */
+
+/* ===================== Includy ===================== */
+#include <string.h>
+
+#ifndef BOARD_SIMD
+#if defined(__x86_64__) || defined(__i386__)
+#define BOARD_SIMD 1
+#else
+#define BOARD_SIMD 0
+#endif
+#endif
+
+#if BOARD_SIMD
+#include <immintrin.h>
+#endif
+
+/* ===================== Definicje ===================== */
+// Znaki pól w kolejności kodów 2-bitowych
+#define BOARD_CHAR_EMPTY '.'
+#define BOARD_CHAR_SHIP  'O'
+#define BOARD_CHAR_HIT   'X'
+#define BOARD_CHAR_MISS  '='
+
+#define BOARD_MASK_WORDS(n)  (((n) + 63) / 64)  // Słowa maski bitowej n pól
+#define BOARD_PACKED_LEN(n)  (((n) + 3) / 4)    // Bajty n pól spakowanych po 2 bity
+
+enum { BOARD_EMPTY, BOARD_SHIP, BOARD_HIT, BOARD_MISS, BOARD_STATES };
+
+static const char board_chars[BOARD_STATES] = {
+    BOARD_CHAR_EMPTY, BOARD_CHAR_SHIP, BOARD_CHAR_HIT, BOARD_CHAR_MISS
+};
+
+// Zestaw jąder jednej implementacji
+typedef struct {
+    const char *name;
+    int (*available)(void);  // Czy procesor ją obsługuje
+    // Bit i maski ustawiony, gdy a[i] != b[i]
+    void (*diff)(const char *a, const char *b, int n, unsigned long long *mask);
+    // Liczba pól w każdym stanie (nieznany znak liczy się jako puste pole)
+    void (*count)(const char *cells, int n, int counts[BOARD_STATES]);
+    // Pole i w bitach 2*(i%4) bajtu i/4 (nieużyte bity ostatniego bajtu są zerami)
+    void (*pack)(const char *cells, int n, unsigned char *out);
+    void (*unpack)(const unsigned char *in, int n, char *cells);
+    // Znak 'on' dla ustawionych bitów maski, 'off' dla pozostałych
+    void (*render)(const unsigned long long *mask, int n, char on, char off, char *out);
+} BoardKernels;
+
+/* ===================== Wersja skalarna ===================== */
+// 2-bitowy kod pola (nieznany znak jest pustym polem)
+static inline int board_code(char c) {
+    return c == BOARD_CHAR_SHIP ? BOARD_SHIP : c == BOARD_CHAR_HIT ? BOARD_HIT :
+           c == BOARD_CHAR_MISS ? BOARD_MISS : BOARD_EMPTY;
+}
+
+// Funkcje *_from liczą pola od 'i' do końca - całą planszę w wersji skalarnej i końcówkę
+// w wersjach SIMD ('i' jest wielokrotnością 64 dla masek i 4 dla pakowania)
+static inline void board_diff_from(const char *a, const char *b, int i, int n, unsigned long long *mask) {
+    for (int w = i / 64; w < BOARD_MASK_WORDS(n); w++)
+        mask[w] = 0;
+    for (; i < n; i++)
+        if (a[i] != b[i])
+            mask[i / 64] |= 1ULL << (i % 64);
+}
+
+static inline void board_count_from(const char *cells, int i, int n, int counts[BOARD_STATES]) {
+    for (; i < n; i++)
+        counts[board_code(cells[i])]++;
+}
+
+static inline void board_pack_from(const char *cells, int i, int n, unsigned char *out) {
+    for (int b = i / 4; b < BOARD_PACKED_LEN(n); b++)
+        out[b] = 0;
+    for (; i < n; i++)
+        out[i / 4] |= (unsigned char)(board_code(cells[i]) << (2 * (i % 4)));
+}
+
+static inline void board_unpack_from(const unsigned char *in, int i, int n, char *cells) {
+    for (; i < n; i++)
+        cells[i] = board_chars[(in[i / 4] >> (2 * (i % 4))) & 3];
+}
+
+static inline void board_render_from(const unsigned long long *mask, int i, int n, char on, char off, char *out) {
+    for (; i < n; i++)
+        out[i] = (mask[i / 64] >> (i % 64)) & 1 ? on : off;
+}
+
+static inline void board_diff_scalar(const char *a, const char *b, int n, unsigned long long *mask) {
+    board_diff_from(a, b, 0, n, mask);
+}
+
+static inline void board_count_scalar(const char *cells, int n, int counts[BOARD_STATES]) {
+    memset(counts, 0, sizeof(int) * BOARD_STATES);
+    board_count_from(cells, 0, n, counts);
+}
+
+static inline void board_pack_scalar(const char *cells, int n, unsigned char *out) {
+    board_pack_from(cells, 0, n, out);
+}
+
+static inline void board_unpack_scalar(const unsigned char *in, int n, char *cells) {
+    board_unpack_from(in, 0, n, cells);
+}
+
+static inline void board_render_scalar(const unsigned long long *mask, int n, char on, char off, char *out) {
+    board_render_from(mask, 0, n, on, off, out);
+}
+
+static inline int board_always(void) {
+    return 1;
+}
+
+#if BOARD_SIMD
+/* ===================== Wersja SSE2 ===================== */
+#define BOARD_SSE2 __attribute__((target("sse2")))
+#define BOARD_AVX2 __attribute__((target("avx2")))
+
+// Stałe dekodowania: bajt zawiera cztery pola, pole k w bitach 2k..2k+1
+#define BOARD_FIELD_MASK  ((int)0xC0300C03)  // Bity pól 0-3 w kolejnych bajtach słowa
+#define BOARD_FIELD_SHIP  ((int)0x40100401)  // Kod 1 w polu 0-3
+#define BOARD_FIELD_HIT   ((int)0x80200802)  // Kod 2
+#define BOARD_BIT_OF_BYTE ((long long)0x8040201008040201ULL)  // Bajt j wektora bada bit j%8
+
+static inline BOARD_SSE2 int board_has_sse2(void) {
+    return __builtin_cpu_supports("sse2");
+}
+
+static inline BOARD_SSE2 void board_diff_sse2(const char *a, const char *b, int n, unsigned long long *mask) {
+    int i = 0;
+    for (; i + 64 <= n; i += 64) {
+        unsigned long long m = 0;
+        for (int k = 0; k < 4; k++) {
+            __m128i x = _mm_loadu_si128((const __m128i *)(a + i + 16 * k));
+            __m128i y = _mm_loadu_si128((const __m128i *)(b + i + 16 * k));
+            unsigned same = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y));
+            m |= (unsigned long long)(~same & 0xFFFF) << (16 * k);
+        }
+        mask[i / 64] = m;
+    }
+    board_diff_from(a, b, i, n, mask);
+}
+
+// Suma 64-bitowych połówek wektora (wyniku _mm_sad_epu8)
+static inline BOARD_SSE2 int board_sum_sse2(__m128i v) {
+    return _mm_cvtsi128_si32(v) + _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+}
+
+static inline BOARD_SSE2 void board_count_sse2(const char *cells, int n, int counts[BOARD_STATES]) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ship = _mm_set1_epi8(BOARD_CHAR_SHIP);
+    const __m128i hit = _mm_set1_epi8(BOARD_CHAR_HIT);
+    const __m128i miss = _mm_set1_epi8(BOARD_CHAR_MISS);
+    __m128i sum_ship = zero, sum_hit = zero, sum_miss = zero;
+    int i = 0;
+    while (i + 16 <= n) {
+        // Liczniki 8-bitowe (cmpeq daje -1) - zrzucane do sum co 255 wektorów
+        __m128i c_ship = zero, c_hit = zero, c_miss = zero;
+        for (int k = 0; k < 255 && i + 16 <= n; k++, i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(cells + i));
+            c_ship = _mm_sub_epi8(c_ship, _mm_cmpeq_epi8(v, ship));
+            c_hit = _mm_sub_epi8(c_hit, _mm_cmpeq_epi8(v, hit));
+            c_miss = _mm_sub_epi8(c_miss, _mm_cmpeq_epi8(v, miss));
+        }
+        sum_ship = _mm_add_epi64(sum_ship, _mm_sad_epu8(c_ship, zero));
+        sum_hit = _mm_add_epi64(sum_hit, _mm_sad_epu8(c_hit, zero));
+        sum_miss = _mm_add_epi64(sum_miss, _mm_sad_epu8(c_miss, zero));
+    }
+    counts[BOARD_SHIP] = board_sum_sse2(sum_ship);
+    counts[BOARD_HIT] = board_sum_sse2(sum_hit);
+    counts[BOARD_MISS] = board_sum_sse2(sum_miss);
+    counts[BOARD_EMPTY] = i - counts[BOARD_SHIP] - counts[BOARD_HIT] - counts[BOARD_MISS];
+    board_count_from(cells, i, n, counts);
+}
+
+// Znaki -> kody 0-3 (po jednym w bajcie)
+static inline BOARD_SSE2 __m128i board_codes_sse2(__m128i v) {
+    __m128i ship = _mm_and_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(BOARD_CHAR_SHIP)), _mm_set1_epi8(BOARD_SHIP));
+    __m128i hit = _mm_and_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(BOARD_CHAR_HIT)), _mm_set1_epi8(BOARD_HIT));
+    __m128i miss = _mm_and_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(BOARD_CHAR_MISS)), _mm_set1_epi8(BOARD_MISS));
+    return _mm_or_si128(_mm_or_si128(ship, hit), miss);
+}
+
+// Cztery kody z bajtów słowa 32-bitowego -> jeden bajt w młodszych bitach słowa
+static inline BOARD_SSE2 __m128i board_join_sse2(__m128i codes) {
+    __m128i pairs = _mm_and_si128(_mm_or_si128(codes, _mm_srli_epi16(codes, 6)), _mm_set1_epi16(0x00FF));
+    return _mm_and_si128(_mm_or_si128(pairs, _mm_srli_epi32(pairs, 12)), _mm_set1_epi32(0xFF));
+}
+
+static inline BOARD_SSE2 void board_pack_sse2(const char *cells, int n, unsigned char *out) {
+    int i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m128i q[4];
+        for (int k = 0; k < 4; k++)
+            q[k] = board_join_sse2(board_codes_sse2(_mm_loadu_si128((const __m128i *)(cells + i + 16 * k))));
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(q[0], q[1]), _mm_packs_epi32(q[2], q[3]));
+        _mm_storeu_si128((__m128i *)(out + i / 4), packed);
+    }
+    board_pack_from(cells, i, n, out);
+}
+
+// Bajty powielone 4 razy (pola 0-3 każdego bajtu w kolejnych bajtach) -> znaki pól
+static inline BOARD_SSE2 __m128i board_decode_sse2(__m128i quads) {
+    __m128i fields = _mm_and_si128(quads, _mm_set1_epi32(BOARD_FIELD_MASK));
+    __m128i ship = _mm_cmpeq_epi8(fields, _mm_set1_epi32(BOARD_FIELD_SHIP));
+    __m128i hit = _mm_cmpeq_epi8(fields, _mm_set1_epi32(BOARD_FIELD_HIT));
+    __m128i miss = _mm_cmpeq_epi8(fields, _mm_set1_epi32(BOARD_FIELD_MASK));
+    // Najwyżej jedna maska jest ustawiona, więc XOR podmienia puste pole na właściwy znak
+    __m128i out = _mm_set1_epi8(BOARD_CHAR_EMPTY);
+    out = _mm_xor_si128(out, _mm_and_si128(ship, _mm_set1_epi8(BOARD_CHAR_SHIP ^ BOARD_CHAR_EMPTY)));
+    out = _mm_xor_si128(out, _mm_and_si128(hit, _mm_set1_epi8(BOARD_CHAR_HIT ^ BOARD_CHAR_EMPTY)));
+    return _mm_xor_si128(out, _mm_and_si128(miss, _mm_set1_epi8(BOARD_CHAR_MISS ^ BOARD_CHAR_EMPTY)));
+}
+
+static inline BOARD_SSE2 void board_unpack_sse2(const unsigned char *in, int n, char *cells) {
+    int i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(in + i / 4));
+        __m128i lo = _mm_unpacklo_epi8(x, x), hi = _mm_unpackhi_epi8(x, x);
+        _mm_storeu_si128((__m128i *)(cells + i), board_decode_sse2(_mm_unpacklo_epi16(lo, lo)));
+        _mm_storeu_si128((__m128i *)(cells + i + 16), board_decode_sse2(_mm_unpackhi_epi16(lo, lo)));
+        _mm_storeu_si128((__m128i *)(cells + i + 32), board_decode_sse2(_mm_unpacklo_epi16(hi, hi)));
+        _mm_storeu_si128((__m128i *)(cells + i + 48), board_decode_sse2(_mm_unpackhi_epi16(hi, hi)));
+    }
+    board_unpack_from(in, i, n, cells);
+}
+
+static inline BOARD_SSE2 void board_render_sse2(const unsigned long long *mask, int n, char on, char off, char *out) {
+    const __m128i bits = _mm_set1_epi64x(BOARD_BIT_OF_BYTE);
+    const __m128i base = _mm_set1_epi8(off), flip = _mm_set1_epi8((char)(on ^ off));
+    int i = 0;
+    for (; i + 64 <= n; i += 64) {
+        unsigned long long m = mask[i / 64];
+        for (int k = 0; k < 4; k++, m >>= 16) {
+            __m128i v = _mm_unpacklo_epi64(_mm_set1_epi8((char)(m & 0xFF)), _mm_set1_epi8((char)((m >> 8) & 0xFF)));
+            __m128i set = _mm_cmpeq_epi8(_mm_and_si128(v, bits), bits);
+            _mm_storeu_si128((__m128i *)(out + i + 16 * k), _mm_xor_si128(base, _mm_and_si128(set, flip)));
+        }
+    }
+    board_render_from(mask, i, n, on, off, out);
+}
+
+/* ===================== Wersja AVX2 ===================== */
+static inline BOARD_AVX2 int board_has_avx2(void) {
+    return __builtin_cpu_supports("avx2");
+}
+
+static inline BOARD_AVX2 void board_diff_avx2(const char *a, const char *b, int n, unsigned long long *mask) {
+    int i = 0;
+    for (; i + 64 <= n; i += 64) {
+        unsigned long long m = 0;
+        for (int k = 0; k < 2; k++) {
+            __m256i x = _mm256_loadu_si256((const __m256i *)(a + i + 32 * k));
+            __m256i y = _mm256_loadu_si256((const __m256i *)(b + i + 32 * k));
+            unsigned same = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+            m |= (unsigned long long)~same << (32 * k);
+        }
+        mask[i / 64] = m;
+    }
+    board_diff_from(a, b, i, n, mask);
+}
+
+static inline BOARD_AVX2 int board_sum_avx2(__m256i v) {
+    __m128i half = _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    return _mm_cvtsi128_si32(half) + _mm_cvtsi128_si32(_mm_srli_si128(half, 8));
+}
+
+static inline BOARD_AVX2 void board_count_avx2(const char *cells, int n, int counts[BOARD_STATES]) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ship = _mm256_set1_epi8(BOARD_CHAR_SHIP);
+    const __m256i hit = _mm256_set1_epi8(BOARD_CHAR_HIT);
+    const __m256i miss = _mm256_set1_epi8(BOARD_CHAR_MISS);
+    __m256i sum_ship = zero, sum_hit = zero, sum_miss = zero;
+    int i = 0;
+    while (i + 32 <= n) {
+        __m256i c_ship = zero, c_hit = zero, c_miss = zero;
+        for (int k = 0; k < 255 && i + 32 <= n; k++, i += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(cells + i));
+            c_ship = _mm256_sub_epi8(c_ship, _mm256_cmpeq_epi8(v, ship));
+            c_hit = _mm256_sub_epi8(c_hit, _mm256_cmpeq_epi8(v, hit));
+            c_miss = _mm256_sub_epi8(c_miss, _mm256_cmpeq_epi8(v, miss));
+        }
+        sum_ship = _mm256_add_epi64(sum_ship, _mm256_sad_epu8(c_ship, zero));
+        sum_hit = _mm256_add_epi64(sum_hit, _mm256_sad_epu8(c_hit, zero));
+        sum_miss = _mm256_add_epi64(sum_miss, _mm256_sad_epu8(c_miss, zero));
+    }
+    counts[BOARD_SHIP] = board_sum_avx2(sum_ship);
+    counts[BOARD_HIT] = board_sum_avx2(sum_hit);
+    counts[BOARD_MISS] = board_sum_avx2(sum_miss);
+    counts[BOARD_EMPTY] = i - counts[BOARD_SHIP] - counts[BOARD_HIT] - counts[BOARD_MISS];
+    board_count_from(cells, i, n, counts);
+}
+
+static inline BOARD_AVX2 __m256i board_codes_avx2(__m256i v) {
+    __m256i ship = _mm256_and_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(BOARD_CHAR_SHIP)), _mm256_set1_epi8(BOARD_SHIP));
+    __m256i hit = _mm256_and_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(BOARD_CHAR_HIT)), _mm256_set1_epi8(BOARD_HIT));
+    __m256i miss = _mm256_and_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(BOARD_CHAR_MISS)), _mm256_set1_epi8(BOARD_MISS));
+    return _mm256_or_si256(_mm256_or_si256(ship, hit), miss);
+}
+
+static inline BOARD_AVX2 __m256i board_join_avx2(__m256i codes) {
+    __m256i pairs = _mm256_and_si256(_mm256_or_si256(codes, _mm256_srli_epi16(codes, 6)), _mm256_set1_epi16(0x00FF));
+    return _mm256_and_si256(_mm256_or_si256(pairs, _mm256_srli_epi32(pairs, 12)), _mm256_set1_epi32(0xFF));
+}
+
+static inline BOARD_AVX2 void board_pack_avx2(const char *cells, int n, unsigned char *out) {
+    // packs/packus działają w połówkach 128-bitowych - permutacja przywraca kolejność słów
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    int i = 0;
+    for (; i + 128 <= n; i += 128) {
+        __m256i q[4];
+        for (int k = 0; k < 4; k++)
+            q[k] = board_join_avx2(board_codes_avx2(_mm256_loadu_si256((const __m256i *)(cells + i + 32 * k))));
+        __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(q[0], q[1]), _mm256_packs_epi32(q[2], q[3]));
+        _mm256_storeu_si256((__m256i *)(out + i / 4), _mm256_permutevar8x32_epi32(packed, order));
+    }
+    board_pack_sse2(cells + i, n - i, out + i / 4);  // Blok 64 pól i końcówka
+}
+
+static inline BOARD_AVX2 __m256i board_decode_avx2(__m256i quads) {
+    __m256i fields = _mm256_and_si256(quads, _mm256_set1_epi32(BOARD_FIELD_MASK));
+    __m256i ship = _mm256_cmpeq_epi8(fields, _mm256_set1_epi32(BOARD_FIELD_SHIP));
+    __m256i hit = _mm256_cmpeq_epi8(fields, _mm256_set1_epi32(BOARD_FIELD_HIT));
+    __m256i miss = _mm256_cmpeq_epi8(fields, _mm256_set1_epi32(BOARD_FIELD_MASK));
+    __m256i out = _mm256_set1_epi8(BOARD_CHAR_EMPTY);
+    out = _mm256_xor_si256(out, _mm256_and_si256(ship, _mm256_set1_epi8(BOARD_CHAR_SHIP ^ BOARD_CHAR_EMPTY)));
+    out = _mm256_xor_si256(out, _mm256_and_si256(hit, _mm256_set1_epi8(BOARD_CHAR_HIT ^ BOARD_CHAR_EMPTY)));
+    return _mm256_xor_si256(out, _mm256_and_si256(miss, _mm256_set1_epi8(BOARD_CHAR_MISS ^ BOARD_CHAR_EMPTY)));
+}
+
+static inline BOARD_AVX2 void board_unpack_avx2(const unsigned char *in, int n, char *cells) {
+    // Bajt j/4 do bajtu j (shuffle działa w połówkach, więc druga połówka bierze bajty 4-7)
+    const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                            4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7);
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_broadcastsi128_si256(_mm_loadl_epi64((const __m128i *)(in + i / 4)));
+        _mm256_storeu_si256((__m256i *)(cells + i), board_decode_avx2(_mm256_shuffle_epi8(x, spread)));
+    }
+    board_unpack_from(in, i, n, cells);
+}
+
+static inline BOARD_AVX2 void board_render_avx2(const unsigned long long *mask, int n, char on, char off, char *out) {
+    const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                            2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+    const __m256i bits = _mm256_set1_epi64x(BOARD_BIT_OF_BYTE);
+    const __m256i base = _mm256_set1_epi8(off), flip = _mm256_set1_epi8((char)(on ^ off));
+    int i = 0;
+    for (; i + 64 <= n; i += 64) {
+        unsigned long long m = mask[i / 64];
+        for (int k = 0; k < 2; k++, m >>= 32) {
+            __m256i v = _mm256_shuffle_epi8(_mm256_set1_epi32((int)(unsigned)m), spread);
+            __m256i set = _mm256_cmpeq_epi8(_mm256_and_si256(v, bits), bits);
+            _mm256_storeu_si256((__m256i *)(out + i + 32 * k), _mm256_xor_si256(base, _mm256_and_si256(set, flip)));
+        }
+    }
+    board_render_from(mask, i, n, on, off, out);
+}
+#endif // BOARD_SIMD
+
+/* ===================== Wybór implementacji ===================== */
+// Od najwolniejszej; pierwsza jest zawsze dostępna
+static const BoardKernels board_impls[] = {
+    { "scalar", board_always, board_diff_scalar, board_count_scalar, board_pack_scalar,
+      board_unpack_scalar, board_render_scalar },
+#if BOARD_SIMD
+    { "sse2", board_has_sse2, board_diff_sse2, board_count_sse2, board_pack_sse2,
+      board_unpack_sse2, board_render_sse2 },
+    { "avx2", board_has_avx2, board_diff_avx2, board_count_avx2, board_pack_avx2,
+      board_unpack_avx2, board_render_avx2 },
+#endif
+};
+#define BOARD_IMPL_COUNT ((int)(sizeof(board_impls) / sizeof(board_impls[0])))
+
+static const BoardKernels *board_active;  // Wybrana implementacja (NULL = jeszcze nie wybrano)
+
+// Najszybsza implementacja obsługiwana przez procesor. Wybór jest idempotentny,
+// więc równoczesne pierwsze wywołania z kilku wątków nie szkodzą.
+static inline const BoardKernels *board_kernels(void) {
+    const BoardKernels *k = __atomic_load_n(&board_active, __ATOMIC_ACQUIRE);
+    if (k)
+        return k;
+    k = &board_impls[0];
+    for (int i = BOARD_IMPL_COUNT - 1; i > 0; i--) {
+        if (board_impls[i].available()) {
+            k = &board_impls[i];
+            break;
+        }
+    }
+    __atomic_store_n(&board_active, k, __ATOMIC_RELEASE);
+    return k;
+}
+
+// Implementacja o danej nazwie, o ile jest wkompilowana i obsługiwana (albo NULL)
+static inline const BoardKernels *board_impl_find(const char *name) {
+    for (int i = 0; i < BOARD_IMPL_COUNT; i++)
+        if (strcmp(board_impls[i].name, name) == 0)
+            return board_impls[i].available() ? &board_impls[i] : NULL;
+    return NULL;
+}
+
+static inline void board_diff(const char *a, const char *b, int n, unsigned long long *mask) {
+    board_kernels()->diff(a, b, n, mask);
+}
+
+static inline void board_count(const char *cells, int n, int counts[BOARD_STATES]) {
+    board_kernels()->count(cells, n, counts);
+}
+
+static inline void board_pack(const char *cells, int n, unsigned char *out) {
+    board_kernels()->pack(cells, n, out);
+}
+
+static inline void board_unpack(const unsigned char *in, int n, char *cells) {
+    board_kernels()->unpack(in, n, cells);
+}
+
+static inline void board_render(const unsigned long long *mask, int n, char on, char off, char *out) {
+    board_kernels()->render(mask, n, on, off, out);
+}
+
+#endif // PLANSZA_H
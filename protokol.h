@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca & Marcel Gacoń
+ * AGH - Programowanie sieciowe
+ */
+
+#ifndef PROTOKOL_H
+#define PROTOKOL_H
+
+/*
+ * Zwarty binarny protokół gry na kanale głównym.
+ *
+ * Klient ogłasza możliwość "bin" w HELLO, serwer potwierdza ją linią "PROTOCOL bin".
+ * Od tej chwili najczęstsze komunikaty gry (strzał, wynik strzału, tura, plansza, czat)
+ * obie strony mogą wysyłać jako ramki binarne; pozostałe komunikaty i klienci bez tej
+ * możliwości (np. netcat) używają dalej protokołu tekstowego.
+ *
+ * Ramki i linie tekstu mogą się przeplatać w jednym strumieniu: pierwszy bajt ramki
+ * (kod operacji) ma ustawiony najstarszy bit. Kody 0x81-0x87 są w UTF-8 wyłącznie
+ * bajtami kontynuacji, więc żadna linia tekstu (także z polskimi znakami) nie może
+ * się od nich zaczynać.
+ * Długość ramki wynika z kodu operacji - ramki stałej długości - albo z długości
+ * zapisanej jako varint (LEB128, little-endian po 7 bitów) w przypadku czatu.
+ *
+ *   FIRE / HIT / MISS   [kod][x][y][miejsce gracza]          4 bajty
+ *   NEXT_TURN           [kod][miejsce gracza]                2 bajty
+ *   BOARD               [kod][numer planszy][64 pola x 2 bity] 18 bajtów
+ *   CHAT                [kod][varint n][n bajtów tekstu]
+ *   BOARD_DELTA         [kod][numer planszy][varint wersja][n][n x (pole | kod pola << 6)]
+ *
+ * Zamiast nazwy użytkownika ramki niosą miejsce gracza w pokoju (0 - twórca, 1 - drugi).
+ *
+ * Przyrostowe plansze (możliwość "delta", niezależna od "bin"): pełna plansza (BOARD0/BOARD1
+ * albo ramka BOARD) jest wersją 0, a dalej klient wysyła tylko zmienione pola jako kolejne
+ * wersje - "BOARD_DELTA <plansza> <wersja> <pola>", gdzie każde pole to dwie cyfry numeru
+ * i znak pola (np. "BOARD_DELTA 1 3 12X40="), albo ramką BOARD_DELTA. Serwer potwierdza
+ * wersje ("BOARD_ACK <plansza> <wersja>"), a gdy delta nie pasuje do jego wersji
+ * (np. po przejęciu gry przez inny serwer) - prosi o pełną planszę ("BOARD_RESYNC <plansza>").
+ */
+
+/* ===================== Includy ===================== */
+#include <string.h>
+
+#include "plansza.h"  // Pakowanie pól i różnice plansz (jądra SIMD)
+
+/* ===================== Definicje ===================== */
+#define PROTO_CAP_BINARY   "bin"     // Możliwość ogłaszana w HELLO
+#define PROTO_CAP_DELTA    "delta"   // Przyrostowe plansze (BOARD_DELTA)
+
+#define PROTO_FIRE         0x81
+#define PROTO_HIT          0x82
+#define PROTO_MISS         0x83
+#define PROTO_NEXT_TURN    0x84
+#define PROTO_BOARD        0x85
+#define PROTO_CHAT         0x86
+#define PROTO_BOARD_DELTA  0x87
+
+#define PROTO_SHOT_SIZE    4
+#define PROTO_TURN_SIZE    2
+#define PROTO_BOARD_CELLS  64
+#define PROTO_BOARD_SIZE   (2 + PROTO_BOARD_CELLS / 4)
+#define PROTO_MAX_CHAT     1000      // Najdłuższy tekst czatu w ramce
+#define PROTO_MAX_FRAME    (1 + 2 + PROTO_MAX_CHAT)
+#define PROTO_MAX_DELTA    (2 + 3 + 1 + PROTO_BOARD_CELLS)  // Ramka BOARD_DELTA zmieniająca wszystkie pola
+#define PROTO_DELTA_TEXT   (PROTO_BOARD_CELLS * 3 + 1)      // Pola delty w postaci tekstowej
+
+// Pola planszy w kolejności kodów 2-bitowych: puste, statek, trafiony statek, pudło
+static const char proto_cells[4] = { BOARD_CHAR_EMPTY, BOARD_CHAR_SHIP, BOARD_CHAR_HIT, BOARD_CHAR_MISS };
+
+/* ===================== Varint ===================== */
+// Zapisuje liczbę jako varint; zwraca liczbę zapisanych bajtów
+static inline int proto_put_varint(unsigned char *out, unsigned value) {
+    int n = 0;
+    while (value >= 0x80) {
+        out[n++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (unsigned char)value;
+    return n;
+}
+
+// Odczytuje varint; zwraca liczbę bajtów, 0 gdy brakuje danych, -1 gdy za długi
+static inline int proto_get_varint(const unsigned char *in, int avail, unsigned *value) {
+    unsigned v = 0;
+    for (int i = 0; i < avail && i < 3; i++) {
+        v |= (unsigned)(in[i] & 0x7F) << (7 * i);
+        if (!(in[i] & 0x80)) {
+            *value = v;
+            return i + 1;
+        }
+    }
+    return avail >= 3 ? -1 : 0;
+}
+
+/* ===================== Ramki ===================== */
+// Czy bajt rozpoczynający wiadomość jest kodem ramki (a nie początkiem linii tekstu)
+static inline int proto_is_frame(unsigned char first) {
+    return first >= PROTO_FIRE && first <= PROTO_BOARD_DELTA;
+}
+
+// Długość ramki zaczynającej się w 'in'. Zwraca 0, gdy brakuje jeszcze bajtów
+// do jej ustalenia, i -1 dla nieznanego kodu lub zbyt długiego czatu.
+static inline int proto_frame_length(const unsigned char *in, int avail) {
+    if (avail < 1)
+        return 0;
+    switch (in[0]) {
+    case PROTO_FIRE:
+    case PROTO_HIT:
+    case PROTO_MISS:
+        return PROTO_SHOT_SIZE;
+    case PROTO_NEXT_TURN:
+        return PROTO_TURN_SIZE;
+    case PROTO_BOARD:
+        return PROTO_BOARD_SIZE;
+    case PROTO_CHAT: {
+        unsigned len;
+        int n = proto_get_varint(in + 1, avail - 1, &len);
+        if (n <= 0)
+            return n;
+        if (len > PROTO_MAX_CHAT)
+            return -1;
+        return 1 + n + (int)len;
+    }
+    case PROTO_BOARD_DELTA: {
+        unsigned version;
+        if (avail < 2)
+            return 0;
+        int n = proto_get_varint(in + 2, avail - 2, &version);
+        if (n <= 0)
+            return n;
+        if (avail < 2 + n + 1)
+            return 0;
+        if (in[2 + n] > PROTO_BOARD_CELLS)
+            return -1;
+        return 2 + n + 1 + in[2 + n];
+    }
+    default:
+        return -1;
+    }
+}
+
+static inline int proto_shot(unsigned char out[PROTO_SHOT_SIZE], int op, int x, int y, int seat) {
+    out[0] = (unsigned char)op;
+    out[1] = (unsigned char)x;
+    out[2] = (unsigned char)y;
+    out[3] = (unsigned char)seat;
+    return PROTO_SHOT_SIZE;
+}
+
+static inline int proto_next_turn(unsigned char out[PROTO_TURN_SIZE], int seat) {
+    out[0] = PROTO_NEXT_TURN;
+    out[1] = (unsigned char)seat;
+    return PROTO_TURN_SIZE;
+}
+
+// 2-bitowy kod pola (nieznany znak jest pustym polem)
+static inline int proto_cell_code(char c) {
+    return board_code(c);
+}
+
+// Pakuje 64 pola planszy (znaki z proto_cells) po 2 bity na pole
+static inline int proto_board(unsigned char out[PROTO_BOARD_SIZE], int board, const char *cells) {
+    out[0] = PROTO_BOARD;
+    out[1] = (unsigned char)board;
+    board_pack(cells, PROTO_BOARD_CELLS, out + 2);
+    return PROTO_BOARD_SIZE;
+}
+
+// Rozpakowuje pola planszy z ramki BOARD do 64 znaków
+static inline void proto_unpack_board(const unsigned char *frame, char *cells) {
+    board_unpack(frame + 2, PROTO_BOARD_CELLS, cells);
+}
+
+// Ramka BOARD_DELTA z pól, którymi 'cur' różni się od 'old' (po 64 pola). Zwraca jej długość.
+static inline int proto_board_delta(unsigned char out[PROTO_MAX_DELTA], int board, unsigned version,
+                                    const char *old, const char *cur) {
+    out[0] = PROTO_BOARD_DELTA;
+    out[1] = (unsigned char)board;
+    int n = 2 + proto_put_varint(out + 2, version);
+    int count = n++;
+    unsigned long long changed;
+    board_diff(old, cur, PROTO_BOARD_CELLS, &changed);
+    out[count] = (unsigned char)__builtin_popcountll(changed);
+    for (; changed; changed &= changed - 1) {
+        int i = __builtin_ctzll(changed);
+        out[n++] = (unsigned char)(i | proto_cell_code(cur[i]) << 6);
+    }
+    return n;
+}
+
+// Pola delty w postaci tekstowej ("12X40=") - z linii BOARD_DELTA albo z ramki
+static inline int proto_delta_text(const char *old, const char *cur, char out[PROTO_DELTA_TEXT]) {
+    int n = 0;
+    unsigned long long changed;
+    board_diff(old, cur, PROTO_BOARD_CELLS, &changed);
+    for (; changed; changed &= changed - 1) {
+        int i = __builtin_ctzll(changed);
+        out[n++] = (char)('0' + i / 10);
+        out[n++] = (char)('0' + i % 10);
+        out[n++] = cur[i];
+    }
+    out[n] = '\0';
+    return n;
+}
+
+// Rozpakowuje ramkę BOARD_DELTA: numer planszy, wersja i pola w postaci tekstowej.
+// Zwraca liczbę pól albo -1 dla uszkodzonej ramki.
+static inline int proto_unpack_delta(const unsigned char *frame, int length, int *board, unsigned *version,
+                                     char out[PROTO_DELTA_TEXT]) {
+    int n = proto_get_varint(frame + 2, length - 2, version);
+    if (n <= 0 || 2 + n + 1 > length)
+        return -1;
+    int count = frame[2 + n];
+    const unsigned char *cells = frame + 3 + n;
+    if (count > PROTO_BOARD_CELLS || 3 + n + count > length)
+        return -1;
+    *board = frame[1];
+    for (int i = 0; i < count; i++) {
+        int cell = cells[i] & 0x3F;
+        out[3 * i] = (char)('0' + cell / 10);
+        out[3 * i + 1] = (char)('0' + cell % 10);
+        out[3 * i + 2] = proto_cells[cells[i] >> 6];
+    }
+    out[3 * count] = '\0';
+    return count;
+}
+
+// Buduje ramkę czatu; zwraca jej długość (tekst dłuższy niż PROTO_MAX_CHAT jest obcinany)
+static inline int proto_chat(unsigned char *out, const char *text, int len) {
+    if (len > PROTO_MAX_CHAT)
+        len = PROTO_MAX_CHAT;
+    out[0] = PROTO_CHAT;
+    int n = 1 + proto_put_varint(out + 1, (unsigned)len);
+    memcpy(out + n, text, len);
+    return n + len;
+}
+
+// Tekst z ramki czatu (bez zakończenia zerem); zwraca jego długość
+static inline int proto_chat_text(const unsigned char *frame, int frame_len, const char **text) {
+    unsigned len;
+    int n = proto_get_varint(frame + 1, frame_len - 1, &len);
+    if (n <= 0 || 1 + n + (int)len > frame_len)
+        return -1;
+    *text = (const char *)frame + 1 + n;
+    return (int)len;
+}
+
+/* ===================== TLV Obserwatorów ===================== */
+// Plansze dla obserwatora idą osobnym połączeniem (port z TLV_PORT) jako pakiety
+// [typ][długość - 2 bajty big-endian][wartość]
+#define TLV_BOARD_PLAYER0  0x01
+#define TLV_BOARD_PLAYER1  0x02
+#define TLV_HEADER_SIZE    3
+#define TLV_BOARDS_FRAME   (2 * (TLV_HEADER_SIZE + 64))  // Aktualizacja obserwatora: obie plansze
+
+// Buduje pakiet TLV z planszą; zwraca jego długość
+static inline int tlv_board_packet(unsigned char *out, int type, const char *cells, int len) {
+    out[0] = (unsigned char)type;
+    out[1] = (unsigned char)(len >> 8);
+    out[2] = (unsigned char)len;
+    memcpy(out + TLV_HEADER_SIZE, cells, len);
+    return TLV_HEADER_SIZE + len;
+}
+
+/* ===================== Negocjacja ===================== */
+// Czy lista możliwości (rozdzielana przecinkami, np. "resume,bin") zawiera 'cap'
+static inline int proto_has_cap(const char *caps, const char *cap) {
+    size_t len = strlen(cap);
+    while (*caps) {
+        size_t n = strcspn(caps, ",");
+        if (n == len && strncmp(caps, cap, len) == 0)
+            return 1;
+        caps += n;
+        if (*caps == ',')
+            caps++;
+    }
+    return 0;
+}
+
+#endif // PROTOKOL_H
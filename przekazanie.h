@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca & Marcel Gacoń
+ * AGH - Programowanie sieciowe
+ */
+
+#ifndef PRZEKAZANIE_H
+#define PRZEKAZANIE_H
+
+/*
+ * Kanał gorącego restartu (serwer z --handoff): gniazdo Unix SOCK_SEQPACKET, którym nowy
+ * proces serwera przejmuje od starego gniazda i stan.
+ *
+ * Każdy komunikat to jeden pakiet: 4-bajtowy typ i treść (struktura rekordu), a deskryptory
+ * (gniazda nasłuchujące, gniazda klientów) jadą w danych pomocniczych SCM_RIGHTS tego
+ * samego pakietu - rekord i jego gniazda docierają razem albo wcale. SOCK_SEQPACKET
+ * zachowuje granice komunikatów, więc nie trzeba ich ramkować.
+ *
+ * Znaczenie rekordów (i wymiana REQUEST -> stan -> COMMIT) należy do serwera;
+ * tutaj jest tylko transport.
+ */
+
+/* ===================== Includy ===================== */
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/* ===================== Definicje ===================== */
+#define HANDOFF_MAGIC      0x42534831u  // "BSH1"
+#define HANDOFF_MAX_FDS    72           // Deskryptory w jednym komunikacie (< SCM_MAX_FD)
+#define HANDOFF_MAX_MSG    (64 * 1024)  // Największa treść komunikatu
+#define HANDOFF_TIMEOUT_MS 5000         // Milczenie drugiej strony przerywa przekazanie
+
+// Adres gniazda; zwraca 0 albo -1, gdy ścieżka jest za długa
+static inline int handoff_address(const char *path, struct sockaddr_un *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path))
+        return -1;
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+// Łączy się z serwerem nasłuchującym na 'path'. Zwraca gniazdo albo -1 (errno z connect:
+// ENOENT / ECONNREFUSED oznaczają, że nikt nie czeka na następcę).
+static inline int handoff_connect(const char *path) {
+    struct sockaddr_un addr;
+    if (handoff_address(path, &addr) < 0) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+// Gniazdo nasłuchujące na następcę (pozostałość po poprzednim procesie jest usuwana)
+static inline int handoff_listen(const char *path) {
+    struct sockaddr_un addr;
+    if (handoff_address(path, &addr) < 0) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 1) < 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+/* ===================== Komunikaty ===================== */
+// Wysyła komunikat 'type' z treścią 'body' i deskryptorami 'fds'. Zwraca 0 albo -1.
+static int handoff_send(int sock, unsigned type, const void *body, size_t len, const int *fds, int nfds) {
+    struct iovec iov[2] = { { &type, sizeof(type) }, { (void *)body, len } };
+    union {
+        char buf[CMSG_SPACE(sizeof(int) * HANDOFF_MAX_FDS)];
+        struct cmsghdr align;
+    } control;
+    struct msghdr m;
+    memset(&m, 0, sizeof(m));
+    m.msg_iov = iov;
+    m.msg_iovlen = len ? 2 : 1;
+    if (nfds > HANDOFF_MAX_FDS || len > HANDOFF_MAX_MSG)
+        return -1;
+    if (nfds > 0) {
+        memset(&control, 0, sizeof(control));
+        m.msg_control = control.buf;
+        m.msg_controllen = CMSG_SPACE(sizeof(int) * nfds);
+        struct cmsghdr *c = CMSG_FIRSTHDR(&m);
+        c->cmsg_level = SOL_SOCKET;
+        c->cmsg_type = SCM_RIGHTS;
+        c->cmsg_len = CMSG_LEN(sizeof(int) * nfds);
+        memcpy(CMSG_DATA(c), fds, sizeof(int) * nfds);
+    }
+    ssize_t n;
+    while ((n = sendmsg(sock, &m, MSG_NOSIGNAL)) < 0 && errno == EINTR)
+        ;
+    return n == (ssize_t)(sizeof(type) + len) ? 0 : -1;
+}
+
+// Odbiera komunikat: treść do 'body' (*len - jej długość), deskryptory do 'fds' (*nfds).
+// Zwraca typ komunikatu, 0 przy zamknięciu kanału albo -1 przy błędzie lub przekroczeniu czasu.
+static int handoff_recv(int sock, void *body, size_t size, size_t *len, int *fds, int *nfds) {
+    struct pollfd p = { sock, POLLIN, 0 };
+    int ready;
+    while ((ready = poll(&p, 1, HANDOFF_TIMEOUT_MS)) < 0 && errno == EINTR)
+        ;
+    if (ready <= 0)
+        return -1;
+    unsigned type = 0;
+    struct iovec iov[2] = { { &type, sizeof(type) }, { body, size } };
+    union {
+        char buf[CMSG_SPACE(sizeof(int) * HANDOFF_MAX_FDS)];
+        struct cmsghdr align;
+    } control;
+    struct msghdr m;
+    memset(&m, 0, sizeof(m));
+    m.msg_iov = iov;
+    m.msg_iovlen = 2;
+    m.msg_control = control.buf;
+    m.msg_controllen = sizeof(control.buf);
+    ssize_t n;
+    while ((n = recvmsg(sock, &m, MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR)
+        ;
+    *nfds = 0;
+    if (n < 0)
+        return -1;  // Przy błędzie jądro nie wypełnia bufora kontrolnego
+    int overflow = 0;
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&m); c; c = CMSG_NXTHDR(&m, c)) {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS)
+            continue;
+        int count = (int)((c->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        for (int i = 0; i < count; i++) {
+            int fd;
+            memcpy(&fd, CMSG_DATA(c) + sizeof(int) * i, sizeof(int));
+            if (*nfds < HANDOFF_MAX_FDS) {
+                fds[(*nfds)++] = fd;
+            } else {
+                close(fd);  // Więcej niż mieści 'fds' - cały komunikat jest odrzucany
+                overflow = 1;
+            }
+        }
+    }
+    if (n == 0 && !overflow)
+        return 0;
+    if (overflow || n < (ssize_t)sizeof(type) || (m.msg_flags & (MSG_TRUNC | MSG_CTRUNC))) {
+        for (int i = 0; i < *nfds; i++)
+            close(fds[i]);
+        *nfds = 0;
+        return -1;
+    }
+    *len = (size_t)n - sizeof(type);
+    return (int)type;
+}
+
+#endif // PRZEKAZANIE_H
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca & Marcel Gacoń
+ * AGH - Programowanie sieciowe
+ */
+
+#ifndef PULA_H
+#define PULA_H
+
+/*
+ * Pula wątków z podkradaniem pracy (work stealing).
+ *
+ * Każdy wątek roboczy ma własną kolejkę dwustronną zadań. Zadanie trafia
+ * zawsze do kolejki swojego wątku domowego (Task.home), więc praca jednego
+ * aktora (pokoju, klienta) wykonuje się zwykle na tym samym rdzeniu.
+ * Wątek bez pracy podkrada zadania z końca cudzych kolejek, dzięki czemu
+ * nagły napływ komend w jednym pokoju nie blokuje pozostałych rdzeni.
+ *
+ * Pula nie gwarantuje kolejności między zadaniami - kolejność zapewnia
+ * wywołujący, planując każde zadanie co najwyżej raz naraz (flaga aktora).
+ */
+
+/* ===================== Includy ===================== */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+
+/* ===================== Definicje ===================== */
+#ifndef POOL_MAX_WORKERS
+#define POOL_MAX_WORKERS  64
+#endif
+#ifndef POOL_DEQUE_SIZE
+#define POOL_DEQUE_SIZE   4096   // Pojemność kolejki wątku (potęga dwójki)
+#endif
+#define POOL_DEQUE_MASK   (POOL_DEQUE_SIZE - 1)
+
+typedef struct Task Task;
+typedef void (*TaskFunction)(Task *task);
+
+struct Task {
+    TaskFunction run;
+    int home;          // Preferowany wątek roboczy
+};
+
+// Kolejka dwustronna wątku: właściciel bierze z początku (najstarsze zadanie),
+// złodzieje z końca. Krótka blokada na kolejkę - rywalizacja jest tylko przy kradzieży.
+typedef struct {
+    pthread_mutex_t lock;
+    Task *items[POOL_DEQUE_SIZE];
+    unsigned long head;
+    unsigned long tail;
+} WorkDeque;
+
+struct ThreadPool;
+
+typedef struct {
+    int id;
+    pthread_t thread;
+    WorkDeque deque;
+    struct ThreadPool *pool;
+    unsigned long executed;  // Wykonane zadania
+    unsigned long stolen;    // W tym podkradzione z cudzych kolejek
+} PoolWorker;
+
+typedef struct ThreadPool {
+    int size;
+    PoolWorker workers[POOL_MAX_WORKERS];
+    pthread_mutex_t sleep_lock;
+    pthread_cond_t wake;
+    int sleepers;      // Wątki uśpione w oczekiwaniu na pracę
+    long pending;      // Zadania w kolejkach (jeszcze nie pobrane)
+} ThreadPool;
+
+static __thread PoolWorker *pool_current_worker;  // Wątek roboczy bieżącego wątku (lub NULL)
+
+/* ===================== Kolejka ===================== */
+static int work_deque_push(WorkDeque *dq, Task *task) {
+    pthread_mutex_lock(&dq->lock);
+    if (dq->tail - dq->head >= POOL_DEQUE_SIZE) {
+        pthread_mutex_unlock(&dq->lock);
+        return 0;
+    }
+    dq->items[dq->tail++ & POOL_DEQUE_MASK] = task;
+    pthread_mutex_unlock(&dq->lock);
+    return 1;
+}
+
+static Task *work_deque_take(WorkDeque *dq) {
+    Task *task = NULL;
+    pthread_mutex_lock(&dq->lock);
+    if (dq->head != dq->tail)
+        task = dq->items[dq->head++ & POOL_DEQUE_MASK];
+    pthread_mutex_unlock(&dq->lock);
+    return task;
+}
+
+static Task *work_deque_steal(WorkDeque *dq) {
+    Task *task = NULL;
+    if (pthread_mutex_trylock(&dq->lock) != 0)
+        return NULL;  // Właściciel lub inny złodziej pracuje na kolejce - próbujemy dalej
+    if (dq->head != dq->tail)
+        task = dq->items[--dq->tail & POOL_DEQUE_MASK];
+    pthread_mutex_unlock(&dq->lock);
+    return task;
+}
+
+/* ===================== API Puli ===================== */
+// Zleca zadanie jego wątkowi domowemu. Bezpieczne z dowolnego wątku.
+static void pool_submit(ThreadPool *pool, Task *task) {
+    PoolWorker *w = &pool->workers[task->home % pool->size];
+    __atomic_add_fetch(&pool->pending, 1, __ATOMIC_SEQ_CST);
+    if (!work_deque_push(&w->deque, task)) {
+        __atomic_sub_fetch(&pool->pending, 1, __ATOMIC_SEQ_CST);
+        fprintf(stderr, "[POOL] Worker %d queue full, running task inline\n", w->id);
+        task->run(task);
+        return;
+    }
+    if (__atomic_load_n(&pool->sleepers, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&pool->sleep_lock);
+        pthread_cond_broadcast(&pool->wake);
+        pthread_mutex_unlock(&pool->sleep_lock);
+    }
+}
+
+// Szuka pracy: najpierw własna kolejka, potem kradzież z pozostałych
+static Task *pool_find_task(PoolWorker *w) {
+    ThreadPool *pool = w->pool;
+    Task *task = work_deque_take(&w->deque);
+    if (task)
+        return task;
+    for (int i = 1; i < pool->size; i++) {
+        PoolWorker *victim = &pool->workers[(w->id + i) % pool->size];
+        task = work_deque_steal(&victim->deque);
+        if (task) {
+            w->stolen++;
+            return task;
+        }
+    }
+    return NULL;
+}
+
+static void *pool_worker_loop(void *arg) {
+    PoolWorker *w = (PoolWorker *)arg;
+    ThreadPool *pool = w->pool;
+    pool_current_worker = w;
+    while (1) {
+        Task *task = pool_find_task(w);
+        if (task) {
+            __atomic_sub_fetch(&pool->pending, 1, __ATOMIC_SEQ_CST);
+            task->run(task);
+            w->executed++;
+            continue;
+        }
+        if (__atomic_load_n(&pool->pending, __ATOMIC_SEQ_CST) > 0) {
+            sched_yield();  // Praca jest, ale kolejka chwilowo zajęta przez innego złodzieja
+            continue;
+        }
+        pthread_mutex_lock(&pool->sleep_lock);
+        __atomic_add_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&pool->pending, __ATOMIC_SEQ_CST) == 0)
+            pthread_cond_wait(&pool->wake, &pool->sleep_lock);
+        __atomic_sub_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&pool->sleep_lock);
+    }
+    return NULL;
+}
+
+// Czy pula nic nie robi: kolejki puste i wszystkie wątki uśpione (nikt nie wykonuje zadania).
+// Wynik jest trwały tylko wtedy, gdy nikt poza pulą nie zleca zadań (gorący restart).
+static int pool_idle(ThreadPool *pool) {
+    return __atomic_load_n(&pool->pending, __ATOMIC_SEQ_CST) == 0 &&
+           __atomic_load_n(&pool->sleepers, __ATOMIC_SEQ_CST) == pool->size;
+}
+
+// Uruchamia 'size' wątków roboczych
+static void pool_start(ThreadPool *pool, int size) {
+    if (size < 1)
+        size = 1;
+    if (size > POOL_MAX_WORKERS)
+        size = POOL_MAX_WORKERS;
+    pool->size = size;
+    pool->sleepers = 0;
+    pool->pending = 0;
+    pthread_mutex_init(&pool->sleep_lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    for (int i = 0; i < size; i++) {
+        PoolWorker *w = &pool->workers[i];
+        w->id = i;
+        w->pool = pool;
+        w->executed = 0;
+        w->stolen = 0;
+        w->deque.head = w->deque.tail = 0;
+        pthread_mutex_init(&w->deque.lock, NULL);
+    }
+    for (int i = 0; i < size; i++) {
+        if (pthread_create(&pool->workers[i].thread, NULL, pool_worker_loop, &pool->workers[i]) != 0) {
+            perror("[POOL] pthread_create");
+            exit(EXIT_FAILURE);
+        }
+        pthread_detach(pool->workers[i].thread);
+    }
+}
+
+#endif // PULA_H
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca & Marcel Gacoń
+ * AGH - Programowanie sieciowe
+ */
+
+#ifndef REPLIKACJA_H
+#define REPLIKACJA_H
+
+/*
+ * Binarny dziennik replikacji (serwer z --replicate i serwer zapasowy z --standby).
+ *
+ * Aktor pokoju po każdej komendzie porównuje pokój z jego ostatnim wysłanym obrazem
+ * (ReplRoomState) i dopisuje do dziennika tylko różnice: otwarcie i zamknięcie pokoju,
+ * zajęcie miejsca, gotowość, start gry i turę, zmienione pola planszy. Sesja gracza
+ * (token wznowienia i nazwa) jedzie raz, zanim pierwszy raz pojawi się na miejscu.
+ *
+ * Rekord to nagłówek [typ u8][pokój u16] i treść stałej długości zależnej od typu
+ * (SESSION i OPEN kończą się napisem poprzedzonym długością). Liczby są little-endian.
+ * Rekordy jednego pokoju są w kolejności jego zdarzeń; strumień zaczyna RESET, po którym
+ * każdy pokój przychodzi w całości, więc serwer zapasowy nie potrzebuje historii.
+ */
+
+/* ===================== Includy ===================== */
+#include <string.h>
+
+#include "plansza.h"  // Różnice plansz jako maska bitowa
+
+/* ===================== Definicje ===================== */
+#define REPL_HEADER_LEN   3      // Typ i numer pokoju
+#define REPL_TOKEN_LEN    32     // Token wznowienia (RESUME_TOKEN_LEN serwera)
+#define REPL_NAME_MAX     49     // Najdłuższa nazwa gracza lub twórcy pokoju
+#define REPL_BOARD_CELLS  64     // Jedno słowo maski board_diff
+#define REPL_CELLS_AS_BOARD 8    // Od tylu zmienionych pól wysyłamy całą planszę
+
+enum {
+    REPL_HELLO = 1,   // Zapasowy -> główny: port, na którym zapasowy przyjmie klientów (u16)
+    REPL_HEARTBEAT,   // Strumień żyje, choć nic się nie dzieje
+    REPL_RESET,       // Zapomnij wszystko - dalej przychodzi pełny stan
+    REPL_SESSION,     // sesja u32, token, nazwa
+    REPL_OPEN,        // Pokój zajęty: twórca
+    REPL_CLOSE,       // Pokój zwolniony
+    REPL_SEAT,        // miejsce u8, sesja u32 (0 = wolne)
+    REPL_READY,       // miejsce u8, gotowość u8
+    REPL_TURN,        // gra trwa u8, gracz na ruchu u8
+    REPL_CELL,        // plansza u8, pole u8, wartość u8
+    REPL_BOARD,       // plansza u8, 64 pola
+    REPL_TYPE_COUNT
+};
+
+// Obraz pokoju po stronie nadawcy (ostatnio wysłany stan) i odbiorcy
+typedef struct {
+    unsigned epoch;                // Strumień, którego dotyczy obraz (inny = pokój jeszcze nie wysłany)
+    unsigned char in_use;
+    unsigned char started;
+    unsigned char turn;
+    unsigned char ready[2];
+    unsigned seat[2];              // Numery sesji graczy (0 = wolne miejsce)
+    char creator[REPL_NAME_MAX + 1];
+    char board[2][REPL_BOARD_CELLS];
+} ReplRoomState;
+
+// Bufor, do którego dopisywane są rekordy
+typedef struct {
+    unsigned char *data;
+    size_t len;
+    size_t cap;
+} ReplLog;
+
+/* ===================== Kodowanie ===================== */
+static inline unsigned char *repl_record(ReplLog *log, int type, int room, size_t body) {
+    if (log->len + REPL_HEADER_LEN + body > log->cap)
+        return NULL;
+    unsigned char *p = log->data + log->len;
+    p[0] = (unsigned char)type;
+    p[1] = (unsigned char)(room & 0xff);
+    p[2] = (unsigned char)((room >> 8) & 0xff);
+    log->len += REPL_HEADER_LEN + body;
+    return p + REPL_HEADER_LEN;
+}
+
+static inline void repl_put_u16(unsigned char *p, unsigned v) {
+    p[0] = (unsigned char)(v & 0xff);
+    p[1] = (unsigned char)((v >> 8) & 0xff);
+}
+
+static inline void repl_put_u32(unsigned char *p, unsigned v) {
+    for (int i = 0; i < 4; i++)
+        p[i] = (unsigned char)((v >> (8 * i)) & 0xff);
+}
+
+static inline unsigned repl_get_u16(const unsigned char *p) {
+    return p[0] | (unsigned)p[1] << 8;
+}
+
+static inline unsigned repl_get_u32(const unsigned char *p) {
+    return p[0] | (unsigned)p[1] << 8 | (unsigned)p[2] << 16 | (unsigned)p[3] << 24;
+}
+
+// Rekord bez treści (HEARTBEAT, RESET, CLOSE). Zwraca 0 albo -1, gdy bufor jest pełny.
+static inline int repl_put_empty(ReplLog *log, int type, int room) {
+    return repl_record(log, type, room, 0) ? 0 : -1;
+}
+
+static inline int repl_put_hello(ReplLog *log, int port) {
+    unsigned char *p = repl_record(log, REPL_HELLO, 0, 2);
+    if (!p)
+        return -1;
+    repl_put_u16(p, (unsigned)port);
+    return 0;
+}
+
+static inline int repl_put_session(ReplLog *log, unsigned sid, const char *token, const char *name) {
+    size_t n = strnlen(name, REPL_NAME_MAX);
+    unsigned char *p = repl_record(log, REPL_SESSION, 0, 4 + REPL_TOKEN_LEN + 1 + n);
+    if (!p)
+        return -1;
+    repl_put_u32(p, sid);
+    memcpy(p + 4, token, REPL_TOKEN_LEN);
+    p[4 + REPL_TOKEN_LEN] = (unsigned char)n;
+    memcpy(p + 5 + REPL_TOKEN_LEN, name, n);
+    return 0;
+}
+
+// Dopisuje różnice między 'old' (ostatnio wysłanym obrazem) a 'cur'.
+// Zwraca 0 albo -1, gdy bufor się zapełnił (część rekordów mogła zostać dopisana).
+static inline int repl_put_diff(ReplLog *log, int room, const ReplRoomState *old, const ReplRoomState *cur) {
+    unsigned char *p;
+    if (!cur->in_use) {
+        if (old->in_use && repl_put_empty(log, REPL_CLOSE, room) < 0)
+            return -1;
+        return 0;
+    }
+    if (!old->in_use) {
+        size_t n = strnlen(cur->creator, REPL_NAME_MAX);
+        if (!(p = repl_record(log, REPL_OPEN, room, 1 + n)))
+            return -1;
+        p[0] = (unsigned char)n;
+        memcpy(p + 1, cur->creator, n);
+    }
+    for (int s = 0; s < 2; s++) {
+        if (cur->seat[s] != old->seat[s]) {
+            if (!(p = repl_record(log, REPL_SEAT, room, 5)))
+                return -1;
+            p[0] = (unsigned char)s;
+            repl_put_u32(p + 1, cur->seat[s]);
+        }
+        if (cur->ready[s] != old->ready[s]) {
+            if (!(p = repl_record(log, REPL_READY, room, 2)))
+                return -1;
+            p[0] = (unsigned char)s;
+            p[1] = cur->ready[s];
+        }
+    }
+    if (cur->started != old->started || cur->turn != old->turn) {
+        if (!(p = repl_record(log, REPL_TURN, room, 2)))
+            return -1;
+        p[0] = cur->started;
+        p[1] = cur->turn;
+    }
+    for (int b = 0; b < 2; b++) {
+        unsigned long long mask;
+        board_diff(old->board[b], cur->board[b], REPL_BOARD_CELLS, &mask);
+        if (__builtin_popcountll(mask) >= REPL_CELLS_AS_BOARD) {
+            if (!(p = repl_record(log, REPL_BOARD, room, 1 + REPL_BOARD_CELLS)))
+                return -1;
+            p[0] = (unsigned char)b;
+            memcpy(p + 1, cur->board[b], REPL_BOARD_CELLS);
+            continue;
+        }
+        for (; mask; mask &= mask - 1) {
+            int i = __builtin_ctzll(mask);
+            if (!(p = repl_record(log, REPL_CELL, room, 3)))
+                return -1;
+            p[0] = (unsigned char)b;
+            p[1] = (unsigned char)i;
+            p[2] = (unsigned char)cur->board[b][i];
+        }
+    }
+    return 0;
+}
+
+/* ===================== Dekodowanie ===================== */
+// Długość rekordu na początku 'p': > 0, 0 gdy rekord jest niekompletny, -1 dla nieznanego typu
+static inline int repl_record_len(const unsigned char *p, size_t avail) {
+    static const unsigned char body[REPL_TYPE_COUNT] = {
+        [REPL_HELLO] = 2, [REPL_SEAT] = 5, [REPL_READY] = 2, [REPL_TURN] = 2,
+        [REPL_CELL] = 3, [REPL_BOARD] = 1 + REPL_BOARD_CELLS,
+    };
+    if (avail == 0)
+        return 0;
+    if (p[0] == 0 || p[0] >= REPL_TYPE_COUNT)
+        return -1;
+    size_t len = REPL_HEADER_LEN + body[p[0]];
+    // SESSION i OPEN: długość napisu stoi tuż przed nim
+    size_t str = p[0] == REPL_SESSION ? REPL_HEADER_LEN + 4 + REPL_TOKEN_LEN :
+                 p[0] == REPL_OPEN ? REPL_HEADER_LEN : 0;
+    if (str) {
+        if (avail <= str)
+            return 0;
+        len = str + 1 + p[str];
+    }
+    return avail >= len ? (int)len : 0;
+}
+
+#endif // REPLIKACJA_H
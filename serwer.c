@@ -4,23 +4,98 @@
  */
 
 // ==================== Includy i Definicje ====================
+#define _GNU_SOURCE  // accept4, pthread_setaffinity_np
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <stddef.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <pthread.h>
+#include <sched.h>
 #include <signal.h>
 #include <time.h>
 #include <sys/stat.h> // Demon
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h> // SIGINT/SIGTERM jako zdarzenie reaktora 0
+#include <sys/un.h>   // Gniazdo metryk (--metrics)
+#include <sys/random.h> // Tokeny wznowienia (getrandom)
+#include <poll.h>     // POLLIN dla poll w io_uring (discovery)
+#include <netinet/tcp.h>
 
-#define MAX_CLIENTS     10
+#include "zegar.h"     // Koło czasowe (timery tur, bezczynności i heartbeatu)
+#include "skrzynka.h"  // Bezblokadowa skrzynka do przekazywania klientów między reaktorami
+#include "pula.h"      // Pula wątków z podkradaniem pracy (wykonywanie komend)
+#include "pierscien.h" // Opcjonalny backend io_uring reaktorów (--io uring)
+#include "protokol.h"  // Binarne ramki gry negocjowane w HELLO
+#include "komendy.h"   // Rejestr komend tekstowych i uprawnienia ról
+#include "nagrywanie.h" // Nagrywanie ruchu połączeń (--capture)
+#include "metryki.h"    // Liczniki i histogramy (--metrics)
+#include "sledzenie.h"  // Ślady strzałów w formacie Chrome Trace (--trace-sample)
+#include "blokady.h"    // Profiler blokad (-DLOCK_PROFILING=1)
+#include "klaster.h"    // Katalog pokoi klastra serwerów (--cluster)
+#include "przekazanie.h" // Kanał gorącego restartu (--handoff)
+#include "replikacja.h"  // Dziennik replikacji do serwera zapasowego (--replicate, --standby)
+
+#define MAX_CLIENTS     1024
+#define MAX_ROOMS       (MAX_CLIENTS / 2)
+#define MAX_OBSERVERS   8
+#define OBSERVER_UPDATE_MS 100        // Najczęściej co tyle pokój wysyła obserwatorom plansze (TLV)
 #define SERVER_PORT     12345
 #define DISCOVERY_PORT  12346
 #define MULTICAST_ADDR  "239.255.0.1"
+#define DISCOVERY_REQUEST      "DISCOVERY_REQUEST"
+#define DISCOVERY_REQUEST_MAX  64     // Dłuższe datagramy są przycinane (i tak nie są zapytaniem)
+#define DISCOVERY_BATCH        32     // Datagramy na jedno recvmmsg/sendmmsg
+#define DISCOVERY_RATE         5      // Odpowiedzi na sekundę dla jednego adresu...
+#define DISCOVERY_BURST        10     // ...z zapasem na krótką serię
+#define DISCOVERY_LIMIT_SLOTS  1024   // Rozmiar tablicy limitów (potęga dwójki)
+#define DISCOVERY_LOAD_REFRESH_MS 100 // Jak długo odpowiedź z obciążeniem serwera jest aktualna
+#define SERVER_ID_LEN          8      // Długość losowego identyfikatora serwera (znaki hex)
 #define USERNAME_HANDSHAKE_TIMEOUT 5
 
+// Zegary serwera (w sekundach). Rozdzielczość koła czasowego to TIMER_TICK_MS.
+#define TIMER_TICK_MS        100
+#define TURN_TIMEOUT         60    // Czas na ruch - po nim gracz przegrywa walkowerem
+#define IDLE_TIMEOUT         300   // Bezczynność w lobby / pokoju przed startem gry
+#define HEARTBEAT_INTERVAL   15    // Co ile wysyłamy PING
+#define HEARTBEAT_TIMEOUT    45    // Brak jakichkolwiek danych od klienta => rozłączenie
+#define RESUME_GRACE         30    // Jak długo trzymamy miejsce rozłączonego gracza
+#define OBSERVER_UPDATE_TICKS (OBSERVER_UPDATE_MS >= TIMER_TICK_MS ? OBSERVER_UPDATE_MS / TIMER_TICK_MS : 1)
+#define RESUME_TOKEN_LEN     32    // Długość tokenu wznowienia (znaki hex)
+#define TCP_FASTOPEN_QUEUE   16    // Kolejka połączeń TCP Fast Open na gnieździe nasłuchującym
+
+// Reaktory (wątki pętli zdarzeń epoll)
+#define MAX_REACTORS         64
+#define EPOLL_BATCH          64           // Ile zdarzeń odbieramy jednym epoll_wait
+#define MAX_OUTPUT_BUFFER    (256 * 1024) // Limit zaległych danych wolnego klienta
+#define COALESCE_MAX_MS      50           // Najdłuższy tick łączenia komunikatów pokoju (--coalesce)
+
+// Backend wejścia/wyjścia reaktorów (--io epoll|uring)
+#define IO_EPOLL             0
+#define IO_URING             1
+#define URING_ENTRIES        256          // Rozmiar pierścienia zgłoszeń reaktora
+#define URING_CQ_ENTRIES     4096         // Pierścień zakończeń (multishot daje wiele CQE na zgłoszenie)
+#define URING_RECV_BUFFERS   256          // Bufory recv w pierścieniu buforów reaktora (potęga dwójki)
+#define URING_RECV_BUF_SIZE  512
+#define URING_FILE_SLOTS     4096         // Tablica stałych deskryptorów reaktora (slot = numer gniazda)
+
+// user_data zgłoszeń io_uring: wskaźnik klienta | rodzaj operacji.
+// Bez wskaźnika klienta - operacje samego reaktora.
+#define URING_OP_RECV        1
+#define URING_OP_SEND        2
+#define URING_TAG_MASK       3ULL
+#define URING_UD_IGNORE      0            // Wynik nieistotny (rejestracja deskryptora, anulowanie)
+#define URING_UD_ACCEPT      1
+#define URING_UD_WAKE        2
+#define URING_UD_DISCOVERY   3            // Gniazdo discovery gotowe do odczytu (reaktor 0)
+#define URING_UD_CLUSTER     4            // Gniazdo ogłoszeń klastra gotowe do odczytu (reaktor 0)
+#define URING_UD_SIGNAL      5            // SIGINT/SIGTERM w signalfd (reaktor 0)
+#define URING_UD_COUNT       8            // user_data poniżej tej wartości to operacje reaktora
+
 // Definicja trybu demona. 1 aby uruchomić serwer jako demona, 0 aby uruchomić normalnie.
 #define RUN_AS_DAEMON 0
 
@@ -37,59 +112,285 @@
 "  /fire x y         - shoot at (x,y) if it's your turn\n\n"
 
 #define BUFFER_SIZE    1024   // Rozmiar bufora wiadomości
-static char msg[BUFFER_SIZE];     // Bufor do tworzenia komunikatów
+static __thread char msg[BUFFER_SIZE];     // Bufor do tworzenia komunikatów (osobny dla każdego wątku)
 
 // ==================== Struktury Danych ====================
 
-typedef struct {
+// Stan połączenia
+#define CONN_HANDSHAKE  0   // Czekamy na nazwę użytkownika / HELLO / RESUME
+#define CONN_READY      1   // Klient w lobby lub w pokoju
+
+// Wynik przetworzenia jednej linii
+#define LINE_OK         0   // Czytamy dalej
+#define LINE_CLOSE     -1   // Zamknąć połączenie
+#define LINE_HANDOFF    1   // Linia ma zostać obsłużona przez inny reaktor (handoff_target)
+
+// Połączeniem (gniazdo, bufor wejściowy, timery) zarządza jego reaktor, a komendy
+// zalogowanego klienta wykonuje aktor klienta w puli wątków. Struktura jest zwalniana,
+// gdy zniknie ostatnia referencja: sesji, członkostwa w pokoju, komendy w skrzynce
+// pokoju albo zaplanowanego aktora klienta.
+
+struct Reactor;
+
+typedef struct Client {
     int socket;
     struct sockaddr_in address;
     char username[50];
     int room_id;
     int active;
     int tlv_socket; // Gniazdo dla połączenia TLV, jeśli dotyczy
+    // Ramka plansz czekająca na gniazdo TLV (wyłącznie aktor pokoju obserwatora). Niewysłaną
+    // ramkę zastępuje nowsza; rozpoczętą trzeba dokończyć, więc nowszy stan tylko oznaczamy.
+    unsigned char tlv_frame[TLV_BOARDS_FRAME];
+    int tlv_frame_len;
+    int tlv_frame_off;
+    int tlv_stale;                 // Plansze zmieniły się od ramki w tlv_frame
+    unsigned long long last_seen;  // Tick ostatnich danych od klienta
+    Timer handshake_timer;         // Termin na podanie nazwy użytkownika
+    Timer idle_timer;              // Bezczynność poza rozgrywką
+    Timer heartbeat_timer;         // Okresowy PING i wykrywanie półotwartych połączeń
+    char resume_token[RESUME_TOKEN_LEN + 1];  // Token wznowienia sesji wydany przy handshake
+    int held;                      // Rozłączony gracz, którego miejsce czeka na wznowienie
+    int no_resume;                 // Rozłączony celowo (bezczynność) - nie trzymamy miejsca
+    Timer grace_timer;             // Koniec okresu wznowienia
+    char caps[64];                 // Możliwości ogłoszone przez klienta w HELLO
+    int binary;                    // Klient rozumie ramki binarne (możliwość "bin")
+    int board_deltas;              // Klient wysyła plansze przyrostowo (możliwość "delta")
+    unsigned long capture_conn;    // Numer połączenia w nagraniu (0 = nie nagrywamy)
+    char inbuf[BUFFER_SIZE];       // Bufor odbiorczy - strumień dzielony jest na linie
+    int in_start;
+    int in_end;
+    int state;                     // CONN_HANDSHAKE / CONN_READY
+    struct Reactor *reactor;       // Reaktor obsługujący połączenie (i timery klienta)
+    struct Reactor *handoff_target;// Docelowy reaktor przy LINE_HANDOFF
+    MailboxNode handoff_node;      // Węzeł skrzynki przekazań między reaktorami
+    pthread_mutex_t out_lock;      // Chroni gniazdo i bufor wyjściowy (wysyłają też wątki puli)
+    char *outbuf;                  // Dane, których gniazdo nie przyjęło od razu
+    size_t out_len;
+    size_t out_cap;
+    int want_write;                // Czy czekamy na EPOLLOUT
+    int corked;                    // Wyjście czeka w outbuf na koniec ticku łączenia (--coalesce)
+    int cork_queued;               // Klient jest w cork_queue reaktora (trzyma referencję)
+    MailboxNode cork_node;
+    int refs;                      // Licznik referencji
+    int seated;                    // Gracz (nie obserwator) w pokoju - ustawia aktor pokoju
+    unsigned long long last_command;  // Tick ostatniej komendy użytkownika (bezczynność)
+    RingMailbox lines;             // Linie i ramki (InputLine) czekające na aktora klienta
+    Task task;                     // Zadanie aktora klienta w puli
+    int scheduled;                 // Aktor klienta zaplanowany lub w trakcie pracy
+    int awaiting_room;             // Czekamy, aż pokój wykona poprzednią komendę klienta
+    // Backend io_uring (pola używane tylko przy --io uring)
+    int fixed_slot;                // Slot gniazda w tablicy stałych deskryptorów reaktora (-1 = brak)
+    int recv_armed;                // Wielokrotny recv aktywny (trzyma referencję)
+    int send_busy;                 // Wysyłka w kolejce reaktora lub w jądrze (trzyma referencję)
+    char *sendbuf;                 // Dane przekazane jądru - niezmienne do zakończenia wysyłki
+    size_t send_len;
+    size_t send_off;
+    size_t send_cap;
+    MailboxNode send_node;         // Węzeł kolejki wysyłek reaktora
+    struct Client *conn_prev;      // Lista połączeń przed handshake'iem (pending_conns)
+    struct Client *conn_next;
+    unsigned repl_sid;             // Numer sesji w strumieniu replikacji (0 = jeszcze nie nadany)
 } Client;
 
+// Linia tekstu lub ramka binarna w skrzynce aktora klienta
+typedef struct {
+    int length;
+    unsigned long long recv_ns;    // Chwila odebrania przez reaktor (tylko przy włączonym śledzeniu)
+    char data[];                   // Zakończone zerem (ramka może zawierać też zera w środku)
+} InputLine;
+
+// Komendy wykonywane przez aktora pokoju
+#define ROOM_CMD_JOIN           0
+#define ROOM_CMD_EXIT           1
+#define ROOM_CMD_START          2
+#define ROOM_CMD_FIRE           3
+#define ROOM_CMD_HIT            4
+#define ROOM_CMD_MISS           5
+#define ROOM_CMD_WIN            6
+#define ROOM_CMD_CHAT           7
+#define ROOM_CMD_BOARD          8
+#define ROOM_CMD_TURN_TIMEOUT   9   // Zegar tury (sender = NULL)
+#define ROOM_CMD_ABANDON       10   // Koniec okresu wznowienia trzymanego gracza
+#define ROOM_CMD_LEAVE         11   // Połączenie zamknięte - zwolnić miejsce
+#define ROOM_CMD_HOLD          12   // Gracz rozłączony, miejsce trzymane do wznowienia
+#define ROOM_CMD_RESUME        13   // Gracz wznowił sesję - wysłać mu stan pokoju
+#define ROOM_CMD_REPLICATE     14   // Wysłać pełny stan pokoju serwerowi zapasowemu (sender = NULL)
+#define ROOM_CMD_OBSERVERS     15   // Odłożona aktualizacja plansz obserwatorów (sender = NULL)
+#define ROOM_CMD_BOARD_DELTA   16
+#define ROOM_CMD_COUNT         17
+
+// Stan przyrostowej synchronizacji planszy gracza (BOARD_DELTA)
+#define BOARD_SYNC_NONE        0    // Brak pełnej planszy - delta wymaga BOARD_RESYNC
+#define BOARD_SYNC_OK          1    // board_version to wersja planszy w pokoju
+#define BOARD_SYNC_REQUESTED   2    // Wysłano BOARD_RESYNC - delty czekają na pełną planszę
+
+typedef struct {
+    int type;
+    Client *sender;
+    int wakes_sender;              // Po wykonaniu wznowić aktora klienta (kolejna linia)
+    unsigned long long recv_ns;    // Odebranie linii, z której powstała komenda (0 = nieznane)
+    char text[];                   // Oryginalna linia (FIRE/HIT/MISS, czat, BOARD)
+} RoomCommand;
+
 typedef struct {
     int id;
+    int in_use;                    // Pokój zajęty (pusty pokój jest odzyskiwany)
+    struct Reactor *owner;         // Reaktor, w którego kole czasowym żyje zegar tury
+    RingMailbox mailbox;           // Komendy czekające na aktora pokoju
+    Task task;                     // Zadanie aktora pokoju w puli (wątek domowy = id pokoju)
+    int scheduled;                 // Aktor zaplanowany lub w trakcie pracy
+    unsigned long turn_gen;        // Generacja zegara tury (aktor); przeterminowane walkowery są ignorowane
+    unsigned long turn_request;    // Żądana generacja zegara dla reaktora (0 = anuluj)
+    unsigned long turn_timer_gen;  // Generacja uzbrojona w kole reaktora
+    MailboxNode timer_node;        // Węzeł skrzynki żądań zegara w reaktorze
+    int timer_queued;
+    int observer_request;          // Żądanie zegara aktualizacji obserwatorów dla reaktora
+    int observer_flush_pending;    // Aktualizacja obserwatorów czeka na zegar (aktor)
+    int observers_dirty;           // Plansze zmieniły się od ostatniej aktualizacji obserwatorów
+    unsigned long long observers_sent;  // Tick ostatniej aktualizacji obserwatorów
+    unsigned long seq;             // Numer ostatniego zastosowanego zdarzenia
+    int player_count;              // Liczba graczy publikowana dla /list
     char creator[50];
     Client *clients[2];
-    Client *observers[MAX_CLIENTS-2];
+    Client *observers[MAX_OBSERVERS];
     int observer_count;
     int playerReady[2];
     int gameStarted;
     int current_turn;
     char boardPlayer0[64];
     char boardPlayer1[64];
+    unsigned board_version[2];     // Wersja planszy z ostatniej delty (pełna plansza = 0)
+    int board_sync[2];             // BOARD_SYNC_*
+    Timer turn_timer;  // Zegar tury - walkower po TURN_TIMEOUT
+    Timer observer_timer;  // Kolejna aktualizacja obserwatorów (limit OBSERVER_UPDATE_MS)
+    unsigned long long fire_ns;    // Chwila zastosowania ostatniego FIRE (metryka FIRE -> NEXT_TURN)
+    unsigned long long trace_id;   // Ślad bieżącego strzału (0 = nieśledzony)
+    unsigned long long trace_turn_ns;  // Początek śledzonej tury (odebranie FIRE)
+    unsigned long long trace_fire_sent_ns;  // Koniec rozesłania FIRE
 } ChatRoom;
 
+// Reaktor: wątek z własną pętlą epoll, własnym gniazdem nasłuchującym (SO_REUSEPORT),
+// własnym zbiorem połączeń i własnym kołem czasowym. Pokoje są przypisane do reaktora
+// twórcy; klient dołączający do pokoju innego reaktora jest do niego przekazywany.
+typedef struct Reactor {
+    int id;
+    pthread_t thread;
+    int epoll_fd;
+    int listen_fd;
+    int wake_fd;           // eventfd budzący reaktor po wrzuceniu czegoś do skrzynki
+    Mailbox inbox;         // Klienci przekazani z innych reaktorów
+    Mailbox timer_requests;// Pokoje, których zegar tury trzeba uzbroić lub anulować
+    Mailbox cork_queue;    // Klienci z wyjściem wstrzymanym do końca ticku łączenia
+    unsigned long long cork_deadline;  // Koniec bieżącego ticku łączenia (ms, 0 = nie trwa)
+    TimerWheel wheel;      // Timery połączeń i pokoi tego reaktora
+    // Backend io_uring
+    Uring ring;            // Pierścień zgłoszeń i zakończeń reaktora
+    Mailbox send_queue;    // Klienci z danymi do wysłania
+    int sleeping;          // Reaktor czeka w io_uring_enter - piszący musi go obudzić
+    unsigned long long wake_count;  // Bufor odczytu eventfd przez pierścień
+} Reactor;
+
 // ==================== Zmienne Globalne i Mutexy ====================
 
-int server_fd;
-int udp_sock;
+int udp_sock = -1;
+static int cluster_sock = -1;  // --cluster: ogłoszenia pokoi między węzłami (reaktor 0)
+static int signal_fd = -1;     // SIGINT i SIGTERM (signalfd, reaktor 0)
 
 // Zmienne do obsługi połączeń TLV
 static int tlv_server_fd;
 static int tlv_port;
 pthread_t tlv_thread;
 
-static ChatRoom chat_rooms[MAX_CLIENTS];
-static int room_count = 0;
+static ChatRoom chat_rooms[MAX_ROOMS];
+static int room_count = 0;  // Najwyższy użyty indeks pokoju + 1
 
 static Client *clients[MAX_CLIENTS];
 static int client_count = 0;
 
+// Kolejność blokad: clients_mutex -> rooms_mutex -> Client.out_lock.
+// rooms_mutex chroni tylko tablicę pokoi (przydział, zwolnienie, /list) - stan gry
+// należy do aktora pokoju i jest zmieniany wyłącznie przez niego.
 pthread_mutex_t clients_mutex = PTHREAD_MUTEX_INITIALIZER;
 pthread_mutex_t rooms_mutex   = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t cluster_mutex = PTHREAD_MUTEX_INITIALIZER;  // Katalog klastra; brana bez innych blokad (-> out_lock)
+pthread_mutex_t conns_mutex   = PTHREAD_MUTEX_INITIALIZER;  // Lista pending_conns (po clients_mutex)
+
+static Client *pending_conns;        // Połączenia w trakcie handshake'u (nie ma ich jeszcze w clients)
+
+static Reactor reactors[MAX_REACTORS];
+static int reactor_count = 0;
+static int pin_reactors  = 0;        // --pin: przypięcie reaktora i do rdzenia i
+static __thread Reactor *current_reactor;  // Reaktor bieżącego wątku
+
+static ThreadPool pool;              // Wątki wykonujące komendy (aktory klientów i pokoi)
+static int worker_count = 0;
+static int io_backend = IO_EPOLL;    // --io: pętla reaktora na epoll albo io_uring
+static int coalesce_ms;              // --coalesce MS: tick łączenia komunikatów pokoju (0 = wysyłka od razu)
+static int coalesce_shots;           // --coalesce-shots: strzały i tury też czekają na koniec ticku
+static const char *metrics_path;     // --metrics: ścieżka gniazda Unix z metrykami
+static int server_port = SERVER_PORT;    // --port: port TCP (kilka serwerów na jednym hoście)
+static char server_id[SERVER_ID_LEN + 1];  // --id: identyfikator ogłaszany w discovery
+static int cluster_enabled;           // --cluster: węzeł klastra (katalog pokoi, REDIRECT)
+static const char *handoff_path;     // --handoff: gniazdo gorącego restartu (przejęcie i przekazanie)
+static int handoff_frozen;           // Gorący restart w toku - reaktory stoją
+static int inherited_listeners[MAX_REACTORS];  // Gniazda nasłuchujące przejęte od poprzednika
+static int inherited_listener_count;
+static int inherited_tlv_fd = -1;
+static char replicate_host[64];      // --replicate HOST:PORT: serwer zapasowy, do którego wysyłamy stan
+static int replicate_port;
+static int standby_client_port;      // Port, na którym serwer zapasowy przyjmie klientów (0 = brak)
+static int standby_mode;             // --standby: odbieramy stan głównego serwera, nie obsługujemy graczy
+static unsigned long long trace_slow_ns;  // --trace-slow MS: tura dłuższa niż próg zrzuca ślady
+static long trace_last_dump;         // Czas (s) ostatniego zrzutu po wolnej turze
+static __thread unsigned long long current_input_ns;  // recv_ns linii wykonywanej przez aktora klienta
+
+static int room_post(ChatRoom *room, int type, Client *sender, const char *text);
+static void room_request_turn_timer(ChatRoom *room, int arm);
+static void room_request_observer_flush(ChatRoom *room);
+static void reactor_wake(Reactor *r);
+static void client_continue(Client *client);
+static void uring_queue_send(Client *client);
+static void replica_capture(ChatRoom *room);
+static int standby_line(char *out, size_t size);
+static void handoff_park(void);
 
 // ==================== Obsługa Sygnałów ====================
-// Funkcja obsługująca sygnał SIGINT. Zamyka wszystkie gniazda i kończy działanie serwera.
-void handle_sigint(int sig) {
+// SIGINT i SIGTERM są zablokowane we wszystkich wątkach i przychodzą przez signalfd do pętli
+// reaktora 0. Zamykanie serwera działa więc w zwykłym wątku, a nie w obsłudze sygnału, która
+// mogłaby przerwać wątek trzymający blokadę stdout albo strumienia nagrania.
+static int signal_open(void) {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);  // kill (np. demona) też domyka pliki, w tym nagranie
+    pthread_sigmask(SIG_BLOCK, &set, NULL);  // Przed startem wątków - dziedziczą maskę
+    int fd = signalfd(-1, &set, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (fd < 0) {
+        perror("[SERVER] signalfd");
+        pthread_sigmask(SIG_UNBLOCK, &set, NULL);  // Sygnał zakończy proces bez sprzątania
+    }
+    return fd;
+}
+
+// Odebrany SIGINT/SIGTERM: zamyka wszystkie gniazda i kończy działanie serwera.
+static void signal_on_readable(void) {
+    struct signalfd_siginfo info;
+    if (read(signal_fd, &info, sizeof(info)) != (ssize_t)sizeof(info))
+        return;
     printf("Shutting down server...\n");
-    close(server_fd);      // Zamknięcie gniazda TCP
+    for (int i = 0; i < reactor_count; i++)
+        close(reactors[i].listen_fd);  // Zamknięcie gniazd TCP
     close(udp_sock);       // Zamknięcie gniazda UDP
+    if (cluster_sock >= 0)
+        close(cluster_sock);  // Ogłoszenia klastra
     close(tlv_server_fd);  // Zamknięcie gniazda TLV
-    exit(0);
+    if (metrics_path)
+        unlink(metrics_path);  // Gniazdo metryk
+    if (handoff_path)
+        unlink(handoff_path);  // Gniazdo gorącego restartu
+    lockprof_report_top(stdout);  // Najbardziej sporne blokady (tylko z LOCK_PROFILING)
+    exit(0);  // Wypycha też bufory stdio, w tym nagranie (--capture)
 }
 
 // ==================== Uruchamianie Demona ====================
@@ -143,224 +444,971 @@ void log_game_result(const char *winner, const char *loser) {
     fclose(log_file);
 }
 
+static void client_get(Client *client) {
+    __atomic_add_fetch(&client->refs, 1, __ATOMIC_RELAXED);
+}
+
+// Ustawia zdarzenia epoll połączenia (EPOLLOUT tylko, gdy zalegają dane do wysłania)
+static void client_update_events(Client *client) {
+    if (io_backend != IO_EPOLL)
+        return;
+    struct epoll_event ev;
+    ev.events = EPOLLIN | (client->want_write ? EPOLLOUT : 0);
+    ev.data.ptr = client;
+    epoll_ctl(client->reactor->epoll_fd, EPOLL_CTL_MOD, client->socket, &ev);
+}
+
+// Wysyła dane czekające w buforze wyjściowym. Przy epoll to, czego gniazdo nie przyjmie,
+// zostaje w buforze do EPOLLOUT; przy io_uring wysyłkę zleca reaktor.
+// Wywoływane z trzymanym out_lock.
+static void client_send_buffered_locked(Client *client) {
+    if (client->socket < 0 || client->out_len == 0)
+        return;
+    if (io_backend == IO_URING) {
+        if (!client->send_busy) {
+            client->send_busy = 1;
+            client_get(client);  // Referencja wysyłki
+            uring_queue_send(client);
+        }
+        return;
+    }
+    size_t off = 0;
+    while (off < client->out_len) {
+        ssize_t n = send(client->socket, client->outbuf + off, client->out_len - off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            break;  // EAGAIN - poczekamy na kolejne EPOLLOUT; błąd wyjdzie przy odczycie
+        }
+        off += n;
+    }
+    memmove(client->outbuf, client->outbuf + off, client->out_len - off);
+    client->out_len -= off;
+    int want = client->out_len > 0;
+    if (want != client->want_write) {
+        client->want_write = want;
+        client_update_events(client);
+    }
+}
+
+// Wysyła zaległe dane klienta. Wywoływane po EPOLLOUT.
+static void client_flush(Client *client) {
+    MUTEX_LOCK(&client->out_lock);
+    client_send_buffered_locked(client);
+    MUTEX_UNLOCK(&client->out_lock);
+}
+
+// Dopisuje dane na koniec bufora wyjściowego. Zwraca 0 albo -1 (przepełnienie - klient
+// zostaje rozłączony - albo brak pamięci). Wywoływane z trzymanym out_lock.
+static int client_buffer_locked(Client *client, const char *data, size_t len) {
+    if (client->out_len + len > MAX_OUTPUT_BUFFER) {
+        // Klient nie odbiera danych - nie pozwalamy na nieograniczoną kolejkę
+        printf("[SERVER] Output buffer overflow for %s, disconnecting.\n", client->username);
+        metric_inc(MET_OUTPUT_OVERFLOWS);
+        shutdown(client->socket, SHUT_RDWR);
+        return -1;
+    }
+    if (client->out_len + len > client->out_cap) {
+        size_t cap = client->out_cap ? client->out_cap : 4096;
+        while (cap < client->out_len + len)
+            cap *= 2;
+        char *grown = realloc(client->outbuf, cap);
+        if (!grown)
+            return -1;
+        client->outbuf = grown;
+        client->out_cap = cap;
+    }
+    memcpy(client->outbuf + client->out_len, data, len);
+    client->out_len += len;
+    return 0;
+}
+
+// Wysyła dane do klienta. Gniazda są nieblokujące: czego jądro nie przyjmie od razu,
+// trafia do bufora klienta i zostanie dosłane po EPOLLOUT (kolejność jest zachowana).
+// Przy io_uring dane zawsze trafiają do bufora, a wysyła je reaktor - jednym
+// io_uring_enter dla wszystkich klientów, do których pisano od ostatniego obiegu pętli.
+// Dane wstrzymane do końca ticku łączenia wychodzą razem z tymi, przed nimi.
+// Wywoływane z trzymanym out_lock.
+static void client_write_locked(Client *client, const char *data, size_t len) {
+    if (client->socket < 0 || len == 0)
+        return;
+    capture_record(CAPTURE_OUT, client->capture_conn, data, len);
+    metric_add(MET_BYTES_OUT, len);
+    if (client->corked) {
+        client->corked = 0;
+        if (client_buffer_locked(client, data, len) == 0)
+            client_send_buffered_locked(client);
+        return;
+    }
+    if (client->out_len == 0 && io_backend == IO_EPOLL) {
+        ssize_t n = send(client->socket, data, len, MSG_NOSIGNAL);
+        if (n == (ssize_t)len)
+            return;
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                return;  // Zerwane połączenie - sprzątnie je ścieżka odczytu
+            n = 0;
+        }
+        data += n;
+        len -= n;
+    }
+    if (client_buffer_locked(client, data, len) < 0)
+        return;
+    if (io_backend == IO_EPOLL || client->send_busy) {
+        // Dane czekają za niewysłanymi (przy io_uring: za wysyłką w locie)
+        metric_inc(MET_SEND_STALLS);
+        metric_observe(HIST_SEND_QUEUE_BYTES, client->out_len);
+    }
+    if (io_backend == IO_URING) {
+        if (!client->send_busy) {
+            client->send_busy = 1;
+            client_get(client);  // Referencja wysyłki
+            uring_queue_send(client);
+        }
+    } else if (!client->want_write) {
+        client->want_write = 1;
+        client_update_events(client);
+    }
+}
+
+// Bezpieczne z dowolnego wątku - komendy wykonywane w puli piszą do klientów wszystkich reaktorów
+static void client_write(Client *client, const char *data, size_t len) {
+    if (!client)
+        return;
+    MUTEX_LOCK(&client->out_lock);
+    client_write_locked(client, data, len);
+    MUTEX_UNLOCK(&client->out_lock);
+}
+
+// Wysyłka, która może poczekać do końca ticku łączenia (--coalesce): dane dołączają do
+// bufora wyjściowego, a reaktor klienta po coalesce_ms wysyła wszystko, co się zebrało,
+// jednym send. Pierwsza wstrzymana wiadomość w ticku budzi reaktor (kolejne już nie).
+// Bezpieczne z dowolnego wątku.
+static void client_write_coalesced(Client *client, const char *data, size_t len) {
+    if (!client)
+        return;
+    if (!coalesce_ms) {
+        client_write(client, data, len);
+        return;
+    }
+    MUTEX_LOCK(&client->out_lock);
+    if ((client->out_len > 0 && !client->corked) || client->send_busy) {
+        client_write_locked(client, data, len);  // Dane i tak czekają na gniazdo - dołączamy do nich
+    } else if (client->socket >= 0 && len > 0) {
+        capture_record(CAPTURE_OUT, client->capture_conn, data, len);
+        metric_add(MET_BYTES_OUT, len);
+        if (client_buffer_locked(client, data, len) == 0) {
+            client->corked = 1;
+            if (!client->cork_queued) {
+                client->cork_queued = 1;
+                client_get(client);  // Referencja kolejki ticku
+                Reactor *r = client->reactor;
+                if (mailbox_push(&r->cork_queue, &client->cork_node) && r != current_reactor)
+                    reactor_wake(r);
+            }
+        }
+    }
+    MUTEX_UNLOCK(&client->out_lock);
+}
+
+// Zrywa połączenie z dowolnego wątku; zamknięciem zajmie się reaktor po odczytaniu EOF
+static void client_shutdown(Client *client) {
+    MUTEX_LOCK(&client->out_lock);
+    if (client->socket >= 0)
+        shutdown(client->socket, SHUT_RDWR);
+    MUTEX_UNLOCK(&client->out_lock);
+}
+
+// Zwalnia referencję; ostatnia zwalnia klienta razem z nieprzetworzonymi liniami
+static void client_put(Client *client) {
+    if (__atomic_sub_fetch(&client->refs, 1, __ATOMIC_ACQ_REL) != 0)
+        return;
+    InputLine *line;
+    while ((line = ring_mailbox_pop(&client->lines)) != NULL)
+        free(line);
+    pthread_mutex_destroy(&client->out_lock);
+    free(client->outbuf);
+    free(client->sendbuf);
+    free(client);
+}
+
 // Wysyła wiadomość do klienta
-void send_to_client(int client_socket, const char *message) {
-    if (client_socket <= 0 || message == NULL)
+void send_to_client(Client *client, const char *message) {
+    if (client == NULL || message == NULL)
         return;
-    send(client_socket, message, strlen(message), 0);
+    client_write(client, message, strlen(message));
+}
+
+// Wyjmuje z bufora klienta kolejną kompletną linię (bez "\r\n") albo ramkę binarną.
+// Kilka komend w jednym segmencie (np. HELLO i /create) nie zlewa się w jedną wiadomość.
+// Zbyt długa linia jest zwracana w kawałkach. Zwraca długość wiadomości (ramka może
+// zawierać bajty zerowe) albo -1, gdy brak jeszcze całej linii lub ramki.
+static int client_next_line(Client *client, char *line, int size) {
+    int avail = client->in_end - client->in_start;
+    char *start = client->inbuf + client->in_start;
+    while (client->binary && avail > 0 && proto_is_frame((unsigned char)start[0])) {
+        int flen = proto_frame_length((unsigned char *)start, avail);
+        if (flen == 0 || flen > avail)
+            return -1;
+        if (flen < 0 || flen > size) {
+            // Uszkodzona ramka - pomijamy kod operacji i szukamy dalej
+            client->in_start++;
+            start++;
+            avail--;
+            continue;
+        }
+        memcpy(line, start, flen);
+        client->in_start += flen;
+        return flen;
+    }
+    char *nl = memchr(start, '\n', avail);
+    int len = nl ? (int)(nl - start) : avail;
+    if (!nl && len < size - 1)
+        return -1;
+    int consumed = len;
+    if (len > size - 1)
+        len = consumed = size - 1;
+    else if (nl)
+        consumed++;
+    memcpy(line, start, len);
+    line[len] = '\0';
+    client->in_start += consumed;
+    if (len > 0 && line[len - 1] == '\r')
+        line[--len] = '\0';
+    return len;
+}
+
+// Wysyłka do uczestnika pokoju: pilna od razu, pozostałe mogą poczekać na koniec ticku łączenia
+static void room_send(Client *client, const char *data, size_t len, int urgent) {
+    if (urgent)
+        client_write(client, data, len);
+    else
+        client_write_coalesced(client, data, len);
 }
 
-// Rozsyła wiadomość do wszystkich uczestników pokoju, z opcjonalnym wykluczeniem jednego gniazda
-void broadcast_to_room(ChatRoom *room, const char *message, int exclude_socket) {
+// Czy strzały i tury omijają tick łączenia (domyślnie tak - liczy się opóźnienie tury)
+static int shot_urgent(void) {
+    return !coalesce_shots;
+}
+
+// Rozsyła wiadomość do wszystkich uczestników pokoju, z opcjonalnym wykluczeniem jednego klienta
+static void broadcast_text(ChatRoom *room, const char *message, Client *exclude, int urgent) {
     if (!room)
         return;
+    size_t len = strlen(message);
     for (int i = 0; i < 2; i++) {
-        if (room->clients[i] && room->clients[i]->active) {
-            if (room->clients[i]->socket != exclude_socket) {
-                send_to_client(room->clients[i]->socket, message);
+        if (room->clients[i] && __atomic_load_n(&room->clients[i]->active, __ATOMIC_RELAXED)) {
+            if (room->clients[i] != exclude) {
+                room_send(room->clients[i], message, len, urgent);
             }
         }
     }
     for (int i = 0; i < room->observer_count; i++) {
-        if (room->observers[i] && room->observers[i]->active) {
-            if (room->observers[i]->socket != exclude_socket) {
-                send_to_client(room->observers[i]->socket, message);
+        if (room->observers[i] && __atomic_load_n(&room->observers[i]->active, __ATOMIC_RELAXED)) {
+            if (room->observers[i] != exclude) {
+                room_send(room->observers[i], message, len, urgent);
             }
         }
     }
 }
 
+// Komunikaty pokoju (dołączenia, gotowość, start i koniec gry) mogą poczekać na koniec ticku
+void broadcast_to_room(ChatRoom *room, const char *message, Client *exclude) {
+    broadcast_text(room, message, exclude, 0);
+}
+
+// Rozsyła komunikat gry: klienci z możliwością "bin" dostają ramkę, pozostali linię tekstu
+static void broadcast_frame(ChatRoom *room, const unsigned char *frame, int flen, const char *text, int urgent) {
+    Client *members[2 + MAX_OBSERVERS];
+    int n = 0;
+    for (int i = 0; i < 2; i++)
+        members[n++] = room->clients[i];
+    for (int i = 0; i < room->observer_count; i++)
+        members[n++] = room->observers[i];
+    for (int i = 0; i < n; i++) {
+        Client *c = members[i];
+        if (!c || !__atomic_load_n(&c->active, __ATOMIC_RELAXED))
+            continue;
+        if (c->binary)
+            room_send(c, (const char *)frame, flen, urgent);
+        else
+            room_send(c, text, strlen(text), urgent);
+    }
+}
+
+// Ogłasza, czyja jest tura (room->current_turn); 'text' to wersja dla klientów tekstowych
+static void broadcast_next_turn(ChatRoom *room, const char *text) {
+    unsigned char frame[PROTO_TURN_SIZE];
+    proto_next_turn(frame, room->current_turn);
+    broadcast_frame(room, frame, sizeof(frame), text, shot_urgent());
+}
+
 // Zwraca wskaźnik do pokoju o podanym ID
 ChatRoom* get_room_by_id(int room_id) {
-    if (room_id < 0 || room_id >= room_count)
+    if (room_id < 0 || room_id >= MAX_ROOMS ||
+        !__atomic_load_n(&chat_rooms[room_id].in_use, __ATOMIC_ACQUIRE))
         return NULL;
     return &chat_rooms[room_id];
 }
 
+// Publikuje liczbę graczy dla /list wykonywanego w innych reaktorach
+static void room_publish(ChatRoom *room) {
+    int players = (room->clients[0] != NULL) + (room->clients[1] != NULL);
+    __atomic_store_n(&room->player_count, players, __ATOMIC_RELAXED);
+}
+
 // Informuje obserwatora o stanie gry
-void notify_observer_about_game_state(ChatRoom *room, int observer_socket) {
+void notify_observer_about_game_state(ChatRoom *room, Client *observer) {
     if (!room->gameStarted)
-        send_to_client(observer_socket, "GAME_NOT_STARTED\n");
+        send_to_client(observer, "GAME_NOT_STARTED\n");
     else
-        send_to_client(observer_socket, "GAME_STARTED\n");
+        send_to_client(observer, "GAME_STARTED\n");
+}
+
+// ==================== Zegary ====================
+
+// Bieżący czas monotoniczny w tickach koła czasowego
+static unsigned long long now_ticks(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((unsigned long long)ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000) / TIMER_TICK_MS;
+}
+
+#define SECONDS_TO_TICKS(s) ((unsigned long long)(s) * 1000ULL / TIMER_TICK_MS)
+
+// Uzbraja timer w kole bieżącego reaktora. Timery żyją zawsze w reaktorze, który je
+// obsługuje, więc koło nie wymaga blokad; wątki puli proszą o zegar tury przez skrzynkę.
+static void schedule_timer(Timer *t, int seconds, TimerCallback cb, void *arg) {
+    timer_wheel_arm(&current_reactor->wheel, t, SECONDS_TO_TICKS(seconds), cb, arg);
+}
+
+// Anuluje timer w kole bieżącego reaktora
+static void cancel_timer(Timer *t) {
+    timer_wheel_cancel(&current_reactor->wheel, t);
+}
+
+// Zwalnia pokój, z którego wyszli wszyscy uczestnicy, aby /create mógł go użyć ponownie.
+// Wywoływane przez aktora pokoju.
+static void maybe_reclaim_room(ChatRoom *room) {
+    if (!room || room->clients[0] || room->clients[1] || room->observer_count > 0)
+        return;
+    room_request_turn_timer(room, 0);
+    __atomic_store_n(&room->gameStarted, 0, __ATOMIC_RELAXED);
+    MUTEX_LOCK(&rooms_mutex);
+    if (__atomic_load_n(&room->in_use, __ATOMIC_RELAXED))
+        metric_inc(MET_ROOMS_RECLAIMED);
+    __atomic_store_n(&room->in_use, 0, __ATOMIC_RELEASE);
+    MUTEX_UNLOCK(&rooms_mutex);
+}
+
+// Kończy grę: ogłasza zwycięzcę, loguje wynik i odsyła wszystkich do lobby.
+// Wywoływane przez aktora pokoju; zegar tury musi być już anulowany.
+static void end_game(ChatRoom *room, const char *winner, const char *loser) {
+    snprintf(msg, sizeof(msg), "YOU_WIN %s\n", winner);
+    broadcast_to_room(room, msg, NULL);
+    log_game_result(winner, loser);
+    metric_inc(MET_GAMES_FINISHED);
+    __atomic_store_n(&room->gameStarted, 0, __ATOMIC_RELAXED);
+    room->playerReady[0] = 0;
+    room->playerReady[1] = 0;
+    for (int p = 0; p < 2; p++) {
+        Client *c = room->clients[p];
+        if (c) {
+            send_to_client(c, "Returning to lobby.\n");
+            send_to_client(c, WELCOME_IN_LOBBY);
+            __atomic_store_n(&c->seated, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&c->room_id, -1, __ATOMIC_SEQ_CST);
+            room->clients[p] = NULL;
+            client_put(c);  // Referencja członkostwa
+        }
+    }
+    for (int i = 0; i < room->observer_count; i++) {
+        Client *c = room->observers[i];
+        if (c) {
+            send_to_client(c, "Returning to lobby.\n");
+            send_to_client(c, WELCOME_IN_LOBBY);
+            __atomic_store_n(&c->room_id, -1, __ATOMIC_SEQ_CST);
+            room->observers[i] = NULL;
+            client_put(c);
+        }
+    }
+    room->observer_count = 0;
+    maybe_reclaim_room(room);
+}
+
+// Upłynął czas tury - walkower rozstrzyga aktor pokoju (o ile zegar nie został w międzyczasie przezbrojony)
+static void turn_timeout_cb(Timer *t, void *arg) {
+    (void)t;
+    ChatRoom *room = (ChatRoom *)arg;
+    char gen[32];
+    snprintf(gen, sizeof(gen), "%lu", room->turn_timer_gen);
+    room_post(room, ROOM_CMD_TURN_TIMEOUT, NULL, gen);
+}
+
+// Wstawia pokój do skrzynki żądań zegarów jego reaktora (najwyżej raz naraz)
+static void room_queue_timer_request(ChatRoom *room) {
+    int expected = 0;
+    if (__atomic_compare_exchange_n(&room->timer_queued, &expected, 1, 0,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        if (mailbox_push(&room->owner->timer_requests, &room->timer_node))
+            reactor_wake(room->owner);
+    }
+}
+
+// Prosi reaktor-właściciela zegara tury o jego uzbrojenie (arm=1) lub anulowanie (arm=0).
+// Wywoływane przez aktora pokoju; każde żądanie unieważnia wcześniejszy zegar.
+static void room_request_turn_timer(ChatRoom *room, int arm) {
+    room->turn_gen++;
+    __atomic_store_n(&room->turn_request, arm ? room->turn_gen : 0, __ATOMIC_SEQ_CST);
+    room_queue_timer_request(room);
+}
+
+// Kolejna aktualizacja obserwatorów nadejdzie jako ROOM_CMD_OBSERVERS za OBSERVER_UPDATE_MS.
+// Wywoływane przez aktora pokoju.
+static void room_request_observer_flush(ChatRoom *room) {
+    room->observer_flush_pending = 1;
+    __atomic_store_n(&room->observer_request, 1, __ATOMIC_SEQ_CST);
+    room_queue_timer_request(room);
+}
+
+static void observer_timer_cb(Timer *t, void *arg) {
+    ChatRoom *room = (ChatRoom *)arg;
+    if (!room_post(room, ROOM_CMD_OBSERVERS, NULL, NULL))
+        timer_wheel_arm(&current_reactor->wheel, t, OBSERVER_UPDATE_TICKS, observer_timer_cb, room);
+}
+
+// (Prze)uzbraja zegar tury po każdym NEXT_TURN. Wywoływane przez aktora pokoju.
+static void arm_turn_timer(ChatRoom *room) {
+    room_request_turn_timer(room, 1);
+}
+
+// Brak komend przez IDLE_TIMEOUT poza rozgrywką => rozłączamy klienta i zwalniamy miejsce.
+// Komendy wykonują wątki puli, więc zamiast przezbrajać timer zapisują tylko last_command.
+static void idle_timeout_cb(Timer *t, void *arg) {
+    Client *client = (Client *)arg;
+    unsigned long long idle = current_reactor->wheel.now -
+                              __atomic_load_n(&client->last_command, __ATOMIC_RELAXED);
+    if (idle < SECONDS_TO_TICKS(IDLE_TIMEOUT)) {
+        timer_wheel_arm(&current_reactor->wheel, t, SECONDS_TO_TICKS(IDLE_TIMEOUT) - idle,
+                        idle_timeout_cb, client);
+        return;
+    }
+    ChatRoom *room = get_room_by_id(__atomic_load_n(&client->room_id, __ATOMIC_RELAXED));
+    if (room && __atomic_load_n(&room->gameStarted, __ATOMIC_RELAXED)) {
+        // W trakcie gry bezczynnością zajmuje się zegar tury
+        schedule_timer(t, IDLE_TIMEOUT, idle_timeout_cb, client);
+        return;
+    }
+    printf("[TIMER] Client %s idle, disconnecting.\n", client->username);
+    client->no_resume = 1;
+    send_to_client(client, "You were disconnected due to inactivity.\n");
+    client_shutdown(client);  // Reaktor odczyta EOF i posprząta
+}
+
+// Heartbeat aplikacyjny: wysyła PING, a gdy klient milczy zbyt długo - zrywa połączenie
+static void heartbeat_cb(Timer *t, void *arg) {
+    Client *client = (Client *)arg;
+    if (current_reactor->wheel.now - client->last_seen >= SECONDS_TO_TICKS(HEARTBEAT_TIMEOUT)) {
+        printf("[TIMER] Client %s missed heartbeats, reaping connection.\n", client->username);
+        client_shutdown(client);
+        return;
+    }
+    send_to_client(client, "PING\n");
+    schedule_timer(t, HEARTBEAT_INTERVAL, heartbeat_cb, client);
+}
+
+// Klient nie podał nazwy w terminie - zamykamy połączenie
+static void handshake_timeout_cb(Timer *t, void *arg) {
+    (void)t;
+    Client *client = (Client *)arg;
+    metric_inc(MET_HANDSHAKE_TIMEOUT);
+    send_to_client(client, "You were disconnected due to inactivity.\n");
+    client_shutdown(client);
+}
+
+// Usuwa klienta z listy klientów (nazwa staje się wolna). Wywoływane z trzymanym clients_mutex.
+static void unlist_client(Client *client) {
+    for (int i = 0; i < client_count; i++) {
+        if (clients[i] == client) {
+            for (int j = i; j < client_count - 1; j++) {
+                clients[j] = clients[j+1];
+            }
+            clients[client_count - 1] = NULL;
+            client_count--;
+            break;
+        }
+    }
+}
+
+// Zwalnia miejsce klienta w pokoju (gracza lub obserwatora). Wywoływane przez aktora pokoju.
+static void room_remove_member(ChatRoom *r, Client *client) {
+    int member = 0;
+    if (r->clients[0] == client) {
+        r->clients[0] = NULL;
+        member = 1;
+    }
+    else if (r->clients[1] == client) {
+        r->clients[1] = NULL;
+        member = 1;
+    }
+    else {
+        for (int i = 0; i < r->observer_count; i++) {
+            if (r->observers[i] == client) {
+                for (int j = i; j < r->observer_count - 1; j++) {
+                    r->observers[j] = r->observers[j+1];
+                }
+                r->observer_count--;
+                member = 1;
+                break;
+            }
+        }
+    }
+    __atomic_store_n(&client->seated, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&client->room_id, -1, __ATOMIC_SEQ_CST);
+    room_publish(r);
+    if (member)
+        client_put(client);  // Referencja członkostwa
+}
+
+// Koniec okresu wznowienia - sesję zamyka aktor pokoju (od tej chwili nie da się jej wznowić)
+static void grace_timeout_cb(Timer *t, void *arg) {
+    (void)t;
+    Client *client = (Client *)arg;
+    MUTEX_LOCK(&clients_mutex);
+    client->held = 0;
+    MUTEX_UNLOCK(&clients_mutex);
+    ChatRoom *room = get_room_by_id(__atomic_load_n(&client->room_id, __ATOMIC_SEQ_CST));
+    if (!room || !room_post(room, ROOM_CMD_ABANDON, client, NULL)) {
+        // Gra skończyła się w trakcie oczekiwania - miejsca już nie ma
+        MUTEX_LOCK(&clients_mutex);
+        unlist_client(client);
+        MUTEX_UNLOCK(&clients_mutex);
+        client_put(client);  // Referencja sesji
+    }
 }
 
 // Rozpoczyna grę w danym pokoju - ustawia flagi i wysyła komunikaty do graczy
 void start_game(ChatRoom *room) {
-    room->gameStarted = 1;
-    broadcast_to_room(room, "GAME_START\n", -1);
+    __atomic_store_n(&room->gameStarted, 1, __ATOMIC_RELAXED);
+    broadcast_to_room(room, "GAME_START\n", NULL);
     room->current_turn = 0;
     if (room->clients[0]) {
         char buf[BUFFER_SIZE];
         snprintf(buf, sizeof(buf), "NEXT_TURN %s\n", room->clients[0]->username);
-        broadcast_to_room(room, buf, -1);
+        broadcast_next_turn(room, buf);
     }
+    arm_turn_timer(room);
 }
 
-// ==================== Wątek UDP Discovery ====================
-// Wątek obsługujący wykrywanie serwera przez UDP multicast
-void* udp_discovery_thread(void* arg) {
-    char *interface_name = (char *)arg;
-    struct sockaddr_in servaddr, cliaddr;
-    socklen_t len;
-    char buffer[BUFFER_SIZE];
+// ==================== UDP Discovery ====================
+// Odpowiedzi na DISCOVERY_REQUEST (multicast) obsługuje pętla reaktora 0, bez osobnego
+// wątku. Datagramy są odbierane i odsyłane paczkami (recvmmsg/sendmmsg), odpowiedź jest
+// przygotowana raz przy starcie, a każdy adres źródłowy ma limit odpowiedzi (wiadro
+// żetonów), więc burza zapytań po restarcie sieci kosztuje kilka wywołań systemowych
+// na paczkę i nie zagłusza obsługi połączeń.
 
-    if ((udp_sock = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
-        perror("socket UDP");
-        pthread_exit(NULL);
+typedef struct {
+    in_addr_t addr;                // Adres IPv4 źródła, 0 = wolny slot
+    unsigned tokens;               // Żetony w tysięcznych częściach
+    unsigned long long last_ms;    // Ostatnie uzupełnienie wiadra
+} DiscoveryLimit;
+
+static char discovery_response[160];  // "SERVER_IP=<adres>:<port> ID=... CLIENTS=... ROOMS=... CAPACITY=..."
+static int discovery_response_len;
+static unsigned long long discovery_response_ms;  // Kiedy odpowiedź zbudowano (0 = nigdy)
+static const char *discovery_ip;
+static DiscoveryLimit discovery_limits[DISCOVERY_LIMIT_SLOTS];
+
+static unsigned long long discovery_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+// Czy odpowiedzieć adresowi 'from' (wiadro żetonów: DISCOVERY_RATE/s, zapas DISCOVERY_BURST).
+// Kluczem jest sam adres - zmiana portu źródłowego nie daje nowego wiadra.
+// Kolizja w tablicy oddaje slot nowemu adresowi - limit jest przybliżony, ale ma stały koszt.
+static int discovery_allow(const struct sockaddr_in *from, unsigned long long now_ms) {
+    in_addr_t addr = from->sin_addr.s_addr;
+    DiscoveryLimit *l = &discovery_limits[(addr * 0x9E3779B97F4A7C15ULL) >> 54 & (DISCOVERY_LIMIT_SLOTS - 1)];
+    if (l->addr != addr) {
+        l->addr = addr;
+        l->tokens = DISCOVERY_BURST * 1000;
+        l->last_ms = now_ms;
     }
+    unsigned long long refill = (now_ms - l->last_ms) * DISCOVERY_RATE;
+    l->tokens = l->tokens + refill > DISCOVERY_BURST * 1000 ? DISCOVERY_BURST * 1000
+                                                            : l->tokens + (unsigned)refill;
+    l->last_ms = now_ms;
+    if (l->tokens < 1000)
+        return 0;
+    l->tokens -= 1000;
+    return 1;
+}
 
-    struct ip_mreq mreq;
+// Buduje odpowiedź z bieżącym obciążeniem. Stare klienty czytają tylko "SERVER_IP=adres:port"
+// (atoi kończy na spacji), nowe wybierają serwer według obciążenia i RTT.
+static void discovery_build_response(unsigned long long now_ms) {
+    int rooms_active = 0;
+    for (int i = 0; i < MAX_ROOMS; i++)
+        if (__atomic_load_n(&chat_rooms[i].in_use, __ATOMIC_RELAXED))
+            rooms_active++;
+    discovery_response_len = snprintf(discovery_response, sizeof(discovery_response),
+                                      "SERVER_IP=%s:%d ID=%s CLIENTS=%d ROOMS=%d CAPACITY=%d",
+                                      discovery_ip, server_port, server_id,
+                                      __atomic_load_n(&client_count, __ATOMIC_RELAXED),
+                                      rooms_active, MAX_CLIENTS);
+    discovery_response_ms = now_ms;
+}
+
+// Tworzy gniazdo discovery (dołącza do grupy multicast na interfejsie 'interface_ip').
+// Zwraca gniazdo nieblokujące albo -1.
+static int discovery_open(const char *interface_ip) {
     struct in_addr local_interface;
-    if (inet_aton(interface_name, &local_interface) == 0) {
-        perror("Invalid interface IP");
-        close(udp_sock);
-        pthread_exit(NULL);
+    if (inet_aton(interface_ip, &local_interface) == 0) {
+        fprintf(stderr, "Invalid interface IP: %s\n", interface_ip);
+        return -1;
+    }
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket UDP");
+        return -1;
     }
+    // Kilka serwerów na jednym hoście dzieli port discovery - każdy dostaje kopię zapytania multicast
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct ip_mreq mreq;
     mreq.imr_multiaddr.s_addr = inet_addr(MULTICAST_ADDR);
     mreq.imr_interface = local_interface;
-
-    if (setsockopt(udp_sock, IPPROTO_IP, IP_ADD_MEMBERSHIP,
-                   (char *)&mreq, sizeof(mreq)) < 0) {
+    if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, (char *)&mreq, sizeof(mreq)) < 0) {
         perror("setsockopt IP_ADD_MEMBERSHIP");
-        close(udp_sock);
-        pthread_exit(NULL);
+        close(fd);
+        return -1;
     }
-
+    struct sockaddr_in servaddr;
     memset(&servaddr, 0, sizeof(servaddr));
     servaddr.sin_family      = AF_INET;
     servaddr.sin_addr.s_addr = INADDR_ANY;
     servaddr.sin_port        = htons(DISCOVERY_PORT);
-
-    if (bind(udp_sock, (struct sockaddr*)&servaddr, sizeof(servaddr)) < 0) {
+    if (bind(fd, (struct sockaddr*)&servaddr, sizeof(servaddr)) < 0) {
         perror("bind UDP");
-        close(udp_sock);
-        pthread_exit(NULL);
+        close(fd);
+        return -1;
     }
-
     int ttl = 5;
-    setsockopt(udp_sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+
+    discovery_ip = interface_ip;
+    printf("UDP discovery: listening on port %d, joined group %s\n", DISCOVERY_PORT, MULTICAST_ADDR);
+    return fd;
+}
 
-    printf("UDP discovery thread: listening on port %d, joined group %s\n", DISCOVERY_PORT, MULTICAST_ADDR);
-    const char *server_ip_for_discovery = interface_name;
+// Odbiera wszystkie czekające zapytania i odpowiada na nie paczkami. Wywoływane przez reaktor 0.
+static void discovery_on_readable(void) {
+    struct mmsghdr in[DISCOVERY_BATCH], out[DISCOVERY_BATCH];
+    struct iovec in_iov[DISCOVERY_BATCH], out_iov;
+    struct sockaddr_in from[DISCOVERY_BATCH];
+    char bufs[DISCOVERY_BATCH][DISCOVERY_REQUEST_MAX];
 
+    out_iov.iov_base = discovery_response;
     while (1) {
-        len = sizeof(cliaddr);
-        int n = recvfrom(udp_sock, buffer, BUFFER_SIZE, 0, (struct sockaddr*)&cliaddr, &len);
-        if (n < 0) {
-            perror("recvfrom UDP");
+        for (int i = 0; i < DISCOVERY_BATCH; i++) {
+            in_iov[i].iov_base = bufs[i];
+            in_iov[i].iov_len = sizeof(bufs[i]);
+            memset(&in[i].msg_hdr, 0, sizeof(in[i].msg_hdr));
+            in[i].msg_hdr.msg_name = &from[i];
+            in[i].msg_hdr.msg_namelen = sizeof(from[i]);
+            in[i].msg_hdr.msg_iov = &in_iov[i];
+            in[i].msg_hdr.msg_iovlen = 1;
+        }
+        int n = recvmmsg(udp_sock, in, DISCOVERY_BATCH, MSG_DONTWAIT, NULL);
+        if (n <= 0) {
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                perror("recvmmsg UDP");
+            return;
+        }
+        if (__atomic_load_n(&standby_mode, __ATOMIC_RELAXED)) {
+            if (n < DISCOVERY_BATCH)
+                return;  // Serwer zapasowy nie zgłasza się nowym klientom
             continue;
         }
-        buffer[n] = '\0';
-        if (strstr(buffer, "DISCOVERY_REQUEST")) {
-            char response[BUFFER_SIZE];
-            snprintf(response, sizeof(response),
-                     "SERVER_IP=%s:%d", server_ip_for_discovery, SERVER_PORT);
-            sendto(udp_sock, response, strlen(response), 0, (struct sockaddr*)&cliaddr, len);
+        unsigned long long now_ms = discovery_now_ms();
+        if (now_ms - discovery_response_ms >= DISCOVERY_LOAD_REFRESH_MS || !discovery_response_ms)
+            discovery_build_response(now_ms);
+        out_iov.iov_len = discovery_response_len;
+        int replies = 0;
+        for (int i = 0; i < n; i++) {
+            if (in[i].msg_len < sizeof(DISCOVERY_REQUEST) - 1 ||
+                memcmp(bufs[i], DISCOVERY_REQUEST, sizeof(DISCOVERY_REQUEST) - 1) != 0)
+                continue;
+            if (!discovery_allow(&from[i], now_ms)) {
+                metric_inc(MET_DISCOVERY_LIMITED);
+                continue;
+            }
+            memset(&out[replies].msg_hdr, 0, sizeof(out[replies].msg_hdr));
+            out[replies].msg_hdr.msg_name = &from[i];
+            out[replies].msg_hdr.msg_namelen = in[i].msg_hdr.msg_namelen;
+            out[replies].msg_hdr.msg_iov = &out_iov;
+            out[replies].msg_hdr.msg_iovlen = 1;
+            replies++;
+        }
+        for (int sent = 0; sent < replies; ) {
+            int k = sendmmsg(udp_sock, out + sent, replies - sent, MSG_DONTWAIT);
+            if (k <= 0)
+                break;  // Pełny bufor gniazda - klient ponowi zapytanie
+            sent += k;
+            metric_add(MET_DISCOVERY_REPLIES, k);
         }
+        if (n < DISCOVERY_BATCH)
+            return;
     }
-
-    close(udp_sock);
-    pthread_exit(NULL);
 }
 
-// ==================== Obsługa Użytkowników ====================
+// ==================== Klaster ====================
+// Z --cluster serwer jest węzłem klastra: co CLUSTER_GOSSIP_INTERVAL s ogłasza swoje pokoje
+// na grupie CLUSTER_ADDR i z ogłoszeń innych węzłów buduje katalog (klaster.h). /list pokazuje
+// wtedy także cudze pokoje jako <id>@<węzeł>, a /join do cudzego pokoju odsyła klienta
+// komunikatem REDIRECT do węzła, który ten pokój ma. Gniazdo i timer ogłoszeń obsługuje
+// reaktor 0 (jak discovery).
 
-// Sprawdza, czy dany username jest już zajęty przez kogoś aktywnego
-int is_username_taken(const char *uname) {
-    for (int i = 0; i < client_count; i++) {
-        if (clients[i] && clients[i]->active) {
-            if (strcmp(clients[i]->username, uname) == 0)
-                return 1;
-        }
+static ClusterDirectory cluster_dir;   // Chroniony przez cluster_mutex
+static Timer cluster_timer;
+static const char *cluster_ip;
+
+// Tworzy gniazdo ogłoszeń klastra na interfejsie 'interface_ip'. Zwraca gniazdo nieblokujące albo -1.
+static int cluster_open(const char *interface_ip) {
+    struct in_addr local_interface;
+    if (inet_aton(interface_ip, &local_interface) == 0)
+        return -1;
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket cluster");
+        return -1;
     }
-    return 0;
+    int reuse = 1;  // Kilka węzłów na jednym hoście
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct ip_mreq mreq;
+    mreq.imr_multiaddr.s_addr = inet_addr(CLUSTER_ADDR);
+    mreq.imr_interface = local_interface;
+    if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, (char *)&mreq, sizeof(mreq)) < 0) {
+        perror("setsockopt cluster IP_ADD_MEMBERSHIP");
+        close(fd);
+        return -1;
+    }
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &local_interface, sizeof(local_interface));
+    int ttl = 5;
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port        = htons(CLUSTER_PORT);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("bind cluster");
+        close(fd);
+        return -1;
+    }
+    cluster_ip = interface_ip;
+    printf("Cluster: node %s gossiping on %s:%d\n", server_id, CLUSTER_ADDR, CLUSTER_PORT);
+    return fd;
 }
 
-// Negocjuje z nowym klientem jego nazwę użytkownika i w pętli pyta, dopóki nazwa nie będzie wolna.
-int negotiate_username(Client *client) {
-    printf("[SERVER] Sending: Enter your username:\n");
-    send_to_client(client->socket, "Enter your username:\n");
+static void cluster_send(const char *datagram, int len) {
+    struct sockaddr_in group;
+    memset(&group, 0, sizeof(group));
+    group.sin_family      = AF_INET;
+    group.sin_addr.s_addr = inet_addr(CLUSTER_ADDR);
+    group.sin_port        = htons(CLUSTER_PORT);
+    if (sendto(cluster_sock, datagram, len, MSG_DONTWAIT, (struct sockaddr *)&group, sizeof(group)) < 0 &&
+        errno != EAGAIN && errno != EWOULDBLOCK)
+        perror("sendto cluster");
+}
+
+// Timer reaktora 0: ogłasza pokoje węzła i uzbraja się ponownie
+static void cluster_announce(Timer *t, void *arg) {
+    (void)arg;
+    static ClusterRoom rooms[MAX_ROOMS];
+    int count = 0;
+    MUTEX_LOCK(&rooms_mutex);
+    for (int i = 0; i < room_count; i++) {
+        ChatRoom *r = &chat_rooms[i];
+        if (!r->in_use || __atomic_load_n(&standby_mode, __ATOMIC_RELAXED))
+            continue;  // Pokoje serwera zapasowego są kopiami - do /join prowadzi serwer główny
+        rooms[count].id = r->id;
+        rooms[count].players = __atomic_load_n(&r->player_count, __ATOMIC_RELAXED);
+        snprintf(rooms[count].creator, sizeof(rooms[count].creator), "%s", r->creator);
+        count++;
+    }
+    MUTEX_UNLOCK(&rooms_mutex);
 
-    struct timeval tv;
-    tv.tv_sec = USERNAME_HANDSHAKE_TIMEOUT;
-    tv.tv_usec = 0;
-    setsockopt(client->socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof(tv));
+    char datagram[CLUSTER_DATAGRAM];
+    unsigned long long gen = cluster_generation();
+    int clients = __atomic_load_n(&client_count, __ATOMIC_RELAXED);
+    int header = cluster_announce_header(datagram, sizeof(datagram), server_id, cluster_ip,
+                                         server_port, gen, clients, MAX_CLIENTS);
+    int len = header;
+    for (int i = 0; i < count; i++) {
+        int next = cluster_announce_room(datagram, len, sizeof(datagram), rooms[i].id,
+                                         rooms[i].players, rooms[i].creator);
+        if (next < 0) {
+            cluster_send(datagram, len);  // Datagram pełny - reszta pokoi w kolejnym tej samej generacji
+            len = header;
+            next = cluster_announce_room(datagram, len, sizeof(datagram), rooms[i].id,
+                                         rooms[i].players, rooms[i].creator);
+        }
+        len = next;
+    }
+    cluster_send(datagram, len);
+    schedule_timer(t, CLUSTER_GOSSIP_INTERVAL, cluster_announce, NULL);
+}
 
+// Odbiera ogłoszenia innych węzłów. Wywoływane przez reaktor 0.
+static void cluster_on_readable(void) {
+    char datagram[CLUSTER_DATAGRAM + 1];
     while (1) {
-        char buf[50];
-        int n = recv(client->socket, buf, sizeof(buf) - 1, 0);
-        if (n <= 0) {
-            if(n == 0)
-                printf("[SERVER] Client disconnected during handshake.\n");
-            else
-                perror("[SERVER] Timeout or error while waiting for username");
-            send_to_client(client->socket, "You were disconnected due to inactivity.\n");
-            close(client->socket);
-            return -1;
+        ssize_t n = recv(cluster_sock, datagram, CLUSTER_DATAGRAM, MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                perror("recv cluster");
+            return;
         }
-        buf[n] = '\0';
-        char *p = strchr(buf, '\n');
-        if (p)
-            *p = '\0';
-        p = strchr(buf, '\r');
-        if (p)
-            *p = '\0';
-        if (strlen(buf) == 0) {
-            send_to_client(client->socket, "Username cannot be empty, try again.\nEnter your username:\n");
+        MUTEX_LOCK(&cluster_mutex);
+        cluster_apply(&cluster_dir, server_id, datagram, (int)n, cluster_now_ms());
+        MUTEX_UNLOCK(&cluster_mutex);
+    }
+}
+
+// Dopisuje do /list pokoje pozostałych węzłów. Zwraca ich liczbę.
+static int cluster_list_rooms(Client *client) {
+    int listed = 0;
+    MUTEX_LOCK(&cluster_mutex);
+    cluster_expire(&cluster_dir, cluster_now_ms());
+    for (int i = 0; i < CLUSTER_MAX_NODES; i++) {
+        ClusterNode *n = &cluster_dir.nodes[i];
+        if (!n->id[0])
             continue;
+        for (int j = 0; j < n->room_count; j++) {
+            snprintf(msg, sizeof(msg), "ID:%d@%s by:%s players:%d/2 node:%s:%d\n", n->rooms[j].id,
+                     n->id, n->rooms[j].creator, n->rooms[j].players, n->ip, n->port);
+            send_to_client(client, msg);
+            listed++;
         }
-        pthread_mutex_lock(&clients_mutex);
-        int taken = is_username_taken(buf);
-        pthread_mutex_unlock(&clients_mutex);
-        if (taken) {
-            send_to_client(client->socket, "Username in use, try again.\nEnter your username:\n");
-        } else {
-            strncpy(client->username, buf, sizeof(client->username)-1);
-            client->username[sizeof(client->username)-1] = '\0';
-            send_to_client(client->socket, "Username accepted\n");
-            tv.tv_sec = 0;
-            setsockopt(client->socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof(tv));
+    }
+    MUTEX_UNLOCK(&cluster_mutex);
+    return listed;
+}
+
+// /join <id>@<węzeł> do pokoju innego węzła: REDIRECT <adres>:<port> <id>.
+// Zwraca 1, gdy klient został odesłany, 0 gdy węzeł nie jest znany.
+static int cluster_redirect(Client *client, int room_id, const char *node) {
+    char target[96];
+    MUTEX_LOCK(&cluster_mutex);
+    cluster_expire(&cluster_dir, cluster_now_ms());
+    ClusterNode *n = cluster_find(&cluster_dir, node);
+    if (n)
+        snprintf(target, sizeof(target), "%s:%d", n->ip, n->port);
+    MUTEX_UNLOCK(&cluster_mutex);
+    if (!n)
+        return 0;
+    snprintf(msg, sizeof(msg), "REDIRECT %s %d\n", target, room_id);
+    send_to_client(client, msg);
+    return 1;
+}
+
+// ==================== Obsługa TLV ====================
+
+// Dosyła ramkę czekającą w tlv_frame obserwatora. Gniazdo TLV jest blokujące, więc
+// piszemy z MSG_DONTWAIT - aktor pokoju nie czeka na wolnego widza.
+// Zwraca 1, gdy ramka wyszła w całości.
+static int tlv_send_pending(Client *obs) {
+    while (obs->tlv_frame_off < obs->tlv_frame_len) {
+        ssize_t n = send(obs->tlv_socket, obs->tlv_frame + obs->tlv_frame_off,
+                         obs->tlv_frame_len - obs->tlv_frame_off, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("[TLV] Failed to send board update");
+                obs->tlv_frame_len = obs->tlv_frame_off = 0;
+            }
             return 0;
         }
+        obs->tlv_frame_off += n;
     }
+    obs->tlv_frame_len = obs->tlv_frame_off = 0;
+    return 1;
 }
 
-// ==================== Obsługa TLV ====================
+// Wysyła obserwatorowi najnowszy stan plansz 'packet' (NULL = tylko dokończ zaległą ramkę).
+// Ramka, z której nic jeszcze nie wyszło, zostaje zastąpiona - widz dostaje tylko
+// najnowszy stan, a zaległości nie rosną. Zwraca 1, gdy obserwator dostał wszystko.
+static int tlv_observer_send(Client *obs, const unsigned char *packet, int len) {
+    if (obs->tlv_frame_off > 0) {
+        if (!tlv_send_pending(obs)) {
+            obs->tlv_stale |= packet != NULL;
+            return 0;
+        }
+    } else if (obs->tlv_frame_len > 0 && packet) {
+        metric_inc(MET_OBSERVER_CONFLATED);  // Niewysłana ramka zastąpiona nowszą
+    }
+    if (packet) {
+        memcpy(obs->tlv_frame, packet, len);
+        obs->tlv_frame_len = len;
+        obs->tlv_frame_off = 0;
+        obs->tlv_stale = 0;
+    }
+    return tlv_send_pending(obs);
+}
 
-static void send_board_update_to_observers(ChatRoom *room) {
+// Wysyła obserwatorom plansze (jeśli się zmieniły) i dosyła zaległe ramki. Obserwator,
+// którego gniazdo nie przyjęło całej ramki, dostanie kolejną próbę przy następnym zegarze.
+// Wywoływane przez aktora pokoju.
+static void room_flush_observers(ChatRoom *room) {
+    // Pakiety obu plansz (gracza 0 i 1) budujemy raz - są takie same dla każdego obserwatora
+    unsigned char packet[TLV_BOARDS_FRAME];
+    int dirty = room->observers_dirty, len = 0, reached = 0, backlog = 0;
+    room->observers_dirty = 0;
+    room->observers_sent = now_ticks();
     for (int i = 0; i < room->observer_count; i++) {
         Client *obs = room->observers[i];
         if (!obs->active)
             continue;
-        int sock = obs->tlv_socket;
-        if (sock <= 0)
+        if (obs->tlv_socket <= 0)
             continue;
-        unsigned char packet[3+64];
-        // Wysyłamy planszę gracza 0
-        packet[0] = 0x01; // Typ
-        packet[1] = 0x00; // Długość (high byte)
-        packet[2] = 64;   // Długość (low byte)
-        memcpy(packet+3, room->boardPlayer0, 64);
-        if (send(sock, packet, 67, 0) < 0)
-            perror("[TLV] Failed to send boardPlayer0");
-        else
-        {
-            //printf("[DEBUG][TLV] Sent boardPlayer0 update to observer %s\n", obs->username);
-        }
-
-        // Wysyłamy planszę gracza 1
-        packet[0] = 0x02; // Typ
-        packet[1] = 0x00;
-        packet[2] = 64;
-        memcpy(packet+3, room->boardPlayer1, 64);
-        if (send(sock, packet, 67, 0) < 0)
-            perror("[TLV] Failed to send boardPlayer1");
-        else
-        {
-            // Pomyślnie przesłano
+        int fresh = dirty || obs->tlv_stale;
+        if (!fresh && obs->tlv_frame_len == 0)
+            continue;
+        if (fresh && len == 0) {
+            len  = tlv_board_packet(packet, TLV_BOARD_PLAYER0, room->boardPlayer0, 64);
+            len += tlv_board_packet(packet + len, TLV_BOARD_PLAYER1, room->boardPlayer1, 64);
         }
+        if (tlv_observer_send(obs, fresh ? packet : NULL, len))
+            reached++;
+        else if (obs->tlv_frame_len > 0)
+            backlog = 1;
     }
+    if (dirty && room->observer_count > 0)
+        metric_observe(HIST_OBSERVER_FANOUT, reached);
+    if (backlog && !room->observer_flush_pending)
+        room_request_observer_flush(room);
+}
+
+// Plansze pokoju się zmieniły. Obserwatorzy dostają je od razu, chyba że ostatnia
+// aktualizacja była przed chwilą - wtedy kolejne zmiany zbierają się do zegara
+// (najwyżej jedna aktualizacja na OBSERVER_UPDATE_MS, liczy się ostatni stan).
+// Wywoływane przez aktora pokoju.
+static void send_board_update_to_observers(ChatRoom *room) {
+    if (room->observer_count == 0)
+        return;
+    if (room->observers_dirty)
+        metric_inc(MET_OBSERVER_CONFLATED);
+    room->observers_dirty = 1;
+    if (room->observer_flush_pending)
+        return;  // Zegar już czeka - wyśle najnowszy stan
+    if (now_ticks() - room->observers_sent >= OBSERVER_UPDATE_TICKS)
+        room_flush_observers(room);
+    else
+        room_request_observer_flush(room);
 }
 
 // Wątek akceptujący połączenia TLV od obserwatorów
@@ -383,7 +1431,7 @@ static void *tlv_accept_thread(void *arg) {
             tlv_username[n] = '\0';
             printf("[TLV] Received TLV username: %s\n", tlv_username);
             // Mapujemy gniazdo TLV do odpowiedniego klienta
-            pthread_mutex_lock(&clients_mutex);
+            MUTEX_LOCK(&clients_mutex);
             for (int i = 0; i < client_count; i++) {
                 if (clients[i] && clients[i]->active &&
                     strcmp(clients[i]->username, tlv_username) == 0) {
@@ -392,7 +1440,7 @@ static void *tlv_accept_thread(void *arg) {
                     break;
                 }
             }
-            pthread_mutex_unlock(&clients_mutex);
+            MUTEX_UNLOCK(&clients_mutex);
         } else {
             printf("[TLV] Failed to receive TLV username, closing connection.\n");
             close(obs_sock);
@@ -401,513 +1449,3200 @@ static void *tlv_accept_thread(void *arg) {
     return NULL;
 }
 
+// ==================== Metryki ====================
+// Gniazdo administracyjne (Unix) z metrykami w formacie Prometheusa. Każde połączenie
+// dostaje jeden zrzut; żądanie zaczynające się od "GET" dostaje odpowiedź HTTP/1.0,
+// więc gniazdo można podać wprost scraperowi (np. curl --unix-socket).
+// Żądanie "/trace" zwraca zamiast metryk pierścień śladów strzałów (JSON Chrome Trace).
+
+// Wartości chwilowe odczytywane przy zrzucie (liczniki i histogramy zbiera metryki.h)
+static void metrics_render_gauges(FILE *out) {
+    int connected = 0, held = 0, rooms_active = 0;
+    MUTEX_LOCK(&clients_mutex);
+    for (int i = 0; i < client_count; i++) {
+        if (clients[i] && clients[i]->held)
+            held++;
+        else if (clients[i])
+            connected++;
+    }
+    MUTEX_UNLOCK(&clients_mutex);
+    for (int i = 0; i < MAX_ROOMS; i++)
+        if (__atomic_load_n(&chat_rooms[i].in_use, __ATOMIC_RELAXED))
+            rooms_active++;
+
+    fprintf(out, "# TYPE " METRICS_PREFIX "clients_connected gauge\n"
+                 METRICS_PREFIX "clients_connected %d\n", connected);
+    fprintf(out, "# TYPE " METRICS_PREFIX "sessions_held gauge\n"
+                 METRICS_PREFIX "sessions_held %d\n", held);
+    fprintf(out, "# TYPE " METRICS_PREFIX "rooms_active gauge\n"
+                 METRICS_PREFIX "rooms_active %d\n", rooms_active);
+    fprintf(out, "# TYPE " METRICS_PREFIX "pool_pending_tasks gauge\n"
+                 METRICS_PREFIX "pool_pending_tasks %ld\n",
+            __atomic_load_n(&pool.pending, __ATOMIC_RELAXED));
+    fprintf(out, "# TYPE " METRICS_PREFIX "pool_tasks_executed_total counter\n");
+    for (int i = 0; i < pool.size; i++)
+        fprintf(out, METRICS_PREFIX "pool_tasks_executed_total{worker=\"%d\"} %lu\n", i,
+                __atomic_load_n(&pool.workers[i].executed, __ATOMIC_RELAXED));
+    fprintf(out, "# TYPE " METRICS_PREFIX "pool_tasks_stolen_total counter\n");
+    for (int i = 0; i < pool.size; i++)
+        fprintf(out, METRICS_PREFIX "pool_tasks_stolen_total{worker=\"%d\"} %lu\n", i,
+                __atomic_load_n(&pool.workers[i].stolen, __ATOMIC_RELAXED));
+    fprintf(out, "# TYPE " METRICS_PREFIX "reactors gauge\n"
+                 METRICS_PREFIX "reactors %d\n", reactor_count);
+}
+
+static void metrics_serve(int fd) {
+    // Krótkie oczekiwanie na żądanie HTTP; klient, który nic nie wysyła, też dostaje zrzut
+    struct timeval tv = { 0, 100000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    char request[512];
+    ssize_t n = recv(fd, request, sizeof(request) - 1, 0);
+    request[n > 0 ? n : 0] = '\0';
+    int http = n >= 3 && strncmp(request, "GET", 3) == 0;
+    // "GET /trace" albo "trace" - zrzut śladów strzałów zamiast metryk
+    int trace = strncmp(request, "trace", 5) == 0 || strncmp(request, "GET /trace", 10) == 0;
+
+    char *body = NULL;
+    size_t body_len = 0;
+    FILE *out = open_memstream(&body, &body_len);
+    if (!out)
+        return;
+    if (trace) {
+        trace_dump_json(out);
+    } else {
+        metrics_render(out);
+        metrics_render_gauges(out);
+        lockprof_render(out);
+        lockprof_report_top(out);
+    }
+    fclose(out);
+
+    if (http) {
+        char header[160];
+        int hlen = snprintf(header, sizeof(header),
+                            "HTTP/1.0 200 OK\r\nContent-Type: %s\r\n"
+                            "Content-Length: %zu\r\n\r\n",
+                            trace ? "application/json" : "text/plain; version=0.0.4", body_len);
+        send(fd, header, hlen, MSG_NOSIGNAL);
+    }
+    for (size_t off = 0; off < body_len; ) {
+        ssize_t sent = send(fd, body + off, body_len - off, MSG_NOSIGNAL);
+        if (sent <= 0)
+            break;
+        off += sent;
+    }
+    free(body);
+}
+
+static void *metrics_thread(void *arg) {
+    int listen_fd = (int)(long)arg;
+    while (1) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("[METRICS] accept");
+            return NULL;
+        }
+        metrics_serve(fd);
+        close(fd);
+    }
+    return NULL;
+}
+
+static int metrics_start(const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "[METRICS] Socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("[METRICS] socket");
+        return -1;
+    }
+    unlink(path);  // Pozostałość po poprzednim uruchomieniu
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 16) < 0) {
+        perror("[METRICS] bind");
+        close(fd);
+        return -1;
+    }
+    pthread_t thread;
+    pthread_create(&thread, NULL, metrics_thread, (void *)(long)fd);
+    pthread_detach(thread);
+    printf("[METRICS] Serving metrics on unix:%s\n", path);
+    return 0;
+}
+
+// ==================== Reaktory ====================
+
+// Budzi reaktor (pętla epoll_wait wraca i opróżnia skrzynkę)
+static void reactor_wake(Reactor *r) {
+    unsigned long long one = 1;
+    if (write(r->wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+        perror("[REACTOR] wake");
+}
+
+// Uzbraja timery połączenia w kole bieżącego reaktora
+static void client_arm_timers(Client *client) {
+    if (client->state == CONN_HANDSHAKE) {
+        schedule_timer(&client->handshake_timer, USERNAME_HANDSHAKE_TIMEOUT,
+                       handshake_timeout_cb, client);
+    } else {
+        schedule_timer(&client->idle_timer, IDLE_TIMEOUT, idle_timeout_cb, client);
+        schedule_timer(&client->heartbeat_timer, HEARTBEAT_INTERVAL, heartbeat_cb, client);
+    }
+}
+
+static void client_cancel_timers(Client *client) {
+    cancel_timer(&client->handshake_timer);
+    cancel_timer(&client->idle_timer);
+    cancel_timer(&client->heartbeat_timer);
+}
+
+// Połączenia przed handshake'iem nie są jeszcze w tablicy clients - lista pozwala je
+// odnaleźć przy gorącym restarcie
+static void pending_conn_add(Client *client) {
+    MUTEX_LOCK(&conns_mutex);
+    client->conn_prev = NULL;
+    client->conn_next = pending_conns;
+    if (pending_conns)
+        pending_conns->conn_prev = client;
+    pending_conns = client;
+    MUTEX_UNLOCK(&conns_mutex);
+}
+
+static void pending_conn_remove(Client *client) {
+    MUTEX_LOCK(&conns_mutex);
+    if (client->conn_prev)
+        client->conn_prev->conn_next = client->conn_next;
+    else if (pending_conns == client)
+        pending_conns = client->conn_next;
+    if (client->conn_next)
+        client->conn_next->conn_prev = client->conn_prev;
+    client->conn_prev = client->conn_next = NULL;
+    MUTEX_UNLOCK(&conns_mutex);
+}
+
+static const int uring_no_file = -1;
+
+// Zwalnia slot gniazda w tablicy stałych deskryptorów reaktora
+static void uring_release_slot(Reactor *r, Client *client) {
+    if (client->fixed_slot < 0)
+        return;
+    struct io_uring_sqe *sqe = uring_get_sqe(&r->ring);
+    uring_prep_files_update(sqe, &uring_no_file, client->fixed_slot, URING_UD_IGNORE);
+    sqe->flags |= IOSQE_CQE_SKIP_SUCCESS;
+    client->fixed_slot = -1;
+}
+
+// Uzbraja wielokrotny recv połączenia. Przy pierwszym uzbrojeniu na danym reaktorze
+// gniazdo trafia do tablicy stałych deskryptorów - zgłoszeniem powiązanym z recv,
+// więc rejestracja wykona się przed nim, bez osobnego wywołania systemowego.
+static void uring_arm_recv(Reactor *r, Client *client) {
+    if (client->fixed_slot < 0 && client->socket < r->ring.file_slots) {
+        struct io_uring_sqe *sqe = uring_get_sqe(&r->ring);
+        uring_prep_files_update(sqe, &client->socket, client->socket, URING_UD_IGNORE);
+        sqe->flags |= IOSQE_IO_LINK | IOSQE_CQE_SKIP_SUCCESS;
+        client->fixed_slot = client->socket;
+    }
+    struct io_uring_sqe *sqe = uring_get_sqe(&r->ring);
+    int fixed = client->fixed_slot >= 0;
+    uring_prep_recv_multishot(sqe, fixed ? client->fixed_slot : client->socket, fixed,
+                              (unsigned long)client | URING_OP_RECV);
+    client->recv_armed = 1;
+    client_get(client);  // Referencja recv
+}
+
+// Wstawia klienta do kolejki wysyłek jego reaktora. Wywoływane z out_lock, po ustawieniu
+// send_busy. Reaktor budzimy tylko wtedy, gdy śpi - pracujący sam opróżni kolejkę
+// przed kolejnym io_uring_enter (reaktor sprawdza kolejkę po ustawieniu 'sleeping').
+static void uring_queue_send(Client *client) {
+    Reactor *r = client->reactor;
+    if (!mailbox_push(&r->send_queue, &client->send_node) || r == current_reactor)
+        return;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&r->sleeping, __ATOMIC_SEQ_CST))
+        reactor_wake(r);
+}
+
+// Przekazuje połączenie do innego reaktora przez jego skrzynkę. Od tej chwili klient
+// (gniazdo, bufory, timery) należy do 'target'; nieprzetworzone linie obsłuży już on.
+// Przy io_uring najpierw anulujemy wielokrotny recv - przekazanie dokończy
+// uring_on_recv po ostatnim CQE tego recv (dane, które zdążą dojść, trafią do bufora).
+static void reactor_handoff(Client *client, Reactor *target) {
+    if (io_backend == IO_URING) {
+        client_cancel_timers(client);
+        client->handoff_target = target;
+        struct io_uring_sqe *sqe = uring_get_sqe(&client->reactor->ring);
+        uring_prep_cancel(sqe, (unsigned long)client | URING_OP_RECV, URING_UD_IGNORE);
+        sqe->flags |= IOSQE_CQE_SKIP_SUCCESS;
+        return;
+    }
+    epoll_ctl(client->reactor->epoll_fd, EPOLL_CTL_DEL, client->socket, NULL);
+    client_cancel_timers(client);
+    client->reactor = target;
+    if (mailbox_push(&target->inbox, &client->handoff_node))
+        reactor_wake(target);
+}
+
+// Zamyka połączenie i sprząta sesję klienta (albo trzyma miejsce gracza do wznowienia).
+// Wywoływane wyłącznie przez reaktor, do którego należy klient. Miejsce w pokoju
+// zwalnia aktor pokoju; struktura żyje, dopóki ktoś trzyma do niej referencję.
+static void close_client(Client *client) {
+    // Timery anulujemy przed zamknięciem gniazda, aby callback nie zadziałał
+    // na zwolnionym kliencie ani na cudzym deskryptorze
+    client_cancel_timers(client);
+    if (io_backend == IO_URING) {
+        // Zgłoszenia używające gniazda muszą trafić do jądra przed jego zamknięciem
+        uring_release_slot(client->reactor, client);
+        uring_submit(&client->reactor->ring);
+        client->handoff_target = NULL;
+    }
+    capture_record(CAPTURE_CLOSE, client->capture_conn, NULL, 0);
+    metric_inc(MET_CONN_CLOSED);
+    MUTEX_LOCK(&client->out_lock);
+    int fd = client->socket;
+    client->socket = -1;
+    free(client->outbuf);
+    client->outbuf = NULL;
+    client->out_len = client->out_cap = 0;
+    client->want_write = 0;
+    client->send_off = client->send_len;  // Reszta wysyłki w toku nie trafi już do nikogo
+    MUTEX_UNLOCK(&client->out_lock);
+    if (io_backend == IO_URING)
+        shutdown(fd, SHUT_RDWR);  // Kończy wielokrotny recv (pierścień trzyma własną referencję gniazda)
+    close(fd);
+
+    if (client->state == CONN_HANDSHAKE) {
+        pending_conn_remove(client);
+        client_put(client);  // Klient nie zdążył się zarejestrować
+        return;
+    }
+
+    MUTEX_LOCK(&clients_mutex);
+    // Najpierw active = 0, potem odczyt pokoju - aktor pokoju robi to w odwrotnej kolejności
+    // przy /join, więc przynajmniej jedna strona zauważy drugą
+    __atomic_store_n(&client->active, 0, __ATOMIC_SEQ_CST);
+    ChatRoom *r = get_room_by_id(__atomic_load_n(&client->room_id, __ATOMIC_SEQ_CST));
+    if (r && !client->no_resume && __atomic_load_n(&client->seated, __ATOMIC_RELAXED)) {
+        // Gracz przy stole - trzymamy miejsce i stan gry na wypadek wznowienia sesji
+        client->held = 1;
+        MUTEX_UNLOCK(&clients_mutex);
+        schedule_timer(&client->grace_timer, RESUME_GRACE, grace_timeout_cb, client);
+        room_post(r, ROOM_CMD_HOLD, client, NULL);
+        printf("[SERVER] Holding seat of %s for resume.\n", client->username);
+        return;
+    }
+    unlist_client(client);
+    MUTEX_UNLOCK(&clients_mutex);
+    if (r)
+        room_post(r, ROOM_CMD_LEAVE, client, NULL);
+    client_put(client);  // Referencja sesji
+}
+
+// ==================== Obsługa Użytkowników ====================
+
+// Sprawdza, czy dany username jest już zajęty przez kogoś aktywnego
+int is_username_taken(const char *uname) {
+    for (int i = 0; i < client_count; i++) {
+        if (clients[i] && (clients[i]->active || clients[i]->held)) {
+            if (strcmp(clients[i]->username, uname) == 0)
+                return 1;
+        }
+    }
+    return 0;
+}
+
+// Generuje losowy token wznowienia (hex) z getrandom. Sam token wystarcza do przejęcia
+// trzymanego miejsca, więc bez dobrej losowości nie ma tokenu: zwraca -1.
+static int generate_resume_token(char out[RESUME_TOKEN_LEN + 1]) {
+    unsigned char raw[RESUME_TOKEN_LEN / 2];
+    if (getrandom(raw, sizeof(raw), 0) != (ssize_t)sizeof(raw))
+        return -1;
+    for (size_t i = 0; i < sizeof(raw); i++)
+        snprintf(out + 2 * i, 3, "%02x", raw[i]);
+    out[RESUME_TOKEN_LEN] = '\0';
+    return 0;
+}
+
+// Wysyła wznowionemu graczowi pełny stan pokoju w jednej odpowiedzi:
+// RESUME_STATE <nr gracza> <gra trwa> <gracz na ruchu|-> <moja plansza> <plansza przeciwnika>
+static void send_resume_state(Client *client) {
+    ChatRoom *room = get_room_by_id(client->room_id);
+    if (!room)
+        return;
+    int me = (room->clients[1] == client) ? 1 : 0;
+    const char *mine   = me == 0 ? room->boardPlayer0 : room->boardPlayer1;
+    const char *theirs = me == 0 ? room->boardPlayer1 : room->boardPlayer0;
+    char shots[64];  // Z planszy przeciwnika ujawniamy tylko trafienia i pudła
+    for (int i = 0; i < 64; i++)
+        shots[i] = (theirs[i] == 'X' || theirs[i] == '=') ? theirs[i] : '.';
+    const char *turn = "-";
+    if (room->gameStarted && room->clients[room->current_turn])
+        turn = room->clients[room->current_turn]->username;
+    snprintf(msg, sizeof(msg), "JOINED_ROOM\nRESUME_STATE %d %d %s %.64s %.64s\n",
+             me, room->gameStarted, turn, mine, shots);
+    send_to_client(client, msg);
+    snprintf(msg, sizeof(msg), "%s reconnected.\n", client->username);
+    broadcast_to_room(room, msg, client);
+}
+
+// Szuka trzymanej sesji o podanym tokenie. Wywoływane z trzymanym clients_mutex.
+static Client *find_held_session(const char *token) {
+    for (int i = 0; i < client_count; i++) {
+        Client *c = clients[i];
+        // recv_armed: recv poprzedniego połączenia (io_uring) jeszcze się nie zakończył
+        if (c && c->held && !c->recv_armed && strcmp(c->resume_token, token) == 0)
+            return c;
+    }
+    return NULL;
+}
+
+// Przenosi nowe połączenie 'conn' do trzymanej sesji: gniazdo, rejestrację w epoll oraz
+// nieprzeczytane dane wejściowe i wyjściowe. Struktura 'conn' zostaje zwolniona.
+// Wywoływane przez reaktor sesji (tam żyje jej grace_timer) z trzymanym clients_mutex.
+static void adopt_connection(Client *session, Client *conn) {
+    cancel_timer(&session->grace_timer);
+    cancel_timer(&conn->handshake_timer);
+    session->held = 0;
+    session->state = CONN_READY;
+    session->address = conn->address;
+    session->last_seen = conn->last_seen;
+    session->last_command = conn->last_seen;
+    int pending = conn->in_end - conn->in_start;
+    memcpy(session->inbuf, conn->inbuf + conn->in_start, pending);
+    session->in_start = 0;
+    session->in_end = pending;
+    MUTEX_LOCK(&session->out_lock);
+    session->socket = conn->socket;
+    session->capture_conn = conn->capture_conn;
+    session->outbuf = conn->outbuf;
+    session->out_len = conn->out_len;
+    session->out_cap = conn->out_cap;
+    session->want_write = conn->want_write;
+    client_update_events(session);
+    MUTEX_UNLOCK(&session->out_lock);
+    __atomic_store_n(&session->active, 1, __ATOMIC_SEQ_CST);
+    conn->socket = -1;
+    conn->outbuf = NULL;
+    if (io_backend == IO_URING)
+        uring_arm_recv(session->reactor, session);
+    pending_conn_remove(conn);
+    client_put(conn);
+}
+
+// Obsługuje jedną linię handshake'u. Klient podaje nazwę w odpowiedzi na prompt, albo
+// nie czekając na prompt wysyła od razu "HELLO <nazwa> [możliwości]" (handshake trwa jedno RTT),
+// albo "RESUME <token>", by przejąć swoją trzymaną sesję (wtedy *clientp wskazuje na sesję).
+// Przyjęty klient jest od razu rejestrowany w tablicy clients (pod tym samym mutexem co sprawdzenie).
+static int process_handshake_line(Client **clientp, const char *line) {
+    Client *client = *clientp;
+    char buf[50];
+    char standby[96];
+    if (__atomic_load_n(&standby_mode, __ATOMIC_ACQUIRE)) {
+        // Gry prowadzi serwer główny; klient ponowi próbę (RESUME trafi tu po przejęciu)
+        metric_inc(MET_HANDSHAKE_REJECTED);
+        send_to_client(client, "Standby server, not serving yet.\n");
+        return LINE_CLOSE;
+    }
+    standby_line(standby, sizeof(standby));
+    if (strncmp(line, "HELLO ", 6) == 0) {
+        char caps[64] = "";
+        buf[0] = '\0';
+        sscanf(line + 6, "%49s %63s", buf, caps);
+        strcpy(client->caps, caps);
+    } else {
+        strncpy(buf, line, sizeof(buf) - 1);
+        buf[sizeof(buf) - 1] = '\0';
+    }
+    if (strlen(buf) == 0) {
+        metric_inc(MET_HANDSHAKE_REJECTED);
+        send_to_client(client, "Username cannot be empty, try again.\nEnter your username:\n");
+        return LINE_OK;
+    }
+    if (strncmp(buf, "RESUME ", 7) == 0) {
+        MUTEX_LOCK(&clients_mutex);
+        Client *session = find_held_session(buf + 7);
+        if (session && (session->reactor != client->reactor || client->recv_armed)) {
+            // Sesja (i jej timer wznowienia) należy do innego reaktora - tam ją przejmiemy.
+            // Przy io_uring przechodzimy tę drogę zawsze: recv połączenia trzeba najpierw zatrzymać.
+            MUTEX_UNLOCK(&clients_mutex);
+            client->handoff_target = session->reactor;
+            return LINE_HANDOFF;
+        }
+        if (!session) {
+            MUTEX_UNLOCK(&clients_mutex);
+            metric_inc(MET_HANDSHAKE_REJECTED);
+            send_to_client(client, "Resume failed.\nEnter your username:\n");
+            return LINE_OK;
+        }
+        adopt_connection(session, client);
+        MUTEX_UNLOCK(&clients_mutex);
+        printf("[SERVER] Session resumed: %s\n", session->username);
+        metric_inc(MET_SESSIONS_RESUMED);
+        char reply[BUFFER_SIZE];
+        snprintf(reply, sizeof(reply), "Username accepted\nRESUMED %s\n%s", session->username, standby);
+        send_to_client(session, reply);
+        // Stan pokoju wyśle aktor pokoju (gra mogła się w międzyczasie skończyć)
+        ChatRoom *room = get_room_by_id(__atomic_load_n(&session->room_id, __ATOMIC_SEQ_CST));
+        if (!room || !room_post(room, ROOM_CMD_RESUME, session, NULL))
+            send_to_client(session, WELCOME_IN_LOBBY);
+        client_arm_timers(session);
+        *clientp = session;  // Dalsze linie z bufora należą już do wznowionej sesji
+        return LINE_OK;
+    }
+    char token[RESUME_TOKEN_LEN + 1];
+    if (generate_resume_token(token) < 0) {
+        perror("[SERVER] getrandom");
+        metric_inc(MET_HANDSHAKE_REJECTED);
+        send_to_client(client, "Login failed, try again later.\n");
+        return LINE_CLOSE;
+    }
+    MUTEX_LOCK(&clients_mutex);
+    if (is_username_taken(buf)) {
+        MUTEX_UNLOCK(&clients_mutex);
+        metric_inc(MET_HANDSHAKE_REJECTED);
+        send_to_client(client, "Username in use, try again.\nEnter your username:\n");
+        return LINE_OK;
+    }
+    if (client_count >= MAX_CLIENTS) {
+        MUTEX_UNLOCK(&clients_mutex);
+        metric_inc(MET_HANDSHAKE_REJECTED);
+        send_to_client(client, "Server full.\n");
+        return LINE_CLOSE;
+    }
+    strncpy(client->username, buf, sizeof(client->username)-1);
+    client->username[sizeof(client->username)-1] = '\0';
+    client->active = 1;
+    client->state = CONN_READY;
+    client->binary = proto_has_cap(client->caps, PROTO_CAP_BINARY);
+    client->board_deltas = proto_has_cap(client->caps, PROTO_CAP_DELTA);
+    client->last_command = client->last_seen;
+    memcpy(client->resume_token, token, sizeof(token));
+    clients[client_count++] = client;
+    MUTEX_UNLOCK(&clients_mutex);
+    pending_conn_remove(client);
+    printf("New client connected: %s\n", client->username);
+    metric_inc(MET_HANDSHAKE_OK);
+
+    char reply[BUFFER_SIZE];
+    snprintf(reply, sizeof(reply), "Username accepted\nRESUME_TOKEN %s\n%s%s%s", client->resume_token,
+             client->binary ? "PROTOCOL " PROTO_CAP_BINARY "\n" : "",
+             client->board_deltas ? "PROTOCOL " PROTO_CAP_DELTA "\n" : "", standby);
+    send_to_client(client, reply);
+    // Po udanym handshake wysyłamy komunikat lobby
+    send_to_client(client, WELCOME_IN_LOBBY);
+    cancel_timer(&client->handshake_timer);
+    client_arm_timers(client);
+    return LINE_OK;
+}
+
+// ==================== Aktor Pokoju ====================
+// Każdy pokój jest aktorem. Połączenia nie zmieniają stanu gry same - wrzucają sparsowane
+// komendy do ograniczonej skrzynki pokoju, a aktor wykonuje je po kolei, bez blokad,
+// w puli wątków (zawsze co najwyżej jeden wątek naraz, zwykle wątek domowy pokoju).
+// Każde zastosowane zdarzenie dostaje kolejny numer room->seq, więc kolejność zdarzeń
+// w pokoju jest deterministyczna.
+
+// Zamyka pomiar od FIRE do NEXT_TURN po wyniku strzału
+static void room_observe_turn(ChatRoom *room) {
+    if (room->fire_ns) {
+        metric_observe(HIST_FIRE_TO_NEXT_TURN, metric_now_ns() - room->fire_ns);
+        room->fire_ns = 0;
+    }
+}
+
+// ==================== Śledzenie Strzałów ====================
+// Śledzony FIRE (co N-ty, --trace-sample) dostaje numer śladu, pod którym aktor pokoju
+// zapisuje spany: oczekiwanie FIRE w kolejkach, rozesłanie FIRE, czas obrońcy (od rozesłania
+// FIRE do odebrania jego HIT/MISS - sieć i registerHitOrMiss klienta), oczekiwanie wyniku,
+// rozesłanie wyniku, NEXT_TURN, aktualizację TLV i całą turę.
+
+// Znacznik czasu tylko dla śledzonego strzału (nieśledzony nie płaci za zegar)
+static unsigned long long room_trace_mark(ChatRoom *room) {
+    return room->trace_id ? trace_now_ns() : 0;
+}
+
+static void room_trace_fire(ChatRoom *room, RoomCommand *cmd) {
+    if (!room->trace_id)
+        return;
+    unsigned long long sent = trace_now_ns();
+    unsigned long long applied = room->fire_ns;
+    room->trace_turn_ns = cmd->recv_ns ? cmd->recv_ns : applied;
+    room->trace_fire_sent_ns = sent;
+    trace_span(room->trace_id, "fire.queue", room->id, cmd->recv_ns, applied, cmd->sender->username);
+    trace_span(room->trace_id, "fire.broadcast", room->id, applied, sent, cmd->text);
+}
+
+static void *trace_dump_thread(void *arg) {
+    (void)arg;
+    char path[64];
+    snprintf(path, sizeof(path), "trace-slow-%ld.json", (long)time(NULL));
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror("[TRACE] Cannot write trace dump");
+        return NULL;
+    }
+    int spans = trace_dump_json(f);
+    fclose(f);
+    printf("[TRACE] Slow turn, dumped %d spans to %s\n", spans, path);
+    return NULL;
+}
+
+// Zrzut pierścienia po wolnej turze - najwyżej jeden na TRACE_SLOW_INTERVAL sekund,
+// zapisywany w osobnym wątku, aby nie wstrzymywać aktora pokoju
+#define TRACE_SLOW_INTERVAL 10
+static void trace_dump_slow(void) {
+    long now = (long)time(NULL);
+    long last = __atomic_load_n(&trace_last_dump, __ATOMIC_RELAXED);
+    if (now - last < TRACE_SLOW_INTERVAL ||
+        !__atomic_compare_exchange_n(&trace_last_dump, &last, now, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        return;
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, trace_dump_thread, NULL) == 0)
+        pthread_detach(thread);
+}
+
+// Spany wyniku strzału; marks = początek, po rozesłaniu HIT/MISS, po NEXT_TURN
+static void room_trace_result(ChatRoom *room, RoomCommand *cmd, const unsigned long long marks[3]) {
+    if (!room->trace_id)
+        return;
+    unsigned long long id = room->trace_id, end = trace_now_ns();
+    char detail[TRACE_DETAIL_LEN];
+    snprintf(detail, sizeof(detail), "%d observers", room->observer_count);
+    trace_span(id, "defender", room->id, room->trace_fire_sent_ns,
+               cmd->recv_ns ? cmd->recv_ns : marks[0], cmd->sender->username);
+    trace_span(id, "result.queue", room->id, cmd->recv_ns, marks[0], NULL);
+    trace_span(id, "result.broadcast", room->id, marks[0], marks[1], cmd->text);
+    trace_span(id, "next_turn", room->id, marks[1], marks[2], NULL);
+    trace_span(id, "tlv_update", room->id, marks[2], end, detail);
+    trace_span(id, "turn", room->id, room->trace_turn_ns, end, NULL);
+    room->trace_id = 0;
+    if (trace_slow_ns && end - room->trace_turn_ns >= trace_slow_ns)
+        trace_dump_slow();
+}
+
+// Potwierdza klientowi z możliwością "delta" wersję planszy (może poczekać na tick łączenia)
+static void room_ack_board(ChatRoom *room, Client *client, int board) {
+    if (!client->board_deltas)
+        return;
+    char ack[48];
+    int n = snprintf(ack, sizeof(ack), "BOARD_ACK %d %u\n", board, room->board_version[board]);
+    client_write_coalesced(client, ack, n);
+}
+
+// Zapisuje planszę gracza (BOARD0/BOARD1) i rozsyła ją obserwatorom przez TLV.
+// Pełna plansza jest wersją 0 - od niej liczą się kolejne delty.
+static void room_apply_board(ChatRoom *room, Client *client, const char *text) {
+    const char *dat = text + 7;
+    if (strlen(dat) < 64)
+        return;
+    int board = text[5] == '0' ? 0 : 1;
+    memcpy(board ? room->boardPlayer1 : room->boardPlayer0, dat, 64);
+    room->board_version[board] = 0;
+    room->board_sync[board] = BOARD_SYNC_OK;
+    room_ack_board(room, client, board);
+    send_board_update_to_observers(room);
+}
+
+// BOARD_DELTA <plansza> <wersja> <pola>: zmienione pola planszy (dwie cyfry numeru pola
+// i znak). Delta musi być następną wersją po tej, którą ma pokój - inaczej (np. po
+// przejęciu gry od innego serwera) prosimy klienta o pełną planszę.
+static void room_apply_board_delta(ChatRoom *room, Client *client, const char *text) {
+    int board, used = 0;
+    unsigned version;
+    if (sscanf(text, "BOARD_DELTA %d %u %n", &board, &version, &used) != 2 || used == 0 ||
+        board < 0 || board > 1)
+        return;
+    const char *cells = text + used;
+    size_t len = strlen(cells);
+    if (len % 3 != 0 || len > PROTO_BOARD_CELLS * 3)
+        return;
+    for (size_t i = 0; i < len; i += 3) {
+        if (cells[i] < '0' || cells[i] > '9' || cells[i + 1] < '0' || cells[i + 1] > '9' ||
+            (cells[i] - '0') * 10 + (cells[i + 1] - '0') >= PROTO_BOARD_CELLS)
+            return;
+    }
+    if (room->board_sync[board] != BOARD_SYNC_OK || version != room->board_version[board] + 1) {
+        if (room->board_sync[board] != BOARD_SYNC_REQUESTED) {
+            // Kolejne delty, które klient zdążył wysłać, pomijamy do nadejścia pełnej planszy
+            room->board_sync[board] = BOARD_SYNC_REQUESTED;
+            metric_inc(MET_BOARD_RESYNCS);
+            snprintf(msg, sizeof(msg), "BOARD_RESYNC %d\n", board);
+            send_to_client(client, msg);
+        }
+        return;
+    }
+    char *cur = board ? room->boardPlayer1 : room->boardPlayer0;
+    for (size_t i = 0; i < len; i += 3)
+        cur[(cells[i] - '0') * 10 + (cells[i + 1] - '0')] = cells[i + 2];
+    room->board_version[board] = version;
+    metric_inc(MET_BOARD_DELTAS);
+    room_ack_board(room, client, board);
+    send_board_update_to_observers(room);
+}
+
+// Rozsyła strzał (FIRE) lub jego wynik (HIT/MISS) zapisany jako "KOMENDA x y nazwa".
+// W ramce binarnej nazwę zastępuje miejsce gracza 'seat', który wysłał komendę.
+static void room_broadcast_shot(ChatRoom *room, int op, int seat, const char *text) {
+    snprintf(msg, sizeof(msg), "%s\n", text);
+    int x, y;
+    if (seat < 0 || sscanf(text, "%*s %d %d", &x, &y) != 2 ||
+        x < 0 || x > 255 || y < 0 || y > 255) {
+        broadcast_text(room, msg, NULL, shot_urgent());  // Nie da się zapisać w ramce - tylko tekst
+        return;
+    }
+    unsigned char frame[PROTO_SHOT_SIZE];
+    proto_shot(frame, op, x, y, seat);
+    broadcast_frame(room, frame, sizeof(frame), msg, shot_urgent());
+}
+
+// Wpisuje klienta do pokoju (referencja członkostwa). Zwraca 0, jeśli klient rozłączył się
+// w międzyczasie - reaktor mógł nie zauważyć członkostwa, więc je wycofujemy.
+static int room_admit(ChatRoom *room, Client *client, int seated) {
+    client_get(client);
+    __atomic_store_n(&client->seated, seated, __ATOMIC_RELAXED);
+    __atomic_store_n(&client->room_id, room->id, __ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&client->active, __ATOMIC_SEQ_CST)) {
+        room_remove_member(room, client);
+        return 0;
+    }
+    room_publish(room);
+    return 1;
+}
+
+static void room_apply_join(ChatRoom *room, Client *client) {
+    int rid = room->id;
+    if (room->clients[0] && room->clients[1]) {
+        if (room->observer_count >= MAX_OBSERVERS) {
+            send_to_client(client, "Room is full.\n");
+            return;
+        }
+        room->observers[room->observer_count++] = client;
+        if (!room_admit(room, client, 0))
+            return;
+        send_to_client(client, "JOINED_ROOM_OBSERVER\n");
+        send_to_client(client, "Room is full. Joined as observer.\n");
+        snprintf(msg, sizeof(msg), "TLV_PORT %d\n", tlv_port);
+        send_to_client(client, msg);
+        notify_observer_about_game_state(room, client);
+    }
+    else if (room->clients[0] && !room->clients[1]) {
+        room->clients[1] = client;
+        if (!room_admit(room, client, 1))
+            return;
+        send_to_client(client, "JOINED_ROOM\n");
+        snprintf(msg, sizeof(msg),
+                 "Joined room %d as second player. Now 2 players in room.\n", rid);
+        send_to_client(client, msg);
+        snprintf(msg, sizeof(msg),
+                 "%s joined as second player.\n", client->username);
+        broadcast_to_room(room, msg, client);
+    }
+    else if (!room->clients[0]) {
+        room->clients[0] = client;
+        if (!room_admit(room, client, 1))
+            return;
+        send_to_client(client, "JOINED_ROOM\n");
+        send_to_client(client, "Joined room as first player.\n");
+        memset(room->boardPlayer0, '.', 64);
+        memset(room->boardPlayer1, '.', 64);
+        room->board_sync[0] = room->board_sync[1] = BOARD_SYNC_NONE;
+        snprintf(msg, sizeof(msg),
+                 "%s joined as first player.\n", client->username);
+        broadcast_to_room(room, msg, client);
+    }
+    else {
+        send_to_client(client, "Could not join.\n");
+    }
+}
+
+static void room_apply_exit(ChatRoom *room, Client *client) {
+    room_remove_member(room, client);
+    send_to_client(client, "You are now in the lobby.\n");
+    if (room->clients[0])
+        send_to_client(room->clients[0], WELCOME_IN_LOBBY);
+    maybe_reclaim_room(room);
+}
+
+// Upłynął czas tury: gracz na ruchu (lub nieobecny przeciwnik) przegrywa walkowerem
+static void room_apply_turn_timeout(ChatRoom *room, const char *gen) {
+    if (!room->gameStarted || strtoul(gen, NULL, 10) != room->turn_gen)
+        return;  // Zegar przezbrojony lub anulowany po odpaleniu - walkower nieaktualny
+    int loser = room->current_turn;
+    Client *opponent = room->clients[1 - loser];
+    if (room->clients[loser] && (!opponent || !opponent->active))
+        loser = 1 - loser;  // Przeciwnik nieobecny (lub rozłączony) - to on traci turę
+    const char *loser_name  = room->clients[loser] ? room->clients[loser]->username : "UNKNOWN";
+    const char *winner_name = room->clients[1 - loser] ? room->clients[1 - loser]->username : "UNKNOWN";
+    printf("[TIMER] Room %d: turn timeout for %s\n", room->id, loser_name);
+    snprintf(msg, sizeof(msg), "TURN_TIMEOUT %s\n", loser_name);
+    broadcast_to_room(room, msg, NULL);
+    end_game(room, winner_name, loser_name);
+}
+
+// Gracz nie wrócił w okresie wznowienia - zwalniamy miejsce, w trakcie gry przeciwnik wygrywa
+static void room_apply_abandon(ChatRoom *room, Client *client) {
+    printf("[TIMER] Resume grace expired for %s\n", client->username);
+    int member = (client->room_id == room->id);
+    if (member && room->gameStarted) {
+        int me = (room->clients[1] == client) ? 1 : 0;
+        Client *opponent = room->clients[1 - me];
+        room_request_turn_timer(room, 0);
+        end_game(room, opponent ? opponent->username : "UNKNOWN", client->username);
+        member = 0;  // end_game zwolnił już wszystkie miejsca
+    }
+    if (member) {
+        room_remove_member(room, client);
+        snprintf(msg, sizeof(msg), "%s did not reconnect and left the room.\n", client->username);
+        broadcast_to_room(room, msg, NULL);
+        maybe_reclaim_room(room);
+    }
+    MUTEX_LOCK(&clients_mutex);
+    unlist_client(client);
+    MUTEX_UNLOCK(&clients_mutex);
+    client_put(client);  // Referencja sesji
+}
+
+// Komenda klienta, z której powstaje komenda pokoju. Aktor pokoju zna rzeczywiste
+// miejsce nadawcy, więc to on ostatecznie sprawdza uprawnienia roli z rejestru.
+static const int room_command_source[ROOM_CMD_COUNT] = {
+    [ROOM_CMD_START] = CMD_START,
+    [ROOM_CMD_FIRE]  = CMD_FIRE,
+    [ROOM_CMD_HIT]   = CMD_HIT,
+    [ROOM_CMD_MISS]  = CMD_MISS,
+    [ROOM_CMD_WIN]   = CMD_YOU_WIN,
+    [ROOM_CMD_CHAT]  = CMD_CHAT,
+    [ROOM_CMD_BOARD] = CMD_BOARD0,
+    [ROOM_CMD_BOARD_DELTA] = CMD_BOARD_DELTA,
+};
+
+// Wykonuje jedną komendę w pokoju. Działa wyłącznie w aktorze pokoju.
+static void room_apply(ChatRoom *room, RoomCommand *cmd) {
+    Client *client = cmd->sender;
+    if (cmd->type == ROOM_CMD_REPLICATE)
+        return;  // Obraz pokoju do dziennika dopisuje room_run po każdej komendzie
+    if (cmd->type == ROOM_CMD_OBSERVERS) {
+        room->observer_flush_pending = 0;
+        if (room->in_use)
+            room_flush_observers(room);
+        return;
+    }
+    if (!room->in_use)
+        return;  // Pokój zwolniony, zanim komenda doczekała na swoją kolej
+    if (cmd->type == ROOM_CMD_ABANDON) {
+        room->seq++;
+        room_apply_abandon(room, client);
+        return;
+    }
+    // Komendy gracza są ważne tylko, jeśli wciąż jest w tym pokoju (i połączony)
+    int member = client && client->room_id == room->id;
+    if (cmd->type == ROOM_CMD_RESUME && !member) {
+        send_to_client(client, WELCOME_IN_LOBBY);  // Gra skończyła się podczas rozłączenia
+        return;
+    }
+    if (client && cmd->type != ROOM_CMD_JOIN && !member)
+        return;
+    if (client && cmd->type < ROOM_CMD_LEAVE && !__atomic_load_n(&client->active, __ATOMIC_SEQ_CST))
+        return;
+
+    int pIndex = -1;
+    if (client && room->clients[0] == client)
+        pIndex = 0;
+    if (client && room->clients[1] == client)
+        pIndex = 1;
+    int source = room_command_source[cmd->type];
+    if (client && source != CMD_NONE &&
+        !command_allowed(&client_commands, source, pIndex >= 0 ? ROLE_PLAYER : ROLE_OBSERVER)) {
+        if (client_command_specs[source].denied)
+            send_to_client(client, client_command_specs[source].denied);
+        return;
+    }
+    room->seq++;
+    unsigned long long trace_marks[3];  // Śledzony wynik strzału: początek, po HIT/MISS, po NEXT_TURN
+
+    switch (cmd->type) {
+    case ROOM_CMD_JOIN:
+        if (client->room_id == -1)
+            room_apply_join(room, client);
+        break;
+    case ROOM_CMD_EXIT:
+        room_apply_exit(room, client);
+        break;
+    case ROOM_CMD_LEAVE:
+        room_remove_member(room, client);
+        maybe_reclaim_room(room);
+        break;
+    case ROOM_CMD_HOLD:
+        snprintf(msg, sizeof(msg), "%s disconnected, holding the seat for %d s.\n",
+                 client->username, RESUME_GRACE);
+        broadcast_to_room(room, msg, NULL);
+        break;
+    case ROOM_CMD_RESUME:
+        send_resume_state(client);
+        break;
+    case ROOM_CMD_BOARD:
+        room_apply_board(room, client, cmd->text);
+        break;
+    case ROOM_CMD_BOARD_DELTA:
+        room_apply_board_delta(room, client, cmd->text);
+        break;
+    case ROOM_CMD_CHAT: {
+        snprintf(msg, sizeof(msg), "%s: %s\n", client->username, cmd->text);
+        unsigned char frame[PROTO_MAX_FRAME];
+        int flen = proto_chat(frame, msg, (int)strlen(msg) - 1);
+        broadcast_frame(room, frame, flen, msg, 0);
+        break;
+    }
+    case ROOM_CMD_START:
+        room->playerReady[pIndex] = 1;
+        snprintf(msg, sizeof(msg), "%s is ready.\n", client->username);
+        broadcast_to_room(room, msg, NULL);
+        if (room->clients[0] && room->clients[1]) {
+            if (!room->gameStarted) {
+                if (room->playerReady[0] && room->playerReady[1]) {
+                    start_game(room);
+                }
+            }
+        }
+        else {
+            send_to_client(client, "Waiting for second player...\n");
+        }
+        break;
+    case ROOM_CMD_FIRE:
+        if (!room->gameStarted) {
+            send_to_client(client, "Game not started yet.\n");
+            break;
+        }
+        if (pIndex != room->current_turn) {
+            send_to_client(client, "Not your turn!\n");
+            break;
+        }
+        room->fire_ns = metric_now_ns();
+        room->trace_id = trace_begin();
+        room_broadcast_shot(room, PROTO_FIRE, pIndex, cmd->text);
+        room_trace_fire(room, cmd);
+        break;
+    case ROOM_CMD_HIT:
+        trace_marks[0] = room_trace_mark(room);
+        room_broadcast_shot(room, PROTO_HIT, pIndex, cmd->text);
+        trace_marks[1] = room_trace_mark(room);
+        //room->current_turn = (room->current_turn == 0) ? 1 : 0; // Tutaj trzeba wrócić Miras
+        if (room->clients[room->current_turn]) {
+            snprintf(msg, sizeof(msg),
+                     "NEXT_TURN %s TUTAJ POWINIEN ZOSTAC TEN SAM GRACZ\n",
+                     room->clients[room->current_turn]->username);
+            broadcast_next_turn(room, msg);
+            room_observe_turn(room);
+        }
+        trace_marks[2] = room_trace_mark(room);
+        if (room->gameStarted)
+            arm_turn_timer(room);
+        send_board_update_to_observers(room);
+        room_trace_result(room, cmd, trace_marks);
+        break;
+    case ROOM_CMD_MISS:
+        trace_marks[0] = room_trace_mark(room);
+        room_broadcast_shot(room, PROTO_MISS, pIndex, cmd->text);
+        trace_marks[1] = room_trace_mark(room);
+        room->current_turn = (room->current_turn == 0) ? 1 : 0;
+        if (room->clients[room->current_turn]) {
+            snprintf(msg, sizeof(msg), "NEXT_TURN %s\n",
+                     room->clients[room->current_turn]->username);
+            broadcast_next_turn(room, msg);
+            room_observe_turn(room);
+        }
+        trace_marks[2] = room_trace_mark(room);
+        if (room->gameStarted)
+            arm_turn_timer(room);
+        send_board_update_to_observers(room);
+        room_trace_result(room, cmd, trace_marks);
+        break;
+    case ROOM_CMD_WIN: {
+        char winner[50];
+        strncpy(winner, client->username, 49);
+        winner[49] = '\0';
+        char loser[50] = "UNKNOWN";
+        if (room->clients[0] && room->clients[0] != client) {
+            strncpy(loser, room->clients[0]->username, 49);
+        } else if (room->clients[1] && room->clients[1] != client) {
+            strncpy(loser, room->clients[1]->username, 49);
+        }
+        room_request_turn_timer(room, 0);
+        end_game(room, winner, loser);
+        break;
+    }
+    case ROOM_CMD_TURN_TIMEOUT:
+        room_apply_turn_timeout(room, cmd->text);
+        break;
+    }
+    room_publish(room);
+}
+
+// Uruchamia aktora: wykonuje wszystkie komendy ze skrzynki pokoju.
+// Flaga 'scheduled' pozostaje ustawiona do końca pracy, aby zajęty slot nie został
+// ponownie przydzielony przez /create; po jej zdjęciu sprawdzamy, czy nic nie doszło.
+static void room_run(ChatRoom *room) {
+    while (1) {
+        RoomCommand *cmd;
+        while ((cmd = ring_mailbox_pop(&room->mailbox)) != NULL) {
+            room_apply(room, cmd);
+            replica_capture(room);  // Przed wznowieniem nadawcy - jego kolejna komenda trafi do dziennika później
+            if (cmd->sender) {
+                if (cmd->wakes_sender)
+                    client_continue(cmd->sender);
+                client_put(cmd->sender);  // Referencja komendy
+            }
+            free(cmd);
+        }
+        __atomic_store_n(&room->scheduled, 0, __ATOMIC_SEQ_CST);
+        if (ring_mailbox_empty(&room->mailbox))
+            return;
+        int expected = 0;
+        if (!__atomic_compare_exchange_n(&room->scheduled, &expected, 1, 0,
+                                         __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            return;  // Producent już zaplanował pokój ponownie
+    }
+}
+
+static void room_task_run(Task *task) {
+    room_run((ChatRoom *)((char *)task - offsetof(ChatRoom, task)));
+}
+
+// Pierwsze użycie slotu: skrzynka, zadanie i reaktor zegara zostają z pokojem na stałe
+static void room_slot_init(ChatRoom *room, int rid) {
+    room->owner = &reactors[rid % reactor_count];
+    ring_mailbox_init(&room->mailbox);
+    room->task.run = room_task_run;
+    room->task.home = rid;
+    timer_init(&room->turn_timer);
+    timer_init(&room->observer_timer);
+}
+
+// Wrzuca komendę do skrzynki pokoju i w razie potrzeby planuje aktora w puli.
+// Bezpieczne z dowolnego wątku. Zwraca 0, gdy skrzynka jest pełna (komenda odrzucona).
+static int room_post_command(ChatRoom *room, int type, Client *sender, const char *text, int wakes_sender) {
+    size_t len = text ? strlen(text) : 0;
+    RoomCommand *cmd = malloc(sizeof(RoomCommand) + len + 1);
+    if (!cmd)
+        return 0;
+    cmd->type = type;
+    cmd->sender = sender;
+    cmd->wakes_sender = wakes_sender;
+    cmd->recv_ns = current_input_ns;
+    memcpy(cmd->text, text ? text : "", len + 1);
+    if (sender)
+        client_get(sender);
+    metric_observe(HIST_ROOM_MAILBOX_DEPTH, ring_mailbox_depth(&room->mailbox));
+    if (!ring_mailbox_push(&room->mailbox, cmd)) {
+        metric_inc(MET_MAILBOX_FULL);
+        if (sender)
+            client_put(sender);
+        free(cmd);
+        return 0;
+    }
+    int expected = 0;
+    if (__atomic_compare_exchange_n(&room->scheduled, &expected, 1, 0,
+                                    __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        pool_submit(&pool, &room->task);
+    return 1;
+}
+
+static int room_post(ChatRoom *room, int type, Client *sender, const char *text) {
+    return room_post_command(room, type, sender, text, 0);
+}
+
+// Wrzuca komendę klienta do pokoju i wstrzymuje jego aktora do czasu jej wykonania
+static void post_and_wait(Client *client, ChatRoom *room, int type, const char *text) {
+    __atomic_store_n(&client->awaiting_room, 1, __ATOMIC_SEQ_CST);
+    if (!room_post_command(room, type, client, text, 1)) {
+        __atomic_store_n(&client->awaiting_room, 0, __ATOMIC_SEQ_CST);
+        send_to_client(client, "Server busy, command dropped.\n");
+    }
+}
+
+// Przekazuje komendę klienta do aktora jego pokoju. Aktor klienta wstrzymuje kolejne
+// linie, dopóki pokój jej nie wykona - pipelining (np. "/exit" i "/create" w jednym
+// segmencie) widzi efekt poprzedniej komendy.
+static void post_to_room(Client *client, int type, const char *text) {
+    ChatRoom *room = get_room_by_id(client->room_id);
+    if (!room) {
+        send_to_client(client, "Error: room not found.\n");
+        client->room_id = -1;
+        return;
+    }
+    post_and_wait(client, room, type, text);
+}
+
 // ==================== Obsługa Klienta ====================
+// Komendy zalogowanego klienta wykonuje jego aktor w puli wątków. Czasownik linii
+// rozpoznaje rejestr z komendy.h, a tablica command_handlers wskazuje funkcję obsługi.
+// Komendy dotyczące pokoju trafiają do jego aktora; tutaj obsługiwane jest tylko lobby.
 
-// Wątek obsługujący komunikację z pojedynczym klientem
-void *handle_client(void *arg) {
-    Client *client = (Client *)arg;
-    char buffer[BUFFER_SIZE];
+typedef int (*CommandHandler)(Client *client, char *line, const char *args);
+
+static int cmd_create(Client *client, char *line, const char *args) {
+    (void)line; (void)args;
+    MUTEX_LOCK(&rooms_mutex);
+    // Szukamy zwolnionego pokoju (którego aktor już nie pracuje), dopiero potem zajmujemy nowy
+    int rid = 0;
+    while (rid < room_count &&
+           (chat_rooms[rid].in_use || __atomic_load_n(&chat_rooms[rid].scheduled, __ATOMIC_ACQUIRE)))
+        rid++;
+    if (rid >= MAX_ROOMS) {
+        send_to_client(client, "Too many rooms, try again later.\n");
+        MUTEX_UNLOCK(&rooms_mutex);
+        return LINE_OK;
+    }
+    ChatRoom *room = &chat_rooms[rid];
+    if (rid == room_count) {
+        room_count++;
+        room_slot_init(room, rid);
+    }
+    room->id = rid;
+    metric_inc(MET_ROOMS_CREATED);
+    strncpy(room->creator, client->username, sizeof(room->creator)-1);
+    room->creator[sizeof(room->creator)-1] = '\0';
+
+    room->clients[0] = client;
+    room->clients[1] = NULL;
+    room->observer_count = 0;
+    room->playerReady[0] = 0;
+    room->playerReady[1] = 0;
+    room->gameStarted = 0;
+    room->current_turn = 0;
+    room->seq = 0;
+    memset(room->boardPlayer0, '.', 64);
+    memset(room->boardPlayer1, '.', 64);
+    room->board_sync[0] = room->board_sync[1] = BOARD_SYNC_NONE;
+    room_publish(room);
+    client_get(client);  // Referencja członkostwa
+    __atomic_store_n(&client->seated, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&client->room_id, room->id, __ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&client->active, __ATOMIC_SEQ_CST)) {
+        // Rozłączony w międzyczasie - reaktor nie zwolni miejsca, więc nie zajmujemy pokoju
+        room->clients[0] = NULL;
+        room_publish(room);
+        __atomic_store_n(&client->room_id, -1, __ATOMIC_SEQ_CST);
+        MUTEX_UNLOCK(&rooms_mutex);
+        client_put(client);
+        return LINE_OK;
+    }
+    __atomic_store_n(&room->in_use, 1, __ATOMIC_RELEASE);
+
+    send_to_client(client, "JOINED_ROOM\n");
+    snprintf(msg, sizeof(msg),
+             "Room %d created by %s.\n"
+             "Wait for /join <id> from second player.\n",
+             room->id, room->creator);
+    send_to_client(client, msg);
+    MUTEX_UNLOCK(&rooms_mutex);
+    if (__atomic_load_n(&standby_client_port, __ATOMIC_RELAXED))
+        room_post(room, ROOM_CMD_REPLICATE, NULL, NULL);  // Pokój trafia do serwera zapasowego, zanim ktoś dołączy
+    return LINE_OK;
+}
+
+static int cmd_join(Client *client, char *line, const char *args) {
+    (void)line;
+    const char *node = strchr(args, '@');  // <id>@<węzeł> z /list klastra
+    if (node && cluster_sock >= 0 && strcmp(node + 1, server_id) != 0) {
+        if (!cluster_redirect(client, atoi(args), node + 1))
+            send_to_client(client, "Invalid room ID.\n");
+        return LINE_OK;
+    }
+    ChatRoom *room = args[0] ? get_room_by_id(atoi(args)) : NULL;
+    if (!room)
+        send_to_client(client, "Invalid room ID.\n");
+    else
+        post_and_wait(client, room, ROOM_CMD_JOIN, NULL);
+    return LINE_OK;
+}
+
+static int cmd_list(Client *client, char *line, const char *args) {
+    (void)line; (void)args;
+    MUTEX_LOCK(&rooms_mutex);
+    int active_rooms = 0;
+    for (int i = 0; i < room_count; i++)
+        if (chat_rooms[i].in_use)
+            active_rooms++;
+    if (active_rooms == 0) {
+        if (cluster_sock < 0)
+            send_to_client(client, "No rooms.\n");
+    } else {
+        snprintf(msg, sizeof(msg), "Rooms: %d\n", active_rooms);
+        send_to_client(client, msg);
+        for (int i = 0; i < room_count; i++) {
+            ChatRoom *r = &chat_rooms[i];
+            if (!r->in_use)
+                continue;
+            snprintf(msg, sizeof(msg),
+                     "ID:%d by:%s players:%d/2\n",
+                     r->id, r->creator, __atomic_load_n(&r->player_count, __ATOMIC_RELAXED));
+            send_to_client(client, msg);
+        }
+    }
+    MUTEX_UNLOCK(&rooms_mutex);
+    if (cluster_sock >= 0 && cluster_list_rooms(client) == 0 && active_rooms == 0)
+        send_to_client(client, "No rooms.\n");
+    return LINE_OK;
+}
+
+static int cmd_exit(Client *client, char *line, const char *args) {
+    (void)line; (void)args;
+    if (client->room_id != -1) {
+        post_to_room(client, ROOM_CMD_EXIT, NULL);
+        return LINE_OK;
+    }
+    send_to_client(client, "Goodbye.\n");
+    return LINE_CLOSE;
+}
+
+static int cmd_start(Client *client, char *line, const char *args) {
+    (void)line; (void)args;
+    post_to_room(client, ROOM_CMD_START, NULL);
+    return LINE_OK;
+}
+
+static int cmd_fire(Client *client, char *line, const char *args) {
+    (void)args;
+    post_to_room(client, ROOM_CMD_FIRE, line);
+    return LINE_OK;
+}
+
+static int cmd_hit(Client *client, char *line, const char *args) {
+    (void)args;
+    post_to_room(client, ROOM_CMD_HIT, line);
+    return LINE_OK;
+}
+
+static int cmd_miss(Client *client, char *line, const char *args) {
+    (void)args;
+    post_to_room(client, ROOM_CMD_MISS, line);
+    return LINE_OK;
+}
+
+static int cmd_you_win(Client *client, char *line, const char *args) {
+    (void)line; (void)args;
+    post_to_room(client, ROOM_CMD_WIN, NULL);
+    return LINE_OK;
+}
+
+// Aktualizacja planszy (BOARD0/BOARD1) - pokój rozsyła ją obserwatorom przez TLV
+static int cmd_board(Client *client, char *line, const char *args) {
+    (void)args;
+    post_to_room(client, ROOM_CMD_BOARD, line);
+    return LINE_OK;
+}
+
+// Przyrostowa aktualizacja planszy - wersję sprawdza aktor pokoju
+static int cmd_board_delta(Client *client, char *line, const char *args) {
+    (void)args;
+    post_to_room(client, ROOM_CMD_BOARD_DELTA, line);
+    return LINE_OK;
+}
+
+static int cmd_chat(Client *client, char *line, const char *args) {
+    (void)args;
+    if (client->room_id != -1)
+        post_to_room(client, ROOM_CMD_CHAT, line);
+    else
+        send_to_client(client, "You are in the lobby. No chat here.\n");
+    return LINE_OK;
+}
+
+static const CommandHandler command_handlers[CMD_COUNT] = {
+    [CMD_CREATE]  = cmd_create,
+    [CMD_JOIN]    = cmd_join,
+    [CMD_LIST]    = cmd_list,
+    [CMD_EXIT]    = cmd_exit,
+    [CMD_START]   = cmd_start,
+    [CMD_FIRE]    = cmd_fire,
+    [CMD_HIT]     = cmd_hit,
+    [CMD_MISS]    = cmd_miss,
+    [CMD_YOU_WIN] = cmd_you_win,
+    [CMD_BOARD0]  = cmd_board,
+    [CMD_BOARD1]  = cmd_board,
+    [CMD_BOARD_DELTA] = cmd_board_delta,
+    [CMD_CHAT]    = cmd_chat,
+};
+
+// Rola klienta według jego aktora. Miejsce w pokoju ustala aktor pokoju, który
+// sprawdza uprawnienia ponownie przy wykonaniu komendy.
+static int client_role(Client *client) {
+    if (client->room_id == -1)
+        return ROLE_LOBBY;
+    return __atomic_load_n(&client->seated, __ATOMIC_RELAXED) ? ROLE_PLAYER : ROLE_OBSERVER;
+}
+
+// Sprawdza uprawnienia roli klienta i wykonuje komendę
+static int dispatch_command(Client *client, int id, char *line, const char *args) {
+    metric_verb(id);
+    int role = client_role(client);
+    if (id == CMD_NONE || !command_allowed(&client_commands, id, role)) {
+        const CommandSpec *spec = &client_command_specs[id];
+        if (role == ROLE_LOBBY)
+            send_to_client(client, "Invalid command in lobby.\n");
+        else if (spec->denied && (spec->roles & ROLE_IN_ROOM))
+            send_to_client(client, spec->denied);
+        else
+            send_to_client(client, "Invalid command in room.\n");
+        return LINE_OK;
+    }
+    return command_handlers[id](client, line, args);
+}
+
+// Obsługuje ramkę binarną zalogowanego klienta. Ramka staje się tą samą komendą
+// co odpowiadająca jej linia tekstu, więc dalej protokoły się nie różnią.
+static int process_frame(Client *client, const unsigned char *frame, int length) {
+    char line[BUFFER_SIZE];
+    int op = frame[0];
+    switch (op) {
+    case PROTO_CHAT: {
+        const char *text;
+        int n = proto_chat_text(frame, length, &text);
+        if (n <= 0)
+            return LINE_OK;  // Pusta wiadomość, tak jak pusta linia, nie jest rozsyłana
+        if (n > (int)sizeof(line) - 1)
+            n = sizeof(line) - 1;
+        // Tekst trafi też do klientów tekstowych - znaki sterujące nie mogą go podzielić na linie
+        for (int i = 0; i < n; i++)
+            line[i] = ((unsigned char)text[i] < 0x20) ? ' ' : text[i];
+        line[n] = '\0';
+        return dispatch_command(client, CMD_CHAT, line, "");
+    }
+    case PROTO_FIRE:
+        snprintf(line, sizeof(line), "FIRE %d %d %s", frame[1], frame[2], client->username);
+        return dispatch_command(client, CMD_FIRE, line, line + 5);
+    case PROTO_HIT:
+        snprintf(line, sizeof(line), "HIT %d %d %s", frame[1], frame[2], client->username);
+        return dispatch_command(client, CMD_HIT, line, line + 4);
+    case PROTO_MISS:
+        snprintf(line, sizeof(line), "MISS %d %d %s", frame[1], frame[2], client->username);
+        return dispatch_command(client, CMD_MISS, line, line + 5);
+    case PROTO_BOARD: {
+        if (frame[1] > 1)
+            return LINE_OK;
+        int n = snprintf(line, sizeof(line), "BOARD%d ", frame[1]);
+        proto_unpack_board(frame, line + n);
+        line[n + PROTO_BOARD_CELLS] = '\0';
+        return dispatch_command(client, frame[1] ? CMD_BOARD1 : CMD_BOARD0, line, line + n);
+    }
+    case PROTO_BOARD_DELTA: {
+        int board;
+        unsigned version;
+        char cells[PROTO_DELTA_TEXT];
+        if (proto_unpack_delta(frame, length, &board, &version, cells) < 0 || board > 1)
+            return LINE_OK;
+        snprintf(line, sizeof(line), "BOARD_DELTA %d %u %s", board, version, cells);
+        return dispatch_command(client, CMD_BOARD_DELTA, line, line + 12);
+    }
+    default:
+        return dispatch_command(client, CMD_NONE, NULL, NULL);
+    }
+}
+
+// Obsługuje jedną linię (komendę lub wiadomość czatu) od zalogowanego klienta.
+// Wykonywane przez aktora klienta w puli wątków.
+static int process_line(Client *client, char *buffer, int length) {
+    if (length == 0)
+        return LINE_OK;
+    if (client->binary && proto_is_frame((unsigned char)buffer[0])) {
+        __atomic_store_n(&client->last_command, now_ticks(), __ATOMIC_RELAXED);
+        return process_frame(client, (const unsigned char *)buffer, length);
+    }
+    const char *args;
+    int id = command_find(&client_commands, buffer, &args);
+    // Odpowiedź na heartbeat nie jest aktywnością użytkownika
+    if (id == CMD_PONG)
+        return LINE_OK;
+    __atomic_store_n(&client->last_command, now_ticks(), __ATOMIC_RELAXED);
+
+    printf("[SERVER DEBUG]: %s: %s\n", client->username, buffer);
+
+    // Linia bez znanego czasownika to wiadomość czatu, chyba że wygląda na komendę
+    if (id == CMD_NONE && buffer[0] != '/')
+        id = CMD_CHAT;
+    return dispatch_command(client, id, buffer, args);
+}
+
+// ==================== Aktor Klienta ====================
+// Reaktor tylko dzieli strumień na linie; linie zalogowanego klienta trafiają do jego
+// skrzynki i są wykonywane w puli wątków (wątek domowy wynika z numeru gniazda).
+
+// Planuje aktora klienta w puli, jeśli nie jest już zaplanowany
+static void client_schedule(Client *client) {
+    int expected = 0;
+    if (__atomic_compare_exchange_n(&client->scheduled, &expected, 1, 0,
+                                    __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        client_get(client);  // Referencja zaplanowanego aktora
+        pool_submit(&pool, &client->task);
+    }
+}
+
+// Pokój wykonał komendę klienta - aktor klienta może przejść do kolejnej linii
+static void client_continue(Client *client) {
+    __atomic_store_n(&client->awaiting_room, 0, __ATOMIC_SEQ_CST);
+    if (!ring_mailbox_empty(&client->lines))
+        client_schedule(client);
+}
+
+static void client_task_run(Task *task) {
+    Client *client = (Client *)((char *)task - offsetof(Client, task));
+    InputLine *line;
+    while (!__atomic_load_n(&client->awaiting_room, __ATOMIC_SEQ_CST) &&
+           (line = ring_mailbox_pop(&client->lines)) != NULL) {
+        // Linie rozłączonego klienta odrzucamy
+        if (__atomic_load_n(&client->active, __ATOMIC_SEQ_CST)) {
+            current_input_ns = line->recv_ns;
+            if (process_line(client, line->data, line->length) == LINE_CLOSE)
+                client_shutdown(client);
+            current_input_ns = 0;
+        }
+        free(line);
+    }
+    __atomic_store_n(&client->scheduled, 0, __ATOMIC_SEQ_CST);
+    // Linie mogły dojść po ostatnim sprawdzeniu, a pokój mógł właśnie zdjąć awaiting_room
+    if (!__atomic_load_n(&client->awaiting_room, __ATOMIC_SEQ_CST) &&
+        !ring_mailbox_empty(&client->lines))
+        client_schedule(client);
+    client_put(client);
+}
+
+// Przekazuje linię (lub ramkę) zalogowanego klienta do jego aktora. Wywoływane przez reaktor.
+static void client_post_line(Client *client, const char *line, int length) {
+    InputLine *copy = malloc(sizeof(InputLine) + length + 1);
+    if (copy) {
+        copy->length = length;
+        copy->recv_ns = trace_enabled() ? trace_now_ns() : 0;
+        memcpy(copy->data, line, length);
+        copy->data[length] = '\0';
+    }
+    metric_observe(HIST_CLIENT_MAILBOX_DEPTH, ring_mailbox_depth(&client->lines));
+    if (!copy || !ring_mailbox_push(&client->lines, copy)) {
+        if (copy)
+            metric_inc(MET_MAILBOX_FULL);
+        free(copy);
+        send_to_client(client, "Server busy, command dropped.\n");
+        return;
+    }
+    client_schedule(client);
+}
+
+// Przetwarza wszystkie kompletne linie z bufora wejściowego klienta. Handshake
+// obsługuje reaktor, komendy zalogowanego klienta wykonuje pula wątków.
+static void client_process_input(Client *client) {
+    char line[BUFFER_SIZE];
+    while (1) {
+        int line_start = client->in_start;
+        int len = client_next_line(client, line, sizeof(line));
+        if (len < 0)
+            return;
+        if (client->state == CONN_READY) {
+            client_post_line(client, line, len);
+            continue;
+        }
+        int rc = process_handshake_line(&client, line);
+        if (rc == LINE_CLOSE) {
+            close_client(client);
+            return;
+        }
+        if (rc == LINE_HANDOFF) {
+            // Linię obsłuży reaktor docelowy - cofamy ją do bufora przed przekazaniem
+            client->in_start = line_start;
+            reactor_handoff(client, client->handoff_target);
+            return;
+        }
+    }
+}
+
+// Odczytuje dostępne dane z gniazda klienta i obsługuje kompletne linie
+static void client_on_readable(Client *client) {
+    if (client->in_start > 0) {
+        int avail = client->in_end - client->in_start;
+        memmove(client->inbuf, client->inbuf + client->in_start, avail);
+        client->in_start = 0;
+        client->in_end = avail;
+    }
+    int n = recv(client->socket, client->inbuf + client->in_end,
+                 sizeof(client->inbuf) - client->in_end, 0);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        close_client(client);
+        return;
+    }
+    if (n > 0) {
+        capture_record(CAPTURE_IN, client->capture_conn, client->inbuf + client->in_end, n);
+        metric_add(MET_BYTES_IN, n);
+        client->in_end += n;
+        client->last_seen = current_reactor->wheel.now;
+    }
+    client_process_input(client);
+}
+
+// Uzbraja lub anuluje zegary tur i zegary aktualizacji obserwatorów, o które poprosili aktorzy pokoi
+static void reactor_apply_timer_requests(Reactor *r) {
+    MailboxNode *node = mailbox_drain(&r->timer_requests);
+    while (node) {
+        MailboxNode *next = node->next;
+        ChatRoom *room = (ChatRoom *)((char *)node - offsetof(ChatRoom, timer_node));
+        // Zdejmujemy flagę przed odczytem żądania - nowsze żądanie wstawi pokój ponownie
+        __atomic_store_n(&room->timer_queued, 0, __ATOMIC_SEQ_CST);
+        unsigned long gen = __atomic_load_n(&room->turn_request, __ATOMIC_SEQ_CST);
+        if (!gen) {
+            cancel_timer(&room->turn_timer);
+        } else if (gen != room->turn_timer_gen) {
+            // Ta sama generacja to żądanie obserwatorów - zegar tury zostaje, jak był
+            room->turn_timer_gen = gen;
+            schedule_timer(&room->turn_timer, TURN_TIMEOUT, turn_timeout_cb, room);
+        }
+        if (__atomic_exchange_n(&room->observer_request, 0, __ATOMIC_SEQ_CST) &&
+            !timer_pending(&room->observer_timer))
+            timer_wheel_arm(&r->wheel, &room->observer_timer, OBSERVER_UPDATE_TICKS, observer_timer_cb, room);
+        node = next;
+    }
+}
+
+// Przejmuje klientów przekazanych przez inne reaktory i żądania zegarów tur
+static void reactor_drain_inbox(Reactor *r) {
+    MailboxNode *node = mailbox_drain(&r->inbox);
+    while (node) {
+        MailboxNode *next = node->next;
+        Client *client = (Client *)((char *)node - offsetof(Client, handoff_node));
+        if (client->held) {
+            // Trzymana sesja przejęta od poprzedniego procesu (gorący restart) - sam zegar wznowienia
+            schedule_timer(&client->grace_timer, RESUME_GRACE, grace_timeout_cb, client);
+            node = next;
+            continue;
+        }
+        if (io_backend == IO_URING) {
+            client_get(client);  // Linia RESUME może przekazać połączenie sesji i zwolnić 'client'
+            client_arm_timers(client);
+            client_process_input(client);  // Najpierw linia, która spowodowała przekazanie
+            if (client->socket >= 0 && !client->recv_armed && !client->handoff_target)
+                uring_arm_recv(r, client);
+            client_put(client);
+            node = next;
+            continue;
+        }
+        struct epoll_event ev;
+        ev.events = EPOLLIN | (client->want_write ? EPOLLOUT : 0);
+        ev.data.ptr = client;
+        if (epoll_ctl(r->epoll_fd, EPOLL_CTL_ADD, client->socket, &ev) < 0) {
+            perror("[REACTOR] epoll_ctl handoff");
+            close_client(client);
+        } else {
+            client_arm_timers(client);
+            client_process_input(client);  // Najpierw linia, która spowodowała przekazanie
+        }
+        node = next;
+    }
+    reactor_apply_timer_requests(r);
+}
+
+// Tworzy strukturę połączenia 'fd' należącego do reaktora 'r' (stan: handshake)
+static Client *client_new(Reactor *r, int fd) {
+    Client *client = calloc(1, sizeof(Client));  // Zera = timery nieuzbrojone
+    if (!client)
+        return NULL;
+    client->socket = fd;
+    client->refs = 1;  // Referencja sesji
+    pthread_mutex_init(&client->out_lock, NULL);
+    ring_mailbox_init(&client->lines);
+    client->task.run = client_task_run;
+    client->task.home = fd;
+    client->room_id = -1;
+    client->tlv_socket = -1;
+    client->state = CONN_HANDSHAKE;
+    client->reactor = r;
+    client->last_seen = r->wheel.now;
+    client->fixed_slot = -1;
+    client->capture_conn = capture_new_conn();
+    capture_record(CAPTURE_OPEN, client->capture_conn, NULL, 0);
+    return client;
+}
+
+// Rejestruje nowe połączenie w reaktorze i wysyła prośbę o nazwę użytkownika.
+// 'addr' może być NULL (wielokrotny accept io_uring nie zwraca adresu).
+static void reactor_add_client(Reactor *r, int fd, const struct sockaddr_in *addr) {
+    Client *new_client = client_new(r, fd);
+    if (!new_client) {
+        close(fd);
+        return;
+    }
+    if (addr)
+        new_client->address = *addr;
+    metric_inc(MET_CONN_ACCEPTED);
+    // Buforowaniem i łączeniem wysyłek zajmuje się serwer (bufory wyjściowe, tick pokoju),
+    // więc Nagle tylko by dokładał opóźnienie: odpowiedź wysłana zaraz po poprzedniej
+    // czekałaby na opóźnione potwierdzenie TCP klienta (~40 ms na turę). TCP_CORK nie jest
+    // potrzebny: koniec ticku to jeden send całego bufora.
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (io_backend == IO_URING) {
+        uring_arm_recv(r, new_client);
+    } else {
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = new_client;
+        if (epoll_ctl(r->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            perror("[REACTOR] epoll_ctl accept");
+            close(fd);
+            client_put(new_client);
+            return;
+        }
+    }
+    pending_conn_add(new_client);
+    printf("[SERVER] Sending: Enter your username:\n");
+    send_to_client(new_client, "Enter your username:\n");
+    // Twardy termin na handshake (nie odnawia się przy każdym bajcie)
+    client_arm_timers(new_client);
+}
+
+// Przyjmuje wszystkie oczekujące połączenia z gniazda nasłuchującego reaktora
+static void reactor_accept(Reactor *r) {
+    while (1) {
+        struct sockaddr_in addr;
+        socklen_t addr_len = sizeof(addr);
+        int fd = accept4(r->listen_fd, (struct sockaddr *)&addr, &addr_len,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                perror("Accept failed");
+            return;
+        }
+        reactor_add_client(r, fd, &addr);
+    }
+}
+
+// Tick łączenia (--coalesce): pierwsza wstrzymana wysyłka otwiera tick, a po coalesce_ms
+// reaktor wysyła każdemu klientowi z kolejki wszystko, co się zebrało, jednym send.
+// Zwraca, ile ms pętla może czekać na zdarzenia.
+static int reactor_coalesce_tick(Reactor *r) {
+    if (!coalesce_ms)
+        return TIMER_TICK_MS;
+    unsigned long long now = discovery_now_ms();
+    if (r->cork_deadline && now >= r->cork_deadline) {
+        r->cork_deadline = 0;
+        MailboxNode *node = mailbox_drain(&r->cork_queue);
+        while (node) {
+            MailboxNode *next = node->next;
+            Client *client = (Client *)((char *)node - offsetof(Client, cork_node));
+            MUTEX_LOCK(&client->out_lock);
+            client->cork_queued = 0;
+            if (client->corked) {
+                client->corked = 0;
+                client_send_buffered_locked(client);
+            }
+            MUTEX_UNLOCK(&client->out_lock);
+            client_put(client);  // Referencja kolejki ticku
+            node = next;
+        }
+    }
+    if (mailbox_empty(&r->cork_queue))
+        return TIMER_TICK_MS;
+    if (!r->cork_deadline)
+        r->cork_deadline = now + coalesce_ms;
+    return (int)(r->cork_deadline - now);
+}
+
+// Pętla zdarzeń reaktora na epoll. Timeout epoll_wait napędza koło czasowe reaktora
+// (i tick łączenia wysyłek).
+static void reactor_run_epoll(Reactor *r) {
+    struct epoll_event events[EPOLL_BATCH];
+    while (1) {
+        int n = epoll_wait(r->epoll_fd, events, EPOLL_BATCH, reactor_coalesce_tick(r));
+        if (n < 0 && errno != EINTR) {
+            perror("[REACTOR] epoll_wait");
+            break;
+        }
+        if (__atomic_load_n(&handoff_frozen, __ATOMIC_ACQUIRE)) {
+            // Gorący restart: zdarzenia zostają w jądrze (epoll poziomowy) dla następcy
+            handoff_park();
+            continue;
+        }
+        for (int i = 0; i < n; i++) {
+            void *ptr = events[i].data.ptr;
+            if (ptr == &r->listen_fd) {
+                reactor_accept(r);
+            } else if (ptr == &udp_sock) {
+                discovery_on_readable();
+            } else if (ptr == &cluster_sock) {
+                cluster_on_readable();
+            } else if (ptr == &signal_fd) {
+                signal_on_readable();
+            } else if (ptr == &r->wake_fd) {
+                unsigned long long counter;
+                if (read(r->wake_fd, &counter, sizeof(counter)) < 0 && errno != EAGAIN)
+                    perror("[REACTOR] eventfd read");
+                reactor_drain_inbox(r);
+            } else {
+                Client *client = (Client *)ptr;
+                if (events[i].events & EPOLLOUT)
+                    client_flush(client);
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                    client_on_readable(client);
+            }
+        }
+        timer_wheel_advance(&r->wheel, now_ticks());
+    }
+}
+
+// ==================== Backend io_uring ====================
+// Reaktor z --io uring nie wykonuje wywołań systemowych na pojedyncze zdarzenie:
+// accept i recv są wielokrotne (jedno zgłoszenie na całe życie gniazda), recv
+// dostaje bufory z pierścienia buforów reaktora, a wysyłki do wszystkich klientów,
+// do których pisano od ostatniego obiegu (np. rozgłoszenie strzału w pokoju), idą
+// do jądra razem z oczekiwaniem na zdarzenia - jednym io_uring_enter.
+
+// Dokłada odebrane dane do bufora wejściowego i obsługuje kompletne linie.
+// Porcja z pierścienia buforów może być większa niż wolne miejsce - wtedy w częściach.
+static void uring_client_input(Client *client, const char *data, int len) {
+    client->last_seen = current_reactor->wheel.now;
+    capture_record(CAPTURE_IN, client->capture_conn, data, len);
+    metric_add(MET_BYTES_IN, len);
+    while (len > 0 && client->socket >= 0) {
+        if (client->in_start > 0) {
+            int avail = client->in_end - client->in_start;
+            memmove(client->inbuf, client->inbuf + client->in_start, avail);
+            client->in_start = 0;
+            client->in_end = avail;
+        }
+        int space = (int)sizeof(client->inbuf) - client->in_end;
+        if (space == 0)
+            break;  // Tylko przy przekazaniu: połączenie zalewa nas danymi przed RESUME
+        int n = len < space ? len : space;
+        memcpy(client->inbuf + client->in_end, data, n);
+        client->in_end += n;
+        data += n;
+        len -= n;
+        // W trakcie przekazania linie obsłuży reaktor docelowy
+        if (!client->handoff_target)
+            client_process_input(client);
+    }
+}
+
+// Kończy przekazanie połączenia, gdy jego recv na tym reaktorze już się zakończył
+static void uring_finish_handoff(Reactor *r, Client *client) {
+    Reactor *target = client->handoff_target;
+    client->handoff_target = NULL;
+    uring_release_slot(r, client);
+    client->reactor = target;
+    if (mailbox_push(&target->inbox, &client->handoff_node) && target != r)
+        reactor_wake(target);
+}
+
+static void uring_on_recv(Reactor *r, Client *client, int res, unsigned flags) {
+    if (flags & IORING_CQE_F_BUFFER) {
+        unsigned short bid = (unsigned short)(flags >> IORING_CQE_BUFFER_SHIFT);
+        if (res > 0 && client->socket >= 0)
+            uring_client_input(client, uring_buf_data(&r->ring, bid), res);
+        uring_buf_recycle(&r->ring, bid);
+    }
+    if (flags & IORING_CQE_F_MORE)
+        return;
+    // Ostatnie CQE tego recv
+    client->recv_armed = 0;
+    if (client->socket >= 0) {
+        int alive = res > 0 || res == -ENOBUFS;  // Brak wolnego bufora - uzbrajamy ponownie
+        if (client->handoff_target && (alive || res == -ECANCELED)) {
+            uring_finish_handoff(r, client);
+        } else if (alive) {
+            uring_arm_recv(r, client);
+        } else {
+            close_client(client);  // EOF lub błąd (np. shutdown z client_shutdown)
+        }
+    }
+    client_put(client);  // Referencja recv
+}
+
+// Wysyła kolejną porcję danych klienta albo kończy wysyłkę (i zwalnia jej referencję).
+// Dopisywane w międzyczasie dane czekają w outbuf; sendbuf należy do jądra do zakończenia.
+static void uring_start_send(Reactor *r, Client *client) {
+    if (client->reactor != r) {
+        uring_queue_send(client);  // Połączenie przekazane innemu reaktorowi
+        return;
+    }
+    MUTEX_LOCK(&client->out_lock);
+    if (client->socket >= 0 && client->send_off == client->send_len && client->out_len > 0) {
+        char *buf = client->sendbuf;
+        size_t cap = client->send_cap;
+        client->sendbuf = client->outbuf;
+        client->send_cap = client->out_cap;
+        client->send_len = client->out_len;
+        client->send_off = 0;
+        client->outbuf = buf;
+        client->out_cap = cap;
+        client->out_len = 0;
+    }
+    if (client->socket < 0 || client->send_off == client->send_len) {
+        client->send_busy = 0;
+        MUTEX_UNLOCK(&client->out_lock);
+        client_put(client);  // Referencja wysyłki
+        return;
+    }
+    struct io_uring_sqe *sqe = uring_get_sqe(&r->ring);
+    int fixed = client->fixed_slot >= 0;
+    uring_prep_send(sqe, fixed ? client->fixed_slot : client->socket, fixed,
+                    client->sendbuf + client->send_off, client->send_len - client->send_off,
+                    MSG_NOSIGNAL, (unsigned long)client | URING_OP_SEND);
+    MUTEX_UNLOCK(&client->out_lock);
+}
+
+static void uring_on_send(Reactor *r, Client *client, int res) {
+    MUTEX_LOCK(&client->out_lock);
+    if (res < 0) {
+        // Zerwane połączenie - zamknie je ścieżka odczytu, zaległe dane przepadają
+        client->send_off = client->send_len;
+        client->out_len = 0;
+    } else {
+        client->send_off += res;
+        if (client->send_off > client->send_len)
+            client->send_off = client->send_len;  // Wysyłka sprzed zamknięcia połączenia
+    }
+    MUTEX_UNLOCK(&client->out_lock);
+    uring_start_send(r, client);
+}
+
+// Zgłasza wysyłki wszystkich klientów z kolejki reaktora
+static void uring_drain_sends(Reactor *r) {
+    MailboxNode *node = mailbox_drain(&r->send_queue);
+    while (node) {
+        MailboxNode *next = node->next;
+        uring_start_send(r, (Client *)((char *)node - offsetof(Client, send_node)));
+        node = next;
+    }
+}
+
+static void uring_arm_accept(Reactor *r) {
+    struct io_uring_sqe *sqe = uring_get_sqe(&r->ring);
+    uring_prep_accept_multishot(sqe, r->listen_fd, SOCK_NONBLOCK | SOCK_CLOEXEC, URING_UD_ACCEPT);
+}
+
+// Wielokrotny poll gniazda discovery - datagramy odbiera recvmmsg w discovery_on_readable
+static void uring_arm_discovery(Reactor *r) {
+    struct io_uring_sqe *sqe = uring_get_sqe(&r->ring);
+    uring_prep_poll_multishot(sqe, udp_sock, POLLIN, URING_UD_DISCOVERY);
+}
+
+static void uring_arm_cluster(Reactor *r) {
+    struct io_uring_sqe *sqe = uring_get_sqe(&r->ring);
+    uring_prep_poll_multishot(sqe, cluster_sock, POLLIN, URING_UD_CLUSTER);
+}
+
+static void uring_arm_signal(Reactor *r) {
+    struct io_uring_sqe *sqe = uring_get_sqe(&r->ring);
+    uring_prep_poll_multishot(sqe, signal_fd, POLLIN, URING_UD_SIGNAL);
+}
+
+static void uring_arm_wake(Reactor *r) {
+    struct io_uring_sqe *sqe = uring_get_sqe(&r->ring);
+    uring_prep_read(sqe, r->wake_fd, &r->wake_count, sizeof(r->wake_count), URING_UD_WAKE);
+}
+
+static void uring_handle_cqe(Reactor *r, unsigned long long user_data, int res, unsigned flags) {
+    if (user_data >= URING_UD_COUNT) {
+        Client *client = (Client *)(unsigned long)(user_data & ~URING_TAG_MASK);
+        int op = (int)(user_data & URING_TAG_MASK);
+        if (op == URING_OP_RECV)
+            uring_on_recv(r, client, res, flags);
+        else if (op == URING_OP_SEND)
+            uring_on_send(r, client, res);
+        return;
+    }
+    int tag = (int)user_data;
+    if (tag == URING_UD_ACCEPT) {
+        if (res >= 0)
+            reactor_add_client(r, res, NULL);
+        else if (res != -EINTR && res != -ECONNABORTED && res != -EAGAIN)
+            fprintf(stderr, "[URING] accept: %s\n", strerror(-res));
+        if (!(flags & IORING_CQE_F_MORE))
+            uring_arm_accept(r);
+    } else if (tag == URING_UD_WAKE) {
+        uring_arm_wake(r);  // Skrzynki opróżnia pętla po obsłużeniu zakończeń
+    } else if (tag == URING_UD_DISCOVERY) {
+        discovery_on_readable();
+        if (!(flags & IORING_CQE_F_MORE))
+            uring_arm_discovery(r);
+    } else if (tag == URING_UD_CLUSTER) {
+        cluster_on_readable();
+        if (!(flags & IORING_CQE_F_MORE))
+            uring_arm_cluster(r);
+    } else if (tag == URING_UD_SIGNAL) {
+        signal_on_readable();
+        if (!(flags & IORING_CQE_F_MORE))
+            uring_arm_signal(r);
+    }
+}
+
+// Pętla zdarzeń reaktora na io_uring. Timeout io_uring_enter napędza koło czasowe (i tick łączenia).
+static void reactor_run_uring(Reactor *r) {
+    Uring *ring = &r->ring;
+    uring_arm_accept(r);
+    uring_arm_wake(r);
+    if (r->id == 0 && udp_sock >= 0)
+        uring_arm_discovery(r);
+    if (r->id == 0 && cluster_sock >= 0)
+        uring_arm_cluster(r);
+    if (r->id == 0 && signal_fd >= 0)
+        uring_arm_signal(r);
+    while (1) {
+        struct io_uring_cqe *cqe;
+        while ((cqe = uring_peek_cqe(ring)) != NULL) {
+            unsigned long long user_data = cqe->user_data;
+            int res = cqe->res;
+            unsigned flags = cqe->flags;
+            uring_cqe_seen(ring);
+            uring_handle_cqe(r, user_data, res, flags);
+        }
+        timer_wheel_advance(&r->wheel, now_ticks());
+        int timeout = reactor_coalesce_tick(r);  // Koniec ticku dokłada wysyłki do kolejki
+        reactor_drain_inbox(r);
+        uring_drain_sends(r);
+
+        // Zanim zaśniemy, piszący z innych wątków muszą wiedzieć, że trzeba nas obudzić
+        __atomic_store_n(&r->sleeping, 1, __ATOMIC_SEQ_CST);
+        int idle = mailbox_empty(&r->send_queue) && mailbox_empty(&r->inbox) &&
+                   mailbox_empty(&r->timer_requests) && !uring_peek_cqe(ring);
+        int ret = uring_submit_and_wait(ring, idle, timeout);
+        __atomic_store_n(&r->sleeping, 0, __ATOMIC_SEQ_CST);
+        if (ret < 0 && ret != -ETIME && ret != -EINTR && ret != -EBUSY) {
+            fprintf(stderr, "[URING] io_uring_enter: %s\n", strerror(-ret));
+            break;
+        }
+    }
+}
+
+// Sprawdza, czy jądro obsługuje wszystko, czego potrzebuje backend io_uring.
+// Zwraca 0 albo -errno.
+static int uring_probe(void) {
+    Uring ring;
+    int ret = uring_init(&ring, 8, 16);
+    if (ret < 0)
+        return ret;
+    ret = uring_setup_buf_ring(&ring, 8, 64);
+    if (ret == 0)
+        ret = uring_register_file_table(&ring, 8);
+    close(ring.fd);
+    uring_unmap(&ring);
+    if (ring.buf_ring) {
+        munmap(ring.buf_ring, ring.buf_ring_size);
+        free(ring.buf_data);
+    }
+    return ret;
+}
+
+// Wątek reaktora
+static void *reactor_loop(void *arg) {
+    Reactor *r = (Reactor *)arg;
+    current_reactor = r;
+    if (pin_reactors) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(r->id % sysconf(_SC_NPROCESSORS_ONLN), &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+            fprintf(stderr, "[REACTOR %d] Failed to set CPU affinity\n", r->id);
+    }
+    if (r->id == 0 && cluster_sock >= 0) {
+        timer_init(&cluster_timer);
+        cluster_announce(&cluster_timer, NULL);  // Pierwsze ogłoszenie od razu, kolejne z koła
+    }
+    if (io_backend == IO_URING)
+        reactor_run_uring(r);
+    else
+        reactor_run_epoll(r);
+    return NULL;
+}
+
+// Tworzy gniazdo nasłuchujące reaktora. SO_REUSEPORT pozwala każdemu reaktorowi mieć
+// własne gniazdo na SERVER_PORT - jądro rozkłada między nie nowe połączenia.
+static int create_listener(void) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("TCP socket creation failed");
+        exit(EXIT_FAILURE);
+    }
+
+    int opt = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+        perror("setsockopt SO_REUSEADDR failed");
+        exit(EXIT_FAILURE);
+    }
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        perror("setsockopt SO_REUSEPORT failed");
+        exit(EXIT_FAILURE);
+    }
+
+    struct sockaddr_in server_address;
+    memset(&server_address, 0, sizeof(server_address));
+    server_address.sin_family = AF_INET;
+    server_address.sin_addr.s_addr = INADDR_ANY;
+    server_address.sin_port = htons(server_port);
+
+    if (bind(fd, (struct sockaddr *)&server_address, sizeof(server_address)) < 0) {
+        perror("Bind failed");
+        close(fd);
+        exit(EXIT_FAILURE);
+    }
+
+    // TCP Fast Open: HELLO klienta może przyjść już w segmencie SYN
+    int tfo_queue = TCP_FASTOPEN_QUEUE;
+    if (setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN, &tfo_queue, sizeof(tfo_queue)) < 0)
+        perror("setsockopt TCP_FASTOPEN (continuing without it)");
+
+    if (listen(fd, SOMAXCONN) < 0) {
+        perror("Listen failed");
+        close(fd);
+        exit(EXIT_FAILURE);
+    }
+    return fd;
+}
+
+// Przygotowuje reaktor: epoll albo pierścień io_uring, gniazdo nasłuchujące,
+// eventfd skrzynki i koło czasowe
+static void reactor_init(Reactor *r, int id) {
+    r->id = id;
+    r->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (r->wake_fd < 0) {
+        perror("[REACTOR] eventfd");
+        exit(EXIT_FAILURE);
+    }
+    // Po gorącym restarcie reaktor przejmuje gniazdo poprzednika (połączenia czekające na accept zostają)
+    r->listen_fd = id < inherited_listener_count ? inherited_listeners[id] : create_listener();
+    mailbox_init(&r->inbox);
+    mailbox_init(&r->timer_requests);
+    mailbox_init(&r->send_queue);
+    mailbox_init(&r->cork_queue);
+    timer_wheel_init(&r->wheel, now_ticks());
+
+    if (io_backend == IO_URING) {
+        int ret = uring_init(&r->ring, URING_ENTRIES, URING_CQ_ENTRIES);
+        if (ret == 0)
+            ret = uring_setup_buf_ring(&r->ring, URING_RECV_BUFFERS, URING_RECV_BUF_SIZE);
+        if (ret == 0)
+            ret = uring_register_file_table(&r->ring, URING_FILE_SLOTS);
+        if (ret < 0) {
+            fprintf(stderr, "[REACTOR] io_uring setup failed: %s\n", strerror(-ret));
+            exit(EXIT_FAILURE);
+        }
+        r->epoll_fd = -1;
+        return;
+    }
+
+    r->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (r->epoll_fd < 0) {
+        perror("[REACTOR] epoll_create1");
+        exit(EXIT_FAILURE);
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = &r->listen_fd;
+    epoll_ctl(r->epoll_fd, EPOLL_CTL_ADD, r->listen_fd, &ev);
+    ev.events = EPOLLIN;
+    ev.data.ptr = &r->wake_fd;
+    epoll_ctl(r->epoll_fd, EPOLL_CTL_ADD, r->wake_fd, &ev);
+    if (id == 0 && udp_sock >= 0) {
+        ev.events = EPOLLIN;
+        ev.data.ptr = &udp_sock;
+        epoll_ctl(r->epoll_fd, EPOLL_CTL_ADD, udp_sock, &ev);
+    }
+    if (id == 0 && cluster_sock >= 0) {
+        ev.events = EPOLLIN;
+        ev.data.ptr = &cluster_sock;
+        epoll_ctl(r->epoll_fd, EPOLL_CTL_ADD, cluster_sock, &ev);
+    }
+    if (id == 0 && signal_fd >= 0) {
+        ev.events = EPOLLIN;
+        ev.data.ptr = &signal_fd;
+        epoll_ctl(r->epoll_fd, EPOLL_CTL_ADD, signal_fd, &ev);
+    }
+}
+
+// ==================== Replikacja ====================
+// Z --replicate HOST:PORT serwer główny wysyła serwerowi zapasowemu (--standby PORT) dziennik
+// zmian pokoi (replikacja.h). Aktor pokoju dopisuje różnice do bufora w pamięci pod krótką
+// blokadą, a osobny wątek co REPL_BATCH_MS wysyła zebrane rekordy jednym zapisem - gra nigdy
+// nie czeka na sieć do serwera zapasowego. Gdy bufor się przepełni (zapasowy nie nadąża)
+// albo połączenie zostanie nawiązane od nowa, strumień zaczyna się od RESET i pełnego stanu.
+//
+// Serwer zapasowy trzyma kopie pokoi i sesji graczy jako sesje trzymane do wznowienia, ale
+// nie przyjmuje klientów. Gdy strumień się urwie (albo milczy REPL_TIMEOUT_MS), przejmuje
+// gry: sesje dostają RESUME_GRACE na powrót, a klient, który przy handshake dostał
+// "STANDBY <adres>:<port>", wznawia na nim sesję tym samym tokenem.
+
+#define REPL_BUFFER          (1024 * 1024)  // Dziennik czekający na wysłanie (przepełnienie = pełny stan od nowa)
+#define REPL_READ_BUFFER     (64 * 1024)
+#define REPL_BATCH_MS        2              // Co ile wątek replikacji wysyła zebrane rekordy
+#define REPL_HEARTBEAT_MS    500            // HEARTBEAT, gdy przez tyle ms nie było rekordów
+#define REPL_TIMEOUT_MS      3000           // Milczenie serwera głównego => przejęcie gier
+#define REPL_SEND_TIMEOUT    2              // Zablokowany zapis (s) => zerwanie połączenia
+
+pthread_mutex_t repl_mutex = PTHREAD_MUTEX_INITIALIZER;  // Dziennik i obrazy pokoi; brana bez innych blokad
+
+static ReplLog repl_log;                    // Rekordy czekające na wątek replikacji
+static int repl_overflow;                   // Bufor przepełniony - trzeba wysłać pełny stan
+static int repl_live;                       // Serwer zapasowy połączony - aktorzy pokoi piszą do dziennika
+static unsigned repl_epoch;                 // Numer strumienia (rośnie przy każdym RESET)
+static unsigned repl_next_sid;              // Ostatni nadany numer sesji
+static ReplRoomState repl_shadow[MAX_ROOMS];  // Ostatnio wysłany obraz każdego pokoju
+
+// "STANDBY <adres>:<port>\n" dla klientów albo pusty napis, gdy serwera zapasowego nie ma
+static int standby_line(char *out, size_t size) {
+    int port = __atomic_load_n(&standby_client_port, __ATOMIC_ACQUIRE);
+    if (!port) {
+        out[0] = '\0';
+        return 0;
+    }
+    return snprintf(out, size, "STANDBY %s:%d\n", replicate_host, port);
+}
+
+// Dopisuje do dziennika zmiany pokoju od ostatnio wysłanego obrazu. Wywoływane przez
+// aktora pokoju po każdej komendzie.
+static void replica_capture(ChatRoom *room) {
+    if (!__atomic_load_n(&repl_live, __ATOMIC_ACQUIRE))
+        return;
+    ReplRoomState cur;
+    memset(&cur, 0, sizeof(cur));
+    cur.in_use = room->in_use ? 1 : 0;
+    if (cur.in_use) {
+        cur.started = room->gameStarted ? 1 : 0;
+        cur.turn = (unsigned char)room->current_turn;
+        cur.ready[0] = room->playerReady[0] ? 1 : 0;
+        cur.ready[1] = room->playerReady[1] ? 1 : 0;
+        snprintf(cur.creator, sizeof(cur.creator), "%s", room->creator);
+        memcpy(cur.board[0], room->boardPlayer0, REPL_BOARD_CELLS);
+        memcpy(cur.board[1], room->boardPlayer1, REPL_BOARD_CELLS);
+    }
+    MUTEX_LOCK(&repl_mutex);
+    ReplRoomState *old = &repl_shadow[room->id];
+    if (old->epoch != repl_epoch) {
+        memset(old, 0, sizeof(*old));  // Nowy strumień - pokój jedzie w całości
+        old->epoch = repl_epoch;
+    }
+    cur.epoch = repl_epoch;
+    int full = 0;
+    for (int p = 0; p < 2 && cur.in_use; p++) {
+        Client *c = room->clients[p];
+        if (!c)
+            continue;
+        if (!c->repl_sid)
+            c->repl_sid = ++repl_next_sid;
+        cur.seat[p] = c->repl_sid;
+        if (cur.seat[p] != old->seat[p] &&
+            repl_put_session(&repl_log, c->repl_sid, c->resume_token, c->username) < 0)
+            full = 1;
+    }
+    if (full || repl_put_diff(&repl_log, room->id, old, &cur) < 0)
+        repl_overflow = 1;
+    *old = cur;
+    MUTEX_UNLOCK(&repl_mutex);
+}
+
+// Zaczyna strumień od nowa: RESET, a potem pełny stan każdego zajętego pokoju
+static void replica_resync(void) {
+    MUTEX_LOCK(&repl_mutex);
+    repl_log.len = 0;
+    repl_overflow = 0;
+    repl_put_empty(&repl_log, REPL_RESET, 0);
+    repl_epoch++;
+    __atomic_store_n(&repl_live, 1, __ATOMIC_RELEASE);
+    MUTEX_UNLOCK(&repl_mutex);
+    MUTEX_LOCK(&rooms_mutex);
+    int count = room_count;
+    MUTEX_UNLOCK(&rooms_mutex);
+    for (int rid = 0; rid < count; rid++)
+        if (__atomic_load_n(&chat_rooms[rid].in_use, __ATOMIC_ACQUIRE))
+            room_post(&chat_rooms[rid], ROOM_CMD_REPLICATE, NULL, NULL);
+}
+
+// Łączy się z serwerem zapasowym i odbiera jego HELLO. Zwraca gniazdo albo -1.
+static int replica_connect(void) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(replicate_port);
+    if (inet_pton(AF_INET, replicate_host, &addr.sin_addr) <= 0)
+        return -1;
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    unsigned char hello[REPL_HEADER_LEN + 2];
+    struct pollfd p = { fd, POLLIN, 0 };
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || poll(&p, 1, REPL_TIMEOUT_MS) <= 0 ||
+        recv(fd, hello, sizeof(hello), MSG_WAITALL) != (ssize_t)sizeof(hello) || hello[0] != REPL_HELLO) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    struct timeval tv = { REPL_SEND_TIMEOUT, 0 };
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    __atomic_store_n(&standby_client_port, (int)repl_get_u16(hello + REPL_HEADER_LEN), __ATOMIC_RELEASE);
+    return fd;
+}
+
+// Podaje adres serwera zapasowego zalogowanym już klientom
+static void replica_announce_standby(void) {
+    char line[96];
+    if (!standby_line(line, sizeof(line)))
+        return;
+    MUTEX_LOCK(&clients_mutex);
+    for (int i = 0; i < client_count; i++)
+        if (clients[i]->active)
+            send_to_client(clients[i], line);
+    MUTEX_UNLOCK(&clients_mutex);
+}
 
-    // Po udanym handshake wysyłamy komunikat lobby
-    send_to_client(client->socket, WELCOME_IN_LOBBY);
+static int replica_write(int fd, const unsigned char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
 
-    while (1) {
-        memset(buffer, 0, sizeof(buffer));
-        int bytes_received = recv(client->socket, buffer, sizeof(buffer) - 1, 0);
-        if (bytes_received <= 0)
-            break;
-        buffer[bytes_received] = '\0';
-
-        printf("[SERVER DEBUG]: %s: %s\n", client->username, buffer);
-
-        // Obsługa aktualizacji planszy dla TLV
-        pthread_mutex_lock(&rooms_mutex);
-        if (strncmp(buffer, "BOARD0 ", 7) == 0 && client->room_id != -1) {
-            ChatRoom *r = get_room_by_id(client->room_id);
-            if (r) {
-                const char *dat = buffer + 7;
-                if (strlen(dat) >= 64) {
-                    memcpy(r->boardPlayer0, dat, 64);
-                    send_board_update_to_observers(r);
-                }
+// Wątek serwera głównego: co REPL_BATCH_MS zabiera dziennik i wysyła go serwerowi zapasowemu
+static void *replica_sender_thread(void *arg) {
+    (void)arg;
+    ReplLog out = { malloc(REPL_BUFFER), 0, REPL_BUFFER };
+    int sock = -1;
+    unsigned long long last_send = 0;
+    while (out.data) {
+        if (sock < 0) {
+            sock = replica_connect();
+            if (sock < 0) {
+                sleep(1);
+                continue;
             }
-            pthread_mutex_unlock(&rooms_mutex);
-            continue;
+            printf("[REPLICA] Replicating to the standby %s:%d (clients: port %d)\n",
+                   replicate_host, replicate_port, standby_client_port);
+            replica_resync();
+            replica_announce_standby();
         }
-        if (strncmp(buffer, "BOARD1 ", 7) == 0 && client->room_id != -1) {
-            ChatRoom *r = get_room_by_id(client->room_id);
-            if (r) {
-                const char *dat = buffer + 7;
-                if (strlen(dat) >= 64) {
-                    memcpy(r->boardPlayer1, dat, 64);
-                    send_board_update_to_observers(r);
-                }
-            }
-            pthread_mutex_unlock(&rooms_mutex);
+        struct timespec pause = { 0, REPL_BATCH_MS * 1000000L };
+        nanosleep(&pause, NULL);
+        MUTEX_LOCK(&repl_mutex);
+        unsigned char *spare = out.data;
+        out.data = repl_log.data;
+        out.len = repl_log.len;
+        repl_log.data = spare;
+        repl_log.len = 0;
+        int overflow = repl_overflow;
+        repl_overflow = 0;
+        MUTEX_UNLOCK(&repl_mutex);
+        if (overflow) {
+            printf("[REPLICA] Log buffer full, sending the standby a full state\n");
+            replica_resync();
             continue;
         }
-        pthread_mutex_unlock(&rooms_mutex);
-
-        if (buffer[0] != '/') {
-            if ((strncmp(buffer, "FIRE ", 5) != 0) &&
-                (strncmp(buffer, "HIT ", 4) != 0) &&
-                (strncmp(buffer, "MISS ", 5) != 0) &&
-                (strncmp(buffer, "YOU_WIN", 7) != 0))
-            {
-                pthread_mutex_lock(&rooms_mutex);
-                if (client->room_id != -1) {
-                    ChatRoom *room = get_room_by_id(client->room_id);
-                    if (!room) {
-                        send_to_client(client->socket, "Error: room not found.\n");
-                        client->room_id = -1;
-                        pthread_mutex_unlock(&rooms_mutex);
-                        continue;
-                    }
-                    int isPlayer = ((room->clients[0] == client) ||
-                                     (room->clients[1] == client));
-                    if (!isPlayer) {
-                        send_to_client(client->socket, "Observer cannot send messages.\n");
-                        pthread_mutex_unlock(&rooms_mutex);
-                        continue;
-                    }
-                    snprintf(msg, sizeof(msg), "%s: %s\n", client->username, buffer);
-                    broadcast_to_room(room, msg, -1);
-                } else {
-                    send_to_client(client->socket, "You are in the lobby. No chat here.\n");
-                }
-                pthread_mutex_unlock(&rooms_mutex);
+        unsigned long long now = discovery_now_ms();
+        if (out.len == 0) {
+            if (now - last_send < REPL_HEARTBEAT_MS)
                 continue;
-            }
+            repl_put_empty(&out, REPL_HEARTBEAT, 0);
         }
-
-        if (strncmp(buffer, "/exit", 5) == 0) {
-            pthread_mutex_lock(&rooms_mutex);
-            if (client->room_id != -1) {
-                ChatRoom *room = get_room_by_id(client->room_id);
-                if (room) {
-                    if (room->clients[0] == client)
-                        room->clients[0] = NULL;
-                    else if (room->clients[1] == client)
-                        room->clients[1] = NULL;
-                    else {
-                        for (int i = 0; i < room->observer_count; i++) {
-                            if (room->observers[i] == client) {
-                                for (int j = i; j < room->observer_count - 1; j++) {
-                                    room->observers[j] = room->observers[j+1];
-                                }
-                                room->observer_count--;
-                                break;
-                            }
-                        }
-                    }
-                }
-                client->room_id = -1;
-                send_to_client(client->socket, "You are now in the lobby.\n");
-                if (room->clients[0])
-                    send_to_client(room->clients[0]->socket, WELCOME_IN_LOBBY);
-            } else {
-                send_to_client(client->socket, "Goodbye.\n");
-                pthread_mutex_unlock(&rooms_mutex);
-                break;
-            }
-            pthread_mutex_unlock(&rooms_mutex);
+        if (replica_write(sock, out.data, out.len) < 0) {
+            printf("[REPLICA] Lost the standby %s:%d, reconnecting\n", replicate_host, replicate_port);
+            __atomic_store_n(&repl_live, 0, __ATOMIC_RELEASE);
+            __atomic_store_n(&standby_client_port, 0, __ATOMIC_RELEASE);
+            close(sock);
+            sock = -1;
             continue;
         }
+        last_send = now;
+    }
+    fprintf(stderr, "[REPLICA] Out of memory, replication disabled\n");
+    return NULL;
+}
 
-        if (client->room_id == -1) {
-            if (strncmp(buffer, "/create", 7) == 0) {
-                pthread_mutex_lock(&rooms_mutex);
-                ChatRoom *room = &chat_rooms[room_count];
-                room->id = room_count;
-                strncpy(room->creator, client->username, sizeof(room->creator)-1);
-                room->creator[sizeof(room->creator)-1] = '\0';
-
-                room->clients[0] = client;
-                room->clients[1] = NULL;
-                room->observer_count = 0;
-                room->playerReady[0] = 0;
-                room->playerReady[1] = 0;
-                room->gameStarted = 0;
-                room->current_turn = 0;
-                memset(room->boardPlayer0, '.', 64);
-                memset(room->boardPlayer1, '.', 64);
-
-                client->room_id = room->id;
-                room_count++;
-
-                send_to_client(client->socket, "JOINED_ROOM\n");
-                snprintf(msg, sizeof(msg),
-                         "Room %d created by %s.\n"
-                         "Wait for /join <id> from second player.\n",
-                         room->id, room->creator);
-                send_to_client(client->socket, msg);
-                pthread_mutex_unlock(&rooms_mutex);
-            }
-            else if (strncmp(buffer, "/join ", 6) == 0) {
-                int rid = atoi(buffer + 6);
-                pthread_mutex_lock(&rooms_mutex);
-                ChatRoom *room = get_room_by_id(rid);
-                if (!room) {
-                    send_to_client(client->socket, "Invalid room ID.\n");
-                    pthread_mutex_unlock(&rooms_mutex);
-                } else {
-                    if (room->clients[0] && room->clients[1]) {
-                        room->observers[room->observer_count++] = client;
-                        client->room_id = rid;
-                        send_to_client(client->socket, "JOINED_ROOM_OBSERVER\n");
-                        send_to_client(client->socket, "Room is full. Joined as observer.\n");
-                        snprintf(msg, sizeof(msg), "TLV_PORT %d\n", tlv_port);
-                        send_to_client(client->socket, msg);
-                        notify_observer_about_game_state(room, client->socket);
-                        pthread_mutex_unlock(&rooms_mutex);
-                    }
-                    else if (room->clients[0] && !room->clients[1]) {
-                        room->clients[1] = client;
-                        client->room_id = rid;
-                        send_to_client(client->socket, "JOINED_ROOM\n");
-                        snprintf(msg, sizeof(msg),
-                                 "Joined room %d as second player. Now 2 players in room.\n", rid);
-                        send_to_client(client->socket, msg);
-                        snprintf(msg, sizeof(msg),
-                                 "%s joined as second player.\n", client->username);
-                        broadcast_to_room(room, msg, client->socket);
-                        pthread_mutex_unlock(&rooms_mutex);
-                    }
-                    else if (!room->clients[0]) {
-                        room->clients[0] = client;
-                        client->room_id = rid;
-                        send_to_client(client->socket, "JOINED_ROOM\n");
-                        send_to_client(client->socket, "Joined room as first player.\n");
-                        memset(room->boardPlayer0, '.', 64);
-                        memset(room->boardPlayer1, '.', 64);
-                        snprintf(msg, sizeof(msg),
-                                 "%s joined as first player.\n", client->username);
-                        broadcast_to_room(room, msg, client->socket);
-                        pthread_mutex_unlock(&rooms_mutex);
-                    }
-                    else {
-                        send_to_client(client->socket, "Could not join.\n");
-                        pthread_mutex_unlock(&rooms_mutex);
-                    }
-                }
-            }
-            else if (strncmp(buffer, "/list", 5) == 0) {
-                pthread_mutex_lock(&rooms_mutex);
-                if (room_count == 0) {
-                    send_to_client(client->socket, "No rooms.\n");
-                } else {
-                    snprintf(msg, sizeof(msg), "Rooms: %d\n", room_count);
-                    send_to_client(client->socket, msg);
-                    for (int i = 0; i < room_count; i++) {
-                        ChatRoom *r = &chat_rooms[i];
-                        int countPlayers = 0;
-                        if (r->clients[0])
-                            countPlayers++;
-                        if (r->clients[1])
-                            countPlayers++;
-                        snprintf(msg, sizeof(msg),
-                                 "ID:%d by:%s players:%d/2\n",
-                                 r->id, r->creator, countPlayers);
-                        send_to_client(client->socket, msg);
-                    }
-                }
-                pthread_mutex_unlock(&rooms_mutex);
-            }
-            else {
-                send_to_client(client->socket, "Invalid command in lobby.\n");
-            }
+static int replica_start(void) {
+    repl_log.data = malloc(REPL_BUFFER);
+    repl_log.cap = REPL_BUFFER;
+    pthread_t thread;
+    if (!repl_log.data || pthread_create(&thread, NULL, replica_sender_thread, NULL) != 0) {
+        fprintf(stderr, "[REPLICA] Cannot start replication\n");
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+}
+
+// --- Serwer zapasowy ---
+
+// Sesja o numerze 'sid' ze strumienia. Wywoływane z trzymanym clients_mutex.
+static Client *replica_find_session(unsigned sid) {
+    for (int i = 0; i < client_count; i++)
+        if (clients[i]->repl_sid == sid)
+            return clients[i];
+    return NULL;
+}
+
+// Zwalnia miejsce w kopii pokoju; sesja, która nie siedzi już w innym pokoju, znika
+static void replica_release_seat(ChatRoom *room, int p) {
+    Client *c = room->clients[p];
+    if (!c)
+        return;
+    room->clients[p] = NULL;
+    if (__atomic_load_n(&c->room_id, __ATOMIC_RELAXED) == room->id) {
+        __atomic_store_n(&c->seated, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&c->room_id, -1, __ATOMIC_SEQ_CST);
+        MUTEX_LOCK(&clients_mutex);
+        unlist_client(c);
+        MUTEX_UNLOCK(&clients_mutex);
+        client_put(c);  // Referencja sesji
+    }
+    client_put(c);  // Referencja członkostwa
+}
+
+static void replica_close_room(ChatRoom *room) {
+    replica_release_seat(room, 0);
+    replica_release_seat(room, 1);
+    room_publish(room);
+    room->gameStarted = 0;
+    MUTEX_LOCK(&rooms_mutex);
+    __atomic_store_n(&room->in_use, 0, __ATOMIC_RELEASE);
+    MUTEX_UNLOCK(&rooms_mutex);
+}
+
+// Stosuje jeden rekord strumienia. Wywoływane przez wątek serwera zapasowego, zanim
+// cokolwiek innego dotknie kopii pokoi (klienci nie są jeszcze przyjmowani).
+static void replica_apply(const unsigned char *rec) {
+    int type = rec[0];
+    int rid = (int)repl_get_u16(rec + 1);
+    const unsigned char *body = rec + REPL_HEADER_LEN;
+    ChatRoom *room = rid < room_count && chat_rooms[rid].in_use ? &chat_rooms[rid] : NULL;
+
+    switch (type) {
+    case REPL_RESET:
+        for (int i = 0; i < room_count; i++)
+            if (chat_rooms[i].in_use)
+                replica_close_room(&chat_rooms[i]);
+        MUTEX_LOCK(&clients_mutex);
+        while (client_count > 0) {
+            Client *c = clients[client_count - 1];
+            unlist_client(c);
+            client_put(c);  // Referencja sesji (członkostwa zwolniły już pokoje)
         }
-        else {
-            pthread_mutex_lock(&rooms_mutex);
-            ChatRoom *room = get_room_by_id(client->room_id);
-            if (!room) {
-                send_to_client(client->socket, "Error: room not found.\n");
-                client->room_id = -1;
-                pthread_mutex_unlock(&rooms_mutex);
-                continue;
-            }
-            int isPlayer = (room->clients[0] == client || room->clients[1] == client);
-            int pIndex = -1;
-            if (room->clients[0] == client)
-                pIndex = 0;
-            if (room->clients[1] == client)
-                pIndex = 1;
-            if (strncmp(buffer, "/start", 6) == 0) {
-                if (!isPlayer) {
-                    send_to_client(client->socket, "Observer cannot /start.\n");
-                    pthread_mutex_unlock(&rooms_mutex);
-                    continue;
-                }
-                room->playerReady[pIndex] = 1;
-                char tmp[BUFFER_SIZE];
-                snprintf(tmp, sizeof(tmp), "%s is ready.\n", client->username);
-                broadcast_to_room(room, tmp, -1);
-                if (room->clients[0] && room->clients[1]) {
-                    if (!room->gameStarted) {
-                        if (room->playerReady[0] && room->playerReady[1]) {
-                            start_game(room);
-                        }
-                    }
-                }
-                else {
-                    send_to_client(client->socket, "Waiting for second player...\n");
-                }
-                pthread_mutex_unlock(&rooms_mutex);
-                continue;
-            }
-            else if (strncmp(buffer, "FIRE ", 5) == 0) {
-                if (!isPlayer) {
-                    send_to_client(client->socket, "Observer cannot FIRE.\n");
-                    pthread_mutex_unlock(&rooms_mutex);
-                    continue;
-                }
-                if (!room->gameStarted) {
-                    send_to_client(client->socket, "Game not started yet.\n");
-                    pthread_mutex_unlock(&rooms_mutex);
-                    continue;
-                }
-                if (pIndex != room->current_turn) {
-                    send_to_client(client->socket, "Not your turn!\n");
-                    pthread_mutex_unlock(&rooms_mutex);
-                    continue;
-                }
-                snprintf(msg, sizeof(msg), "%s\n", buffer);
-                broadcast_to_room(room, msg, -1);
-                pthread_mutex_unlock(&rooms_mutex);
-                continue;
-            }
-            else if (strncmp(buffer, "HIT ", 4) == 0) {
-                snprintf(msg, sizeof(msg), "%s\n", buffer);
-                broadcast_to_room(room, msg, -1);
-                //room->current_turn = (room->current_turn == 0) ? 1 : 0; // Tutaj trzeba wrócić Miras
-                if (room->clients[room->current_turn]) {
-                    snprintf(msg, sizeof(msg), 
-                             "NEXT_TURN %s TUTAJ POWINIEN ZOSTAC TEN SAM GRACZ\n",
-                             room->clients[room->current_turn]->username);
-                    broadcast_to_room(room, msg, -1);
-                }
-                send_board_update_to_observers(room);
-                pthread_mutex_unlock(&rooms_mutex);
-                continue;
-            }
-            else if (strncmp(buffer, "MISS ", 5) == 0) {
-                snprintf(msg, sizeof(msg), "%s\n", buffer);
-                broadcast_to_room(room, msg, -1);
-                room->current_turn = (room->current_turn == 0) ? 1 : 0;
-                if (room->clients[room->current_turn]) {
-                    snprintf(msg, sizeof(msg), "NEXT_TURN %s\n",
-                             room->clients[room->current_turn]->username);
-                    broadcast_to_room(room, msg, -1);
-                }
-                send_board_update_to_observers(room);
-                pthread_mutex_unlock(&rooms_mutex);
-                continue;
-            }
-            else if (strncmp(buffer, "YOU_WIN", 7) == 0) {
-                char winner[50];
-                strncpy(winner, client->username, 49);
-                winner[49] = '\0';
-                snprintf(msg, sizeof(msg), "YOU_WIN %s\n", winner);
-                broadcast_to_room(room, msg, -1);
-                char loser[50] = "UNKNOWN";
-                if (room->clients[0] && room->clients[0] != client) {
-                    strncpy(loser, room->clients[0]->username, 49);
-                } else if (room->clients[1] && room->clients[1] != client) {
-                    strncpy(loser, room->clients[1]->username, 49);
-                }
-                log_game_result(winner, loser);
-                if (room->clients[0]) {
-                    room->clients[0]->room_id = -1;
-                    send_to_client(room->clients[0]->socket, "Returning to lobby.\n");
-                    send_to_client(room->clients[0]->socket, WELCOME_IN_LOBBY);
-                    room->clients[0] = NULL;
-                }
-                if (room->clients[1]) {
-                    room->clients[1]->room_id = -1;
-                    send_to_client(room->clients[1]->socket, "Returning to lobby.\n");
-                    send_to_client(room->clients[1]->socket, WELCOME_IN_LOBBY);
-                    room->clients[1] = NULL;
-                }
-                for (int i = 0; i < room->observer_count; i++) {
-                    if (room->observers[i]) {
-                        room->observers[i]->room_id = -1;
-                        send_to_client(room->observers[i]->socket, "Returning to lobby.\n");
-                        send_to_client(room->observers[i]->socket, WELCOME_IN_LOBBY);
-                        room->observers[i] = NULL;
-                    }
-                }
-                room->observer_count = 0;
-                pthread_mutex_unlock(&rooms_mutex);
-                continue;
-            }
-            else {
-                send_to_client(client->socket, "Invalid command in room.\n");
-                pthread_mutex_unlock(&rooms_mutex);
-            }
+        MUTEX_UNLOCK(&clients_mutex);
+        break;
+    case REPL_SESSION: {
+        unsigned sid = repl_get_u32(body);
+        size_t n = body[4 + REPL_TOKEN_LEN];
+        MUTEX_LOCK(&clients_mutex);
+        Client *c = replica_find_session(sid);
+        if (!c && sid && client_count < MAX_CLIENTS &&
+            (c = client_new(&reactors[sid % reactor_count], -1)) != NULL) {
+            c->task.home = (int)sid;
+            c->repl_sid = sid;
+            c->state = CONN_READY;
+            c->held = 1;
+            clients[client_count++] = c;
         }
+        if (c) {
+            memcpy(c->resume_token, body + 4, RESUME_TOKEN_LEN);
+            c->resume_token[RESUME_TOKEN_LEN] = '\0';
+            n = n < sizeof(c->username) - 1 ? n : sizeof(c->username) - 1;
+            memcpy(c->username, body + 5 + REPL_TOKEN_LEN, n);
+            c->username[n] = '\0';
+        }
+        MUTEX_UNLOCK(&clients_mutex);
+        break;
     }
+    case REPL_OPEN: {
+        if (rid >= MAX_ROOMS)
+            break;
+        if (room)
+            replica_close_room(room);
+        room = &chat_rooms[rid];
+        MUTEX_LOCK(&rooms_mutex);
+        while (room_count <= rid) {
+            room_slot_init(&chat_rooms[room_count], room_count);
+            room_count++;
+        }
+        size_t n = body[0] < sizeof(room->creator) - 1 ? body[0] : sizeof(room->creator) - 1;
+        memcpy(room->creator, body + 1, n);
+        room->creator[n] = '\0';
+        room->id = rid;
+        room->clients[0] = room->clients[1] = NULL;
+        room->observer_count = 0;
+        room->playerReady[0] = room->playerReady[1] = 0;
+        room->gameStarted = 0;
+        room->current_turn = 0;
+        room->seq = 0;
+        memset(room->boardPlayer0, '.', 64);
+        memset(room->boardPlayer1, '.', 64);
+        room->board_sync[0] = room->board_sync[1] = BOARD_SYNC_NONE;
+        room_publish(room);
+        __atomic_store_n(&room->in_use, 1, __ATOMIC_RELEASE);
+        MUTEX_UNLOCK(&rooms_mutex);
+        break;
+    }
+    case REPL_CLOSE:
+        if (room)
+            replica_close_room(room);
+        break;
+    case REPL_SEAT: {
+        if (!room || body[0] > 1)
+            break;
+        unsigned sid = repl_get_u32(body + 1);
+        Client *c = NULL;
+        MUTEX_LOCK(&clients_mutex);
+        if (sid && (c = replica_find_session(sid)) != NULL)
+            client_get(c);  // Referencja członkostwa
+        MUTEX_UNLOCK(&clients_mutex);
+        if (c && room->clients[body[0]] == c) {
+            client_put(c);
+            break;
+        }
+        replica_release_seat(room, body[0]);
+        if (c) {
+            room->clients[body[0]] = c;
+            __atomic_store_n(&c->seated, 1, __ATOMIC_RELAXED);
+            __atomic_store_n(&c->room_id, rid, __ATOMIC_SEQ_CST);
+        }
+        room_publish(room);
+        break;
+    }
+    case REPL_READY:
+        if (room && body[0] <= 1)
+            room->playerReady[body[0]] = body[1];
+        break;
+    case REPL_TURN:
+        if (room) {
+            room->gameStarted = body[0];
+            room->current_turn = body[1] ? 1 : 0;
+        }
+        break;
+    case REPL_CELL:
+        if (room && body[0] <= 1 && body[1] < REPL_BOARD_CELLS)
+            (body[0] ? room->boardPlayer1 : room->boardPlayer0)[body[1]] = (char)body[2];
+        break;
+    case REPL_BOARD:
+        if (room && body[0] <= 1)
+            memcpy(body[0] ? room->boardPlayer1 : room->boardPlayer0, body + 1, REPL_BOARD_CELLS);
+        break;
+    }
+}
 
-    // Obsługa rozłączenia klienta
-    close(client->socket);
-    client->active = 0;
-
-    pthread_mutex_lock(&clients_mutex);
-    pthread_mutex_lock(&rooms_mutex);
+// Serwer główny zamilkł - kopie stają się właściwymi grami. Sesje dostają zegar wznowienia
+// w swoich reaktorach; klientów przyjmujemy dopiero, gdy wszystkie zegary są uzbrojone
+// (RESUME mógłby inaczej wyprzedzić uzbrojenie i zostawić sesję bez zegara).
+static void replica_promote(void) {
+    int sessions = 0, games = 0;
+    MUTEX_LOCK(&clients_mutex);
     for (int i = 0; i < client_count; i++) {
-        if (clients[i] == client) {
-            for (int j = i; j < client_count - 1; j++) {
-                clients[j] = clients[j+1];
-            }
-            clients[client_count - 1] = NULL;
-            client_count--;
-            break;
+        Client *c = clients[i];
+        if (c->held && c->repl_sid) {
+            mailbox_push(&c->reactor->inbox, &c->handoff_node);
+            sessions++;
         }
     }
-    if (client->room_id != -1) {
-        ChatRoom *r = get_room_by_id(client->room_id);
-        if (r) {
-            if (r->clients[0] == client)
-                r->clients[0] = NULL;
-            else if (r->clients[1] == client)
-                r->clients[1] = NULL;
-            else {
-                for (int i = 0; i < r->observer_count; i++) {
-                    if (r->observers[i] == client) {
-                        for (int j = i; j < r->observer_count - 1; j++) {
-                            r->observers[j] = r->observers[j+1];
-                        }
-                        r->observer_count--;
-                        break;
-                    }
-                }
-            }
+    MUTEX_UNLOCK(&clients_mutex);
+    MUTEX_LOCK(&rooms_mutex);
+    int count = room_count;
+    MUTEX_UNLOCK(&rooms_mutex);
+    for (int rid = 0; rid < count; rid++) {
+        ChatRoom *room = &chat_rooms[rid];
+        if (room->in_use && room->gameStarted) {
+            room_request_turn_timer(room, 1);  // Gracz na ruchu dostaje pełny czas od nowa
+            games++;
+        }
+    }
+    for (int i = 0; i < reactor_count; i++)
+        reactor_wake(&reactors[i]);
+    for (int i = 0; i < reactor_count; i++) {
+        while (!mailbox_empty(&reactors[i].inbox)) {
+            struct timespec pause = { 0, 1000000L };
+            nanosleep(&pause, NULL);
         }
     }
-    pthread_mutex_unlock(&rooms_mutex);
-    pthread_mutex_unlock(&clients_mutex);
+    __atomic_store_n(&standby_mode, 0, __ATOMIC_RELEASE);
+    printf("[REPLICA] Primary lost, taking over %d session(s) and %d game(s) in progress\n", sessions, games);
+}
 
-    free(client);
-    pthread_exit(NULL);
+// Wątek serwera zapasowego: przyjmuje strumień serwera głównego i stosuje go do kopii.
+// Po utracie strumienia (po pierwszym RESET) przejmuje gry i kończy pracę.
+static void *replica_standby_thread(void *arg) {
+    int listen_fd = (int)(long)arg;
+    unsigned char *buf = malloc(REPL_READ_BUFFER);
+    int synced = 0;
+    while (buf && !synced) {
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EINTR)
+                sleep(1);
+            continue;
+        }
+        unsigned char hello[REPL_HEADER_LEN + 2];
+        ReplLog out = { hello, 0, sizeof(hello) };
+        repl_put_hello(&out, server_port);
+        if (replica_write(fd, out.data, out.len) < 0) {
+            close(fd);
+            continue;
+        }
+        printf("[REPLICA] Primary connected, receiving its state\n");
+        size_t have = 0;
+        int alive = 1;
+        while (alive) {
+            struct pollfd p = { fd, POLLIN, 0 };
+            int ready = poll(&p, 1, REPL_TIMEOUT_MS);
+            if (ready < 0 && errno == EINTR)
+                continue;
+            ssize_t n = ready > 0 ? recv(fd, buf + have, REPL_READ_BUFFER - have, 0) : 0;
+            if (n <= 0)
+                break;  // Koniec strumienia albo milczenie dłuższe niż REPL_TIMEOUT_MS
+            have += (size_t)n;
+            size_t off = 0;
+            int len;
+            while ((len = repl_record_len(buf + off, have - off)) > 0) {
+                if (buf[off] == REPL_RESET)
+                    synced = 1;
+                replica_apply(buf + off);
+                off += (size_t)len;
+            }
+            if (len < 0) {
+                fprintf(stderr, "[REPLICA] Malformed replication record, dropping the stream\n");
+                alive = 0;
+            }
+            memmove(buf, buf + off, have - off);
+            have -= off;
+        }
+        close(fd);
+        if (!synced)
+            printf("[REPLICA] Primary disconnected before sending its state, waiting\n");
+    }
+    close(listen_fd);
+    free(buf);
+    replica_promote();
+    return NULL;
 }
 
-// ==================== Funkcja main ====================
-int main(int argc, char *argv[]) {
-    if (argc < 2) {
-        fprintf(stderr, "Usage: %s <interface IP>\n", argv[0]);
-        return 1;
+static int standby_start(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("[REPLICA] socket");
+        return -1;
     }
-    char *interface_name = argv[1];
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port);
+    pthread_t thread;
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 1) < 0) {
+        perror("[REPLICA] Cannot listen for the primary");
+        close(fd);
+        return -1;
+    }
+    printf("[REPLICA] Standby server, waiting for the primary on port %d\n", port);
+    if (pthread_create(&thread, NULL, replica_standby_thread, (void *)(long)fd) != 0) {
+        close(fd);
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+}
 
-    #if RUN_AS_DAEMON
-        daemonize();
-    #endif
+// ==================== Gorący Restart ====================
+// Serwer z --handoff PATH nasłuchuje na PATH na swojego następcę. Nowy proces uruchomiony
+// z tym samym --handoff łączy się z nim i przejmuje:
+//   - gniazda nasłuchujące reaktorów i gniazdo TLV (połączenia czekające na accept zostają),
+//   - gniazda wszystkich połączeń i kanałów TLV obserwatorów (SCM_RIGHTS),
+//   - sesje (nazwa, token wznowienia, bufory wejścia i wyjścia, miejsce w pokoju) i pokoje
+//     (plansze, tura, gotowość graczy) w zwartych rekordach.
+// Poprzednik na czas przekazania zatrzymuje reaktory i czeka, aż pula dokończy rozpoczęte
+// komendy, więc stan nie zmienia się w trakcie kopiowania; po COMMIT następcy kończy
+// działanie, nie zamykając połączeń (następca ma ich własne kopie). Gdy następca zawiedzie
+// przed COMMIT, poprzednik wznawia obsługę, jakby nic się nie stało.
+// Zatrzymanie wymaga pętli epoll u poprzednika - przy io_uring jądro odbiera dane
+// do pierścienia buforów także wtedy, gdy reaktor stoi. Następca może używać obu.
 
-    signal(SIGINT, handle_sigint);
+enum {
+    HANDOFF_REQUEST = 1,  // Następca -> poprzednik: zgodność formatu
+    HANDOFF_REJECT,       // Poprzednik odmawia (treść: powód)
+    HANDOFF_HELLO,        // Parametry serwera; gniazda nasłuchujące i TLV
+    HANDOFF_CLIENT,       // Sesja lub połączenie przed handshake'iem; jego gniazda
+    HANDOFF_OUTPUT,       // Kolejny kawałek niewysłanych danych ostatniego klienta
+    HANDOFF_ROOM,         // Zajęty pokój
+    HANDOFF_DONE,         // Koniec stanu
+    HANDOFF_COMMIT        // Następca przejął stan - poprzednik kończy działanie
+};
 
-    // Uruchomienie wątku discovery UDP
-    pthread_t disc_thread;
-    pthread_create(&disc_thread, NULL, udp_discovery_thread, interface_name);
-    pthread_detach(disc_thread);
+#define HANDOFF_OUTPUT_CHUNK  (32 * 1024)
+#define HANDOFF_QUIESCE_MS    2000  // Jak długo czekamy na zatrzymanie reaktorów i puli
 
-    server_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_fd < 0) {
-        perror("TCP socket creation failed");
-        exit(EXIT_FAILURE);
-    }
+typedef struct {
+    unsigned magic;
+    unsigned layout;             // Rozmiary rekordów - inna wersja serwera ma inne
+} HandoffRequest;
 
-    int opt = 1;
-    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
-        perror("setsockopt SO_REUSEADDR failed");
-        exit(EXIT_FAILURE);
+typedef struct {
+    char server_id[SERVER_ID_LEN + 1];
+    int port;
+    int tlv_port;
+    int listeners;               // Gniazda nasłuchujące w komunikacie (po nich gniazdo TLV)
+    int sessions;                // Rekordy sesji (kolejność tablicy clients)
+    int room_slots;              // room_count poprzednika
+} HandoffHello;
+
+typedef struct {
+    int session;                 // Pozycja w tablicy clients albo -1 (połączenie przed handshake'iem)
+    int state;
+    int active;
+    int held;
+    int no_resume;
+    int binary;
+    int seated;
+    int room_id;
+    int has_socket;              // Gniazda w komunikacie: połączenie, potem TLV
+    int has_tlv;
+    struct sockaddr_in address;
+    char username[50];
+    char resume_token[RESUME_TOKEN_LEN + 1];
+    char caps[64];
+    int in_len;
+    char inbuf[BUFFER_SIZE];
+    size_t out_len;              // Tyle bajtów przyjdzie w komunikatach HANDOFF_OUTPUT
+} HandoffClient;
+
+typedef struct {
+    int id;
+    int players[2];              // Sesje graczy (-1 = wolne miejsce)
+    int observers[MAX_OBSERVERS];
+    int observer_count;
+    int player_ready[2];
+    int game_started;
+    int current_turn;
+    unsigned long seq;
+    char creator[50];
+    char board0[64];
+    char board1[64];
+} HandoffRoom;
+
+#define HANDOFF_LAYOUT ((unsigned)(sizeof(HandoffHello) + (sizeof(HandoffClient) << 8) + (sizeof(HandoffRoom) << 20)))
+
+// Stan odebrany od poprzednika, odtwarzany po utworzeniu reaktorów
+typedef struct {
+    HandoffClient rec;
+    int socket;
+    int tlv_socket;
+    char *out;
+} HandoffIncoming;
+
+static HandoffHello handoff_hello;
+static HandoffIncoming *handoff_in;
+static int handoff_in_count;
+static HandoffRoom *handoff_rooms;
+static int handoff_room_count;
+
+static pthread_mutex_t handoff_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t handoff_cond = PTHREAD_COND_INITIALIZER;
+static int handoff_parked;           // Reaktory zatrzymane w handoff_park
+
+// Reaktor stoi, dopóki trwa przekazanie (po udanym przekazaniu proces kończy się w tym miejscu)
+static void handoff_park(void) {
+    MUTEX_LOCK(&handoff_mutex);
+    handoff_parked++;
+    pthread_cond_broadcast(&handoff_cond);
+    while (__atomic_load_n(&handoff_frozen, __ATOMIC_ACQUIRE))
+        pthread_cond_wait(&handoff_cond, &handoff_mutex);
+    handoff_parked--;
+    MUTEX_UNLOCK(&handoff_mutex);
+}
+
+static void handoff_thaw(void) {
+    MUTEX_LOCK(&handoff_mutex);
+    __atomic_store_n(&handoff_frozen, 0, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&handoff_cond);
+    MUTEX_UNLOCK(&handoff_mutex);
+}
+
+// Zatrzymuje reaktory i czeka na bezczynność puli. Zwraca 0 albo -1 (trzeba odmrozić).
+static int handoff_freeze(void) {
+    __atomic_store_n(&handoff_frozen, 1, __ATOMIC_RELEASE);
+    for (int i = 0; i < reactor_count; i++)
+        reactor_wake(&reactors[i]);
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += HANDOFF_QUIESCE_MS / 1000;
+    MUTEX_LOCK(&handoff_mutex);
+    while (handoff_parked < reactor_count &&
+           pthread_cond_timedwait(&handoff_cond, &handoff_mutex, &deadline) == 0)
+        ;
+    int parked = handoff_parked == reactor_count;
+    MUTEX_UNLOCK(&handoff_mutex);
+    if (!parked)
+        return -1;
+    // Reaktory stoją, więc nic nowego nie trafi do puli - czekamy na komendy już zleconych aktorów
+    struct timespec pause = { 0, 1000000 };
+    for (int waited = 0; !pool_idle(&pool); waited++) {
+        if (waited >= HANDOFF_QUIESCE_MS)
+            return -1;
+        nanosleep(&pause, NULL);
     }
+    return 0;
+}
 
-    struct sockaddr_in server_address;
-    memset(&server_address, 0, sizeof(server_address));
-    server_address.sin_family = AF_INET;
-    server_address.sin_addr.s_addr = INADDR_ANY;
-    server_address.sin_port = htons(SERVER_PORT);
+static int handoff_session_index(const Client *client) {
+    for (int i = 0; client && i < client_count; i++)
+        if (clients[i] == client)
+            return i;
+    return -1;
+}
 
-    if (bind(server_fd, (struct sockaddr *)&server_address, sizeof(server_address)) < 0) {
-        perror("Bind failed");
-        close(server_fd);
-        exit(EXIT_FAILURE);
+static int handoff_send_client(int sock, Client *client, int session) {
+    HandoffClient rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.session = session;
+    rec.state = client->state;
+    rec.active = client->active;
+    rec.held = client->held;
+    rec.no_resume = client->no_resume;
+    rec.binary = client->binary;
+    rec.seated = client->seated;
+    rec.room_id = client->room_id;
+    rec.address = client->address;
+    memcpy(rec.username, client->username, sizeof(rec.username));
+    memcpy(rec.resume_token, client->resume_token, sizeof(rec.resume_token));
+    memcpy(rec.caps, client->caps, sizeof(rec.caps));
+    rec.in_len = client->in_end - client->in_start;
+    memcpy(rec.inbuf, client->inbuf + client->in_start, rec.in_len);
+    rec.out_len = client->out_len;
+    int fds[2], nfds = 0;
+    if ((rec.has_socket = client->socket >= 0))
+        fds[nfds++] = client->socket;
+    if ((rec.has_tlv = client->tlv_socket > 0))
+        fds[nfds++] = client->tlv_socket;
+    if (handoff_send(sock, HANDOFF_CLIENT, &rec, sizeof(rec), fds, nfds) < 0)
+        return -1;
+    for (size_t off = 0; off < client->out_len; off += HANDOFF_OUTPUT_CHUNK) {
+        size_t chunk = client->out_len - off < HANDOFF_OUTPUT_CHUNK ? client->out_len - off : HANDOFF_OUTPUT_CHUNK;
+        if (handoff_send(sock, HANDOFF_OUTPUT, client->outbuf + off, chunk, NULL, 0) < 0)
+            return -1;
     }
+    return 0;
+}
 
-    if (listen(server_fd, MAX_CLIENTS) < 0) {
-        perror("Listen failed");
-        close(server_fd);
-        exit(EXIT_FAILURE);
+static int handoff_send_room(int sock, ChatRoom *room) {
+    HandoffRoom rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.id = room->id;
+    for (int i = 0; i < 2; i++) {
+        rec.players[i] = handoff_session_index(room->clients[i]);
+        rec.player_ready[i] = room->playerReady[i];
+    }
+    for (int i = 0; i < room->observer_count; i++) {
+        int session = handoff_session_index(room->observers[i]);
+        if (session >= 0)
+            rec.observers[rec.observer_count++] = session;
     }
+    rec.game_started = room->gameStarted;
+    rec.current_turn = room->current_turn;
+    rec.seq = room->seq;
+    memcpy(rec.creator, room->creator, sizeof(rec.creator));
+    memcpy(rec.board0, room->boardPlayer0, 64);
+    memcpy(rec.board1, room->boardPlayer1, 64);
+    return handoff_send(sock, HANDOFF_ROOM, &rec, sizeof(rec), NULL, 0);
+}
 
-    printf("Server is running on port %d\n", SERVER_PORT);
+// Wysyła cały stan zatrzymanego serwera
+static int handoff_send_state(int sock) {
+    int fds[MAX_REACTORS + 1], nfds = 0;
+    for (int i = 0; i < reactor_count; i++)
+        fds[nfds++] = reactors[i].listen_fd;
+    fds[nfds++] = tlv_server_fd;
 
-    // Konfiguracja gniazda TLV (ephemeral port)
-    tlv_server_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (tlv_server_fd < 0) {
-        perror("[TLV] socket creation failed");
-        exit(EXIT_FAILURE);
+    MUTEX_LOCK(&clients_mutex);
+    MUTEX_LOCK(&rooms_mutex);
+    MUTEX_LOCK(&conns_mutex);
+    HandoffHello hello;
+    memset(&hello, 0, sizeof(hello));
+    memcpy(hello.server_id, server_id, sizeof(hello.server_id));
+    hello.port = server_port;
+    hello.tlv_port = tlv_port;
+    hello.listeners = reactor_count;
+    hello.sessions = client_count;
+    hello.room_slots = room_count;
+    int rc = handoff_send(sock, HANDOFF_HELLO, &hello, sizeof(hello), fds, nfds);
+    for (int i = 0; i < client_count && rc == 0; i++)
+        rc = handoff_send_client(sock, clients[i], i);
+    for (Client *c = pending_conns; c && rc == 0; c = c->conn_next)
+        rc = handoff_send_client(sock, c, -1);
+    for (int i = 0; i < room_count && rc == 0; i++)
+        if (chat_rooms[i].in_use)
+            rc = handoff_send_room(sock, &chat_rooms[i]);
+    if (rc == 0)
+        rc = handoff_send(sock, HANDOFF_DONE, NULL, 0, NULL, 0);
+    printf("[HANDOFF] Sent %d session(s), %d room slot(s)%s\n", client_count, room_count,
+           rc == 0 ? "" : " - transfer failed");
+    MUTEX_UNLOCK(&conns_mutex);
+    MUTEX_UNLOCK(&rooms_mutex);
+    MUTEX_UNLOCK(&clients_mutex);
+    return rc;
+}
+
+static void handoff_reject(int sock, const char *reason) {
+    fprintf(stderr, "[HANDOFF] Refusing successor: %s\n", reason);
+    handoff_send(sock, HANDOFF_REJECT, reason, strlen(reason), NULL, 0);
+}
+
+// Obsługuje następcę połączonego przez 'sock'. Zwraca 0, gdy przejął stan (trzeba zakończyć proces).
+static int handoff_serve(int sock) {
+    HandoffRequest req;
+    size_t len = 0;
+    int fds[HANDOFF_MAX_FDS], nfds = 0;
+    int type = handoff_recv(sock, &req, sizeof(req), &len, fds, &nfds);
+    for (int i = 0; i < nfds; i++)
+        close(fds[i]);
+    if (type != HANDOFF_REQUEST || len != sizeof(req) || req.magic != HANDOFF_MAGIC) {
+        handoff_reject(sock, "bad request");
+        return -1;
+    }
+    if (req.layout != HANDOFF_LAYOUT) {
+        handoff_reject(sock, "incompatible server build");
+        return -1;
+    }
+    if (io_backend != IO_EPOLL) {
+        handoff_reject(sock, "hot restart needs the running server on --io epoll");
+        return -1;
+    }
+    printf("[HANDOFF] Successor connected, freezing reactors.\n");
+    if (handoff_freeze() < 0) {
+        handoff_thaw();
+        handoff_reject(sock, "server did not quiesce in time");
+        return -1;
     }
-    setsockopt(tlv_server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    int rc = handoff_send_state(sock);
+    if (rc == 0) {
+        char ack[16];
+        type = handoff_recv(sock, ack, sizeof(ack), &len, fds, &nfds);
+        rc = type == HANDOFF_COMMIT ? 0 : -1;
+    }
+    if (rc < 0) {
+        printf("[HANDOFF] Successor did not take over, resuming service.\n");
+        handoff_thaw();
+    }
+    return rc;
+}
 
-    struct sockaddr_in tlv_addr;
-    memset(&tlv_addr, 0, sizeof(tlv_addr));
-    tlv_addr.sin_family = AF_INET;
-    tlv_addr.sin_addr.s_addr = INADDR_ANY;
-    tlv_addr.sin_port = htons(0);
-    if (bind(tlv_server_fd, (struct sockaddr *)&tlv_addr, sizeof(tlv_addr)) < 0) {
-        perror("[TLV] bind failed");
-        close(tlv_server_fd);
-        exit(EXIT_FAILURE);
+static void *handoff_thread(void *arg) {
+    int listen_fd = (int)(long)arg;
+    while (1) {
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("[HANDOFF] accept");
+            return NULL;
+        }
+        if (handoff_serve(fd) == 0) {
+            // Gniazda połączeń ma już następca - zamknięcie naszych kopii niczego nie zrywa.
+            // Gniazda --handoff i --metrics należą teraz do następcy, więc ich nie usuwamy.
+            printf("[HANDOFF] State handed over, exiting.\n");
+            capture_flush();
+            fflush(NULL);
+            _exit(0);
+        }
+        close(fd);
     }
-    if (listen(tlv_server_fd, 5) < 0) {
-        perror("[TLV] listen failed");
-        close(tlv_server_fd);
-        exit(EXIT_FAILURE);
+    return NULL;
+}
+
+// Nasłuchuje na następcę
+static int handoff_start(const char *path) {
+    int fd = handoff_listen(path);
+    if (fd < 0) {
+        perror("[HANDOFF] listen");
+        return -1;
     }
-    socklen_t len2 = sizeof(tlv_addr);
-    getsockname(tlv_server_fd, (struct sockaddr *)&tlv_addr, &len2);
-    tlv_port = ntohs(tlv_addr.sin_port);
-    printf("[TLV] Listening on ephemeral port = %d\n", tlv_port);
+    pthread_t thread;
+    pthread_create(&thread, NULL, handoff_thread, (void *)(long)fd);
+    pthread_detach(thread);
+    printf("[HANDOFF] Waiting for a successor on unix:%s\n", path);
+    return 0;
+}
 
-    pthread_create(&tlv_thread, NULL, tlv_accept_thread, NULL);
-    pthread_detach(tlv_thread);
+// Odbiera stan od poprzednika. Wywoływane przed utworzeniem reaktorów.
+// Zwraca 1 po przejęciu, 0 gdy nikt nie nasłuchuje na 'path', -1 gdy przejęcie się nie udało.
+static int handoff_takeover(const char *path) {
+    int sock = handoff_connect(path);
+    if (sock < 0)
+        return (errno == ENOENT || errno == ECONNREFUSED) ? 0 : -1;
+    printf("[HANDOFF] Taking over from the server on unix:%s\n", path);
+    HandoffRequest req = { HANDOFF_MAGIC, HANDOFF_LAYOUT };
+    if (handoff_send(sock, HANDOFF_REQUEST, &req, sizeof(req), NULL, 0) < 0) {
+        close(sock);
+        return -1;
+    }
+    char *body = malloc(HANDOFF_MAX_MSG);
+    handoff_in = calloc(MAX_CLIENTS * 2, sizeof(HandoffIncoming));
+    handoff_rooms = calloc(MAX_ROOMS, sizeof(HandoffRoom));
+    if (!body || !handoff_in || !handoff_rooms) {
+        close(sock);
+        return -1;
+    }
+    int hello_seen = 0, done = 0;
+    HandoffIncoming *last = NULL;
+    size_t out_filled = 0;
+    while (!done) {
+        size_t len = 0;
+        int fds[HANDOFF_MAX_FDS], nfds = 0;
+        int type = handoff_recv(sock, body, HANDOFF_MAX_MSG, &len, fds, &nfds);
+        if (type == HANDOFF_HELLO && len == sizeof(HandoffHello) && nfds >= 2 && !hello_seen) {
+            memcpy(&handoff_hello, body, sizeof(handoff_hello));
+            inherited_listener_count = nfds - 1 < MAX_REACTORS ? nfds - 1 : MAX_REACTORS;
+            memcpy(inherited_listeners, fds, sizeof(int) * inherited_listener_count);
+            inherited_tlv_fd = fds[nfds - 1];
+            hello_seen = 1;
+        } else if (type == HANDOFF_CLIENT && len == sizeof(HandoffClient) && hello_seen &&
+                   handoff_in_count < MAX_CLIENTS * 2) {
+            last = &handoff_in[handoff_in_count++];
+            memcpy(&last->rec, body, sizeof(last->rec));
+            int f = 0;
+            last->socket = last->rec.has_socket && f < nfds ? fds[f++] : -1;
+            last->tlv_socket = last->rec.has_tlv && f < nfds ? fds[f++] : -1;
+            last->out = last->rec.out_len ? malloc(last->rec.out_len) : NULL;
+            if (last->rec.out_len && !last->out)
+                last->rec.out_len = 0;
+            out_filled = 0;
+        } else if (type == HANDOFF_OUTPUT && last && out_filled + len <= last->rec.out_len) {
+            memcpy(last->out + out_filled, body, len);
+            out_filled += len;
+        } else if (type == HANDOFF_ROOM && len == sizeof(HandoffRoom) && handoff_room_count < MAX_ROOMS) {
+            memcpy(&handoff_rooms[handoff_room_count++], body, sizeof(HandoffRoom));
+        } else if (type == HANDOFF_DONE && hello_seen) {
+            done = 1;
+        } else {
+            if (type == HANDOFF_REJECT) {
+                body[len < HANDOFF_MAX_MSG ? len : HANDOFF_MAX_MSG - 1] = '\0';
+                fprintf(stderr, "[HANDOFF] Previous server refused: %s\n", body);
+            } else {
+                fprintf(stderr, "[HANDOFF] Transfer from previous server failed\n");
+            }
+            for (int i = 0; i < nfds; i++)
+                close(fds[i]);
+            close(sock);
+            free(body);
+            return -1;  // Poprzednik wznowi obsługę po zamknięciu kanału
+        }
+    }
+    free(body);
+    // Poprzednik kończy działanie po COMMIT; gniazd dotykamy dopiero, gdy zamknie kanał
+    char byte;
+    size_t len;
+    int fds[HANDOFF_MAX_FDS], nfds;
+    if (handoff_send(sock, HANDOFF_COMMIT, NULL, 0, NULL, 0) < 0 ||
+        handoff_recv(sock, &byte, sizeof(byte), &len, fds, &nfds) != 0)
+        fprintf(stderr, "[HANDOFF] Previous server did not confirm exit, continuing\n");
+    close(sock);
 
-    while (1) {
-        printf("[DEBUG] Waiting for new connection...\n");
-        Client *new_client = (Client *)malloc(sizeof(Client));
-        socklen_t addr_len = sizeof(new_client->address);
-        new_client->socket = accept(server_fd, (struct sockaddr *)&new_client->address, &addr_len);
-        if (new_client->socket < 0) {
-            perror("Accept failed");
-            free(new_client);
+    // Parametry poprzednika: ten sam port, identyfikator w discovery i klastrze, co najmniej tyle reaktorów
+    memcpy(server_id, handoff_hello.server_id, sizeof(server_id));
+    server_id[SERVER_ID_LEN] = '\0';
+    server_port = handoff_hello.port;
+    if (reactor_count < inherited_listener_count)
+        reactor_count = inherited_listener_count;
+    printf("[HANDOFF] Received %d session(s), %d connection(s) in handshake, %d room(s)\n",
+           handoff_hello.sessions, handoff_in_count - handoff_hello.sessions, handoff_room_count);
+    return 1;
+}
+
+// Odtwarza przejęte sesje i pokoje. Wywoływane po utworzeniu reaktorów, przed ich uruchomieniem.
+static void handoff_restore(void) {
+    Client **sessions = calloc(handoff_hello.sessions > 0 ? handoff_hello.sessions : 1, sizeof(Client *));
+    Client **restored = calloc(handoff_in_count > 0 ? handoff_in_count : 1, sizeof(Client *));
+    for (int k = 0; k < handoff_in_count; k++) {
+        HandoffIncoming *in = &handoff_in[k];
+        Reactor *r = &reactors[k % reactor_count];
+        Client *c = client_new(r, in->socket);
+        if (!c) {
+            if (in->socket >= 0)
+                close(in->socket);
+            free(in->out);
+            continue;
+        }
+        if (in->socket < 0)
+            c->task.home = k;
+        c->state = in->rec.state;
+        c->active = in->rec.active;
+        c->held = in->rec.held || (in->socket < 0 && in->rec.state == CONN_READY);
+        c->no_resume = in->rec.no_resume;
+        c->binary = in->rec.binary;
+        c->seated = in->rec.seated;
+        c->room_id = in->rec.room_id;
+        c->address = in->rec.address;
+        c->tlv_socket = in->tlv_socket;
+        memcpy(c->username, in->rec.username, sizeof(c->username));
+        memcpy(c->resume_token, in->rec.resume_token, sizeof(c->resume_token));
+        memcpy(c->caps, in->rec.caps, sizeof(c->caps));
+        c->username[sizeof(c->username) - 1] = '\0';
+        c->resume_token[RESUME_TOKEN_LEN] = '\0';
+        c->caps[sizeof(c->caps) - 1] = '\0';
+        c->board_deltas = proto_has_cap(c->caps, PROTO_CAP_DELTA);  // Wersje plansz pokoje zaczną od BOARD_RESYNC
+        c->in_end = in->rec.in_len > 0 && in->rec.in_len <= BUFFER_SIZE ? in->rec.in_len : 0;
+        memcpy(c->inbuf, in->rec.inbuf, c->in_end);
+        c->outbuf = in->out;
+        c->out_len = c->out_cap = in->rec.out_len;
+        c->last_command = c->last_seen;
+        int session = in->rec.session;
+        if (session >= 0 && session < handoff_hello.sessions && client_count < MAX_CLIENTS) {
+            sessions[session] = c;
+            clients[client_count++] = c;
+        } else {
+            c->state = CONN_HANDSHAKE;
+            pending_conn_add(c);
+        }
+        restored[k] = c;
+    }
+
+    room_count = handoff_hello.room_slots < MAX_ROOMS ? handoff_hello.room_slots : MAX_ROOMS;
+    for (int rid = 0; rid < room_count; rid++)
+        room_slot_init(&chat_rooms[rid], rid);
+    for (int i = 0; i < handoff_room_count; i++) {
+        HandoffRoom *rec = &handoff_rooms[i];
+        if (rec->id < 0 || rec->id >= room_count)
             continue;
+        ChatRoom *room = &chat_rooms[rec->id];
+        room->id = rec->id;
+        for (int p = 0; p < 2; p++) {
+            int s = rec->players[p];
+            room->clients[p] = s >= 0 && s < handoff_hello.sessions ? sessions[s] : NULL;
+            if (room->clients[p])
+                client_get(room->clients[p]);  // Referencja członkostwa
+            room->playerReady[p] = rec->player_ready[p];
         }
+        room->observer_count = 0;
+        for (int o = 0; o < rec->observer_count && o < MAX_OBSERVERS; o++) {
+            int s = rec->observers[o];
+            Client *obs = s >= 0 && s < handoff_hello.sessions ? sessions[s] : NULL;
+            if (obs) {
+                client_get(obs);
+                room->observers[room->observer_count++] = obs;
+            }
+        }
+        room->gameStarted = rec->game_started;
+        room->current_turn = rec->current_turn;
+        room->seq = rec->seq;
+        memcpy(room->creator, rec->creator, sizeof(room->creator));
+        room->creator[sizeof(room->creator) - 1] = '\0';
+        memcpy(room->boardPlayer0, rec->board0, 64);
+        memcpy(room->boardPlayer1, rec->board1, 64);
+        room_publish(room);
+        __atomic_store_n(&room->in_use, 1, __ATOMIC_RELEASE);
+        if (room->gameStarted)
+            room_request_turn_timer(room, 1);  // Gracz na ruchu dostaje pełny czas od nowa
+    }
 
-        if (negotiate_username(new_client) < 0) {
-            close(new_client->socket);
-            free(new_client);
+    // Rejestrację w pętli zdarzeń, timery i buforowane linie obsłuży reaktor każdego klienta
+    for (int k = 0; k < handoff_in_count; k++) {
+        Client *c = restored[k];
+        if (!c)
             continue;
+        if (c->out_len > 0) {
+            if (io_backend == IO_URING) {
+                c->send_busy = 1;
+                client_get(c);  // Referencja wysyłki
+                uring_queue_send(c);
+            } else {
+                c->want_write = 1;
+            }
         }
+        mailbox_push(&c->reactor->inbox, &c->handoff_node);
+    }
+    for (int i = 0; i < reactor_count; i++)
+        reactor_wake(&reactors[i]);
+    free(sessions);
+    free(restored);
+    free(handoff_in);
+    free(handoff_rooms);
+    handoff_in = NULL;
+    handoff_rooms = NULL;
+}
 
-        new_client->room_id = -1;
-        new_client->active = 1;
-        new_client->tlv_socket = -1;
+// ==================== Funkcja main ====================
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <interface IP> [--reactors N] [--workers N] [--pin] [--io epoll|uring] [--capture FILE] [--metrics SOCKET] [--trace-sample N] [--trace-slow MS] [--port N] [--id NAME] [--cluster] [--handoff SOCKET] [--replicate HOST:PORT] [--standby PORT] [--coalesce MS] [--coalesce-shots]\n", argv[0]);
+        return 1;
+    }
+    char *interface_name = argv[1];
+    const char *capture_path = NULL;
+    int standby_port = 0;
 
-        pthread_mutex_lock(&clients_mutex);
-        if (client_count < MAX_CLIENTS) {
-            clients[client_count++] = new_client;
-            pthread_t thread_id;
-            pthread_create(&thread_id, NULL, handle_client, (void*)new_client);
-            pthread_detach(thread_id);
-            printf("New client connected: %s\n", new_client->username);
+    // Domyślnie jeden reaktor i jeden wątek puli na rdzeń
+    reactor_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    worker_count = reactor_count;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--reactors") == 0 && i + 1 < argc) {
+            reactor_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            worker_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--pin") == 0) {
+            pin_reactors = 1;
+        } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            capture_path = argv[++i];
+        } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metrics_path = argv[++i];
+        } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            server_port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--id") == 0 && i + 1 < argc) {
+            snprintf(server_id, sizeof(server_id), "%s", argv[++i]);
+        } else if (strcmp(argv[i], "--cluster") == 0) {
+            cluster_enabled = 1;
+        } else if (strcmp(argv[i], "--handoff") == 0 && i + 1 < argc) {
+            handoff_path = argv[++i];
+        } else if (strcmp(argv[i], "--replicate") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%63[^:]:%d", replicate_host, &replicate_port) != 2) {
+                fprintf(stderr, "Expected --replicate HOST:PORT\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--standby") == 0 && i + 1 < argc) {
+            standby_port = atoi(argv[++i]);
+            standby_mode = 1;
+        } else if (strcmp(argv[i], "--coalesce") == 0 && i + 1 < argc) {
+            coalesce_ms = atoi(argv[++i]);
+            if (coalesce_ms < 0)
+                coalesce_ms = 0;
+            if (coalesce_ms > COALESCE_MAX_MS)
+                coalesce_ms = COALESCE_MAX_MS;
+        } else if (strcmp(argv[i], "--coalesce-shots") == 0) {
+            coalesce_shots = 1;
+        } else if (strcmp(argv[i], "--trace-sample") == 0 && i + 1 < argc) {
+            trace_sample_every = (unsigned)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--trace-slow") == 0 && i + 1 < argc) {
+            trace_slow_ns = (unsigned long long)(atof(argv[++i]) * 1e6);
+        } else if (strcmp(argv[i], "--io") == 0 && i + 1 < argc) {
+            const char *backend = argv[++i];
+            if (strcmp(backend, "uring") == 0) {
+                io_backend = IO_URING;
+            } else if (strcmp(backend, "epoll") != 0) {
+                fprintf(stderr, "Unknown I/O backend: %s\n", backend);
+                return 1;
+            }
         } else {
-            send_to_client(new_client->socket, "Server full.\n");
-            close(new_client->socket);
-            free(new_client);
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (reactor_count < 1)
+        reactor_count = 1;
+    if (reactor_count > MAX_REACTORS)
+        reactor_count = MAX_REACTORS;
+    if (io_backend == IO_URING) {
+        int ret = uring_probe();
+        if (ret < 0) {
+            fprintf(stderr, "io_uring unavailable (%s), falling back to epoll\n", strerror(-ret));
+            io_backend = IO_EPOLL;
+        }
+    }
+    // Plik nagrania otwieramy przed przejściem w tryb demona (ścieżka względna)
+    if (capture_path) {
+        if (capture_open(capture_path) < 0) {
+            perror("[CAPTURE] Cannot open capture file");
+            return 1;
+        }
+        printf("[CAPTURE] Recording connection traffic to %s\n", capture_path);
+    }
+
+    #if RUN_AS_DAEMON
+        daemonize();
+    #endif
+
+    signal_fd = signal_open();  // Przed pierwszym wątkiem; obsługuje go reaktor 0
+    signal(SIGPIPE, SIG_IGN);  // Wysyłka do zerwanego połączenia nie może zabić serwera
+
+    // Gorący restart: gdy na --handoff czeka działający serwer, przejmujemy jego gniazda i stan
+    int taken_over = 0;
+    if (handoff_path) {
+        taken_over = handoff_takeover(handoff_path);
+        if (taken_over < 0)
+            return 1;  // Poprzednik działa dalej - nie startujemy obok niego
+    }
+    if (server_id[0] == '\0') {
+        char token[RESUME_TOKEN_LEN + 1];
+        if (generate_resume_token(token) < 0) {
+            perror("[SERVER] getrandom");
+            return 1;
+        }
+        snprintf(server_id, sizeof(server_id), "%.*s", SERVER_ID_LEN, token);
+    }
+    // Discovery UDP obsługuje reaktor 0 (rejestruje gniazdo w reactor_init)
+    udp_sock = discovery_open(interface_name);
+    if (cluster_enabled)
+        cluster_sock = cluster_open(interface_name);
+
+    for (int i = 0; i < reactor_count; i++)
+        reactor_init(&reactors[i], i);
+    if (taken_over)
+        handoff_restore();
+    if (standby_mode && standby_start(standby_port) < 0)
+        return 1;
+    pool_start(&pool, worker_count);
+    if (replicate_host[0] && replica_start() < 0)
+        replicate_host[0] = '\0';
+
+    if (metrics_path && metrics_start(metrics_path) < 0)
+        metrics_path = NULL;
+    if (handoff_path && handoff_start(handoff_path) < 0)
+        handoff_path = NULL;
+
+    printf("Server %s is running on port %d with %d %s reactor(s) and %d worker(s)\n", server_id,
+           server_port, reactor_count, io_backend == IO_URING ? "io_uring" : "epoll", pool.size);
+
+    // Konfiguracja gniazda TLV (ephemeral port; po gorącym restarcie gniazdo poprzednika)
+    if (inherited_tlv_fd >= 0) {
+        tlv_server_fd = inherited_tlv_fd;
+        tlv_port = handoff_hello.tlv_port;
+        printf("[TLV] Listening on inherited port = %d\n", tlv_port);
+    } else {
+        int opt = 1;
+        tlv_server_fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (tlv_server_fd < 0) {
+            perror("[TLV] socket creation failed");
+            exit(EXIT_FAILURE);
+        }
+        setsockopt(tlv_server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+        struct sockaddr_in tlv_addr;
+        memset(&tlv_addr, 0, sizeof(tlv_addr));
+        tlv_addr.sin_family = AF_INET;
+        tlv_addr.sin_addr.s_addr = INADDR_ANY;
+        tlv_addr.sin_port = htons(0);
+        if (bind(tlv_server_fd, (struct sockaddr *)&tlv_addr, sizeof(tlv_addr)) < 0) {
+            perror("[TLV] bind failed");
+            close(tlv_server_fd);
+            exit(EXIT_FAILURE);
+        }
+        if (listen(tlv_server_fd, 5) < 0) {
+            perror("[TLV] listen failed");
+            close(tlv_server_fd);
+            exit(EXIT_FAILURE);
         }
-        pthread_mutex_unlock(&clients_mutex);
+        socklen_t len2 = sizeof(tlv_addr);
+        getsockname(tlv_server_fd, (struct sockaddr *)&tlv_addr, &len2);
+        tlv_port = ntohs(tlv_addr.sin_port);
+        printf("[TLV] Listening on ephemeral port = %d\n", tlv_port);
     }
 
-    close(server_fd);
+    pthread_create(&tlv_thread, NULL, tlv_accept_thread, NULL);
+    pthread_detach(tlv_thread);
+
+    // Reaktory 1..N-1 dostają własne wątki, reaktor 0 działa w wątku głównym
+    for (int i = 1; i < reactor_count; i++)
+        pthread_create(&reactors[i].thread, NULL, reactor_loop, &reactors[i]);
+    reactor_loop(&reactors[0]);
+
     return 0;
 }
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca & Marcel Gacoń
+ * AGH - Programowanie sieciowe
+ */
+
+#ifndef SKRZYNKA_H
+#define SKRZYNKA_H
+
+/*
+ * Bezblokadowa skrzynka wielu producentów / jednego konsumenta (MPSC).
+ *
+ * Producenci wkładają węzły na stos Treibera jedną operacją CAS, konsument
+ * zabiera cały stos jedną wymianą atomową i odwraca go, więc dostaje węzły
+ * w kolejności wstawiania. Węzły są wbudowane w struktury użytkownika
+ * (pole 'next'), skrzynka niczego nie alokuje.
+ *
+ * RingMailbox to ograniczona kolejka MPSC (pierścień z numerami sekwencyjnymi
+ * w komórkach, wg D. Vyukova) - producent dostaje informację o przepełnieniu
+ * zamiast rosnącej bez końca kolejki.
+ */
+
+/* ===================== Definicje ===================== */
+typedef struct MailboxNode {
+    struct MailboxNode *next;
+} MailboxNode;
+
+typedef struct {
+    MailboxNode *head;  // Szczyt stosu (ostatnio wstawiony węzeł)
+} Mailbox;
+
+/* ===================== API ===================== */
+static inline void mailbox_init(Mailbox *mb) {
+    __atomic_store_n(&mb->head, NULL, __ATOMIC_RELAXED);
+}
+
+// Wstawia węzeł - bezpieczne z wielu wątków. Zwraca 1, gdy skrzynka była pusta
+// (konsumenta trzeba obudzić), 0 w przeciwnym wypadku.
+static inline int mailbox_push(Mailbox *mb, MailboxNode *node) {
+    MailboxNode *old = __atomic_load_n(&mb->head, __ATOMIC_RELAXED);
+    do {
+        node->next = old;
+    } while (!__atomic_compare_exchange_n(&mb->head, &old, node, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    return old == NULL;
+}
+
+// Zabiera wszystkie węzły (tylko konsument). Zwraca listę w kolejności wstawiania.
+static inline MailboxNode *mailbox_drain(Mailbox *mb) {
+    MailboxNode *list = __atomic_exchange_n(&mb->head, NULL, __ATOMIC_ACQUIRE);
+    MailboxNode *fifo = NULL;
+    while (list) {
+        MailboxNode *next = list->next;
+        list->next = fifo;
+        fifo = list;
+        list = next;
+    }
+    return fifo;
+}
+
+// Czy skrzynka jest pusta - odczyt sekwencyjnie spójny, do sprawdzenia przed uśpieniem konsumenta
+static inline int mailbox_empty(Mailbox *mb) {
+    return __atomic_load_n(&mb->head, __ATOMIC_SEQ_CST) == NULL;
+}
+
+/* ===================== Skrzynka Ograniczona ===================== */
+#define RING_MAILBOX_SIZE  64   // Pojemność (potęga dwójki)
+#define RING_MAILBOX_MASK  (RING_MAILBOX_SIZE - 1)
+
+typedef struct {
+    unsigned long seq;   // Numer pozycji, na którą komórka czeka
+    void *data;
+} RingCell;
+
+typedef struct {
+    RingCell cells[RING_MAILBOX_SIZE];
+    unsigned long tail;  // Następna pozycja do zapisu (producenci)
+    unsigned long head;  // Następna pozycja do odczytu (konsument)
+} RingMailbox;
+
+static inline void ring_mailbox_init(RingMailbox *rb) {
+    for (unsigned long i = 0; i < RING_MAILBOX_SIZE; i++) {
+        __atomic_store_n(&rb->cells[i].seq, i, __ATOMIC_RELAXED);
+        rb->cells[i].data = NULL;
+    }
+    __atomic_store_n(&rb->tail, 0, __ATOMIC_RELAXED);
+    rb->head = 0;
+}
+
+// Wstawia element - bezpieczne z wielu wątków. Zwraca 0, gdy skrzynka jest pełna.
+static inline int ring_mailbox_push(RingMailbox *rb, void *data) {
+    unsigned long pos = __atomic_load_n(&rb->tail, __ATOMIC_RELAXED);
+    RingCell *cell;
+    while (1) {
+        cell = &rb->cells[pos & RING_MAILBOX_MASK];
+        unsigned long seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        long diff = (long)(seq - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&rb->tail, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if (diff < 0) {
+            return 0;  // Pełna
+        } else {
+            pos = __atomic_load_n(&rb->tail, __ATOMIC_RELAXED);
+        }
+    }
+    cell->data = data;
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+// Zabiera najstarszy element (tylko konsument). Zwraca NULL, gdy skrzynka jest pusta.
+static inline void *ring_mailbox_pop(RingMailbox *rb) {
+    unsigned long pos = rb->head;
+    RingCell *cell = &rb->cells[pos & RING_MAILBOX_MASK];
+    unsigned long seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+    if ((long)(seq - (pos + 1)) < 0)
+        return NULL;
+    void *data = cell->data;
+    __atomic_store_n(&cell->seq, pos + RING_MAILBOX_SIZE, __ATOMIC_RELEASE);
+    __atomic_store_n(&rb->head, pos + 1, __ATOMIC_RELAXED);  // Odczytywane przez ring_mailbox_depth
+    return data;
+}
+
+static inline int ring_mailbox_empty(RingMailbox *rb) {
+    RingCell *cell = &rb->cells[rb->head & RING_MAILBOX_MASK];
+    return (long)(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - (rb->head + 1)) < 0;
+}
+
+// Przybliżona liczba elementów w skrzynce - do metryk, wołane z dowolnego wątku
+static inline unsigned long ring_mailbox_depth(RingMailbox *rb) {
+    unsigned long head = __atomic_load_n(&rb->head, __ATOMIC_RELAXED);
+    unsigned long tail = __atomic_load_n(&rb->tail, __ATOMIC_RELAXED);
+    return (long)(tail - head) > 0 ? tail - head : 0;
+}
+
+#endif // SKRZYNKA_H
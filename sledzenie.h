@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca & Marcel Gacoń
+ * AGH - Programowanie sieciowe
+ */
+
+#ifndef SLEDZENIE_H
+#define SLEDZENIE_H
+
+/*
+ * Śledzenie strzałów: odcinki czasu (spany) jednego FIRE i wszystkiego, co z niego
+ * wynika (HIT/MISS, NEXT_TURN, aktualizacje TLV), oznaczone wspólnym numerem śladu.
+ *
+ * Spany trafiają do pierścienia w pamięci (TRACE_RING_SIZE ostatnich), skąd można je
+ * zrzucić jako JSON formatu Chrome Trace Event (chrome://tracing, ui.perfetto.dev).
+ * Zapis to kilka zwykłych zapisów do komórki pierścienia chronionej numerem sekwencyjnym
+ * (jak seqlock) - czytelnik pomija komórki nadpisane w trakcie kopiowania.
+ *
+ * Próbkowanie: śledzony jest co trace_sample_every-ty strzał (0 = śledzenie wyłączone),
+ * więc w produkcji koszt nieśledzonego strzału to jedno dodanie atomowe.
+ */
+
+/* ===================== Includy ===================== */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* ===================== Definicje ===================== */
+#define TRACE_RING_SIZE    16384  // Liczba pamiętanych spanów (potęga dwójki)
+#define TRACE_RING_MASK    (TRACE_RING_SIZE - 1)
+#define TRACE_DETAIL_LEN   24     // Krótki opis spanu (np. nazwa gracza, liczba odbiorców)
+
+typedef struct {
+    unsigned long seq;            // Pozycja zapisu + 1 (0 = komórka w trakcie zapisu)
+    unsigned long long trace_id;
+    const char *name;             // Stała nazwa spanu
+    unsigned long long start_ns;
+    unsigned long long dur_ns;
+    int track;                    // Ścieżka na osi czasu (numer pokoju)
+    char detail[TRACE_DETAIL_LEN];
+} TraceSpan;
+
+static TraceSpan trace_ring[TRACE_RING_SIZE];
+static unsigned long trace_next;           // Następna pozycja zapisu
+static unsigned long long trace_counter;   // Licznik strzałów (do próbkowania i numerów śladów)
+static unsigned trace_sample_every;        // --trace-sample N: co N-ty strzał (0 = wyłączone)
+
+static inline unsigned long long trace_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline int trace_enabled(void) {
+    return trace_sample_every != 0;
+}
+
+// Decyzja o próbkowaniu nowego strzału: numer śladu albo 0 (strzał nieśledzony)
+static inline unsigned long long trace_begin(void) {
+    if (!trace_sample_every)
+        return 0;
+    unsigned long long n = __atomic_add_fetch(&trace_counter, 1, __ATOMIC_RELAXED);
+    return n % trace_sample_every == 0 ? n : 0;
+}
+
+/* ===================== Zapis ===================== */
+static inline void trace_span(unsigned long long trace_id, const char *name, int track,
+                              unsigned long long start_ns, unsigned long long end_ns,
+                              const char *detail) {
+    if (!trace_id || !start_ns)
+        return;
+    unsigned long pos = __atomic_fetch_add(&trace_next, 1, __ATOMIC_RELAXED);
+    TraceSpan *s = &trace_ring[pos & TRACE_RING_MASK];
+    __atomic_store_n(&s->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    s->trace_id = trace_id;
+    s->name = name;
+    s->start_ns = start_ns;
+    s->dur_ns = end_ns > start_ns ? end_ns - start_ns : 0;
+    s->track = track;
+    size_t dlen = detail ? strnlen(detail, TRACE_DETAIL_LEN - 1) : 0;  // Dłuższy opis jest przycinany
+    if (dlen)
+        memcpy(s->detail, detail, dlen);
+    s->detail[dlen] = '\0';
+    __atomic_store_n(&s->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+/* ===================== Zrzut ===================== */
+// Wypisuje zawartość pierścienia jako JSON Chrome Trace Event (spany "X", czasy w us).
+// Zwraca liczbę wypisanych spanów.
+static int trace_dump_json(FILE *out) {
+    unsigned long end = __atomic_load_n(&trace_next, __ATOMIC_ACQUIRE);
+    unsigned long begin = end > TRACE_RING_SIZE ? end - TRACE_RING_SIZE : 0;
+    int written = 0;
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"battleship server\"}}");
+    for (unsigned long pos = begin; pos < end; pos++) {
+        TraceSpan *slot = &trace_ring[pos & TRACE_RING_MASK];
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1)
+            continue;  // W trakcie zapisu albo już nadpisana
+        TraceSpan s = *slot;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != pos + 1)
+            continue;
+        fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"shot\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                     "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"trace\":%llu,\"detail\":\"",
+                s.name, s.track, s.start_ns / 1000.0, s.dur_ns / 1000.0, s.trace_id);
+        for (const char *c = s.detail; *c; c++) {
+            if (*c == '"' || *c == '\\')
+                fputc('\\', out);
+            if ((unsigned char)*c >= 0x20)
+                fputc(*c, out);
+        }
+        fprintf(out, "\"}}");
+        written++;
+    }
+    fprintf(out, "\n]}\n");
+    return written;
+}
+
+#endif // SLEDZENIE_H
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca & Marcel Gacoń
+ * AGH - Programowanie sieciowe
+ */
+
+#ifndef ZEGAR_H
+#define ZEGAR_H
+
+/*
+ * Hierarchiczne koło czasowe (timing wheel).
+ *
+ * Cztery poziomy po 64 sloty; poziom 0 ma rozdzielczość jednego ticka,
+ * każdy kolejny jest 64 razy grubszy. Timery są węzłami list dwukierunkowych
+ * wbudowanymi w struktury właściciela (Client, ChatRoom), więc uzbrojenie
+ * i anulowanie to O(1) bez alokacji. Timery z wyższych poziomów są
+ * przesuwane (kaskada) na niższe, gdy poziom 0 zawinie się do slotu 0.
+ *
+ * Koło nie jest wątkowo bezpieczne - synchronizacja należy do wywołującego.
+ */
+
+/* ===================== Includy ===================== */
+#include <stddef.h>
+
+/* ===================== Definicje ===================== */
+#define TIMER_LEVELS     4
+#define TIMER_SLOT_BITS  6
+#define TIMER_SLOTS      (1 << TIMER_SLOT_BITS)   // 64 sloty na poziom
+#define TIMER_SLOT_MASK  (TIMER_SLOTS - 1)
+// Najdłuższy czas, jaki mieści się w kole bez ponownej kaskady (64^4 ticków)
+#define TIMER_MAX_TICKS  ((1ULL << (TIMER_LEVELS * TIMER_SLOT_BITS)) - 1)
+
+typedef struct Timer Timer;
+typedef void (*TimerCallback)(Timer *timer, void *arg);
+
+struct Timer {
+    Timer *next;                 // Węzeł listy slotu
+    Timer *prev;
+    unsigned long long expires;  // Tick, w którym timer ma się odpalić
+    TimerCallback callback;
+    void *arg;
+};
+
+typedef struct {
+    unsigned long long now;                     // Ostatni przetworzony tick
+    Timer slots[TIMER_LEVELS][TIMER_SLOTS];     // Głowy (wartowniki) list slotów
+} TimerWheel;
+
+/* ===================== Operacje na listach ===================== */
+static inline void timer_list_init(Timer *head) {
+    head->next = head;
+    head->prev = head;
+}
+
+static inline void timer_list_add(Timer *head, Timer *t) {
+    t->prev = head->prev;
+    t->next = head;
+    head->prev->next = t;
+    head->prev = t;
+}
+
+static inline void timer_list_del(Timer *t) {
+    t->prev->next = t->next;
+    t->next->prev = t->prev;
+    t->next = NULL;
+    t->prev = NULL;
+}
+
+/* ===================== API Koła ===================== */
+// Przygotowuje timer do użycia (nieuzbrojony)
+static inline void timer_init(Timer *t) {
+    t->next = NULL;
+    t->prev = NULL;
+    t->expires = 0;
+    t->callback = NULL;
+    t->arg = NULL;
+}
+
+static inline int timer_pending(const Timer *t) {
+    return t->next != NULL;
+}
+
+static void timer_wheel_init(TimerWheel *tw, unsigned long long now) {
+    tw->now = now;
+    for (int l = 0; l < TIMER_LEVELS; l++)
+        for (int s = 0; s < TIMER_SLOTS; s++)
+            timer_list_init(&tw->slots[l][s]);
+}
+
+// Wkłada timer do slotu odpowiadającego jego odległości od bieżącego ticka
+static void timer_wheel_place(TimerWheel *tw, Timer *t) {
+    unsigned long long delta = t->expires - tw->now;
+    int level = 0;
+    while (level < TIMER_LEVELS - 1 &&
+           delta >= (1ULL << ((level + 1) * TIMER_SLOT_BITS)))
+        level++;
+    if (delta > TIMER_MAX_TICKS) {
+        // Zbyt odległe - parkujemy w najdalszym slocie, kaskada wstawi ponownie
+        unsigned long long far = tw->now + TIMER_MAX_TICKS;
+        timer_list_add(&tw->slots[level][(far >> (level * TIMER_SLOT_BITS)) & TIMER_SLOT_MASK], t);
+        return;
+    }
+    int slot = (int)((t->expires >> (level * TIMER_SLOT_BITS)) & TIMER_SLOT_MASK);
+    timer_list_add(&tw->slots[level][slot], t);
+}
+
+// Uzbraja (lub przezbraja) timer na 'ticks' ticków od teraz - O(1)
+static void timer_wheel_arm(TimerWheel *tw, Timer *t, unsigned long long ticks,
+                            TimerCallback cb, void *arg) {
+    if (timer_pending(t))
+        timer_list_del(t);
+    if (ticks == 0)
+        ticks = 1;  // Slot bieżącego ticka został już przetworzony
+    t->expires = tw->now + ticks;
+    t->callback = cb;
+    t->arg = arg;
+    timer_wheel_place(tw, t);
+}
+
+// Anuluje timer, jeśli jest uzbrojony - O(1)
+static void timer_wheel_cancel(TimerWheel *tw, Timer *t) {
+    (void)tw;
+    if (timer_pending(t))
+        timer_list_del(t);
+}
+
+// Przenosi wszystkie timery ze slotu wyższego poziomu na niższe poziomy
+static int timer_wheel_cascade(TimerWheel *tw, int level) {
+    int slot = (int)((tw->now >> (level * TIMER_SLOT_BITS)) & TIMER_SLOT_MASK);
+    Timer pending;
+    timer_list_init(&pending);
+    Timer *head = &tw->slots[level][slot];
+    if (head->next != head) {
+        pending.next = head->next;
+        pending.prev = head->prev;
+        pending.next->prev = &pending;
+        pending.prev->next = &pending;
+        timer_list_init(head);
+    }
+    while (pending.next != &pending) {
+        Timer *t = pending.next;
+        timer_list_del(t);
+        timer_wheel_place(tw, t);
+    }
+    return slot;
+}
+
+// Przesuwa koło do ticka 'now', wywołując callbacki wszystkich wygasłych timerów.
+// Callback może bezpiecznie przezbroić lub anulować dowolny timer.
+static void timer_wheel_advance(TimerWheel *tw, unsigned long long now) {
+    while (tw->now < now) {
+        tw->now++;
+        int slot = (int)(tw->now & TIMER_SLOT_MASK);
+        if (slot == 0) {
+            for (int level = 1; level < TIMER_LEVELS; level++) {
+                if (timer_wheel_cascade(tw, level) != 0)
+                    break;
+            }
+        }
+
+        Timer expired;
+        timer_list_init(&expired);
+        Timer *head = &tw->slots[0][slot];
+        if (head->next == head)
+            continue;
+        expired.next = head->next;
+        expired.prev = head->prev;
+        expired.next->prev = &expired;
+        expired.prev->next = &expired;
+        timer_list_init(head);
+
+        while (expired.next != &expired) {
+            Timer *t = expired.next;
+            timer_list_del(t);
+            if (t->expires > tw->now) {
+                // Timer zaparkowany dalej niż zasięg koła - jeszcze nie jego czas
+                timer_wheel_place(tw, t);
+                continue;
+            }
+            if (t->callback)
+                t->callback(t, t->arg);
+        }
+    }
+}
+
+#endif // ZEGAR_H